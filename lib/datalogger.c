@@ -6,6 +6,7 @@
 
 #define _GNU_SOURCE  // Para strptime
 #include "datalogger.h"
+#include "thread_priority.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -14,6 +15,9 @@
 #include <sys/types.h>
 #include <unistd.h>
 #include <math.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <ctype.h>
 
 /**
  * @brief Cria diretório se não existir
@@ -32,6 +36,335 @@ static bool create_directory_if_not_exists(const char* path) {
     return true;
 }
 
+/**
+ * @brief Calcula CRC32 (IEEE 802.3) de um bloco de dados
+ */
+static uint32_t crc32_compute(const char* data, size_t len) {
+    static uint32_t table[256];
+    static bool table_ready = false;
+
+    if (!table_ready) {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+            }
+            table[i] = c;
+        }
+        table_ready = true;
+    }
+
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < len; i++) {
+        crc = table[(crc ^ (uint8_t)data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+/**
+ * @brief Verifica se uma linha do log TXT (sem o '\n') está íntegra
+ *
+ * Linhas de cabeçalho são aceitas como estão. Linhas de dados devem ter
+ * os 4 campos do formato R;Data Hora;TPrincipal;PA e, se houver um quinto
+ * campo, ele deve ser o CRC32 correto das colunas anteriores.
+ */
+static bool txt_line_is_valid(const char* line, size_t len) {
+    if (len == 0) return false;
+
+    for (size_t i = 0; i < len; i++) {
+        if (line[i] == '\0') return false;
+    }
+
+    if ((len >= 5 && strncmp(line, "NAME:", 5) == 0) ||
+        (len >= 2 && strncmp(line, "R;", 2) == 0)) {
+        return true;
+    }
+
+    if (!isdigit((unsigned char)line[0])) return false;
+
+    int separators = 0;
+    size_t last_sep = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (line[i] == ';') {
+            separators++;
+            last_sep = i;
+        }
+    }
+
+    if (separators == 3) return true;   // Linha sem CRC (log antigo ou CRC desabilitado)
+    if (separators != 4 || len - last_sep - 1 != 8) return false;
+
+    char crc_str[9];
+    memcpy(crc_str, line + last_sep + 1, 8);
+    crc_str[8] = '\0';
+    char* endptr = NULL;
+    unsigned long expected = strtoul(crc_str, &endptr, 16);
+    if (*endptr != '\0') return false;
+
+    return crc32_compute(line, last_sep) == (uint32_t)expected;
+}
+
+/**
+ * @brief Tempo monotônico em nanossegundos (medição de latência)
+ */
+static long long monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * @brief Hora do sistema em milissegundos desde epoch
+ */
+static long long realtime_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (long long)ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
+
+/**
+ * @brief Abre uma atualização das estatísticas (lado escritor do seqlock)
+ *
+ * Os escritores são serializados por ctx->lock (ou rodam em uma única
+ * thread); apenas os leitores (datalogger_get_stats) são concorrentes.
+ */
+static void stats_begin(datalogger_context_t* ctx) {
+    __atomic_store_n(&ctx->stats_seq, ctx->stats_seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Fecha uma atualização das estatísticas
+ */
+static void stats_end(datalogger_context_t* ctx) {
+    __atomic_store_n(&ctx->stats_seq, ctx->stats_seq + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Contabiliza uma escrita bem-sucedida em um destino
+ */
+static void stats_record_write(datalogger_context_t* ctx, datalogger_sink_t sink,
+                               uint32_t records, size_t bytes, long long latency_ns) {
+    datalogger_sink_stats_t* s = &ctx->stats.sinks[sink];
+
+    stats_begin(ctx);
+    s->records += records;
+    s->bytes_written += bytes;
+    s->last_commit_ms = realtime_ms();
+    s->write_latency[datalogger_latency_bucket(latency_ns)]++;
+    stats_end(ctx);
+}
+
+/**
+ * @brief Contabiliza uma falha de escrita em um destino
+ */
+static void stats_record_error(datalogger_context_t* ctx, datalogger_sink_t sink) {
+    stats_begin(ctx);
+    ctx->stats.sinks[sink].errors++;
+    stats_end(ctx);
+}
+
+/**
+ * @brief Contabiliza uma sincronização com o disco
+ */
+static void stats_record_sync(datalogger_context_t* ctx, datalogger_sink_t sink, long long latency_ns) {
+    datalogger_sink_stats_t* s = &ctx->stats.sinks[sink];
+
+    stats_begin(ctx);
+    s->syncs++;
+    s->sync_latency[datalogger_latency_bucket(latency_ns)]++;
+    stats_end(ctx);
+}
+
+/**
+ * @brief Limite superior (µs) do percentil informado em um histograma log2
+ */
+static unsigned long long histogram_percentile(const uint32_t* hist, double pct) {
+    uint64_t total = 0;
+    for (int i = 0; i < DATALOGGER_LATENCY_BUCKETS; i++) total += hist[i];
+    if (total == 0) return 0;
+
+    uint64_t target = (uint64_t)ceil((double)total * pct / 100.0);
+    uint64_t seen = 0;
+    for (int i = 0; i < DATALOGGER_LATENCY_BUCKETS; i++) {
+        seen += hist[i];
+        if (seen >= target) return 2ULL << i;
+    }
+    return 2ULL << (DATALOGGER_LATENCY_BUCKETS - 1);
+}
+
+bool datalogger_recover_txt_log(const char* path, datalogger_recovery_info_t* info) {
+    if (!path) return false;
+
+    int fd = open(path, O_RDWR);
+    if (fd < 0) {
+        fprintf(stderr, "Erro ao abrir %s para recuperação: %s\n", path, strerror(errno));
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        fprintf(stderr, "Erro ao obter tamanho de %s: %s\n", path, strerror(errno));
+        close(fd);
+        return false;
+    }
+
+    char buf[DATALOGGER_RECOVERY_WINDOW];
+    off_t end = st.st_size;     // Fim candidato dos dados válidos (exclusivo)
+    uint32_t lines_lost = 0;
+    bool partial_tail = false;
+
+    // Percorrer janelas a partir do fim até encontrar uma linha válida
+    while (end > 0) {
+        off_t win_start = end > DATALOGGER_RECOVERY_WINDOW ? end - DATALOGGER_RECOVERY_WINDOW : 0;
+        size_t n = (size_t)(end - win_start);
+
+        if (pread(fd, buf, n, win_start) != (ssize_t)n) {
+            fprintf(stderr, "Erro ao ler %s durante recuperação: %s\n", path, strerror(errno));
+            close(fd);
+            return false;
+        }
+
+        // Descartar bytes após a última quebra de linha (linha parcial)
+        size_t pos = n;
+        while (pos > 0 && buf[pos - 1] != '\n') pos--;
+        if (pos < n) partial_tail = true;
+
+        bool found = false;
+        bool refetch = false;
+        while (pos > 0) {
+            size_t line_end = pos - 1;
+            size_t line_start = line_end;
+            while (line_start > 0 && buf[line_start - 1] != '\n') line_start--;
+
+            // Início da linha fora da janela: reler com a janela terminando nesta linha
+            if (line_start == 0 && win_start > 0 && pos < n) {
+                refetch = true;
+                break;
+            }
+
+            if (txt_line_is_valid(buf + line_start, line_end - line_start)) {
+                found = true;
+                break;
+            }
+
+            lines_lost++;
+            pos = line_start;
+        }
+
+        end = win_start + (off_t)pos;
+        if (found || (!refetch && win_start == 0)) break;
+    }
+
+    if (partial_tail) lines_lost++;
+
+    if (info) {
+        info->original_size = (long)st.st_size;
+        info->recovered_size = (long)end;
+        info->bytes_lost = (long)(st.st_size - end);
+        info->lines_lost = lines_lost;
+        info->truncated = end < st.st_size;
+    }
+
+    if (end < st.st_size) {
+        if (ftruncate(fd, end) != 0) {
+            fprintf(stderr, "Erro ao truncar %s: %s\n", path, strerror(errno));
+            close(fd);
+            return false;
+        }
+        fsync(fd);
+    }
+
+    close(fd);
+    return true;
+}
+
+/**
+ * @brief Repara o log TXT mais recente do dispositivo deixado pela execução anterior
+ *
+ * Apenas o último arquivo pode ter ficado aberto durante uma queda de energia.
+ * Os nomes seguem o padrão NOME_AAAAMMDD_HHMMSS.txt, então a ordem
+ * lexicográfica coincide com a ordem cronológica.
+ */
+static void recover_previous_log(const datalogger_context_t* ctx) {
+    DIR* dir = opendir(DATALOGGER_LOG_DIR);
+    if (!dir) return;
+
+    char prefix[64];
+    snprintf(prefix, sizeof(prefix), "%s_", ctx->device_name);
+    size_t prefix_len = strlen(prefix);
+
+    char latest[256] = "";
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        size_t len = strlen(entry->d_name);
+        if (len <= prefix_len + 4 || strncmp(entry->d_name, prefix, prefix_len) != 0 ||
+            strcmp(entry->d_name + len - 4, ".txt") != 0) {
+            continue;
+        }
+        if (strcmp(entry->d_name, latest) > 0) {
+            strncpy(latest, entry->d_name, sizeof(latest) - 1);
+            latest[sizeof(latest) - 1] = '\0';
+        }
+    }
+    closedir(dir);
+
+    if (latest[0] == '\0') return;
+
+    char path[DATALOGGER_MAX_PATH];
+    snprintf(path, sizeof(path), "%s/%s", DATALOGGER_LOG_DIR, latest);
+
+    datalogger_recovery_info_t info;
+    if (!datalogger_recover_txt_log(path, &info)) return;
+
+    if (info.truncated) {
+        printf("⚠️  Log anterior reparado: %s\n", path);
+        printf("    %ld bytes descartados (%u linhas), novo tamanho: %ld bytes\n",
+               info.bytes_lost, info.lines_lost, info.recovered_size);
+    }
+}
+
+/**
+ * @brief Incorpora o WAL deixado por uma execução interrompida aos bancos anteriores
+ *
+ * Um banco fechado normalmente já está em journal DELETE. Se sobrou um
+ * -wal, reabrir o banco e voltar ao modo DELETE aplica o WAL ao arquivo
+ * principal, que passa a ser autocontido para cópia e arquivamento.
+ */
+static void recover_previous_databases(const datalogger_context_t* ctx) {
+    DIR* dir = opendir(DATALOGGER_LOG_DIR);
+    if (!dir) return;
+
+    char prefix[64];
+    snprintf(prefix, sizeof(prefix), "%s_", ctx->device_name);
+    size_t prefix_len = strlen(prefix);
+
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        size_t len = strlen(entry->d_name);
+        if (len <= prefix_len + 3 || strncmp(entry->d_name, prefix, prefix_len) != 0 ||
+            strcmp(entry->d_name + len - 3, ".db") != 0) {
+            continue;
+        }
+
+        char path[DATALOGGER_MAX_PATH];
+        char wal_path[DATALOGGER_MAX_PATH + 8];
+        snprintf(path, sizeof(path), "%s/%s", DATALOGGER_LOG_DIR, entry->d_name);
+        snprintf(wal_path, sizeof(wal_path), "%s-wal", path);
+        if (access(wal_path, F_OK) != 0) continue;
+
+        sqlite3* db = NULL;
+        if (sqlite3_open_v2(path, &db, SQLITE_OPEN_READWRITE, NULL) == SQLITE_OK &&
+            sqlite3_exec(db, "PRAGMA journal_mode=DELETE;", NULL, NULL, NULL) == SQLITE_OK) {
+            printf("⚠️  WAL pendente incorporado ao banco anterior: %s\n", path);
+        } else {
+            fprintf(stderr, "Erro ao recuperar WAL de %s: %s\n", path, sqlite3_errmsg(db));
+        }
+        sqlite3_close(db);
+    }
+    closedir(dir);
+}
+
 /**
  * @brief Executa comando hwclock para obter hora do RTC
  */
@@ -82,14 +415,27 @@ datalogger_context_t* datalogger_init(const char* device_name) {
     strncpy(ctx->device_name, device_name, sizeof(ctx->device_name) - 1);
     ctx->record_counter = 0;
     ctx->initialized = false;
+    ctx->txt_crc = DATALOGGER_TXT_CRC_ENABLED;
     ctx->log_file = NULL;
     ctx->db = NULL;
+    ctx->ring = NULL;
+    ctx->db_profile = (datalogger_db_profile_t)DATALOGGER_DB_PROFILE_DEFAULT;
+    ctx->db_schema_target = DATALOGGER_DB_SCHEMA_VERSION;
+    ctx->db_partitioned = DATALOGGER_DB_PARTITIONED;
+    strncpy(ctx->db_dir, DATALOGGER_LOG_DIR, sizeof(ctx->db_dir) - 1);
+    ctx->retention_months = DATALOGGER_RETENTION_MONTHS;
+    ctx->retention_min_free_mb = DATALOGGER_RETENTION_MIN_FREE_MB;
+    pthread_mutex_init(&ctx->lock, NULL);
     
     // Criar diretório de logs
     if (!create_directory_if_not_exists(DATALOGGER_LOG_DIR)) {
         free(ctx);
         return NULL;
     }
+
+    // Reparar final do log e do banco da execução anterior (se interrompida)
+    recover_previous_log(ctx);
+    recover_previous_databases(ctx);
     
     // Gerar nome do arquivo de log com timestamp
     time_t now = time(NULL);
@@ -106,17 +452,23 @@ datalogger_context_t* datalogger_init(const char* device_name) {
              tm_info->tm_min,
              tm_info->tm_sec);
 
-    // Gerar nome do arquivo de banco de dados
-    snprintf(ctx->db_file_path, sizeof(ctx->db_file_path),
-             "%s/%s_%04d%02d%02d_%02d%02d%02d.db",
-             DATALOGGER_LOG_DIR,
-             ctx->device_name,
-             tm_info->tm_year + 1900,
-             tm_info->tm_mon + 1,
-             tm_info->tm_mday,
-             tm_info->tm_hour,
-             tm_info->tm_min,
-             tm_info->tm_sec);
+    // Gerar nome do arquivo de banco de dados (partição mensal é definida ao abrir o banco)
+    if (!ctx->db_partitioned) {
+        snprintf(ctx->db_file_path, sizeof(ctx->db_file_path),
+                 "%s/%s_%04d%02d%02d_%02d%02d%02d.db",
+                 DATALOGGER_LOG_DIR,
+                 ctx->device_name,
+                 tm_info->tm_year + 1900,
+                 tm_info->tm_mon + 1,
+                 tm_info->tm_mday,
+                 tm_info->tm_hour,
+                 tm_info->tm_min,
+                 tm_info->tm_sec);
+    }
+    
+    // Anel binário é único por dispositivo e persiste entre execuções
+    snprintf(ctx->ring_file_path, sizeof(ctx->ring_file_path),
+             "%s/%s.ring", DATALOGGER_LOG_DIR, ctx->device_name);
     
     // Abrir arquivo de log
     ctx->log_file = fopen(ctx->log_file_path, "w");
@@ -139,6 +491,12 @@ datalogger_context_t* datalogger_init(const char* device_name) {
         printf("⚠️  Aviso: Falha ao inicializar banco SQLite (continuando apenas com TXT)\n");
     }
 
+    // Abrir anel binário de amostras brutas
+    ctx->ring = ring_store_open(ctx->ring_file_path, DATALOGGER_RING_CAPACITY, false);
+    if (!ctx->ring) {
+        printf("⚠️  Aviso: Falha ao abrir anel de amostras brutas (continuando sem ele)\n");
+    }
+
     ctx->initialized = true;
 
     printf("DataLogger inicializado:\n");
@@ -147,6 +505,9 @@ datalogger_context_t* datalogger_init(const char* device_name) {
     if (ctx->db) {
         printf("  Arquivo DB: %s\n", ctx->db_file_path);
     }
+    if (ctx->ring) {
+        printf("  Anel bruto: %s\n", ctx->ring_file_path);
+    }
     
     return ctx;
 }
@@ -163,18 +524,33 @@ void datalogger_cleanup(datalogger_context_t* ctx) {
     // Finalizar banco de dados
     datalogger_cleanup_database(ctx);
 
+    if (ctx->ring) {
+        ring_store_close(ctx->ring);
+        ctx->ring = NULL;
+    }
+
     printf("DataLogger finalizado. Total de registros: %u\n", ctx->record_counter);
+    pthread_mutex_destroy(&ctx->lock);
     free(ctx);
 }
 
 bool datalogger_create_header(datalogger_context_t* ctx) {
     if (!ctx || !ctx->log_file) return false;
     
+    long long start = monotonic_ns();
+
     // Escrever cabeçalho no formato solicitado
-    fprintf(ctx->log_file, "NAME: %s\n", ctx->device_name);
-    fprintf(ctx->log_file, "R;Data Hora;TPrincipal;PA\n");
+    int name_len = fprintf(ctx->log_file, "NAME: %s\n", ctx->device_name);
+    int cols_len = fprintf(ctx->log_file, ctx->txt_crc ? "R;Data Hora;TPrincipal;PA;CRC\n"
+                                                       : "R;Data Hora;TPrincipal;PA\n");
     
-    fflush(ctx->log_file);
+    if (name_len < 0 || cols_len < 0 || fflush(ctx->log_file) != 0) {
+        stats_record_error(ctx, DATALOGGER_SINK_TXT);
+        return false;
+    }
+
+    stats_record_write(ctx, DATALOGGER_SINK_TXT, 0, (size_t)(name_len + cols_len),
+                       monotonic_ns() - start);
     return true;
 }
 
@@ -232,20 +608,37 @@ bool datalogger_write_record(datalogger_context_t* ctx, const datalogger_record_
         strcpy(door_str, "ERROR");
     }
     
-    // Escrever registro no formato: R;Data Hora;TPrincipal;PA
-    fprintf(ctx->log_file, "%u;%s;%s;%s\n",
-            record->record_number,
-            datetime_str,
-            temp_str,
-            door_str);
-    
-    fflush(ctx->log_file);
+    // Montar registro no formato: R;Data Hora;TPrincipal;PA
+    char line[DATALOGGER_MAX_LINE];
+    int len = snprintf(line, sizeof(line), "%u;%s;%s;%s",
+                       record->record_number,
+                       datetime_str,
+                       temp_str,
+                       door_str);
+    if (len < 0 || (size_t)len >= sizeof(line) - 16) return false;
+
+    // Anexar CRC32 da linha para detecção de registros corrompidos
+    if (ctx->txt_crc) {
+        len += snprintf(line + len, sizeof(line) - len, ";%08X",
+                        crc32_compute(line, (size_t)len));
+    }
+    line[len++] = '\n';
+
+    long long start = monotonic_ns();
+    if (fwrite(line, 1, (size_t)len, ctx->log_file) != (size_t)len ||
+        fflush(ctx->log_file) != 0) {
+        stats_record_error(ctx, DATALOGGER_SINK_TXT);
+        return false;
+    }
+
+    stats_record_write(ctx, DATALOGGER_SINK_TXT, 1, (size_t)len, monotonic_ns() - start);
     return true;
 }
 
-bool datalogger_log_data(datalogger_context_t* ctx, const modbus_data_t* modbus_data) {
-    if (!ctx || !ctx->initialized || !modbus_data) return false;
-    
+/**
+ * @brief Registra dados nos destinos TXT e SQLite (chamador detém ctx->lock)
+ */
+static bool log_data_locked(datalogger_context_t* ctx, const modbus_data_t* modbus_data) {
     // Incrementar contador
     ctx->record_counter++;
     
@@ -262,8 +655,8 @@ bool datalogger_log_data(datalogger_context_t* ctx, const modbus_data_t* modbus_
         return false;
     }
 
-    // Escrever registro no banco SQLite (se disponível)
-    if (ctx->db) {
+    // Escrever registro no banco SQLite (se disponível; partições são reabertas na inserção)
+    if (ctx->db || ctx->db_partitioned) {
         datalogger_db_record_t db_record;
         if (datalogger_convert_to_db_record(&record, &db_record)) {
             if (!datalogger_insert_db_record(ctx, &db_record)) {
@@ -275,11 +668,94 @@ bool datalogger_log_data(datalogger_context_t* ctx, const modbus_data_t* modbus_
     return true;
 }
 
+bool datalogger_log_data(datalogger_context_t* ctx, const modbus_data_t* modbus_data) {
+    if (!ctx || !ctx->initialized || !modbus_data) return false;
+
+    pthread_mutex_lock(&ctx->lock);
+    bool ok = log_data_locked(ctx, modbus_data);
+    pthread_mutex_unlock(&ctx->lock);
+    return ok;
+}
+
+bool datalogger_log_raw(datalogger_context_t* ctx, const modbus_data_t* modbus_data) {
+    if (!ctx || !ctx->initialized || !ctx->ring || !modbus_data) return false;
+
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    ring_store_record_t raw;
+    memset(&raw, 0, sizeof(raw));
+    raw.timestamp_ms = (int64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+    raw.slave_id = MODBUS_SLAVE_ID;
+
+    pthread_mutex_lock(&ctx->lock);
+    long long start = monotonic_ns();
+
+    raw.register_id = MODBUS_ADDR_0x200;
+    raw.value = modbus_data->addr_0x200;
+    raw.flags = modbus_data->valid_0x200 ? RING_FLAG_VALID : 0;
+    bool ok = ring_store_append(ctx->ring, &raw);
+
+    raw.register_id = MODBUS_ADDR_0x20D;
+    raw.value = modbus_data->addr_0x20d;
+    raw.flags = modbus_data->valid_0x20d ? RING_FLAG_VALID : 0;
+    ok = ring_store_append(ctx->ring, &raw) && ok;
+
+    if (ok) {
+        stats_record_write(ctx, DATALOGGER_SINK_RING, 2, 2 * sizeof(raw), monotonic_ns() - start);
+    } else {
+        stats_record_error(ctx, DATALOGGER_SINK_RING);
+    }
+
+    pthread_mutex_unlock(&ctx->lock);
+    return ok;
+}
+
 void datalogger_sync(datalogger_context_t* ctx) {
-    if (ctx && ctx->log_file) {
+    if (!ctx) return;
+
+    pthread_mutex_lock(&ctx->lock);
+    if (ctx->log_file) {
+        long long start = monotonic_ns();
         fflush(ctx->log_file);
         fsync(fileno(ctx->log_file));
+        stats_record_sync(ctx, DATALOGGER_SINK_TXT, monotonic_ns() - start);
+    }
+    if (ctx->ring) {
+        long long start = monotonic_ns();
+        ring_store_sync(ctx->ring);
+        stats_record_sync(ctx, DATALOGGER_SINK_RING, monotonic_ns() - start);
+    }
+    pthread_mutex_unlock(&ctx->lock);
+}
+
+bool datalogger_get_stats(const datalogger_context_t* ctx, datalogger_stats_t* out) {
+    if (!ctx || !out) return false;
+
+    // Repetir a cópia enquanto um escritor estiver no meio de uma atualização
+    uint32_t seq;
+    do {
+        seq = __atomic_load_n(&ctx->stats_seq, __ATOMIC_ACQUIRE);
+        memcpy(out, &ctx->stats, sizeof(*out));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while ((seq & 1) || seq != __atomic_load_n(&ctx->stats_seq, __ATOMIC_RELAXED));
+
+    // Bytes e sincronizações do banco em uso são medidos no VFS (inclui journal/WAL);
+    // catálogo, bancos anexados e snapshots têm contadores próprios
+    if (ctx->db) {
+        char path[DATALOGGER_MAX_PATH];
+        memcpy(path, ctx->db_file_path, sizeof(path));
+        path[sizeof(path) - 1] = '\0';
+        datalogger_vfs_counters_t vfs;
+        datalogger_vfs_get_db_counters(path, &vfs);
+
+        datalogger_sink_stats_t* db = &out->sinks[DATALOGGER_SINK_DB];
+        db->bytes_written = vfs.bytes_written;
+        db->syncs = vfs.syncs;
+        memcpy(db->sync_latency, vfs.sync_latency, sizeof(db->sync_latency));
     }
+
+    return true;
 }
 
 bool datalogger_get_log_info(datalogger_context_t* ctx, long* file_size, uint32_t* record_count) {
@@ -289,11 +765,11 @@ bool datalogger_get_log_info(datalogger_context_t* ctx, long* file_size, uint32_
         *record_count = ctx->record_counter;
     }
     
-    if (file_size && ctx->log_file) {
-        long current_pos = ftell(ctx->log_file);
-        fseek(ctx->log_file, 0, SEEK_END);
-        *file_size = ftell(ctx->log_file);
-        fseek(ctx->log_file, current_pos, SEEK_SET);
+    // O arquivo TXT é sempre criado vazio: o tamanho é o total de bytes escritos
+    if (file_size) {
+        datalogger_stats_t stats;
+        datalogger_get_stats(ctx, &stats);
+        *file_size = (long)stats.sinks[DATALOGGER_SINK_TXT].bytes_written;
     }
     
     return true;
@@ -306,212 +782,2743 @@ void datalogger_print_stats(datalogger_context_t* ctx) {
     uint32_t record_count = 0;
     
     datalogger_get_log_info(ctx, &file_size, &record_count);
+
+    datalogger_stats_t stats;
+    datalogger_get_stats(ctx, &stats);
+    static const char* sink_names[DATALOGGER_SINK_COUNT] = { "TXT", "DB", "Anel" };
     
     printf("=== Estatísticas do DataLogger ===\n");
     printf("Dispositivo: %s\n", ctx->device_name);
     printf("Arquivo: %s\n", ctx->log_file_path);
     printf("Registros: %u\n", record_count);
     printf("Tamanho do arquivo: %ld bytes\n", file_size);
+
+    for (int i = 0; i < DATALOGGER_SINK_COUNT; i++) {
+        const datalogger_sink_stats_t* s = &stats.sinks[i];
+        if (s->records == 0 && s->errors == 0) continue;
+
+        printf("[%s] registros: %llu, bytes: %llu, erros: %llu, syncs: %llu\n",
+               sink_names[i],
+               (unsigned long long)s->records,
+               (unsigned long long)s->bytes_written,
+               (unsigned long long)s->errors,
+               (unsigned long long)s->syncs);
+        printf("[%s] escrita p50/p99: <%llu/<%llu µs, sync p50/p99: <%llu/<%llu µs\n",
+               sink_names[i],
+               histogram_percentile(s->write_latency, 50.0),
+               histogram_percentile(s->write_latency, 99.0),
+               histogram_percentile(s->sync_latency, 50.0),
+               histogram_percentile(s->sync_latency, 99.0));
+    }
     printf("==================================\n");
 }
 
-/**
- * @brief Inicializa o banco de dados SQLite
- */
-bool datalogger_init_database(datalogger_context_t* ctx) {
-    if (!ctx) return false;
+// Esquema v1: temperatura REAL arredondada, leituras inválidas gravadas como 0
+#define DATA_TABLE_SQL \
+    "CREATE TABLE IF NOT EXISTS DataGrpData (" \
+    "IndexID INTEGER PRIMARY KEY AUTOINCREMENT," \
+    "CollectTime INTEGER NOT NULL," \
+    "Tprincipal REAL NOT NULL," \
+    "Porta INTEGER NOT NULL" \
+    ");"
 
-    // Abrir banco de dados
-    int rc = sqlite3_open(ctx->db_file_path, &ctx->db);
-    if (rc != SQLITE_OK) {
-        fprintf(stderr, "Erro ao abrir banco SQLite: %s\n", sqlite3_errmsg(ctx->db));
-        sqlite3_close(ctx->db);
-        ctx->db = NULL;
-        return false;
-    }
+// Linha v1 que pode ser falha de leitura (temperatura e porta gravadas como 0):
+// sem Flags, não se distingue de 0,0 °C com porta fechada e é tratada como falha
+#define DATA_FAILED_SQL(alias) "(" alias "Tprincipal = 0 AND " alias "Porta = 0)"
 
-    // Criar tabelas
-    if (!datalogger_create_tables(ctx)) {
-        sqlite3_close(ctx->db);
-        ctx->db = NULL;
-        return false;
-    }
+#define DATA_INDEX_SQL \
+    "CREATE INDEX IF NOT EXISTS idx_DataGrpData_CollectTime ON DataGrpData (CollectTime);"
 
-    printf("📊 Banco SQLite inicializado: %s\n", ctx->db_file_path);
-    return true;
-}
+// Esquema v2: temperatura bruta em décimos de °C (NULL se inválida), validade
+// e porta em Flags (bits TS_FLAG_*), sem AUTOINCREMENT (sem escrita em
+// sqlite_sequence por registro). Novos canais entram como colunas anuláveis
+// no fim da tabela (ALTER TABLE ADD COLUMN não reescreve linhas) e bits
+// livres de Flags.
+#define SAMPLES_TABLE_SQL \
+    "CREATE TABLE IF NOT EXISTS DataGrpSamples (" \
+    "IndexID INTEGER PRIMARY KEY," \
+    "CollectTime INTEGER NOT NULL," \
+    "Temp INTEGER," \
+    "Flags INTEGER NOT NULL" \
+    ");"
 
-/**
- * @brief Cria as tabelas do banco de dados
- */
-bool datalogger_create_tables(datalogger_context_t* ctx) {
-    if (!ctx || !ctx->db) return false;
+#define SAMPLES_INDEX_SQL \
+    "CREATE INDEX IF NOT EXISTS idx_DataGrpSamples_CollectTime ON DataGrpSamples (CollectTime);"
 
-    char* err_msg = NULL;
+// Layout do v1 para leitores existentes (1 = TS_FLAG_TEMP_VALID, 6 = porta válida e aberta)
+#define SAMPLES_COMPAT_VIEW_SQL \
+    "CREATE VIEW IF NOT EXISTS DataGrpData AS SELECT IndexID, CollectTime, " \
+    "CASE WHEN Flags & 1 THEN ROUND(Temp / 10.0, 2) ELSE 0.0 END AS Tprincipal, " \
+    "CASE WHEN (Flags & 6) = 6 THEN 1 ELSE 0 END AS Porta " \
+    "FROM DataGrpSamples;"
 
-    // Criar tabela principal DataGrpData (sem coluna Degelo)
-    const char* create_data_table =
-        "CREATE TABLE IF NOT EXISTS DataGrpData ("
-        "IndexID INTEGER PRIMARY KEY AUTOINCREMENT,"
-        "CollectTime INTEGER NOT NULL,"
-        "Tprincipal REAL NOT NULL,"
-        "Porta INTEGER NOT NULL"
-        ");";
+// Passo de migração do esquema: leva um banco de version - 1 para version
+typedef struct {
+    int version;
+    const char* sql;
+} schema_migration_t;
 
-    int rc = sqlite3_exec(ctx->db, create_data_table, NULL, NULL, &err_msg);
-    if (rc != SQLITE_OK) {
-        fprintf(stderr, "Erro ao criar tabela DataGrpData: %s\n", err_msg);
-        sqlite3_free(err_msg);
-        return false;
-    }
+static const schema_migration_t schema_migrations[] = {
+    // v1 -> v2: IndexID preservado (MaxID/MinID continuam válidos); linhas
+    // 0,0 / porta 0 (DATA_FAILED_SQL) são migradas como leitura inválida
+    { DATALOGGER_DB_SCHEMA_V2,
+      SAMPLES_TABLE_SQL
+      "INSERT INTO DataGrpSamples (IndexID, CollectTime, Temp, Flags) "
+      "SELECT IndexID, CollectTime, "
+      "CASE WHEN " DATA_FAILED_SQL("") " THEN NULL ELSE CAST(ROUND(Tprincipal * 10) AS INTEGER) END, "
+      "CASE WHEN " DATA_FAILED_SQL("") " THEN 0 WHEN Porta THEN 7 ELSE 3 END "
+      "FROM DataGrpData ORDER BY IndexID;"
+      "DROP TABLE DataGrpData;"
+      "DELETE FROM sqlite_sequence WHERE name = 'DataGrpData';"
+      SAMPLES_INDEX_SQL
+      SAMPLES_COMPAT_VIEW_SQL },
+};
 
-    // Criar tabela de informações DBInfo
-    const char* create_info_table =
-        "CREATE TABLE IF NOT EXISTS DBInfo ("
-        "version INTEGER DEFAULT 1,"
-        "MaxID INTEGER DEFAULT 0,"
-        "MinID INTEGER DEFAULT 0,"
-        "StartTime INTEGER DEFAULT 0,"
-        "EndTime INTEGER DEFAULT 0,"
-        "Value0 INTEGER DEFAULT 0,"
-        "Value1 INTEGER DEFAULT 0,"
-        "Value2 INTEGER DEFAULT 0,"
-        "Value3 INTEGER DEFAULT 0,"
-        "Value4 INTEGER DEFAULT 0"
-        ");";
+// Tabelas de agregados (mesmo esquema para hora e dia)
+#define ROLLUP_TABLE_SQL(table) \
+    "CREATE TABLE IF NOT EXISTS " table " (" \
+    "BucketStart INTEGER PRIMARY KEY," \
+    "Count INTEGER NOT NULL," \
+    "TMin REAL," \
+    "TMax REAL," \
+    "TSum REAL," \
+    "DoorOpenCount INTEGER NOT NULL," \
+    "DoorOpenMs INTEGER NOT NULL," \
+    "FirstTime INTEGER," \
+    "LastTime INTEGER" \
+    ");"
 
-    rc = sqlite3_exec(ctx->db, create_info_table, NULL, NULL, &err_msg);
-    if (rc != SQLITE_OK) {
-        fprintf(stderr, "Erro ao criar tabela DBInfo: %s\n", err_msg);
-        sqlite3_free(err_msg);
-        return false;
-    }
+// Acumula uma amostra (?2 = 1) ou apenas tempo de porta aberta (?2 = 0, demais NULL)
+#define ROLLUP_UPSERT_SQL(table) \
+    "INSERT INTO " table " (BucketStart, Count, TMin, TMax, TSum, DoorOpenCount, DoorOpenMs, " \
+    "FirstTime, LastTime) VALUES (?1, ?2, ROUND(?3, 2), ROUND(?3, 2), ROUND(?3, 2), ?4, ?6, ?5, ?5) " \
+    "ON CONFLICT(BucketStart) DO UPDATE SET " \
+    "Count = Count + excluded.Count," \
+    "TMin = MIN(COALESCE(TMin, excluded.TMin), COALESCE(excluded.TMin, TMin))," \
+    "TMax = MAX(COALESCE(TMax, excluded.TMax), COALESCE(excluded.TMax, TMax))," \
+    "TSum = COALESCE(TSum, 0) + COALESCE(excluded.TSum, 0)," \
+    "DoorOpenCount = DoorOpenCount + excluded.DoorOpenCount," \
+    "DoorOpenMs = DoorOpenMs + excluded.DoorOpenMs," \
+    "FirstTime = MIN(COALESCE(FirstTime, excluded.FirstTime), COALESCE(excluded.FirstTime, FirstTime))," \
+    "LastTime = MAX(COALESCE(LastTime, excluded.LastTime), COALESCE(excluded.LastTime, LastTime));"
 
-    // Inserir registro inicial na DBInfo se não existir
-    const char* init_info =
-        "INSERT OR IGNORE INTO DBInfo (rowid, version, StartTime) "
-        "SELECT 1, 1, strftime('%s', 'now') * 1000 "
-        "WHERE NOT EXISTS (SELECT 1 FROM DBInfo);";
+// Mesma ordem de colunas da consulta agregada de DataGrpData, mais DoorOpenMs
+#define ROLLUP_QUERY_SQL(table) \
+    "SELECT BucketStart, FirstTime, LastTime, Count, DoorOpenCount, TMin, TMax, " \
+    "TSum / NULLIF(Count, 0), DoorOpenMs FROM " table " " \
+    "WHERE BucketStart BETWEEN ?1 AND ?2 ORDER BY BucketStart;"
 
-    rc = sqlite3_exec(ctx->db, init_info, NULL, NULL, &err_msg);
-    if (rc != SQLITE_OK) {
-        fprintf(stderr, "Erro ao inicializar DBInfo: %s\n", err_msg);
-        sqlite3_free(err_msg);
-        return false;
-    }
+// Consultas por intervalo em DataGrpData (schema vazio ou "part." para partições anexadas)
+#define QUERY_RAW_SQL(schema) \
+    "SELECT CollectTime, Tprincipal, Porta FROM " schema "DataGrpData " \
+    "WHERE CollectTime BETWEEN ?1 AND ?2 ORDER BY CollectTime;"
+
+#define QUERY_BUCKETS_SQL(schema) \
+    "SELECT CollectTime / ?3 * ?3 AS Bucket, MIN(CollectTime), MAX(CollectTime), COUNT(*), " \
+    "SUM(Porta), MIN(Tprincipal), MAX(Tprincipal), AVG(Tprincipal) FROM " schema "DataGrpData " \
+    "WHERE CollectTime BETWEEN ?1 AND ?2 GROUP BY Bucket ORDER BY Bucket;"
 
+// SQL do cache de statements (índices de datalogger_stmt_id_t)
+static const char* const stmt_sql[DATALOGGER_STMT_COUNT] = {
+    [DATALOGGER_STMT_INSERT_DATA] =
+        "INSERT INTO DataGrpData (CollectTime, Tprincipal, Porta) "
+        "VALUES (?, ROUND(?, 2), ?);",
+    [DATALOGGER_STMT_UPDATE_INFO] =
+        "UPDATE DBInfo SET MaxID = ?, MinID = ?, EndTime = ? WHERE rowid = 1;",
+    [DATALOGGER_STMT_BEGIN] = "BEGIN;",
+    [DATALOGGER_STMT_COMMIT] = "COMMIT;",
+    [DATALOGGER_STMT_ROLLBACK] = "ROLLBACK;",
+    [DATALOGGER_STMT_SAVEPOINT] = "SAVEPOINT rec;",
+    [DATALOGGER_STMT_RELEASE] = "RELEASE rec;",
+    [DATALOGGER_STMT_ROLLBACK_TO] = "ROLLBACK TO rec;",
+    [DATALOGGER_STMT_QUERY_RAW] = QUERY_RAW_SQL(""),
+    [DATALOGGER_STMT_QUERY_BUCKETS] = QUERY_BUCKETS_SQL(""),
+    [DATALOGGER_STMT_ROLLUP_HOURLY] = ROLLUP_UPSERT_SQL("RollupHourly"),
+    [DATALOGGER_STMT_ROLLUP_DAILY] = ROLLUP_UPSERT_SQL("RollupDaily"),
+    [DATALOGGER_STMT_QUERY_HOURLY] = ROLLUP_QUERY_SQL("RollupHourly"),
+    [DATALOGGER_STMT_QUERY_DAILY] = ROLLUP_QUERY_SQL("RollupDaily"),
+};
+
+// Mesmas consultas sobre uma partição selada anexada à conexão do catálogo
+#define PART_SCHEMA DATALOGGER_CATALOG_ATTACH_NAME "."
+static const char* const partition_query_sql[DATALOGGER_STMT_COUNT] = {
+    [DATALOGGER_STMT_QUERY_RAW] = QUERY_RAW_SQL(PART_SCHEMA),
+    [DATALOGGER_STMT_QUERY_BUCKETS] = QUERY_BUCKETS_SQL(PART_SCHEMA),
+    [DATALOGGER_STMT_QUERY_HOURLY] = ROLLUP_QUERY_SQL(PART_SCHEMA "RollupHourly"),
+    [DATALOGGER_STMT_QUERY_DAILY] = ROLLUP_QUERY_SQL(PART_SCHEMA "RollupDaily"),
+};
+
+// Statements que mudam no esquema v2 (demais vêm de stmt_sql)
+static const char* const stmt_sql_v2[DATALOGGER_STMT_COUNT] = {
+    [DATALOGGER_STMT_INSERT_DATA] =
+        "INSERT INTO DataGrpSamples (CollectTime, Temp, Flags) VALUES (?, ?, ?);",
+};
+
+/**
+ * @brief Prepara todos os statements do cache
+ */
+static bool prepare_statements(datalogger_context_t* ctx) {
+    for (int i = 0; i < DATALOGGER_STMT_COUNT; i++) {
+        const char* sql = ctx->db_schema >= DATALOGGER_DB_SCHEMA_V2 && stmt_sql_v2[i]
+                              ? stmt_sql_v2[i] : stmt_sql[i];
+        int rc = sqlite3_prepare_v3(ctx->db, sql, -1, SQLITE_PREPARE_PERSISTENT,
+                                    &ctx->stmts[i], NULL);
+        if (rc != SQLITE_OK) {
+            fprintf(stderr, "Erro ao preparar statement %d: %s\n", i, sqlite3_errmsg(ctx->db));
+            return false;
+        }
+    }
     return true;
 }
 
 /**
- * @brief Converte registro TXT para registro do banco
+ * @brief Finaliza todos os statements do cache
  */
-bool datalogger_convert_to_db_record(const datalogger_record_t* txt_record,
-                                    datalogger_db_record_t* db_record) {
-    if (!txt_record || !db_record) return false;
+static void finalize_statements(datalogger_context_t* ctx) {
+    for (int i = 0; i < DATALOGGER_STMT_COUNT; i++) {
+        sqlite3_finalize(ctx->stmts[i]);
+        ctx->stmts[i] = NULL;
+    }
+}
 
-    // Limpar estrutura
-    memset(db_record, 0, sizeof(datalogger_db_record_t));
+/**
+ * @brief Executa um statement do cache e o deixa pronto para o próximo uso
+ * @return Código de retorno de sqlite3_step
+ */
+static int step_statement(datalogger_context_t* ctx, datalogger_stmt_id_t id) {
+    sqlite3_stmt* stmt = ctx->stmts[id];
+    if (!stmt) return SQLITE_MISUSE;
 
-    // Converter timestamp para milissegundos
-    time_t timestamp = mktime((struct tm*)&txt_record->timestamp);
-    db_record->CollectTime = (long long)timestamp * 1000;
+    int rc = sqlite3_step(stmt);
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+    return rc;
+}
 
-    // Converter temperatura (dividir por 10 e arredondar para 2 casas decimais)
-    if (txt_record->temp_valid) {
-        float temp_celsius = txt_record->temperature / 10.0f;
-        db_record->Tprincipal = roundf(temp_celsius * 100.0f) / 100.0f;  // 2 casas decimais
-    } else {
-        db_record->Tprincipal = 0.0f;  // Valor padrão para erro
+/**
+ * @brief Carrega MaxID/MinID a partir de DataGrpData (executado uma vez ao abrir o banco)
+ */
+static bool reconcile_db_info(datalogger_context_t* ctx) {
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(ctx->db, "SELECT MIN(IndexID), MAX(IndexID) FROM DataGrpData;",
+                           -1, &stmt, NULL) != SQLITE_OK) {
+        fprintf(stderr, "Erro ao consultar DataGrpData: %s\n", sqlite3_errmsg(ctx->db));
+        return false;
     }
 
-    // Status da porta
-    if (txt_record->door_valid) {
-        db_record->Porta = txt_record->door_open ? 1 : 0;
+    ctx->db_min_id = 0;
+    ctx->db_max_id = 0;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        ctx->db_min_id = sqlite3_column_int64(stmt, 0);
+        ctx->db_max_id = sqlite3_column_int64(stmt, 1);
+    }
+    sqlite3_finalize(stmt);
+
+    // Último registro em ordem de CollectTime (bancos consolidados recebem
+    // registros antigos com IndexID maior): início do trecho de porta aberta
+    // ainda não contabilizado. No v2, o estado da porta vem da última
+    // leitura válida (Flags & 2); no v1, da última linha que não é falha
+    ctx->db_last_time = 0;
+    ctx->db_last_porta = -1;
+    const char* last_sql = ctx->db_schema >= DATALOGGER_DB_SCHEMA_V2
+        ? "SELECT CollectTime, (SELECT (Flags & 6) = 6 FROM DataGrpSamples WHERE Flags & 2 "
+          "ORDER BY CollectTime DESC, IndexID DESC LIMIT 1) FROM DataGrpSamples "
+          "ORDER BY CollectTime DESC, IndexID DESC LIMIT 1;"
+        : "SELECT CollectTime, (SELECT Porta FROM DataGrpData WHERE NOT " DATA_FAILED_SQL("")
+          " ORDER BY CollectTime DESC, IndexID DESC LIMIT 1) FROM DataGrpData "
+          "ORDER BY CollectTime DESC, IndexID DESC LIMIT 1;";
+    if (sqlite3_prepare_v2(ctx->db, last_sql, -1, &stmt, NULL) != SQLITE_OK) {
+        fprintf(stderr, "Erro ao consultar DataGrpData: %s\n", sqlite3_errmsg(ctx->db));
+        return false;
+    }
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        ctx->db_last_time = sqlite3_column_int64(stmt, 0);
+        if (sqlite3_column_type(stmt, 1) != SQLITE_NULL) {
+            ctx->db_last_porta = sqlite3_column_int(stmt, 1);
+        }
+    }
+    sqlite3_finalize(stmt);
+    return true;
+}
+
+/**
+ * @brief Início do intervalo de agregação que contém t_ms e início do seguinte
+ */
+static long long rollup_bucket(datalogger_rollup_t level, long long t_ms, long long* next_ms) {
+    const long long hour_ms = 3600 * 1000LL;
+
+    if (level == DATALOGGER_ROLLUP_HOURLY) {
+        long long start = t_ms - ((t_ms % hour_ms) + hour_ms) % hour_ms;
+        *next_ms = start + hour_ms;
+        return start;
+    }
+
+    // Dia local: mktime normaliza tm_mday + 1 na virada de mês/ano
+    time_t secs = (time_t)(t_ms / 1000);
+    struct tm tm_day;
+    localtime_r(&secs, &tm_day);
+    tm_day.tm_hour = 0;
+    tm_day.tm_min = 0;
+    tm_day.tm_sec = 0;
+    tm_day.tm_isdst = -1;
+    long long start = (long long)mktime(&tm_day) * 1000;
+    tm_day.tm_mday += 1;
+    tm_day.tm_isdst = -1;
+    *next_ms = (long long)mktime(&tm_day) * 1000;
+    return start;
+}
+
+/**
+ * @brief Estado da porta em um registro: 1 aberta, 0 fechada, -1 leitura inválida
+ */
+static int record_door_state(const datalogger_db_record_t* rec) {
+    if (!(rec->Flags & TS_FLAG_DOOR_VALID)) return -1;
+    return (rec->Flags & TS_FLAG_DOOR_OPEN) ? 1 : 0;
+}
+
+/**
+ * @brief Acumula uma amostra (rec != NULL) ou tempo de porta aberta em um intervalo
+ *
+ * Apenas leituras válidas (rec->Flags) entram nos agregados: temperatura
+ * inválida não conta em Count/TMin/TMax/TSum e porta inválida não conta
+ * como aberta.
+ */
+static bool rollup_add(datalogger_context_t* ctx, datalogger_rollup_t level, long long bucket,
+                       const datalogger_db_record_t* rec, long long door_open_ms) {
+    datalogger_stmt_id_t id = level == DATALOGGER_ROLLUP_HOURLY ? DATALOGGER_STMT_ROLLUP_HOURLY
+                                                                : DATALOGGER_STMT_ROLLUP_DAILY;
+    sqlite3_stmt* stmt = ctx->stmts[id];
+    if (!stmt) return false;
+
+    sqlite3_bind_int64(stmt, 1, bucket);
+    sqlite3_bind_int64(stmt, 6, door_open_ms);
+    if (rec) {
+        bool temp_valid = (rec->Flags & TS_FLAG_TEMP_VALID) != 0;
+        sqlite3_bind_int(stmt, 2, temp_valid ? 1 : 0);
+        if (temp_valid) {
+            sqlite3_bind_double(stmt, 3, rec->Tprincipal);
+        } else {
+            sqlite3_bind_null(stmt, 3);
+        }
+        sqlite3_bind_int(stmt, 4, record_door_state(rec) == 1 ? 1 : 0);
+        sqlite3_bind_int64(stmt, 5, rec->CollectTime);
     } else {
-        db_record->Porta = 0;  // Valor padrão para erro
+        sqlite3_bind_int(stmt, 2, 0);
+        sqlite3_bind_null(stmt, 3);
+        sqlite3_bind_int(stmt, 4, 0);
+        sqlite3_bind_null(stmt, 5);
+    }
+
+    return step_statement(ctx, id) == SQLITE_DONE;
+}
+
+/**
+ * @brief Soma aos agregados o tempo de porta aberta entre o último registro e until_ms
+ *
+ * Se a porta estava aberta no registro anterior, o trecho é somado ao
+ * tempo de porta aberta de cada intervalo que ele atravessa.
+ */
+static bool rollup_apply_door(datalogger_context_t* ctx, long long until_ms) {
+    if (ctx->db_last_porta != 1 || until_ms <= ctx->db_last_time) return true;
+
+    for (int level = 0; level < DATALOGGER_ROLLUP_COUNT; level++) {
+        long long t = ctx->db_last_time;
+        while (t < until_ms) {
+            long long next;
+            long long bucket = rollup_bucket((datalogger_rollup_t)level, t, &next);
+            long long until = next < until_ms ? next : until_ms;
+            if (!rollup_add(ctx, (datalogger_rollup_t)level, bucket, NULL, until - t)) return false;
+            t = until;
+        }
     }
 
+    ctx->db_last_time = until_ms;
     return true;
 }
 
 /**
- * @brief Insere registro no banco de dados
+ * @brief Atualiza os agregados com um novo registro
+ *
+ * O tempo de porta aberta desde o registro anterior é contabilizado e em
+ * seguida a amostra é acumulada no seu intervalo. Uma leitura inválida da
+ * porta mantém o último estado válido: uma falha de comunicação com a
+ * porta aberta não encerra o tempo de porta aberta.
  */
-bool datalogger_insert_db_record(datalogger_context_t* ctx,
-                                const datalogger_db_record_t* db_record) {
-    if (!ctx || !ctx->db || !db_record) return false;
+static bool rollup_apply_record(datalogger_context_t* ctx, const datalogger_db_record_t* rec) {
+    if (!rollup_apply_door(ctx, rec->CollectTime)) return false;
 
-    const char* sql =
-        "INSERT INTO DataGrpData (CollectTime, Tprincipal, Porta) "
-        "VALUES (?, ROUND(?, 2), ?);";
+    int door = record_door_state(rec);
+    if ((rec->Flags & TS_FLAG_TEMP_VALID) || door >= 0) {
+        for (int level = 0; level < DATALOGGER_ROLLUP_COUNT; level++) {
+            long long next;
+            long long bucket = rollup_bucket((datalogger_rollup_t)level, rec->CollectTime, &next);
+            if (!rollup_add(ctx, (datalogger_rollup_t)level, bucket, rec, 0)) return false;
+        }
+    }
 
-    sqlite3_stmt* stmt;
-    int rc = sqlite3_prepare_v2(ctx->db, sql, -1, &stmt, NULL);
-    if (rc != SQLITE_OK) {
-        fprintf(stderr, "Erro ao preparar statement: %s\n", sqlite3_errmsg(ctx->db));
+    ctx->db_last_time = rec->CollectTime;
+    if (door >= 0) {
+        ctx->db_last_porta = door;
+    }
+    return true;
+}
+
+/**
+ * @brief Aplica os PRAGMAs do perfil de durabilidade e de memória
+ */
+static bool apply_db_profile(datalogger_context_t* ctx) {
+    const datalogger_db_profile_t* p = &ctx->db_profile;
+    char sql[512];
+    char* err_msg = NULL;
+
+    if (p->page_size > 0 &&
+        (p->page_size < 512 || p->page_size > 65536 || (p->page_size & (p->page_size - 1)) != 0)) {
+        fprintf(stderr, "Erro: page_size inválido no perfil do banco: %u\n", p->page_size);
+        return false;
+    }
+    if (p->temp_store < 0 || p->temp_store > 2) {
+        fprintf(stderr, "Erro: temp_store inválido no perfil do banco: %d\n", p->temp_store);
         return false;
     }
 
-    // Bind dos parâmetros
-    sqlite3_bind_int64(stmt, 1, db_record->CollectTime);
-    sqlite3_bind_double(stmt, 2, db_record->Tprincipal);
-    sqlite3_bind_int(stmt, 3, db_record->Porta);
+    // page_size antes do journal: só tem efeito enquanto o banco está vazio
+    int len = 0;
+    if (p->page_size > 0) {
+        len += snprintf(sql + len, sizeof(sql) - len, "PRAGMA page_size=%u; ", p->page_size);
+    }
+    len += snprintf(sql + len, sizeof(sql) - len, "PRAGMA journal_mode=%s; PRAGMA synchronous=%d; ",
+                    p->journal_mode, p->synchronous);
+    if (p->cache_kb > 0) {
+        len += snprintf(sql + len, sizeof(sql) - len, "PRAGMA cache_size=-%u; ", p->cache_kb);
+    }
+    if (p->mmap_bytes > 0) {
+        len += snprintf(sql + len, sizeof(sql) - len, "PRAGMA mmap_size=%u; ", p->mmap_bytes);
+    }
+    if (p->temp_store > 0) {
+        len += snprintf(sql + len, sizeof(sql) - len, "PRAGMA temp_store=%d; ", p->temp_store);
+    }
+    if (p->journal_limit_kb > 0) {
+        snprintf(sql + len, sizeof(sql) - len, "PRAGMA journal_size_limit=%llu;",
+                 (unsigned long long)p->journal_limit_kb * 1024);
+    }
 
-    // Executar
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    if (sqlite3_exec(ctx->db, sql, NULL, NULL, &err_msg) != SQLITE_OK) {
+        fprintf(stderr, "Erro ao aplicar perfil do banco: %s\n", err_msg);
+        sqlite3_free(err_msg);
+        return false;
+    }
+
+    if (p->checkpoint_pages > 0) {
+        sqlite3_wal_autocheckpoint(ctx->db, p->checkpoint_pages);
+    }
+    return true;
+}
+
+/**
+ * @brief Abre a transação de lote se ainda não houver uma
+ * @return Código de retorno de sqlite3_step (SQLITE_DONE em caso de sucesso)
+ */
+static int begin_batch(datalogger_context_t* ctx) {
+    if (ctx->db_txn_open) return SQLITE_DONE;
+
+    int rc = step_statement(ctx, DATALOGGER_STMT_BEGIN);
+    if (rc == SQLITE_DONE) {
+        ctx->db_txn_open = true;
+        ctx->db_txn_rows = 0;
+        ctx->db_txn_start_ns = monotonic_ns();
+    }
+    return rc;
+}
+
+/**
+ * @brief Confirma a transação de lote aberta (chamador detém ctx->lock)
+ */
+static bool commit_batch(datalogger_context_t* ctx) {
+    if (!ctx->db || !ctx->db_txn_open) return true;
+
+    int rc = step_statement(ctx, DATALOGGER_STMT_COMMIT);
+    ctx->db_txn_open = false;
+    ctx->db_txn_rows = 0;
 
     if (rc != SQLITE_DONE) {
-        fprintf(stderr, "Erro ao inserir registro: %s\n", sqlite3_errmsg(ctx->db));
+        fprintf(stderr, "Erro ao confirmar lote no banco: %s\n", sqlite3_errmsg(ctx->db));
+        if (!sqlite3_get_autocommit(ctx->db)) {
+            step_statement(ctx, DATALOGGER_STMT_ROLLBACK);
+        }
+        // Registros do lote foram descartados: recarregar MaxID/MinID
+        reconcile_db_info(ctx);
+        stats_record_error(ctx, DATALOGGER_SINK_DB);
         return false;
     }
 
-    // Atualizar informações do banco
-    datalogger_update_db_info(ctx);
-
     return true;
 }
 
 /**
- * @brief Atualiza informações do banco (tabela DBInfo)
+ * @brief Verifica se o lote aberto atingiu o limite de registros ou de tempo
  */
-bool datalogger_update_db_info(datalogger_context_t* ctx) {
-    if (!ctx || !ctx->db) return false;
+static bool batch_is_due(const datalogger_context_t* ctx) {
+    if (!ctx->db_txn_open || ctx->db_export_hold) return false;
 
-    const char* sql =
-        "UPDATE DBInfo SET "
-        "MaxID = (SELECT MAX(IndexID) FROM DataGrpData),"
-        "MinID = (SELECT MIN(IndexID) FROM DataGrpData),"
-        "EndTime = strftime('%s', 'now') * 1000 "
-        "WHERE rowid = 1;";
+    if (ctx->db_txn_rows >= ctx->db_profile.batch_rows) return true;
+    return ctx->db_profile.batch_seconds > 0 &&
+           monotonic_ns() - ctx->db_txn_start_ns >= (long long)ctx->db_profile.batch_seconds * 1000000000LL;
+}
 
-    char* err_msg = NULL;
-    int rc = sqlite3_exec(ctx->db, sql, NULL, NULL, &err_msg);
+static bool rebuild_rollups_locked(datalogger_context_t* ctx);
 
+/**
+ * @brief Abre db_file_path, aplica o perfil e prepara o cache de statements
+ *
+ * Na troca de partição o chamador detém ctx->lock; na inicialização ainda
+ * não há outras threads.
+ */
+static bool open_database(datalogger_context_t* ctx) {
+    // Abrir banco de dados através do VFS de contagem (padrão do SQLite se indisponível)
+    const char* vfs = datalogger_vfs_register() == SQLITE_OK ? DATALOGGER_VFS_NAME : NULL;
+    int rc = sqlite3_open_v2(ctx->db_file_path, &ctx->db,
+                             SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, vfs);
     if (rc != SQLITE_OK) {
-        fprintf(stderr, "Erro ao atualizar DBInfo: %s\n", err_msg);
-        sqlite3_free(err_msg);
+        fprintf(stderr, "Erro ao abrir banco SQLite: %s\n", sqlite3_errmsg(ctx->db));
+        sqlite3_close(ctx->db);
+        ctx->db = NULL;
+        return false;
+    }
+
+    if (!ctx->db_profile.journal_mode) {
+        ctx->db_profile = (datalogger_db_profile_t)DATALOGGER_DB_PROFILE_DEFAULT;
+    }
+    if (ctx->db_profile.batch_rows == 0) {
+        ctx->db_profile.batch_rows = 1;
+    }
+
+    // Criar tabelas e preparar statements reutilizados a cada registro
+    if (!apply_db_profile(ctx) || !datalogger_create_tables(ctx) ||
+        !prepare_statements(ctx) || !reconcile_db_info(ctx) ||
+        (ctx->rollup_rebuild && !rebuild_rollups_locked(ctx))) {
+        finalize_statements(ctx);
+        sqlite3_close(ctx->db);
+        ctx->db = NULL;
         return false;
     }
 
+    printf("📊 Banco SQLite inicializado: %s\n", ctx->db_file_path);
     return true;
 }
 
 /**
- * @brief Finaliza o banco de dados SQLite
+ * @brief Confirma o lote, atualiza DBInfo e fecha o banco aberto
  */
-void datalogger_cleanup_database(datalogger_context_t* ctx) {
+static void close_database(datalogger_context_t* ctx) {
+    if (!ctx->db) return;
+
+    // Confirmar lote pendente e atualizar informações finais
+    commit_batch(ctx);
+    datalogger_update_db_info(ctx);
+    finalize_statements(ctx);
+
+    // Journal DELETE deixa o .db autocontido (sem -wal/-shm) após o fechamento
+    sqlite3_exec(ctx->db, "PRAGMA journal_mode=DELETE;", NULL, NULL, NULL);
+
+    // Fechar banco
+    sqlite3_close(ctx->db);
+    ctx->db = NULL;
+
+    printf("📊 Banco SQLite finalizado\n");
+}
+
+/**
+ * @brief Nome do arquivo da partição aberta
+ */
+static void live_partition_name(const datalogger_context_t* ctx, char* out, size_t len) {
+    datalogger_partition_name(ctx->device_name, ctx->db_part_start, out, len);
+}
+
+/**
+ * @brief Grava no catálogo o intervalo de tempo da partição aberta
+ */
+static void record_live_partition(datalogger_context_t* ctx) {
+    if (!ctx->catalog || !ctx->db) return;
+
+    datalogger_partition_t part;
+    memset(&part, 0, sizeof(part));
+    live_partition_name(ctx, part.name, sizeof(part.name));
+    part.period_start = ctx->db_part_start;
+    part.period_end = ctx->db_part_end;
+    if (datalogger_partition_measure(ctx->db, &part)) {
+        datalogger_catalog_record(ctx->catalog, &part);
+    }
+}
+
+/**
+ * @brief Remove partições antigas conforme a política de retenção
+ *
+ * A idade é contada a partir do mês da partição aberta, e não do relógio,
+ * para que um RTC adiantado não descarte meses ainda recentes.
+ */
+static void enforce_retention(datalogger_context_t* ctx) {
+    ctx->retention_checked = time(NULL);
+    if (!ctx->catalog || (ctx->retention_months <= 0 && ctx->retention_min_free_mb == 0)) return;
+
+    char live[64] = "";
+    if (ctx->db) {
+        live_partition_name(ctx, live, sizeof(live));
+    }
+    datalogger_catalog_enforce_retention(ctx->catalog, ctx->db ? live : NULL,
+                                         ctx->db ? ctx->db_part_start : realtime_ms(),
+                                         ctx->db ? ctx->retention_months : 0,
+                                         (unsigned long long)ctx->retention_min_free_mb * 1024 * 1024);
+}
+
+/**
+ * @brief Abre a partição do mês que contém t_ms
+ */
+static bool open_partition(datalogger_context_t* ctx, long long t_ms) {
+    char name[64];
+    datalogger_partition_period(t_ms, &ctx->db_part_start, &ctx->db_part_end);
+    live_partition_name(ctx, name, sizeof(name));
+    if (snprintf(ctx->db_file_path, sizeof(ctx->db_file_path), "%s/%s", ctx->db_dir, name) >=
+        (int)sizeof(ctx->db_file_path)) {
+        fprintf(stderr, "Erro: caminho da partição muito longo: %s/%s\n", ctx->db_dir, name);
+        return false;
+    }
+
+    if (!open_database(ctx)) return false;
+    record_live_partition(ctx);
+    return true;
+}
+
+/**
+ * @brief Fecha a partição aberta e grava seu intervalo final no catálogo
+ */
+static void close_partition(datalogger_context_t* ctx) {
+    if (!ctx->db) return;
+
+    datalogger_partition_t part;
+    memset(&part, 0, sizeof(part));
+    live_partition_name(ctx, part.name, sizeof(part.name));
+    part.period_start = ctx->db_part_start;
+    part.period_end = ctx->db_part_end;
+
+    // Medir após confirmar o lote; gravar após fechar (tamanho final do arquivo)
+    commit_batch(ctx);
+    bool measured = datalogger_partition_measure(ctx->db, &part);
+    close_database(ctx);
+
+    if (ctx->catalog && measured) {
+        datalogger_catalog_record(ctx->catalog, &part);
+    }
+}
+
+/**
+ * @brief Troca para a partição do mês que contém t_ms (chamador detém ctx->lock)
+ *
+ * Com a porta aberta na virada do mês, o tempo até o fim do mês fica nos
+ * agregados da partição antiga e a nova começa com a porta aberta.
+ */
+static bool rotate_partition(datalogger_context_t* ctx, long long t_ms) {
+    long long old_end = ctx->db_part_end;
+    bool carry = ctx->db && ctx->db_last_porta == 1 && t_ms >= old_end;
+
+    if (carry) {
+        carry = begin_batch(ctx) == SQLITE_DONE &&
+                step_statement(ctx, DATALOGGER_STMT_SAVEPOINT) == SQLITE_DONE;
+        if (carry && !rollup_apply_door(ctx, old_end)) {
+            step_statement(ctx, DATALOGGER_STMT_ROLLBACK_TO);
+            carry = false;
+        }
+        step_statement(ctx, DATALOGGER_STMT_RELEASE);
+    }
+
+    close_partition(ctx);
+    if (!open_partition(ctx, t_ms)) return false;
+
+    if (carry && ctx->db_max_id == 0 && ctx->db_part_start == old_end) {
+        ctx->db_last_time = ctx->db_part_start;
+        ctx->db_last_porta = 1;
+    }
+
+    printf("📅 Nova partição mensal: %s\n", ctx->db_file_path);
+    enforce_retention(ctx);
+    return true;
+}
+
+/**
+ * @brief Inicializa o banco de dados SQLite
+ */
+bool datalogger_init_database(datalogger_context_t* ctx) {
+    if (!ctx) return false;
+    if (!ctx->db_partitioned) return open_database(ctx);
+
+    if (!ctx->catalog) {
+        ctx->catalog = datalogger_catalog_open(ctx->db_dir, ctx->device_name);
+        if (!ctx->catalog) {
+            printf("⚠️  Aviso: Catálogo de partições indisponível (consultas apenas no mês atual)\n");
+        }
+    }
+
+    if (!open_partition(ctx, realtime_ms())) return false;
+
+    // Reconciliar o catálogo com o diretório (partições copiadas, apagadas ou não fechadas)
+    if (ctx->catalog) {
+        char live[64];
+        live_partition_name(ctx, live, sizeof(live));
+        int count = datalogger_catalog_scan(ctx->catalog, live);
+        enforce_retention(ctx);
+        printf("📅 Partições mensais no catálogo: %d\n", count);
+    }
+    return true;
+}
+
+bool datalogger_db_flush(datalogger_context_t* ctx) {
+    if (!ctx) return false;
+
+    pthread_mutex_lock(&ctx->lock);
+    bool ok = commit_batch(ctx);
+    pthread_mutex_unlock(&ctx->lock);
+    return ok;
+}
+
+void datalogger_db_flush_if_due(datalogger_context_t* ctx) {
     if (!ctx) return;
 
+    pthread_mutex_lock(&ctx->lock);
+    if (batch_is_due(ctx)) {
+        commit_batch(ctx);
+    }
+    if (ctx->catalog && !ctx->db_export_hold &&
+        time(NULL) - ctx->retention_checked >= DATALOGGER_RETENTION_CHECK_SECONDS) {
+        enforce_retention(ctx);
+    }
+    pthread_mutex_unlock(&ctx->lock);
+}
+
+bool datalogger_db_begin_export(datalogger_context_t* ctx) {
+    if (!ctx) return false;
+
+    pthread_mutex_lock(&ctx->lock);
+    bool ok = true;
     if (ctx->db) {
-        // Atualizar informações finais
-        datalogger_update_db_info(ctx);
+        ok = commit_batch(ctx);
 
-        // Fechar banco
-        sqlite3_close(ctx->db);
-        ctx->db = NULL;
+        // Voltar ao journal DELETE aplica o WAL e remove -wal/-shm; sem
+        // cache_spill, páginas do lote aberto durante a cópia ficam em memória
+        // em vez de irem para o .db antes da confirmação
+        if (ok && sqlite3_exec(ctx->db, "PRAGMA journal_mode=DELETE; PRAGMA cache_spill=OFF;",
+                               NULL, NULL, NULL) != SQLITE_OK) {
+            fprintf(stderr, "Erro ao preparar banco para exportação: %s\n", sqlite3_errmsg(ctx->db));
+            ok = false;
+        }
+        ctx->db_export_hold = true;
+    }
+    pthread_mutex_unlock(&ctx->lock);
+    return ok;
+}
+
+void datalogger_db_end_export(datalogger_context_t* ctx) {
+    if (!ctx) return;
+
+    pthread_mutex_lock(&ctx->lock);
+    if (ctx->db) {
+        ctx->db_export_hold = false;
+        commit_batch(ctx);
+        sqlite3_exec(ctx->db, "PRAGMA cache_spill=ON;", NULL, NULL, NULL);
+        apply_db_profile(ctx);
+    }
+    pthread_mutex_unlock(&ctx->lock);
+}
+
+/**
+ * @brief Sincroniza um arquivo ou diretório com o disco
+ */
+static bool fsync_path(const char* path, int flags) {
+    int fd = open(path, flags);
+    if (fd < 0) return false;
+    bool ok = fsync(fd) == 0;
+    close(fd);
+    return ok;
+}
+
+/**
+ * @brief Copia o banco em uso para dest com a API de backup, um passo por vez sob ctx->lock
+ *
+ * Lote confirmado antes: a cópia inclui todos os registros aceitos até aqui.
+ * Confirmações ficam adiadas durante a cópia (cada uma a reiniciaria).
+ * @param steps Recebe o número de passos
+ * @return SQLITE_OK ou o código de erro do SQLite
+ */
+static int snapshot_backup(datalogger_context_t* ctx, sqlite3* dest, datalogger_snapshot_cb_t progress,
+                           void* user, int* steps) {
+    char src_path[DATALOGGER_MAX_PATH];
+    pthread_mutex_lock(&ctx->lock);
+    bool prev_hold = ctx->db_export_hold;
+    bool ok = ctx->db && commit_batch(ctx);
+    if (ok) ctx->db_export_hold = true;
+    snprintf(src_path, sizeof(src_path), "%s", ctx->db_file_path);
+    pthread_mutex_unlock(&ctx->lock);
+    if (!ok) return SQLITE_ERROR;
+
+    // Conexão própria e sem o VFS de contagem: a cópia não entra nas estatísticas do banco
+    sqlite3* src = NULL;
+    sqlite3_backup* backup = NULL;
+    int rc = sqlite3_open_v2(src_path, &src, SQLITE_OPEN_READONLY, NULL);
+    if (rc == SQLITE_OK) {
+        sqlite3_busy_timeout(src, 1000);
+        backup = sqlite3_backup_init(dest, "main", src, "main");
+        if (!backup) rc = sqlite3_errcode(dest);
+    }
+
+    uint64_t page_size = 0;
+    sqlite3_stmt* stmt;
+    if (rc == SQLITE_OK && sqlite3_prepare_v2(src, "PRAGMA page_size;", -1, &stmt, NULL) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            page_size = (uint64_t)sqlite3_column_int64(stmt, 0);
+        }
+        sqlite3_finalize(stmt);
+    }
+
+    *steps = 0;
+    int busy_retries = 0;
+    while (backup) {
+        // Um passo por vez sob o lock: o escritor espera no máximo um passo
+        pthread_mutex_lock(&ctx->lock);
+        rc = sqlite3_backup_step(backup, DATALOGGER_SNAPSHOT_STEP_PAGES);
+        pthread_mutex_unlock(&ctx->lock);
+        (*steps)++;
+
+        if (progress && page_size > 0) {
+            uint64_t total = (uint64_t)sqlite3_backup_pagecount(backup);
+            uint64_t remaining = (uint64_t)sqlite3_backup_remaining(backup);
+            progress((total - remaining) * page_size, total * page_size, user);
+        }
+
+        if (rc == SQLITE_BUSY || rc == SQLITE_LOCKED) {
+            if (++busy_retries > 100) break;
+            sqlite3_sleep(10);
+            continue;
+        }
+        if (rc != SQLITE_OK) break;
+    }
+
+    if (backup) {
+        int finish_rc = sqlite3_backup_finish(backup);
+        if (rc == SQLITE_DONE) rc = finish_rc;
+    }
+
+    pthread_mutex_lock(&ctx->lock);
+    ctx->db_export_hold = prev_hold;
+    if (batch_is_due(ctx)) commit_batch(ctx);
+    pthread_mutex_unlock(&ctx->lock);
+
+    if (rc != SQLITE_OK) {
+        fprintf(stderr, "Erro no snapshot do banco: %s\n", backup ? sqlite3_errmsg(dest) : sqlite3_errmsg(src));
+    }
+    sqlite3_close(src);
+    return rc;
+}
+
+bool datalogger_snapshot(datalogger_context_t* ctx, const char* dest_path,
+                         datalogger_snapshot_cb_t progress, void* user) {
+    if (!ctx || !dest_path) return false;
+
+    char tmp_path[DATALOGGER_MAX_PATH + 8];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", dest_path);
+    unlink(tmp_path);
+
+    long long start = monotonic_ns();
+    sqlite3* dest = NULL;
+    int steps = 0;
+    int rc = sqlite3_open_v2(tmp_path, &dest, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, NULL);
+    if (rc == SQLITE_OK) {
+        // Arquivo temporário: durabilidade garantida pelo fsync antes da renomeação
+        rc = sqlite3_exec(dest, "PRAGMA journal_mode=OFF; PRAGMA synchronous=OFF;", NULL, NULL, NULL);
+    }
+    if (rc == SQLITE_OK) {
+        rc = snapshot_backup(ctx, dest, progress, user, &steps);
+    } else {
+        fprintf(stderr, "Erro no snapshot do banco: %s\n", sqlite3_errmsg(dest));
+    }
+
+    // Origem em WAL marca o cabeçalho copiado como WAL: voltar ao journal DELETE
+    if (rc == SQLITE_OK) {
+        rc = sqlite3_exec(dest, "PRAGMA journal_mode=DELETE;", NULL, NULL, NULL);
+        if (rc != SQLITE_OK) {
+            fprintf(stderr, "Erro no snapshot do banco: %s\n", sqlite3_errmsg(dest));
+        }
+    }
+    sqlite3_close(dest);
+
+    // Conteúdo no disco antes da renomeação; diretório depois, para a renomeação ser durável
+    char dest_dir[DATALOGGER_MAX_PATH];
+    snprintf(dest_dir, sizeof(dest_dir), "%s", dest_path);
+    char* slash = strrchr(dest_dir, '/');
+    if (slash) {
+        *(slash == dest_dir ? slash + 1 : slash) = '\0';
+    } else {
+        snprintf(dest_dir, sizeof(dest_dir), ".");
+    }
+
+    bool ok = rc == SQLITE_OK && fsync_path(tmp_path, O_RDONLY) && rename(tmp_path, dest_path) == 0;
+    if (ok) {
+        fsync_path(dest_dir, O_RDONLY | O_DIRECTORY);
+    } else {
+        if (rc == SQLITE_OK) {
+            fprintf(stderr, "Erro ao gravar snapshot em %s: %s\n", dest_path, strerror(errno));
+        }
+        unlink(tmp_path);
+        return false;
+    }
+
+    struct stat st;
+    printf("💾 Snapshot do banco: %s (%lld bytes, %d passos, %lld ms)\n", dest_path,
+           stat(dest_path, &st) == 0 ? (long long)st.st_size : 0LL, steps,
+           (monotonic_ns() - start) / 1000000);
+    return true;
+}
+
+long long datalogger_snapshot_stream(datalogger_context_t* ctx, datalogger_snapshot_sink_t sink, void* user) {
+    if (!ctx || !sink) return -1;
+
+    // Banco em memória com o tamanho de página da origem (backup para banco
+    // em memória exige páginas iguais)
+    long long start = monotonic_ns();
+    sqlite3* dest = NULL;
+    int steps = 0;
+    char sql[64];
+    pthread_mutex_lock(&ctx->lock);
+    int page_size = 0;
+    sqlite3_stmt* stmt;
+    if (ctx->db && sqlite3_prepare_v2(ctx->db, "PRAGMA page_size;", -1, &stmt, NULL) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) page_size = sqlite3_column_int(stmt, 0);
+        sqlite3_finalize(stmt);
+    }
+    pthread_mutex_unlock(&ctx->lock);
+    snprintf(sql, sizeof(sql), "PRAGMA page_size=%d;", page_size);
+
+    int rc = page_size > 0 ? sqlite3_open(":memory:", &dest) : SQLITE_ERROR;
+    if (rc == SQLITE_OK) rc = sqlite3_exec(dest, sql, NULL, NULL, NULL);
+    if (rc == SQLITE_OK) rc = snapshot_backup(ctx, dest, NULL, NULL, &steps);
+
+    sqlite3_int64 size = 0;
+    unsigned char* data = rc == SQLITE_OK ? sqlite3_serialize(dest, "main", &size, 0) : NULL;
+    sqlite3_close(dest);
+    if (!data) {
+        if (rc == SQLITE_OK) fprintf(stderr, "Erro no snapshot do banco: sem memória (%lld bytes)\n", (long long)size);
+        return -1;
+    }
+
+    // Origem em WAL: cabeçalho copiado volta ao journal DELETE (versões de
+    // escrita/leitura do formato, bytes 18 e 19)
+    if (size >= 100) {
+        data[18] = 1;
+        data[19] = 1;
+    }
+
+    long long delivered = 0;
+    while (delivered < size) {
+        size_t len = size - delivered < DATALOGGER_SNAPSHOT_CHUNK_BYTES
+            ? (size_t)(size - delivered) : DATALOGGER_SNAPSHOT_CHUNK_BYTES;
+        if (sink(data + delivered, len, user) != 0) break;
+        delivered += (long long)len;
+    }
+    sqlite3_free(data);
+    if (delivered < size) return -1;
+
+    printf("💾 Snapshot do banco em fluxo: %lld bytes, %d passos, %lld ms\n", delivered, steps,
+           (monotonic_ns() - start) / 1000000);
+    return delivered;
+}
+
+bool datalogger_export_csv(datalogger_context_t* ctx, const char* dest_path, long long from_ms,
+                           long long to_ms, bool gzip, datalogger_csv_stats_t* stats) {
+    if (!ctx || !dest_path || from_ms > to_ms) return false;
+
+    // Sob o lock, apenas o lote confirmado e a lista de bancos do intervalo
+    pthread_mutex_lock(&ctx->lock);
+    bool ok = (ctx->db || ctx->catalog) && (!ctx->db || commit_batch(ctx));
+    datalogger_partition_t* parts = NULL;
+    int count = 0;
+    char live[64] = "";
+    if (ok && ctx->catalog) {
+        count = datalogger_catalog_find(ctx->catalog, from_ms, to_ms, &parts);
+        ok = count >= 0;
+        if (ctx->db) {
+            live_partition_name(ctx, live, sizeof(live));
+        }
+    }
+
+    // Banco em uso na posição do seu mês, como em query_partitions()
+    char (*paths)[DATALOGGER_MAX_PATH + 64] = ok ? malloc(((size_t)count + 1) * sizeof(*paths)) : NULL;
+    int sources = 0;
+    if (paths) {
+        bool live_pending = ctx->db != NULL &&
+            (!ctx->catalog || (ctx->db_part_start <= to_ms && ctx->db_part_end > from_ms));
+        for (int i = 0; i < count; i++) {
+            if (strcmp(parts[i].name, live) == 0) continue;
+            if (live_pending && ctx->db_part_start < parts[i].period_start) {
+                live_pending = false;
+                snprintf(paths[sources++], sizeof(paths[0]), "%s", ctx->db_file_path);
+            }
+            snprintf(paths[sources++], sizeof(paths[0]), "%s/%s", ctx->db_dir, parts[i].name);
+        }
+        if (live_pending) {
+            snprintf(paths[sources++], sizeof(paths[0]), "%s", ctx->db_file_path);
+        }
+    }
+    pthread_mutex_unlock(&ctx->lock);
+    free(parts);
+    if (!paths) return false;
+
+    // Conexões próprias e sem o VFS de contagem: a leitura não entra nas estatísticas do banco
+    datalogger_csv_t* csv = datalogger_csv_open(dest_path, gzip);
+    ok = csv != NULL;
+    for (int i = 0; i < sources && ok; i++) {
+        sqlite3* db = NULL;
+        ok = sqlite3_open_v2(paths[i], &db, SQLITE_OPEN_READONLY, NULL) == SQLITE_OK;
+        if (ok) {
+            sqlite3_busy_timeout(db, 1000);
+            ok = datalogger_csv_write_db(csv, db, from_ms, to_ms) >= 0;
+        } else {
+            fprintf(stderr, "Erro ao abrir %s para CSV: %s\n", paths[i], sqlite3_errmsg(db));
+        }
+        sqlite3_close(db);
+    }
+    free(paths);
+
+    datalogger_csv_stats_t result;
+    ok = csv && datalogger_csv_close(csv, ok, &result) && ok;
+    if (!ok) return false;
+
+    printf("📄 Planilha CSV: %s (%lld registros de %d bancos, %.1f MB de CSV, %.1f MB gravados, %lld ms)\n",
+           dest_path, result.rows, result.sources, result.csv_bytes / (1024.0 * 1024.0),
+           result.file_bytes / (1024.0 * 1024.0), result.elapsed_ms);
+    if (stats) *stats = result;
+    return true;
+}
+
+/**
+ * @brief Lê DBInfo.version (-1 se não há registro)
+ */
+static int read_schema_version(sqlite3* db) {
+    sqlite3_stmt* stmt;
+    int version = -1;
+    if (sqlite3_prepare_v2(db, "SELECT version FROM DBInfo WHERE rowid = 1;", -1, &stmt, NULL) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            version = sqlite3_column_int(stmt, 0);
+        }
+        sqlite3_finalize(stmt);
+    }
+    return version;
+}
+
+/**
+ * @brief Aplica em ordem os passos de migração acima de from até to
+ *
+ * Cada passo roda em uma transação própria junto com a atualização de
+ * DBInfo.version, então uma falha deixa o banco na última versão completa.
+ */
+static bool migrate_schema(datalogger_context_t* ctx, int from, int to) {
+    for (size_t i = 0; i < sizeof(schema_migrations) / sizeof(schema_migrations[0]); i++) {
+        const schema_migration_t* m = &schema_migrations[i];
+        if (m->version <= from || m->version > to) continue;
+
+        long long start = monotonic_ns();
+        char set_version[64];
+        snprintf(set_version, sizeof(set_version), "UPDATE DBInfo SET version = %d WHERE rowid = 1;",
+                 m->version);
+
+        char* err_msg = NULL;
+        int rc = sqlite3_exec(ctx->db, "BEGIN;", NULL, NULL, &err_msg);
+        if (rc == SQLITE_OK) rc = sqlite3_exec(ctx->db, m->sql, NULL, NULL, &err_msg);
+        if (rc == SQLITE_OK) rc = sqlite3_exec(ctx->db, set_version, NULL, NULL, &err_msg);
+        if (rc == SQLITE_OK) rc = sqlite3_exec(ctx->db, "COMMIT;", NULL, NULL, &err_msg);
+
+        if (rc != SQLITE_OK) {
+            fprintf(stderr, "Erro ao migrar banco para o esquema v%d: %s\n", m->version,
+                    err_msg ? err_msg : sqlite3_errmsg(ctx->db));
+            sqlite3_free(err_msg);
+            if (!sqlite3_get_autocommit(ctx->db)) {
+                sqlite3_exec(ctx->db, "ROLLBACK;", NULL, NULL, NULL);
+            }
+            return false;
+        }
+
+        printf("🔧 Banco migrado para o esquema v%d em %lld ms\n", m->version,
+               (monotonic_ns() - start) / 1000000);
+    }
+    return true;
+}
+
+/**
+ * @brief Cria as tabelas do banco de dados
+ */
+bool datalogger_create_tables(datalogger_context_t* ctx) {
+    if (!ctx || !ctx->db) return false;
+
+    char* err_msg = NULL;
+    int target = ctx->db_schema_target > 0 ? ctx->db_schema_target : DATALOGGER_DB_SCHEMA_VERSION;
+
+    // Banco novo: sem DataGrpData (tabela no v1, visão no v2)
+    sqlite3_stmt* exists_stmt;
+    bool fresh = true;
+    if (sqlite3_prepare_v2(ctx->db, "SELECT 1 FROM sqlite_master WHERE name = 'DataGrpData';",
+                           -1, &exists_stmt, NULL) == SQLITE_OK) {
+        fresh = sqlite3_step(exists_stmt) != SQLITE_ROW;
+        sqlite3_finalize(exists_stmt);
+    }
+
+    // Criar tabela de informações DBInfo
+    const char* create_info_table =
+        "CREATE TABLE IF NOT EXISTS DBInfo ("
+        "version INTEGER DEFAULT 1,"
+        "MaxID INTEGER DEFAULT 0,"
+        "MinID INTEGER DEFAULT 0,"
+        "StartTime INTEGER DEFAULT 0,"
+        "EndTime INTEGER DEFAULT 0,"
+        "Value0 INTEGER DEFAULT 0,"
+        "Value1 INTEGER DEFAULT 0,"
+        "Value2 INTEGER DEFAULT 0,"
+        "Value3 INTEGER DEFAULT 0,"
+        "Value4 INTEGER DEFAULT 0"
+        ");";
+
+    int rc = sqlite3_exec(ctx->db, create_info_table, NULL, NULL, &err_msg);
+    if (rc != SQLITE_OK) {
+        fprintf(stderr, "Erro ao criar tabela DBInfo: %s\n", err_msg);
+        sqlite3_free(err_msg);
+        return false;
+    }
+
+    // Inserir registro inicial na DBInfo se não existir (bancos antigos sem DBInfo são v1)
+    char init_info[160];
+    snprintf(init_info, sizeof(init_info),
+             "INSERT OR IGNORE INTO DBInfo (rowid, version, StartTime) "
+             "SELECT 1, %d, strftime('%%s', 'now') * 1000 "
+             "WHERE NOT EXISTS (SELECT 1 FROM DBInfo);",
+             fresh ? target : DATALOGGER_DB_SCHEMA_V1);
+
+    rc = sqlite3_exec(ctx->db, init_info, NULL, NULL, &err_msg);
+    if (rc != SQLITE_OK) {
+        fprintf(stderr, "Erro ao inicializar DBInfo: %s\n", err_msg);
+        sqlite3_free(err_msg);
+        return false;
+    }
+
+    int version = read_schema_version(ctx->db);
+    if (version < DATALOGGER_DB_SCHEMA_V1 || version > DATALOGGER_DB_SCHEMA_LATEST) {
+        fprintf(stderr, "Erro: esquema do banco não suportado (versão %d)\n", version);
+        return false;
+    }
+
+    if (fresh) {
+        // Criar tabela de amostras e índice para consultas por intervalo de tempo
+        const char* create_data =
+            version >= DATALOGGER_DB_SCHEMA_V2
+                ? SAMPLES_TABLE_SQL SAMPLES_INDEX_SQL SAMPLES_COMPAT_VIEW_SQL
+                : DATA_TABLE_SQL DATA_INDEX_SQL;
+        rc = sqlite3_exec(ctx->db, create_data, NULL, NULL, &err_msg);
+        if (rc != SQLITE_OK) {
+            fprintf(stderr, "Erro ao criar tabela de amostras: %s\n", err_msg);
+            sqlite3_free(err_msg);
+            return false;
+        }
+    } else if (version < target) {
+        if (!migrate_schema(ctx, version, target)) return false;
+        version = read_schema_version(ctx->db);
+    }
+    // Banco em esquema mais novo que o alvo continua no próprio esquema
+    ctx->db_schema = version;
+
+    // Tabelas de agregados: recriadas se a versão gravada no banco for anterior
+    sqlite3_stmt* version_stmt;
+    int user_version = 0;
+    if (sqlite3_prepare_v2(ctx->db, "PRAGMA user_version;", -1, &version_stmt, NULL) == SQLITE_OK) {
+        if (sqlite3_step(version_stmt) == SQLITE_ROW) {
+            user_version = sqlite3_column_int(version_stmt, 0);
+        }
+        sqlite3_finalize(version_stmt);
+    }
+
+    if (user_version < DATALOGGER_ROLLUP_VERSION) {
+        rc = sqlite3_exec(ctx->db, "DROP TABLE IF EXISTS RollupHourly; DROP TABLE IF EXISTS RollupDaily;",
+                          NULL, NULL, &err_msg);
+        if (rc != SQLITE_OK) {
+            fprintf(stderr, "Erro ao remover agregados antigos: %s\n", err_msg);
+            sqlite3_free(err_msg);
+            return false;
+        }
+        ctx->rollup_rebuild = true;
+    }
+
+    rc = sqlite3_exec(ctx->db, ROLLUP_TABLE_SQL("RollupHourly") ROLLUP_TABLE_SQL("RollupDaily"),
+                      NULL, NULL, &err_msg);
+    if (rc != SQLITE_OK) {
+        fprintf(stderr, "Erro ao criar tabelas de agregados: %s\n", err_msg);
+        sqlite3_free(err_msg);
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Converte registro TXT para registro do banco
+ */
+bool datalogger_convert_to_db_record(const datalogger_record_t* txt_record,
+                                    datalogger_db_record_t* db_record) {
+    if (!txt_record || !db_record) return false;
+
+    // Limpar estrutura
+    memset(db_record, 0, sizeof(datalogger_db_record_t));
+
+    // Converter timestamp para milissegundos
+    time_t timestamp = mktime((struct tm*)&txt_record->timestamp);
+    db_record->CollectTime = (long long)timestamp * 1000;
+
+    // Converter temperatura (dividir por 10 e arredondar para 2 casas decimais)
+    if (txt_record->temp_valid) {
+        float temp_celsius = txt_record->temperature / 10.0f;
+        db_record->Tprincipal = roundf(temp_celsius * 100.0f) / 100.0f;  // 2 casas decimais
+        db_record->Traw = txt_record->temperature;
+        db_record->Flags |= TS_FLAG_TEMP_VALID;
+    } else {
+        db_record->Tprincipal = 0.0f;  // Valor padrão para erro
+    }
+
+    // Status da porta
+    if (txt_record->door_valid) {
+        db_record->Porta = txt_record->door_open ? 1 : 0;
+        db_record->Flags |= TS_FLAG_DOOR_VALID | (txt_record->door_open ? TS_FLAG_DOOR_OPEN : 0);
+    } else {
+        db_record->Porta = 0;  // Valor padrão para erro
+    }
+
+    return true;
+}
+
+/**
+ * @brief Insere registro no banco de dados
+ */
+bool datalogger_insert_db_record(datalogger_context_t* ctx,
+                                const datalogger_db_record_t* db_record) {
+    if (!ctx || !db_record) return false;
+
+    // Registro fora do mês da partição aberta (virada do mês ou ajuste do relógio)
+    if (ctx->db_partitioned &&
+        (!ctx->db || db_record->CollectTime < ctx->db_part_start ||
+         db_record->CollectTime >= ctx->db_part_end) &&
+        !rotate_partition(ctx, db_record->CollectTime)) {
+        stats_record_error(ctx, DATALOGGER_SINK_DB);
+        return false;
+    }
+    if (!ctx->db) return false;
+
+    long long start = monotonic_ns();
+
+    sqlite3_stmt* stmt = ctx->stmts[DATALOGGER_STMT_INSERT_DATA];
+    if (!stmt) {
+        stats_record_error(ctx, DATALOGGER_SINK_DB);
+        return false;
+    }
+
+    // Bind dos parâmetros
+    sqlite3_bind_int64(stmt, 1, db_record->CollectTime);
+    if (ctx->db_schema >= DATALOGGER_DB_SCHEMA_V2) {
+        if (db_record->Flags & TS_FLAG_TEMP_VALID) {
+            sqlite3_bind_int(stmt, 2, db_record->Traw);
+        } else {
+            sqlite3_bind_null(stmt, 2);
+        }
+        sqlite3_bind_int(stmt, 3, db_record->Flags);
+    } else {
+        sqlite3_bind_double(stmt, 2, db_record->Tprincipal);
+        sqlite3_bind_int(stmt, 3, db_record->Porta);
+    }
+
+    // Linha e DBInfo na transação de lote; cada registro tem seu próprio
+    // savepoint para que uma falha não descarte os registros anteriores do lote
+    long long prev_min_id = ctx->db_min_id;
+    long long prev_max_id = ctx->db_max_id;
+    long long prev_last_time = ctx->db_last_time;
+    int prev_last_porta = ctx->db_last_porta;
+    int rc = begin_batch(ctx);
+
+    if (rc == SQLITE_DONE) {
+        rc = step_statement(ctx, DATALOGGER_STMT_SAVEPOINT);
+    }
+
+    if (rc == SQLITE_DONE) {
+        rc = step_statement(ctx, DATALOGGER_STMT_INSERT_DATA);
+    } else {
+        sqlite3_clear_bindings(stmt);
+    }
+
+    if (rc == SQLITE_DONE) {
+        ctx->db_max_id = sqlite3_last_insert_rowid(ctx->db);
+        if (ctx->db_min_id == 0) {
+            ctx->db_min_id = ctx->db_max_id;
+        }
+        rc = datalogger_update_db_info(ctx) ? SQLITE_DONE : SQLITE_ERROR;
+    }
+
+    if (rc == SQLITE_DONE) {
+        rc = rollup_apply_record(ctx, db_record) ? SQLITE_DONE : SQLITE_ERROR;
+    }
+
+    if (rc == SQLITE_DONE) {
+        rc = step_statement(ctx, DATALOGGER_STMT_RELEASE);
+    }
+
+    if (rc != SQLITE_DONE) {
+        fprintf(stderr, "Erro ao inserir registro: %s\n", sqlite3_errmsg(ctx->db));
+        ctx->db_min_id = prev_min_id;
+        ctx->db_max_id = prev_max_id;
+        ctx->db_last_time = prev_last_time;
+        ctx->db_last_porta = prev_last_porta;
+
+        if (!sqlite3_get_autocommit(ctx->db)) {
+            step_statement(ctx, DATALOGGER_STMT_ROLLBACK_TO);
+            step_statement(ctx, DATALOGGER_STMT_RELEASE);
+        } else if (ctx->db_txn_open) {
+            // SQLite desfez a transação inteira (ex: disco cheio, erro de I/O)
+            ctx->db_txn_open = false;
+            ctx->db_txn_rows = 0;
+            reconcile_db_info(ctx);
+        }
+        stats_record_error(ctx, DATALOGGER_SINK_DB);
+        return false;
+    }
+
+    ctx->db_txn_rows++;
+    if (batch_is_due(ctx) && !commit_batch(ctx)) {
+        return false;
+    }
+
+    // Bytes do banco são contados pelo VFS, não por registro
+    stats_record_write(ctx, DATALOGGER_SINK_DB, 1, 0, monotonic_ns() - start);
+    return true;
+}
+
+/**
+ * @brief Atualiza informações do banco (tabela DBInfo)
+ */
+bool datalogger_update_db_info(datalogger_context_t* ctx) {
+    if (!ctx || !ctx->db) return false;
+
+    sqlite3_stmt* stmt = ctx->stmts[DATALOGGER_STMT_UPDATE_INFO];
+    if (!stmt) return false;
+
+    // Tabela vazia: MAX/MIN retornariam NULL, manter o mesmo valor
+    if (ctx->db_max_id > 0) {
+        sqlite3_bind_int64(stmt, 1, ctx->db_max_id);
+        sqlite3_bind_int64(stmt, 2, ctx->db_min_id);
+    } else {
+        sqlite3_bind_null(stmt, 1);
+        sqlite3_bind_null(stmt, 2);
+    }
+    sqlite3_bind_int64(stmt, 3, (long long)time(NULL) * 1000);
+
+    int rc = step_statement(ctx, DATALOGGER_STMT_UPDATE_INFO);
+    if (rc != SQLITE_DONE) {
+        fprintf(stderr, "Erro ao atualizar DBInfo: %s\n", sqlite3_errmsg(ctx->db));
+        return false;
+    }
+
+    return true;
+}
+
+// Entrega dos resultados de uma ou mais partições ao callback do chamador
+typedef struct {
+    datalogger_query_cb_t callback;
+    void* user;
+    bool merge;                 // Agregados: combinar intervalos repetidos na fronteira das partições
+    bool has_pending;
+    bool stopped;               // Callback pediu para interromper
+    int delivered;
+    datalogger_query_row_t pending;
+} query_stream_t;
+
+/**
+ * @brief Entrega um resultado ao callback do chamador
+ */
+static bool deliver_row(query_stream_t* qs, const datalogger_query_row_t* row) {
+    qs->delivered++;
+    if (!qs->callback(row, qs->user)) {
+        qs->stopped = true;
+    }
+    return !qs->stopped;
+}
+
+/**
+ * @brief Acumula um agregado; o intervalo anterior é entregue quando o início muda
+ *
+ * Um intervalo que atravessa a virada do mês aparece em duas partições
+ * (ex: hora UTC em fuso de meia hora, tempo de porta aberta na virada).
+ */
+static bool merge_row(query_stream_t* qs, const datalogger_query_row_t* row) {
+    if (!qs->merge) return deliver_row(qs, row);
+
+    datalogger_query_row_t* p = &qs->pending;
+    if (qs->has_pending && p->bucket_start == row->bucket_start) {
+        if (row->count > 0) {
+            if (p->count == 0) {
+                p->first_time = row->first_time;
+                p->temp_min = row->temp_min;
+                p->temp_max = row->temp_max;
+            } else {
+                if (row->first_time < p->first_time) p->first_time = row->first_time;
+                if (row->temp_min < p->temp_min) p->temp_min = row->temp_min;
+                if (row->temp_max > p->temp_max) p->temp_max = row->temp_max;
+            }
+            if (row->last_time > p->last_time) p->last_time = row->last_time;
+            p->temp_avg = (p->temp_avg * p->count + row->temp_avg * row->count) / (p->count + row->count);
+            p->count += row->count;
+        }
+        p->door_open_count += row->door_open_count;
+        p->door_open_ms += row->door_open_ms;
+        return true;
+    }
+
+    if (qs->has_pending && !deliver_row(qs, p)) return false;
+    *p = *row;
+    qs->has_pending = true;
+    return true;
+}
+
+/**
+ * @brief Executa uma consulta já vinculada e entrega cada linha ao stream
+ *
+ * Consultas agregadas usam a ordem de colunas: início, primeiro e último
+ * CollectTime, contagem, porta aberta, mínimo, máximo, média e
+ * (opcional) tempo de porta aberta.
+ * @return false em caso de erro do SQLite
+ */
+static bool stream_query(sqlite3* db, sqlite3_stmt* stmt, bool raw, query_stream_t* qs) {
+    int rc;
+    datalogger_query_row_t row;
+
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        memset(&row, 0, sizeof(row));
+        if (raw) {
+            row.bucket_start = sqlite3_column_int64(stmt, 0);
+            row.first_time = row.bucket_start;
+            row.last_time = row.bucket_start;
+            row.count = 1;
+            row.door_open_count = sqlite3_column_int(stmt, 2) ? 1 : 0;
+            row.temp_min = sqlite3_column_double(stmt, 1);
+            row.temp_max = row.temp_min;
+            row.temp_avg = row.temp_min;
+        } else {
+            row.bucket_start = sqlite3_column_int64(stmt, 0);
+            row.first_time = sqlite3_column_int64(stmt, 1);
+            row.last_time = sqlite3_column_int64(stmt, 2);
+            row.count = (uint32_t)sqlite3_column_int(stmt, 3);
+            row.door_open_count = (uint32_t)sqlite3_column_int(stmt, 4);
+            row.temp_min = sqlite3_column_double(stmt, 5);
+            row.temp_max = sqlite3_column_double(stmt, 6);
+            row.temp_avg = sqlite3_column_double(stmt, 7);
+            if (sqlite3_column_count(stmt) > 8) {
+                row.door_open_ms = sqlite3_column_int64(stmt, 8);
+            }
+        }
+
+        if (!merge_row(qs, &row)) {
+            rc = SQLITE_DONE;
+            break;
+        }
+    }
+
+    if (rc != SQLITE_DONE) {
+        fprintf(stderr, "Erro na consulta por intervalo: %s\n", sqlite3_errmsg(db));
+    }
+
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+    return rc == SQLITE_DONE;
+}
+
+/**
+ * @brief Vincula intervalo (e tamanho do agregado, se houver) a uma consulta
+ */
+static void bind_query(sqlite3_stmt* stmt, long long from_ms, long long to_ms, long long bucket_ms) {
+    sqlite3_bind_int64(stmt, 1, from_ms);
+    sqlite3_bind_int64(stmt, 2, to_ms);
+    if (bucket_ms > 0) {
+        sqlite3_bind_int64(stmt, 3, bucket_ms);
+    }
+}
+
+/**
+ * @brief Consulta a partição aberta pelo escritor (inclui o lote ainda não confirmado)
+ */
+static bool query_live(datalogger_context_t* ctx, datalogger_stmt_id_t id, long long from_ms,
+                       long long to_ms, long long bucket_ms, query_stream_t* qs) {
+    sqlite3_stmt* stmt = ctx->stmts[id];
+    if (!stmt) return false;
+
+    bind_query(stmt, from_ms, to_ms, bucket_ms);
+    return stream_query(ctx->db, stmt, id == DATALOGGER_STMT_QUERY_RAW, qs);
+}
+
+/**
+ * @brief Consulta uma partição selada anexada à conexão do catálogo
+ */
+static bool query_sealed(datalogger_context_t* ctx, const char* name, datalogger_stmt_id_t id,
+                         long long from_ms, long long to_ms, long long bucket_ms, query_stream_t* qs) {
+    sqlite3* db = datalogger_catalog_attach(ctx->catalog, name);
+    if (!db) return false;
+
+    sqlite3_stmt* stmt;
+    bool ok = sqlite3_prepare_v2(db, partition_query_sql[id], -1, &stmt, NULL) == SQLITE_OK;
+    if (ok) {
+        bind_query(stmt, from_ms, to_ms, bucket_ms);
+        ok = stream_query(db, stmt, id == DATALOGGER_STMT_QUERY_RAW, qs);
+        sqlite3_finalize(stmt);
+    } else {
+        fprintf(stderr, "Erro ao consultar partição %s: %s\n", name, sqlite3_errmsg(db));
+    }
+
+    datalogger_catalog_detach(ctx->catalog);
+    return ok;
+}
+
+/**
+ * @brief Executa uma consulta em todas as partições do intervalo, em ordem de tempo
+ *
+ * Sem catálogo, apenas o banco aberto é consultado. Chamador detém ctx->lock.
+ * @return Número de resultados entregues, ou -1 em caso de erro
+ */
+static int query_partitions(datalogger_context_t* ctx, datalogger_stmt_id_t id,
+                            long long from_ms, long long to_ms, long long bucket_ms,
+                            datalogger_query_cb_t callback, void* user) {
+    query_stream_t qs;
+    memset(&qs, 0, sizeof(qs));
+    qs.callback = callback;
+    qs.user = user;
+    qs.merge = id != DATALOGGER_STMT_QUERY_RAW && ctx->catalog != NULL;
+
+    // Agregados mantidos são filtrados pelo início do intervalo: uma partição
+    // cujo primeiro registro é posterior a to_ms ainda pode conter o último dia
+    long long reach_ms = to_ms;
+    if (id == DATALOGGER_STMT_QUERY_HOURLY || id == DATALOGGER_STMT_QUERY_DAILY) {
+        reach_ms += 26 * 3600 * 1000LL;
+    }
+
+    datalogger_partition_t* parts = NULL;
+    int count = 0;
+    char live[64] = "";
+    if (ctx->catalog) {
+        count = datalogger_catalog_find(ctx->catalog, from_ms, reach_ms, &parts);
+        if (count < 0) return -1;
+        if (ctx->db) {
+            live_partition_name(ctx, live, sizeof(live));
+        }
+    }
+
+    bool live_pending = ctx->db != NULL &&
+        (!ctx->catalog || (ctx->db_part_start <= reach_ms && ctx->db_part_end > from_ms));
+    bool ok = true;
+
+    for (int i = 0; i < count && ok && !qs.stopped; i++) {
+        if (strcmp(parts[i].name, live) == 0) continue;
+
+        if (live_pending && ctx->db_part_start < parts[i].period_start) {
+            live_pending = false;
+            ok = query_live(ctx, id, from_ms, to_ms, bucket_ms, &qs);
+            if (!ok || qs.stopped) break;
+        }
+        ok = query_sealed(ctx, parts[i].name, id, from_ms, to_ms, bucket_ms, &qs);
+    }
+    free(parts);
+
+    if (ok && live_pending && !qs.stopped) {
+        ok = query_live(ctx, id, from_ms, to_ms, bucket_ms, &qs);
+    }
+    if (ok && qs.has_pending && !qs.stopped) {
+        deliver_row(&qs, &qs.pending);
+    }
+
+    return ok ? qs.delivered : -1;
+}
+
+/**
+ * @brief Consulta registros ou agregados de um intervalo de tempo
+ */
+int datalogger_query_range(datalogger_context_t* ctx, long long from_ms, long long to_ms,
+                           long long bucket_ms, datalogger_query_cb_t callback, void* user) {
+    if (!ctx || (!ctx->db && !ctx->catalog) || !callback || bucket_ms < 0) return -1;
+
+    pthread_mutex_lock(&ctx->lock);
+    datalogger_stmt_id_t id = bucket_ms > 0 ? DATALOGGER_STMT_QUERY_BUCKETS : DATALOGGER_STMT_QUERY_RAW;
+    int delivered = query_partitions(ctx, id, from_ms, to_ms, bucket_ms, callback, user);
+    pthread_mutex_unlock(&ctx->lock);
+    return delivered;
+}
+
+/**
+ * @brief Consulta os agregados horários ou diários de um intervalo de tempo
+ */
+int datalogger_query_rollup(datalogger_context_t* ctx, datalogger_rollup_t level,
+                            long long from_ms, long long to_ms,
+                            datalogger_query_cb_t callback, void* user) {
+    if (!ctx || (!ctx->db && !ctx->catalog) || !callback || level >= DATALOGGER_ROLLUP_COUNT) return -1;
+
+    pthread_mutex_lock(&ctx->lock);
+    datalogger_stmt_id_t id = level == DATALOGGER_ROLLUP_HOURLY ? DATALOGGER_STMT_QUERY_HOURLY
+                                                                : DATALOGGER_STMT_QUERY_DAILY;
+    int delivered = query_partitions(ctx, id, from_ms, to_ms, 0, callback, user);
+    pthread_mutex_unlock(&ctx->lock);
+    return delivered;
+}
+
+// Tabelas de agregados por nível (datalogger_rollup_t)
+static const char* const rollup_tables[DATALOGGER_ROLLUP_COUNT] = { "RollupHourly", "RollupDaily" };
+
+// Agregado de um intervalo acumulado em memória durante a reconstrução
+typedef struct {
+    bool open;                 // bucket/next válidos
+    bool used;                 // Recebeu registro ou tempo de porta aberta
+    long long bucket;
+    long long next;
+    uint32_t count;            // Temperaturas válidas
+    uint32_t door_count;       // Registros com porta aberta
+    double temp_min;
+    double temp_max;
+    double temp_sum;
+    long long door_ms;
+    long long first_time;      // 0 = só tempo de porta aberta
+    long long last_time;
+} rollup_acc_t;
+
+/**
+ * @brief Grava o intervalo acumulado (se usado) e passa ao intervalo que contém t_ms
+ */
+static bool rollup_acc_move(sqlite3_stmt* store, datalogger_rollup_t level, rollup_acc_t* acc, long long t_ms) {
+    if (acc->open && t_ms >= acc->bucket && t_ms < acc->next) return true;
+
+    if (acc->used) {
+        sqlite3_bind_int64(store, 1, acc->bucket);
+        sqlite3_bind_int64(store, 2, acc->count);
+        if (acc->count > 0) {
+            sqlite3_bind_double(store, 3, acc->temp_min);
+            sqlite3_bind_double(store, 4, acc->temp_max);
+            sqlite3_bind_double(store, 5, acc->temp_sum);
+        } else {
+            sqlite3_bind_null(store, 3);
+            sqlite3_bind_null(store, 4);
+            sqlite3_bind_null(store, 5);
+        }
+        sqlite3_bind_int64(store, 6, acc->door_count);
+        sqlite3_bind_int64(store, 7, acc->door_ms);
+        if (acc->first_time != 0) {
+            sqlite3_bind_int64(store, 8, acc->first_time);
+            sqlite3_bind_int64(store, 9, acc->last_time);
+        } else {
+            sqlite3_bind_null(store, 8);
+            sqlite3_bind_null(store, 9);
+        }
+        int rc = sqlite3_step(store);
+        sqlite3_reset(store);
+        if (rc != SQLITE_DONE) return false;
+    }
+
+    memset(acc, 0, sizeof(*acc));
+    acc->bucket = rollup_bucket(level, t_ms, &acc->next);
+    acc->open = true;
+    return true;
+}
+
+/**
+ * @brief Soma ao acumulador o tempo de porta aberta em [from, until), intervalo a intervalo
+ */
+static bool rollup_acc_door(sqlite3_stmt* store, datalogger_rollup_t level, rollup_acc_t* acc,
+                            long long from, long long until) {
+    while (from < until) {
+        if (!rollup_acc_move(store, level, acc, from)) return false;
+        long long end = acc->next < until ? acc->next : until;
+        acc->door_ms += end - from;
+        acc->used = true;
+        from = end;
+    }
+    return true;
+}
+
+/**
+ * @brief Recalcula os agregados de um nível com início em [from, to)
+ *
+ * Mesmo resultado de rollup_apply_record() registro a registro, mas com
+ * cada intervalo acumulado em memória e gravado uma única vez (no v1,
+ * leituras de 0,0 °C com porta fechada ficam fora, como falha). O estado
+ * da porta no início vem da última leitura válida anterior a from; o
+ * tempo de porta aberta após o último registro do trecho vai até o
+ * registro seguinte, limitado a to. O chamador detém ctx->lock e a
+ * transação.
+ * @return Registros percorridos, ou -1 em caso de erro
+ */
+static long long rebuild_rollup_range(datalogger_context_t* ctx, datalogger_rollup_t level,
+                                      long long from, long long to) {
+    // No v2 a validade vem de Flags; no v1, linhas DATA_FAILED_SQL são
+    // tratadas como falha de leitura (temperatura e porta inválidas)
+    bool v2 = ctx->db_schema >= DATALOGGER_DB_SCHEMA_V2;
+    const char* table = rollup_tables[level];
+    char sql[256];
+    sqlite3_stmt* stmt = NULL;
+    sqlite3_stmt* store = NULL;
+    long long rows = 0;
+
+    snprintf(sql, sizeof(sql), "DELETE FROM %s WHERE BucketStart >= ?1 AND BucketStart < ?2;", table);
+    bool ok = sqlite3_prepare_v2(ctx->db, sql, -1, &stmt, NULL) == SQLITE_OK;
+    if (ok) {
+        sqlite3_bind_int64(stmt, 1, from);
+        sqlite3_bind_int64(stmt, 2, to);
+        ok = sqlite3_step(stmt) == SQLITE_DONE;
+    }
+    sqlite3_finalize(stmt);
+    stmt = NULL;
+
+    // Estado da porta herdado do trecho anterior
+    int porta = -1;
+    if (ok) {
+        ok = sqlite3_prepare_v2(ctx->db, v2
+            ? "SELECT (Flags & 6) = 6 FROM DataGrpSamples WHERE CollectTime < ?1 AND Flags & 2 "
+              "ORDER BY CollectTime DESC, IndexID DESC LIMIT 1;"
+            : "SELECT Porta FROM DataGrpData WHERE CollectTime < ?1 AND NOT " DATA_FAILED_SQL("")
+              " ORDER BY CollectTime DESC, IndexID DESC LIMIT 1;",
+            -1, &stmt, NULL) == SQLITE_OK;
+    }
+    if (ok) {
+        sqlite3_bind_int64(stmt, 1, from);
+        if (sqlite3_step(stmt) == SQLITE_ROW) porta = sqlite3_column_int(stmt, 0) ? 1 : 0;
+    }
+    sqlite3_finalize(stmt);
+    stmt = NULL;
+
+    snprintf(sql, sizeof(sql),
+             "INSERT OR REPLACE INTO %s (BucketStart, Count, TMin, TMax, TSum, DoorOpenCount, "
+             "DoorOpenMs, FirstTime, LastTime) VALUES (?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8, ?9);", table);
+    ok = ok && sqlite3_prepare_v2(ctx->db, sql, -1, &store, NULL) == SQLITE_OK;
+    ok = ok && sqlite3_prepare_v2(ctx->db, v2
+        ? "SELECT CollectTime, Temp, Flags FROM DataGrpSamples "
+          "WHERE CollectTime >= ?1 AND CollectTime < ?2 ORDER BY CollectTime, IndexID;"
+        : "SELECT CollectTime, Tprincipal, Porta, " DATA_FAILED_SQL("") " FROM DataGrpData "
+          "WHERE CollectTime >= ?1 AND CollectTime < ?2 ORDER BY CollectTime, IndexID;",
+        -1, &stmt, NULL) == SQLITE_OK;
+
+    rollup_acc_t acc;
+    memset(&acc, 0, sizeof(acc));
+    long long last_time = from;
+    int rc = SQLITE_DONE;
+    if (ok) {
+        sqlite3_bind_int64(stmt, 1, from);
+        sqlite3_bind_int64(stmt, 2, to);
+    }
+    while (ok && (rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        long long t = sqlite3_column_int64(stmt, 0);
+        bool temp_valid;
+        int door;
+        double temp;
+        if (v2) {
+            int flags = sqlite3_column_int(stmt, 2);
+            temp_valid = (flags & TS_FLAG_TEMP_VALID) != 0;
+            temp = sqlite3_column_int(stmt, 1) / 10.0;
+            door = (flags & TS_FLAG_DOOR_VALID) ? ((flags & TS_FLAG_DOOR_OPEN) ? 1 : 0) : -1;
+        } else {
+            temp_valid = !sqlite3_column_int(stmt, 3);
+            temp = sqlite3_column_double(stmt, 1);
+            door = temp_valid ? (sqlite3_column_int(stmt, 2) ? 1 : 0) : -1;
+        }
+        rows++;
+
+        if (porta == 1) ok = rollup_acc_door(store, level, &acc, last_time, t);
+        last_time = t;
+        if (ok && (temp_valid || door >= 0)) {
+            ok = rollup_acc_move(store, level, &acc, t);
+            if (temp_valid) {
+                if (acc.count == 0 || temp < acc.temp_min) acc.temp_min = temp;
+                if (acc.count == 0 || temp > acc.temp_max) acc.temp_max = temp;
+                acc.temp_sum += temp;
+                acc.count++;
+            }
+            if (door == 1) acc.door_count++;
+            if (acc.first_time == 0) acc.first_time = t;
+            acc.last_time = t;
+            acc.used = true;
+        }
+        if (door >= 0) porta = door;
+    }
+    ok = ok && rc == SQLITE_DONE;
+    sqlite3_finalize(stmt);
+    stmt = NULL;
+
+    // Porta aberta no fim do trecho: até o próximo registro, se já existir
+    if (ok && porta == 1) {
+        ok = sqlite3_prepare_v2(ctx->db, "SELECT MIN(CollectTime) FROM DataGrpData WHERE CollectTime >= ?1;",
+                                -1, &stmt, NULL) == SQLITE_OK;
+        if (ok) {
+            sqlite3_bind_int64(stmt, 1, to);
+            if (sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_type(stmt, 0) != SQLITE_NULL) {
+                long long next = sqlite3_column_int64(stmt, 0);
+                ok = rollup_acc_door(store, level, &acc, last_time, next < to ? next : to);
+            }
+        }
+        sqlite3_finalize(stmt);
+    }
+
+    // Grava o último intervalo acumulado
+    ok = ok && rollup_acc_move(store, level, &acc, acc.open ? acc.next : from);
+    sqlite3_finalize(store);
+    return ok ? rows : -1;
+}
+
+/**
+ * @brief Fim do trecho de reconstrução que começa no intervalo start
+ *
+ * Trechos de um dia limitam o tempo de cada transação (e de cada posse
+ * de ctx->lock) na partição em uso.
+ */
+static long long rollup_chunk_end(datalogger_rollup_t level, long long start) {
+    long long next;
+    if (level == DATALOGGER_ROLLUP_HOURLY) return start + 24 * 3600 * 1000LL;
+    rollup_bucket(level, start, &next);
+    return next;
+}
+
+/**
+ * @brief Lê o intervalo de CollectTime do banco
+ * @return false se o banco está vazio ou em caso de erro
+ */
+static bool collect_time_range(sqlite3* db, long long* first, long long* last) {
+    sqlite3_stmt* stmt;
+    bool found = false;
+    if (sqlite3_prepare_v2(db, "SELECT MIN(CollectTime), MAX(CollectTime) FROM DataGrpData;",
+                           -1, &stmt, NULL) != SQLITE_OK) {
+        return false;
+    }
+    if (sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_type(stmt, 0) != SQLITE_NULL) {
+        *first = sqlite3_column_int64(stmt, 0);
+        *last = sqlite3_column_int64(stmt, 1);
+        found = true;
+    }
+    sqlite3_finalize(stmt);
+    return found;
+}
+
+/**
+ * @brief Recalcula os agregados (chamador detém ctx->lock)
+ *
+ * Registros são percorridos em ordem de CollectTime: bancos consolidados
+ * recebem registros antigos com IndexID maior que os já existentes. O
+ * estado incremental (db_last_time/db_last_porta) não é alterado.
+ */
+static bool rebuild_rollups_locked(datalogger_context_t* ctx) {
+    // Lote pendente é confirmado antes para que a reconstrução seja atômica
+    bool ok = commit_batch(ctx);
+    ok = ok && step_statement(ctx, DATALOGGER_STMT_BEGIN) == SQLITE_DONE;
+    ok = ok && sqlite3_exec(ctx->db, "DELETE FROM RollupHourly; DELETE FROM RollupDaily;",
+                            NULL, NULL, NULL) == SQLITE_OK;
+
+    long long first = 0;
+    long long last = 0;
+    long long rows = 0;
+    if (ok && collect_time_range(ctx->db, &first, &last)) {
+        for (int level = 0; ok && level < DATALOGGER_ROLLUP_COUNT; level++) {
+            long long end;
+            long long start = rollup_bucket((datalogger_rollup_t)level, first, &end);
+            rollup_bucket((datalogger_rollup_t)level, last, &end);
+            rows = rebuild_rollup_range(ctx, (datalogger_rollup_t)level, start, end);
+            ok = rows >= 0;
+        }
+    }
+
+    if (ok) {
+        char sql[64];
+        snprintf(sql, sizeof(sql), "PRAGMA user_version = %d;", DATALOGGER_ROLLUP_VERSION);
+        ok = sqlite3_exec(ctx->db, sql, NULL, NULL, NULL) == SQLITE_OK &&
+             step_statement(ctx, DATALOGGER_STMT_COMMIT) == SQLITE_DONE;
+    }
+
+    if (!ok) {
+        fprintf(stderr, "Erro ao recalcular agregados: %s\n", sqlite3_errmsg(ctx->db));
+        if (!sqlite3_get_autocommit(ctx->db)) {
+            step_statement(ctx, DATALOGGER_STMT_ROLLBACK);
+        }
+    } else {
+        ctx->rollup_rebuild = false;
+        if (rows > 0) {
+            printf("📊 Agregados recalculados a partir de %lld registros\n", rows);
+        }
+    }
+    return ok;
+}
+
+/**
+ * @brief Recalcula RollupHourly e RollupDaily a partir de DataGrpData
+ */
+bool datalogger_rebuild_rollups(datalogger_context_t* ctx) {
+    if (!ctx || !ctx->db) return false;
+
+    pthread_mutex_lock(&ctx->lock);
+    bool ok = rebuild_rollups_locked(ctx);
+    pthread_mutex_unlock(&ctx->lock);
+    return ok;
+}
+
+/**
+ * @brief Grava um bloco finalizado na tabela DataGrpBlocks
+ */
+static bool store_block(sqlite3_stmt* insert, ts_block_encoder_t* enc) {
+    size_t len = 0;
+    const uint8_t* block = ts_block_finish(enc, false, &len);
+
+    ts_block_header_t header;
+    ts_block_read_header(block, len, &header);
+
+    sqlite3_bind_int64(insert, 1, header.start_time);
+    sqlite3_bind_int64(insert, 2, header.end_time);
+    sqlite3_bind_int(insert, 3, header.count);
+    sqlite3_bind_int(insert, 4, header.temp_min);
+    sqlite3_bind_int(insert, 5, header.temp_max);
+    sqlite3_bind_blob(insert, 6, block, (int)len, SQLITE_TRANSIENT);
+
+    int rc = sqlite3_step(insert);
+    sqlite3_reset(insert);
+    return rc == SQLITE_DONE;
+}
+
+/**
+ * @brief Compacta um intervalo em blocos (chamador detém ctx->lock, savepoint aberto)
+ * @return Número de blocos gravados, ou -1 em caso de erro
+ */
+static int archive_blocks_locked(datalogger_context_t* ctx, long long from_ms, long long to_ms) {
+    const char* create_blocks_table =
+        "CREATE TABLE IF NOT EXISTS DataGrpBlocks ("
+        "StartTime INTEGER PRIMARY KEY,"
+        "EndTime INTEGER NOT NULL,"
+        "Count INTEGER NOT NULL,"
+        "TMin INTEGER NOT NULL,"   // TMin > TMax: bloco sem temperatura válida
+        "TMax INTEGER NOT NULL,"
+        "Data BLOB NOT NULL"
+        ");";
+
+    char* err_msg = NULL;
+    if (sqlite3_exec(ctx->db, create_blocks_table, NULL, NULL, &err_msg) != SQLITE_OK) {
+        fprintf(stderr, "Erro ao criar tabela DataGrpBlocks: %s\n", err_msg);
+        sqlite3_free(err_msg);
+        return -1;
+    }
+
+    sqlite3_stmt* select = NULL;
+    sqlite3_stmt* insert = NULL;
+    // No v2, temperatura bruta e flags de validade vêm direto de DataGrpSamples
+    bool v2 = ctx->db_schema >= DATALOGGER_DB_SCHEMA_V2;
+    int rc = sqlite3_prepare_v2(ctx->db, v2
+        ? "SELECT CollectTime, COALESCE(Temp, 0), Flags FROM DataGrpSamples "
+          "WHERE CollectTime BETWEEN ? AND ? ORDER BY CollectTime;"
+        : "SELECT CollectTime, Tprincipal, Porta FROM DataGrpData "
+          "WHERE CollectTime BETWEEN ? AND ? ORDER BY CollectTime;", -1, &select, NULL);
+    if (rc == SQLITE_OK) {
+        rc = sqlite3_prepare_v2(ctx->db,
+            "INSERT OR REPLACE INTO DataGrpBlocks (StartTime, EndTime, Count, TMin, TMax, Data) "
+            "VALUES (?, ?, ?, ?, ?, ?);", -1, &insert, NULL);
+    }
+    if (rc != SQLITE_OK) {
+        fprintf(stderr, "Erro ao preparar compactação em blocos: %s\n", sqlite3_errmsg(ctx->db));
+        sqlite3_finalize(select);
+        return -1;
+    }
+
+    sqlite3_bind_int64(select, 1, from_ms);
+    sqlite3_bind_int64(select, 2, to_ms);
+
+    ts_block_encoder_t enc;
+    ts_block_encoder_init(&enc);
+    int blocks = 0;
+    bool ok = true;
+
+    while (ok && (rc = sqlite3_step(select)) == SQLITE_ROW) {
+        ts_sample_t sample;
+        sample.collect_time = sqlite3_column_int64(select, 0);
+        if (v2) {
+            sample.temperature = (int16_t)sqlite3_column_int(select, 1);
+            sample.flags = (uint8_t)sqlite3_column_int(select, 2);
+        } else {
+            // O esquema v1 não distingue leituras inválidas: todas são marcadas como válidas
+            sample.temperature = (int16_t)lround(sqlite3_column_double(select, 1) * 10.0);
+            sample.flags = TS_FLAG_TEMP_VALID | TS_FLAG_DOOR_VALID |
+                           (sqlite3_column_int(select, 2) ? TS_FLAG_DOOR_OPEN : 0);
+        }
+
+        if (!ts_block_append(&enc, &sample)) {
+            ok = store_block(insert, &enc);
+            blocks++;
+            ts_block_encoder_init(&enc);
+            ts_block_append(&enc, &sample);
+        }
+    }
+
+    if (ok && rc == SQLITE_DONE && ts_block_count(&enc) > 0) {
+        ok = store_block(insert, &enc);
+        blocks++;
+    }
+    if (ok && rc != SQLITE_DONE) ok = false;
+    if (!ok) {
+        fprintf(stderr, "Erro ao compactar blocos: %s\n", sqlite3_errmsg(ctx->db));
+    }
+
+    sqlite3_finalize(select);
+    sqlite3_finalize(insert);
+    return ok ? blocks : -1;
+}
+
+/**
+ * @brief Compacta um intervalo de DataGrpData em blocos na tabela DataGrpBlocks
+ *
+ * Roda sob ctx->lock na conexão do escritor. O lote pendente é confirmado
+ * antes (registros já aceitos não dependem do resultado da compactação) e
+ * os blocos são gravados em um savepoint próprio: em caso de erro, apenas
+ * os blocos são desfeitos. Durante uma exportação o savepoint entra no
+ * lote retido, sem modificar o arquivo principal.
+ */
+int datalogger_archive_blocks(datalogger_context_t* ctx, long long from_ms, long long to_ms) {
+    if (!ctx || !ctx->db) return -1;
+
+    pthread_mutex_lock(&ctx->lock);
+    bool ok = ctx->db_export_hold ? begin_batch(ctx) == SQLITE_DONE : commit_batch(ctx);
+    if (!ok) {
+        fprintf(stderr, "Erro ao preparar compactação em blocos: %s\n", sqlite3_errmsg(ctx->db));
+        pthread_mutex_unlock(&ctx->lock);
+        return -1;
+    }
+
+    char* err_msg = NULL;
+    if (sqlite3_exec(ctx->db, "SAVEPOINT blocks;", NULL, NULL, &err_msg) != SQLITE_OK) {
+        fprintf(stderr, "Erro ao iniciar compactação em blocos: %s\n", err_msg);
+        sqlite3_free(err_msg);
+        pthread_mutex_unlock(&ctx->lock);
+        return -1;
+    }
+
+    int blocks = archive_blocks_locked(ctx, from_ms, to_ms);
+    if (blocks >= 0 && sqlite3_exec(ctx->db, "RELEASE blocks;", NULL, NULL, &err_msg) != SQLITE_OK) {
+        fprintf(stderr, "Erro ao confirmar blocos: %s\n", err_msg);
+        sqlite3_free(err_msg);
+        blocks = -1;
+    }
+
+    if (blocks < 0) {
+        // Desfaz só os blocos; se o SQLite já desfez a transação inteira
+        // (ex: disco cheio), o lote retido também foi perdido
+        if (!sqlite3_get_autocommit(ctx->db)) {
+            sqlite3_exec(ctx->db, "ROLLBACK TO blocks; RELEASE blocks;", NULL, NULL, NULL);
+        }
+        if (ctx->db_txn_open && sqlite3_get_autocommit(ctx->db)) {
+            ctx->db_txn_open = false;
+            ctx->db_txn_rows = 0;
+            reconcile_db_info(ctx);
+        }
+    }
+
+    pthread_mutex_unlock(&ctx->lock);
+    return blocks;
+}
+
+// Banco por execução candidato à consolidação
+typedef struct {
+    char path[DATALOGGER_MAX_PATH];
+    bool samples;               // Esquema v2: ler DataGrpSamples (preserva leituras inválidas)
+    long long first_time;       // Menor CollectTime
+    long long last_time;        // Maior CollectTime
+    long long rows;             // Registros em DataGrpData
+    long long expired;          // Registros anteriores à janela de retenção
+    long long* periods;         // Início dos meses com registros a consolidar (alocado)
+    int period_count;
+    int pending;                // Meses ainda não confirmados nas partições
+    bool failed;                // Falha em algum mês: banco mantido
+} merge_source_t;
+
+/**
+ * @brief Verifica se o nome segue o padrão dos bancos por execução (NOME_AAAAMMDD_HHMMSS.db)
+ */
+static bool is_boot_database_name(const datalogger_context_t* ctx, const char* name) {
+    size_t prefix_len = strlen(ctx->device_name);
+    if (strncmp(name, ctx->device_name, prefix_len) != 0 || name[prefix_len] != '_') return false;
+
+    const char* stamp = name + prefix_len + 1;
+    if (strlen(stamp) != 15 + 3 || strcmp(stamp + 15, ".db") != 0) return false;
+    for (int i = 0; i < 15; i++) {
+        if (i == 8 ? stamp[i] != '_' : !isdigit((unsigned char)stamp[i])) return false;
+    }
+    return true;
+}
+
+static int compare_merge_sources(const void* a, const void* b) {
+    return strcmp(((const merge_source_t*)a)->path, ((const merge_source_t*)b)->path);
+}
+
+/**
+ * @brief Verifica se o banco tem registros a consolidar no mês que começa em period_start
+ */
+static bool merge_source_has_period(const merge_source_t* src, long long period_start) {
+    for (int i = 0; i < src->period_count; i++) {
+        if (src->periods[i] == period_start) return !src->failed;
+    }
+    return false;
+}
+
+/**
+ * @brief Lê intervalo de tempo, contagens, esquema e meses com registros de um banco por execução
+ */
+static bool probe_merge_source(merge_source_t* src, long long keep_from) {
+    sqlite3* db = NULL;
+    if (sqlite3_open_v2(src->path, &db, SQLITE_OPEN_READONLY, NULL) != SQLITE_OK) {
+        sqlite3_close(db);
+        return false;
+    }
+
+    sqlite3_stmt* stmt;
+    bool ok = sqlite3_prepare_v2(db, "SELECT MIN(CollectTime), MAX(CollectTime), COUNT(*), "
+                                     "TOTAL(CollectTime < ?1) FROM DataGrpData;",
+                                 -1, &stmt, NULL) == SQLITE_OK;
+    if (ok) {
+        sqlite3_bind_int64(stmt, 1, keep_from);
+        ok = sqlite3_step(stmt) == SQLITE_ROW;
+        if (ok) {
+            src->first_time = sqlite3_column_int64(stmt, 0);
+            src->last_time = sqlite3_column_int64(stmt, 1);
+            src->rows = sqlite3_column_int64(stmt, 2);
+            src->expired = (long long)sqlite3_column_double(stmt, 3);
+        }
+        sqlite3_finalize(stmt);
+    }
+
+    src->samples = false;
+    if (ok && sqlite3_prepare_v2(db, "SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = 'DataGrpSamples';",
+                                 -1, &stmt, NULL) == SQLITE_OK) {
+        src->samples = sqlite3_step(stmt) == SQLITE_ROW;
+        sqlite3_finalize(stmt);
+    }
+
+    // Meses dentro da retenção com pelo menos um registro (busca pelo índice de CollectTime)
+    if (ok && src->rows > src->expired &&
+        sqlite3_prepare_v2(db, "SELECT 1 FROM DataGrpData WHERE CollectTime >= ?1 AND CollectTime < ?2 LIMIT 1;",
+                           -1, &stmt, NULL) == SQLITE_OK) {
+        long long period_start, period_end;
+        datalogger_partition_period(src->first_time > keep_from ? src->first_time : keep_from,
+                                    &period_start, &period_end);
+        int capacity = 0;
+        while (ok && period_start <= src->last_time) {
+            sqlite3_bind_int64(stmt, 1, period_start);
+            sqlite3_bind_int64(stmt, 2, period_end);
+            if (sqlite3_step(stmt) == SQLITE_ROW) {
+                if (src->period_count == capacity) {
+                    capacity = capacity ? capacity * 2 : 4;
+                    long long* grown = realloc(src->periods, (size_t)capacity * sizeof(*grown));
+                    ok = grown != NULL;
+                    if (ok) src->periods = grown;
+                }
+                if (ok) src->periods[src->period_count++] = period_start;
+            }
+            sqlite3_reset(stmt);
+            datalogger_partition_period(period_end, &period_start, &period_end);
+        }
+        sqlite3_finalize(stmt);
+        src->pending = src->period_count;
+    }
+
+    sqlite3_close(db);
+    return ok;
+}
+
+/**
+ * @brief Lista os bancos por execução selados do diretório, em ordem cronológica
+ * @return Número de bancos (vetor em *out, liberar com free), ou -1 em caso de erro
+ */
+static int list_boot_databases(const datalogger_context_t* ctx, merge_source_t** out,
+                               datalogger_merge_stats_t* stats) {
+    *out = NULL;
+    DIR* dir = opendir(ctx->db_dir);
+    if (!dir) {
+        fprintf(stderr, "Erro ao abrir diretório %s: %s\n", ctx->db_dir, strerror(errno));
+        return -1;
+    }
+
+    merge_source_t* list = NULL;
+    int count = 0;
+    int capacity = 0;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (!is_boot_database_name(ctx, entry->d_name)) continue;
+
+        char path[DATALOGGER_MAX_PATH];
+        if (snprintf(path, sizeof(path), "%s/%s", ctx->db_dir, entry->d_name) >= (int)sizeof(path) ||
+            strcmp(path, ctx->db_file_path) == 0) {
+            continue;
+        }
+
+        // Journal ou WAL pendente: banco ainda não selado (ou recuperação falhou)
+        char side_path[DATALOGGER_MAX_PATH + 16];
+        snprintf(side_path, sizeof(side_path), "%s-journal", path);
+        bool sealed = access(side_path, F_OK) != 0;
+        snprintf(side_path, sizeof(side_path), "%s-wal", path);
+        sealed = sealed && access(side_path, F_OK) != 0;
+        if (!sealed) {
+            stats->kept++;
+            continue;
+        }
+
+        if (count == capacity) {
+            int new_capacity = capacity ? capacity * 2 : 32;
+            merge_source_t* grown = realloc(list, (size_t)new_capacity * sizeof(*list));
+            if (!grown) break;
+            list = grown;
+            capacity = new_capacity;
+        }
+        memset(&list[count], 0, sizeof(list[count]));
+        memcpy(list[count].path, path, sizeof(path));
+        count++;
+    }
+    closedir(dir);
+
+    if (count > 1) qsort(list, (size_t)count, sizeof(*list), compare_merge_sources);
+    *out = list;
+    return count;
+}
+
+/**
+ * @brief Início do mês mais antigo mantido pela retenção (0 = sem limite de idade)
+ */
+static long long merge_retention_start(const datalogger_context_t* ctx, long long live_start) {
+    if (ctx->retention_months <= 0) return 0;
+
+    long long start = live_start;
+    long long end;
+    for (int i = 1; i < ctx->retention_months; i++) {
+        datalogger_partition_period(start - 1, &start, &end);
+    }
+    return start;
+}
+
+/**
+ * @brief Copia um grupo de bancos anexados para o trecho [period_start, period_end)
+ *
+ * Todas as inserções, o recálculo de DBInfo e a marcação dos agregados como
+ * desatualizados (PRAGMA user_version = 0) são confirmados juntos; se a
+ * consolidação for interrompida antes de merge_period() recalcular os
+ * agregados, eles são refeitos na próxima abertura da partição. O trecho é
+ * o mês inteiro em partições seladas e um lote de merge_chunk_end() na
+ * partição em uso.
+ */
+static bool merge_group(datalogger_context_t* target, merge_source_t** group, int count,
+                        long long period_start, long long period_end, datalogger_merge_stats_t* stats) {
+    sqlite3* db = target->db;
+    bool v2 = target->db_schema >= DATALOGGER_DB_SCHEMA_V2;
+    long long last_time = target->db_last_time;
+    int last_porta = target->db_last_porta;
+    int attached = 0;
+    bool ok = true;
+
+    for (int i = 0; i < count && ok; i++) {
+        char sql[64];
+        sqlite3_stmt* stmt;
+        snprintf(sql, sizeof(sql), "ATTACH DATABASE ?1 AS boot%d;", i);
+        ok = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) == SQLITE_OK;
+        if (ok) {
+            sqlite3_bind_text(stmt, 1, group[i]->path, -1, SQLITE_STATIC);
+            ok = sqlite3_step(stmt) == SQLITE_DONE;
+            sqlite3_finalize(stmt);
+        }
+        if (ok) attached++;
+    }
+
+    ok = ok && step_statement(target, DATALOGGER_STMT_BEGIN) == SQLITE_DONE;
+
+    long long rows = 0;
+    long long duplicates = 0;
+    for (int i = 0; i < count && ok; i++) {
+        // ORDER BY mantém a partição em ordem de tempo; o SQLite materializa o
+        // SELECT antes de inserir, então duplicatas dentro do mesmo banco são
+        // preservadas (mudança de porta e registro periódico no mesmo segundo)
+        char sql[768];
+        if (v2 && group[i]->samples) {
+            snprintf(sql, sizeof(sql),
+                     "INSERT INTO main.DataGrpSamples (CollectTime, Temp, Flags) "
+                     "SELECT s.CollectTime, s.Temp, s.Flags FROM boot%d.DataGrpSamples s "
+                     "WHERE s.CollectTime >= ?1 AND s.CollectTime < ?2 AND NOT EXISTS "
+                     "(SELECT 1 FROM main.DataGrpSamples d WHERE d.CollectTime = s.CollectTime) "
+                     "ORDER BY s.CollectTime, s.IndexID;", i);
+        } else if (v2) {
+            snprintf(sql, sizeof(sql),
+                     "INSERT INTO main.DataGrpSamples (CollectTime, Temp, Flags) "
+                     "SELECT s.CollectTime, CASE WHEN " DATA_FAILED_SQL("s.") " THEN NULL "
+                     "ELSE CAST(ROUND(s.Tprincipal * 10) AS INTEGER) END, "
+                     "CASE WHEN " DATA_FAILED_SQL("s.") " THEN 0 WHEN s.Porta THEN 7 ELSE 3 END "
+                     "FROM boot%d.DataGrpData s "
+                     "WHERE s.CollectTime >= ?1 AND s.CollectTime < ?2 AND NOT EXISTS "
+                     "(SELECT 1 FROM main.DataGrpSamples d WHERE d.CollectTime = s.CollectTime) "
+                     "ORDER BY s.CollectTime, s.IndexID;", i);
+        } else {
+            snprintf(sql, sizeof(sql),
+                     "INSERT INTO main.DataGrpData (CollectTime, Tprincipal, Porta) "
+                     "SELECT s.CollectTime, s.Tprincipal, s.Porta FROM boot%d.DataGrpData s "
+                     "WHERE s.CollectTime >= ?1 AND s.CollectTime < ?2 AND NOT EXISTS "
+                     "(SELECT 1 FROM main.DataGrpData d WHERE d.CollectTime = s.CollectTime) "
+                     "ORDER BY s.CollectTime, s.IndexID;", i);
+        }
+
+        char count_sql[160];
+        snprintf(count_sql, sizeof(count_sql),
+                 "SELECT COUNT(*) FROM boot%d.DataGrpData WHERE CollectTime >= ?1 AND CollectTime < ?2;", i);
+
+        sqlite3_stmt* count_stmt = NULL;
+        sqlite3_stmt* insert = NULL;
+        ok = sqlite3_prepare_v2(db, count_sql, -1, &count_stmt, NULL) == SQLITE_OK &&
+             sqlite3_prepare_v2(db, sql, -1, &insert, NULL) == SQLITE_OK;
+        if (ok) {
+            sqlite3_bind_int64(count_stmt, 1, period_start);
+            sqlite3_bind_int64(count_stmt, 2, period_end);
+            sqlite3_bind_int64(insert, 1, period_start);
+            sqlite3_bind_int64(insert, 2, period_end);
+            ok = sqlite3_step(count_stmt) == SQLITE_ROW;
+            long long in_period = ok ? sqlite3_column_int64(count_stmt, 0) : 0;
+            ok = ok && sqlite3_step(insert) == SQLITE_DONE;
+            if (ok) {
+                long long changes = sqlite3_changes(db);
+                rows += changes;
+                duplicates += in_period - changes;
+            }
+        }
+        sqlite3_finalize(count_stmt);
+        sqlite3_finalize(insert);
+    }
+
+    // DBInfo recalculado na mesma transação: MaxID/MinID e início dos dados
+    ok = ok && reconcile_db_info(target) && datalogger_update_db_info(target);
+    ok = ok && sqlite3_exec(db, "UPDATE DBInfo SET StartTime = MIN(StartTime, "
+                                "COALESCE((SELECT MIN(CollectTime) FROM DataGrpData), StartTime)) "
+                                "WHERE rowid = 1;", NULL, NULL, NULL) == SQLITE_OK;
+    ok = ok && (rows == 0 || sqlite3_exec(db, "PRAGMA user_version = 0;", NULL, NULL, NULL) == SQLITE_OK);
+    ok = ok && step_statement(target, DATALOGGER_STMT_COMMIT) == SQLITE_DONE;
+
+    if (!ok) {
+        fprintf(stderr, "Erro ao consolidar bancos por execução: %s\n", sqlite3_errmsg(db));
+        if (!sqlite3_get_autocommit(db)) {
+            step_statement(target, DATALOGGER_STMT_ROLLBACK);
+        }
+    }
+
+    for (int i = 0; i < attached; i++) {
+        char sql[32];
+        snprintf(sql, sizeof(sql), "DETACH DATABASE boot%d;", i);
+        sqlite3_exec(db, sql, NULL, NULL, NULL);
+    }
+
+    // MaxID/MinID voltam a refletir o banco (inclusive após falha); o último
+    // registro do escritor continua o mesmo, pois os consolidados são antigos
+    reconcile_db_info(target);
+    target->db_last_time = last_time;
+    target->db_last_porta = last_porta;
+    if (!ok) return false;
+
+    stats->rows += rows;
+    stats->duplicates += duplicates;
+    return true;
+}
+
+/**
+ * @brief Obtém ctx->lock para um lote da consolidação na partição em uso
+ *
+ * Com um snapshot em andamento o lote aguarda fora do lock: cada
+ * confirmação reiniciaria a cópia.
+ * @param ok Recebe false se a partição em uso mudou de mês
+ * @return true com ctx->lock mantido; false (sem o lock) se interrompido ou se a partição mudou
+ */
+static bool lock_live_partition(datalogger_context_t* ctx, long long period_start, bool* ok) {
+    pthread_mutex_lock(&ctx->lock);
+    while (ctx->db_export_hold && !__atomic_load_n(&ctx->merge_stop, __ATOMIC_RELAXED)) {
+        pthread_mutex_unlock(&ctx->lock);
+        sleep(1);
+        pthread_mutex_lock(&ctx->lock);
+    }
+    if (__atomic_load_n(&ctx->merge_stop, __ATOMIC_RELAXED)) {
+        pthread_mutex_unlock(&ctx->lock);
+        return false;
+    }
+    if (!ctx->db || ctx->db_part_start != period_start) {
+        pthread_mutex_unlock(&ctx->lock);
+        *ok = false;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Fim do próximo lote da partição em uso: no máximo per_source registros de cada banco
+ *
+ * O fim é sempre um CollectTime (ou period_end), então registros com o
+ * mesmo CollectTime ficam no mesmo lote e a deduplicação continua válida.
+ * @return Fim exclusivo do lote que começa em from
+ */
+static long long merge_chunk_end(sqlite3** readers, int count, long long from, long long period_end,
+                                 int per_source) {
+    long long end = period_end;
+    for (int i = 0; i < count; i++) {
+        sqlite3_stmt* stmt;
+        if (!readers[i] ||
+            sqlite3_prepare_v2(readers[i], "SELECT CollectTime FROM DataGrpData WHERE CollectTime >= ?1 "
+                                           "AND CollectTime < ?2 ORDER BY CollectTime LIMIT 1 OFFSET ?3;",
+                               -1, &stmt, NULL) != SQLITE_OK) {
+            continue;
+        }
+        sqlite3_bind_int64(stmt, 1, from);
+        sqlite3_bind_int64(stmt, 2, period_end);
+        sqlite3_bind_int(stmt, 3, per_source);
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            long long t = sqlite3_column_int64(stmt, 0);
+            if (t < end) end = t;
+        }
+        sqlite3_finalize(stmt);
+    }
+    // Mais de per_source registros com CollectTime = from: lote só com eles
+    return end > from ? end : from + 1;
+}
+
+/**
+ * @brief Consolida os bancos do grupo na partição em uso, em lotes de DATALOGGER_MERGE_CHUNK_ROWS
+ *
+ * A thread de consolidação roda com I/O idle: ctx->lock é mantido apenas
+ * durante um lote (INSERT ... SELECT limitado), nunca durante o mês
+ * inteiro, e o próximo lote é delimitado fora do lock. Cada lote é
+ * confirmado sozinho; uma interrupção entre lotes é retomada sem
+ * duplicatas pela deduplicação por CollectTime.
+ * @param complete Recebe false se a consolidação foi interrompida antes do fim do mês
+ * @return false em caso de erro ou se a partição em uso mudou de mês
+ */
+static bool merge_live_group(datalogger_context_t* ctx, merge_source_t** group, int count,
+                             long long period_start, long long period_end, datalogger_merge_stats_t* stats,
+                             bool* complete) {
+    sqlite3* readers[DATALOGGER_MERGE_ATTACH_MAX];
+    bool ok = true;
+    for (int i = 0; i < count; i++) {
+        if (sqlite3_open_v2(group[i]->path, &readers[i], SQLITE_OPEN_READONLY, NULL) != SQLITE_OK) {
+            fprintf(stderr, "Erro ao abrir %s: %s\n", group[i]->path, sqlite3_errmsg(readers[i]));
+            sqlite3_close(readers[i]);
+            readers[i] = NULL;
+            ok = false;
+        }
+    }
+
+    int per_source = DATALOGGER_MERGE_CHUNK_ROWS / count;
+    if (per_source < 1) per_source = 1;
+
+    long long from = period_start;
+    while (ok && from < period_end) {
+        long long to = merge_chunk_end(readers, count, from, period_end, per_source);
+
+        if (!lock_live_partition(ctx, period_start, &ok)) {
+            *complete = false;
+            break;
+        }
+        ok = commit_batch(ctx) && merge_group(ctx, group, count, from, to, stats);
+        pthread_mutex_unlock(&ctx->lock);
+        from = to;
+    }
+
+    for (int i = 0; i < count; i++) {
+        sqlite3_close(readers[i]);
+    }
+    return ok;
+}
+
+/**
+ * @brief Recalcula os agregados da partição em uso em trechos de um dia
+ *
+ * Cada trecho é uma transação própria sob ctx->lock; o escritor continua
+ * atualizando os agregados de forma incremental entre os trechos, o que
+ * não altera o resultado (um trecho recalcula tudo o que já foi gravado
+ * nele).
+ */
+static bool rebuild_live_rollups(datalogger_context_t* ctx, long long period_start) {
+    bool ok = true;
+    long long first = 0;
+    long long last = 0;
+    // user_version zerado até o último trecho: uma interrupção leva à
+    // reconstrução completa na próxima abertura do banco
+    if (!lock_live_partition(ctx, period_start, &ok)) return false;
+    ok = commit_batch(ctx) && sqlite3_exec(ctx->db, "PRAGMA user_version = 0;", NULL, NULL, NULL) == SQLITE_OK;
+    bool found = ok && collect_time_range(ctx->db, &first, &last);
+    pthread_mutex_unlock(&ctx->lock);
+
+    long long rows = 0;
+    for (int level = 0; found && ok && level < DATALOGGER_ROLLUP_COUNT; level++) {
+        long long end;
+        long long start = rollup_bucket((datalogger_rollup_t)level, first, &end);
+        rows = 0;
+        while (ok && start <= last) {
+            end = rollup_chunk_end((datalogger_rollup_t)level, start);
+            if (!lock_live_partition(ctx, period_start, &ok)) return false;
+
+            long long chunk = -1;
+            if (commit_batch(ctx) && step_statement(ctx, DATALOGGER_STMT_BEGIN) == SQLITE_DONE) {
+                chunk = rebuild_rollup_range(ctx, (datalogger_rollup_t)level, start, end);
+                if (chunk >= 0 && step_statement(ctx, DATALOGGER_STMT_COMMIT) != SQLITE_DONE) chunk = -1;
+                if (chunk < 0) {
+                    fprintf(stderr, "Erro ao recalcular agregados: %s\n", sqlite3_errmsg(ctx->db));
+                    if (!sqlite3_get_autocommit(ctx->db)) step_statement(ctx, DATALOGGER_STMT_ROLLBACK);
+                }
+            }
+            pthread_mutex_unlock(&ctx->lock);
+            ok = chunk >= 0;
+            rows += ok ? chunk : 0;
+            start = end;
+        }
+    }
+
+    if (!ok || !lock_live_partition(ctx, period_start, &ok)) return false;
+    char sql[64];
+    snprintf(sql, sizeof(sql), "PRAGMA user_version = %d;", DATALOGGER_ROLLUP_VERSION);
+    ok = commit_batch(ctx) && sqlite3_exec(ctx->db, sql, NULL, NULL, NULL) == SQLITE_OK;
+    if (ok) record_live_partition(ctx);
+    pthread_mutex_unlock(&ctx->lock);
+
+    if (ok && rows > 0) {
+        printf("📊 Agregados recalculados a partir de %lld registros\n", rows);
+    }
+    return ok;
+}
+
+/**
+ * @brief Consolida no mês [period_start, period_end) os bancos que o intersectam
+ * @return Registros copiados para a partição, ou -1 em caso de erro
+ */
+static long long merge_period(datalogger_context_t* ctx, merge_source_t* sources, int count,
+                              long long period_start, long long period_end,
+                              datalogger_merge_stats_t* stats) {
+    merge_source_t* group[DATALOGGER_MERGE_ATTACH_MAX];
+    int members = 0;
+    for (int i = 0; i < count; i++) {
+        if (merge_source_has_period(&sources[i], period_start)) members++;
+    }
+    if (members == 0) return 0;
+
+    char name[64];
+    datalogger_partition_name(ctx->device_name, period_start, name, sizeof(name));
+
+    // Mês da partição aberta: conexão do escritor, em lotes curtos sob ctx->lock
+    pthread_mutex_lock(&ctx->lock);
+    bool live = ctx->db && ctx->db_part_start == period_start;
+    pthread_mutex_unlock(&ctx->lock);
+
+    datalogger_context_t* target = ctx;
+    if (!live) {
+        target = calloc(1, sizeof(datalogger_context_t));
+        if (!target) return -1;
+        memcpy(target->device_name, ctx->device_name, sizeof(target->device_name));
+        target->db_profile = ctx->db_profile;
+        target->db_schema_target = ctx->db_schema_target;
+        pthread_mutex_init(&target->lock, NULL);
+        if (snprintf(target->db_file_path, sizeof(target->db_file_path), "%s/%s", ctx->db_dir, name) >=
+                (int)sizeof(target->db_file_path) ||
+            !open_database(target)) {
+            pthread_mutex_destroy(&target->lock);
+            free(target);
+            return -1;
+        }
+    }
+
+    long long rows_before = stats->rows;
+    bool ok = true;
+    int next = 0;
+    while (ok && next < count && !__atomic_load_n(&ctx->merge_stop, __ATOMIC_RELAXED)) {
+        int grouped = 0;
+        for (; next < count && grouped < DATALOGGER_MERGE_ATTACH_MAX; next++) {
+            if (merge_source_has_period(&sources[next], period_start)) {
+                group[grouped++] = &sources[next];
+            }
+        }
+        if (grouped == 0) break;
+
+        bool complete = true;
+        if (live) {
+            ok = merge_live_group(ctx, group, grouped, period_start, period_end, stats, &complete);
+        } else {
+            ok = merge_group(target, group, grouped, period_start, period_end, stats);
+        }
+
+        // Grupo interrompido no meio do mês: bancos mantidos para a próxima passada
+        for (int i = 0; i < grouped; i++) {
+            if (!ok) {
+                group[i]->failed = true;
+            } else if (complete) {
+                group[i]->pending--;
+            }
+        }
+    }
+
+    // Agregados recalculados uma vez por mês, com todos os grupos confirmados
+    long long rows = stats->rows - rows_before;
+    if (rows > 0) {
+        if (live) {
+            rebuild_live_rollups(ctx, period_start);
+        } else {
+            rebuild_rollups_locked(target);
+        }
+    }
+
+    if (target != ctx) {
+        datalogger_partition_t part;
+        memset(&part, 0, sizeof(part));
+        memcpy(part.name, name, sizeof(part.name));
+        part.period_start = period_start;
+        part.period_end = period_end;
+        bool measured = datalogger_partition_measure(target->db, &part);
+        close_database(target);
+        pthread_mutex_destroy(&target->lock);
+        free(target);
+
+        if (measured) {
+            pthread_mutex_lock(&ctx->lock);
+            if (ctx->catalog) datalogger_catalog_record(ctx->catalog, &part);
+            pthread_mutex_unlock(&ctx->lock);
+        }
+    }
+
+    if (ok && rows > 0) {
+        stats->partitions++;
+        printf("🧩 Consolidados %lld registros em %s\n", rows, name);
+    }
+    return ok ? rows : -1;
+}
+
+int datalogger_merge_boot_databases(datalogger_context_t* ctx, datalogger_merge_stats_t* stats) {
+    datalogger_merge_stats_t local;
+    if (!stats) stats = &local;
+    memset(stats, 0, sizeof(*stats));
+    if (!ctx) return -1;
+
+    pthread_mutex_lock(&ctx->lock);
+    bool ready = ctx->db_partitioned && ctx->db && ctx->catalog;
+    long long live_start = ctx->db_part_start;
+    pthread_mutex_unlock(&ctx->lock);
+    if (!ready) {
+        fprintf(stderr, "Erro: consolidação requer partições mensais e catálogo abertos\n");
+        return -1;
+    }
+
+    long long start = monotonic_ns();
+    merge_source_t* sources = NULL;
+    int count = list_boot_databases(ctx, &sources, stats);
+    if (count <= 0) {
+        free(sources);
+        return count;
+    }
+
+    // Meses de cada banco a consolidar (anteriores à retenção são descartados)
+    long long keep_from = merge_retention_start(ctx, live_start);
+    long long first_period = 0;
+    long long last_time = 0;
+    for (int i = 0; i < count; i++) {
+        merge_source_t* src = &sources[i];
+        if (!probe_merge_source(src, keep_from)) {
+            fprintf(stderr, "Erro ao ler banco por execução %s (mantido)\n", src->path);
+            src->failed = true;
+            continue;
+        }
+        stats->expired += src->expired;
+        if (src->period_count == 0) continue;
+
+        if (first_period == 0 || src->periods[0] < first_period) first_period = src->periods[0];
+        if (src->last_time > last_time) last_time = src->last_time;
+    }
+
+    long long period_start = first_period;
+    long long period_end = 0;
+    bool ok = true;
+    while (first_period != 0 && period_start <= last_time &&
+           !__atomic_load_n(&ctx->merge_stop, __ATOMIC_RELAXED)) {
+        datalogger_partition_period(period_start, &period_start, &period_end);
+        if (merge_period(ctx, sources, count, period_start, period_end, stats) < 0) ok = false;
+        period_start = period_end;
+    }
+
+    // Bancos cujos meses foram todos confirmados são removidos
+    int merged = 0;
+    for (int i = 0; i < count; i++) {
+        merge_source_t* src = &sources[i];
+        if (src->failed || src->pending > 0) {
+            stats->kept++;
+            continue;
+        }
+        if (unlink(src->path) != 0) {
+            fprintf(stderr, "Erro ao remover %s: %s\n", src->path, strerror(errno));
+            stats->kept++;
+            continue;
+        }
+        merged++;
+    }
+    if (merged > 0) fsync_path(ctx->db_dir, O_RDONLY | O_DIRECTORY);
+    for (int i = 0; i < count; i++) {
+        free(sources[i].periods);
+    }
+    free(sources);
+
+    stats->sources = merged;
+    stats->elapsed_ms = (monotonic_ns() - start) / 1000000;
+    double seconds = (double)stats->elapsed_ms / 1000.0;
+    printf("🧩 Consolidação: %d bancos por execução em %d partições, %lld registros "
+           "(%lld duplicados, %lld fora da retenção, %d mantidos) em %lld ms (%.0f registros/s)\n",
+           merged, stats->partitions, stats->rows, stats->duplicates, stats->expired, stats->kept,
+           stats->elapsed_ms, seconds > 0 ? (double)stats->rows / seconds : 0.0);
+    return ok ? merged : -1;
+}
+
+/**
+ * @brief Thread de consolidação (uma passada)
+ */
+static void* merge_thread_main(void* arg) {
+    datalogger_context_t* ctx = arg;
+
+    thread_priority_lower("Consolidação");
+    datalogger_merge_boot_databases(ctx, NULL);
+    return NULL;
+}
+
+bool datalogger_merge_start(datalogger_context_t* ctx) {
+    if (!ctx || ctx->merge_running) return false;
+
+    __atomic_store_n(&ctx->merge_stop, false, __ATOMIC_RELAXED);
+    if (pthread_create(&ctx->merge_thread, NULL, merge_thread_main, ctx) != 0) {
+        fprintf(stderr, "Erro ao criar thread de consolidação\n");
+        return false;
+    }
+    ctx->merge_running = true;
+    return true;
+}
+
+void datalogger_merge_stop(datalogger_context_t* ctx) {
+    if (!ctx || !ctx->merge_running) return;
+
+    __atomic_store_n(&ctx->merge_stop, true, __ATOMIC_RELAXED);
+    pthread_join(ctx->merge_thread, NULL);
+    ctx->merge_running = false;
+}
+
+/**
+ * @brief Finaliza o banco de dados SQLite
+ */
+void datalogger_cleanup_database(datalogger_context_t* ctx) {
+    if (!ctx) return;
+
+    // Consolidação usa a partição aberta e o catálogo
+    datalogger_merge_stop(ctx);
+
+    if (ctx->db_partitioned) {
+        close_partition(ctx);
+    } else {
+        close_database(ctx);
+    }
 
-        printf("📊 Banco SQLite finalizado\n");
+    if (ctx->catalog) {
+        datalogger_catalog_close(ctx->catalog);
+        ctx->catalog = NULL;
     }
 }
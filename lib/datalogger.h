@@ -11,23 +11,188 @@
 #include <stdbool.h>
 #include <time.h>
 #include <stdio.h>
+#include <pthread.h>
 #include <sqlite3.h>
 #include "modbus.h"
+#include "ring_store.h"
+#include "ts_block.h"
+#include "datalogger_vfs.h"
+#include "datalogger_catalog.h"
+#include "datalogger_csv.h"
 
 // Configurações do DataLogger
 #define DATALOGGER_LOG_DIR "/home/nova"
 #define DATALOGGER_MAX_PATH 512
 #define DATALOGGER_MAX_LINE 1024
+#define DATALOGGER_TXT_CRC_ENABLED false  // Coluna CRC32 no log TXT (opcional: muda o formato lido por terceiros)
+#define DATALOGGER_RECOVERY_WINDOW 4096   // Bytes lidos por vez do fim do arquivo na recuperação
+#define DATALOGGER_RING_CAPACITY 262144   // Registros no anel binário de amostras brutas (4 MB)
+
+// Perfil de durabilidade padrão do banco SQLite
+#define DATALOGGER_DB_JOURNAL_MODE "WAL"      // Modo de journal (WAL, DELETE, TRUNCATE, ...)
+#define DATALOGGER_DB_SYNCHRONOUS 1           // 0=OFF, 1=NORMAL, 2=FULL, 3=EXTRA
+// Registros ainda não confirmados se perdem em qualquer queda do processo ou
+// de energia; com WAL e synchronous=NORMAL, uma queda de energia pode perder
+// também as confirmações desde o último checkpoint. Lotes maiores trocam
+// essa janela por menos escritas no cartão (o log TXT grava cada registro).
+#define DATALOGGER_DB_BATCH_ROWS 1            // Registros por transação (1 = confirma cada registro)
+#define DATALOGGER_DB_BATCH_SECONDS 300       // Tempo máximo de uma transação aberta (0 = sem limite; um intervalo do log periódico)
+#define DATALOGGER_DB_CHECKPOINT_PAGES 1000   // Páginas no WAL que disparam checkpoint automático
+#define DATALOGGER_ROLLUP_VERSION 2           // Versão das tabelas de agregados (PRAGMA user_version; 2 = sem leituras inválidas)
+#define DATALOGGER_SNAPSHOT_STEP_PAGES 128    // Páginas copiadas por passo do snapshot (escritor bloqueado no máximo um passo)
+#define DATALOGGER_SNAPSHOT_CHUNK_BYTES 65536 // Bloco entregue por vez pelo snapshot em fluxo
+
+// Memória e páginas do SQLite (0 = padrão do SQLite)
+#define DATALOGGER_DB_CACHE_KB 1024           // PRAGMA cache_size por conexão, em KiB
+#define DATALOGGER_DB_MMAP_BYTES 0            // PRAGMA mmap_size (leituras mapeadas em memória)
+#define DATALOGGER_DB_PAGE_SIZE 1024          // PRAGMA page_size, aplicado apenas na criação do banco
+#define DATALOGGER_DB_TEMP_STORE 2            // PRAGMA temp_store: 1=arquivo, 2=memória
+#define DATALOGGER_DB_JOURNAL_LIMIT_KB 1024   // PRAGMA journal_size_limit (WAL truncado após checkpoint)
+
+// Esquema de armazenamento (DBInfo.version)
+#define DATALOGGER_DB_SCHEMA_V1 1             // DataGrpData com Tprincipal REAL e AUTOINCREMENT
+#define DATALOGGER_DB_SCHEMA_V2 2             // DataGrpSamples compacta + visão DataGrpData
+#define DATALOGGER_DB_SCHEMA_LATEST DATALOGGER_DB_SCHEMA_V2
+#define DATALOGGER_DB_SCHEMA_VERSION DATALOGGER_DB_SCHEMA_V1  // Esquema de bancos novos (bancos antigos são migrados até ele)
+
+// Partições mensais e retenção
+#define DATALOGGER_DB_PARTITIONED true        // Um banco por mês (NOME_AAAAMM.db) em vez de um por execução
+#define DATALOGGER_RETENTION_MONTHS 24        // Meses mantidos, incluindo o atual (0 = sem limite)
+#define DATALOGGER_RETENTION_MIN_FREE_MB 256  // Espaço livre mínimo no cartão (0 = sem limite)
+#define DATALOGGER_RETENTION_CHECK_SECONDS 3600  // Intervalo entre verificações de retenção
+#define DATALOGGER_MERGE_BOOT_DBS true        // Consolidar bancos por execução (NOME_AAAAMMDD_HHMMSS.db) nas partições
+#define DATALOGGER_MERGE_ATTACH_MAX 8         // Bancos anexados por transação de consolidação (SQLite permite 10)
+#define DATALOGGER_MERGE_CHUNK_ROWS 2000      // Registros por transação (e por posse do lock) na partição em uso
+
+#define DATALOGGER_DB_PROFILE_DEFAULT { \
+    DATALOGGER_DB_JOURNAL_MODE, DATALOGGER_DB_SYNCHRONOUS, DATALOGGER_DB_BATCH_ROWS, \
+    DATALOGGER_DB_BATCH_SECONDS, DATALOGGER_DB_CHECKPOINT_PAGES, \
+    DATALOGGER_DB_CACHE_KB, DATALOGGER_DB_MMAP_BYTES, DATALOGGER_DB_PAGE_SIZE, \
+    DATALOGGER_DB_TEMP_STORE, DATALOGGER_DB_JOURNAL_LIMIT_KB }
+
+// Perfil de durabilidade e de memória do banco SQLite (campos de memória 0 = padrão do SQLite)
+typedef struct {
+    const char* journal_mode;   // Valor de PRAGMA journal_mode
+    int synchronous;            // Valor de PRAGMA synchronous
+    uint32_t batch_rows;        // Registros por transação explícita
+    uint32_t batch_seconds;     // Tempo máximo até confirmar uma transação parcial
+    int checkpoint_pages;       // PRAGMA wal_autocheckpoint (0 = padrão do SQLite)
+    uint32_t cache_kb;          // PRAGMA cache_size em KiB
+    uint32_t mmap_bytes;        // PRAGMA mmap_size
+    uint32_t page_size;         // PRAGMA page_size (potência de 2 entre 512 e 65536; só em bancos novos)
+    int temp_store;             // PRAGMA temp_store (1=arquivo, 2=memória)
+    uint32_t journal_limit_kb;  // PRAGMA journal_size_limit em KiB
+} datalogger_db_profile_t;
+
+// Resultado da recuperação do final de um log TXT após queda de energia
+typedef struct {
+    long original_size;         // Tamanho do arquivo antes da recuperação
+    long recovered_size;        // Tamanho após truncar no último registro válido
+    long bytes_lost;            // Bytes descartados do final do arquivo
+    uint32_t lines_lost;        // Linhas descartadas (incluindo linha parcial)
+    bool truncated;             // true se o arquivo foi truncado
+} datalogger_recovery_info_t;
+
+// Destinos de escrita contabilizados nas estatísticas
+typedef enum {
+    DATALOGGER_SINK_TXT = 0,    // Log TXT
+    DATALOGGER_SINK_DB,         // Banco SQLite
+    DATALOGGER_SINK_RING,       // Anel binário de amostras brutas
+    DATALOGGER_SINK_COUNT
+} datalogger_sink_t;
+
+// Estatísticas de um destino de escrita
+typedef struct {
+    uint64_t bytes_written;     // Bytes escritos (DB: inclui journal/WAL, medido pelo VFS)
+    uint64_t records;           // Registros gravados com sucesso
+    uint64_t errors;            // Falhas de escrita
+    uint64_t syncs;             // Chamadas de sincronização com o disco
+    long long last_commit_ms;   // Timestamp (ms desde epoch) do último registro gravado
+    uint32_t write_latency[DATALOGGER_LATENCY_BUCKETS];  // Histograma log2 (µs) por registro
+    uint32_t sync_latency[DATALOGGER_LATENCY_BUCKETS];   // Histograma log2 (µs) por sincronização
+} datalogger_sink_stats_t;
+
+// Estatísticas acumuladas do datalogger
+typedef struct {
+    datalogger_sink_stats_t sinks[DATALOGGER_SINK_COUNT];
+} datalogger_stats_t;
+
+// Statements SQL preparados uma única vez e reutilizados
+typedef enum {
+    DATALOGGER_STMT_INSERT_DATA = 0,    // INSERT em DataGrpData
+    DATALOGGER_STMT_UPDATE_INFO,        // UPDATE de DBInfo
+    DATALOGGER_STMT_BEGIN,              // Início de transação
+    DATALOGGER_STMT_COMMIT,             // Confirmação de transação
+    DATALOGGER_STMT_ROLLBACK,           // Descarte de transação
+    DATALOGGER_STMT_SAVEPOINT,          // Ponto de salvamento de um registro dentro do lote
+    DATALOGGER_STMT_RELEASE,            // Confirmação do ponto de salvamento
+    DATALOGGER_STMT_ROLLBACK_TO,        // Descarte apenas do registro com falha
+    DATALOGGER_STMT_QUERY_RAW,          // Registros de um intervalo de tempo
+    DATALOGGER_STMT_QUERY_BUCKETS,      // Agregados por intervalo fixo
+    DATALOGGER_STMT_ROLLUP_HOURLY,      // UPSERT em RollupHourly
+    DATALOGGER_STMT_ROLLUP_DAILY,       // UPSERT em RollupDaily
+    DATALOGGER_STMT_QUERY_HOURLY,       // Leitura de RollupHourly
+    DATALOGGER_STMT_QUERY_DAILY,        // Leitura de RollupDaily
+    DATALOGGER_STMT_COUNT
+} datalogger_stmt_id_t;
+
+// Níveis de agregados mantidos pelo escritor
+typedef enum {
+    DATALOGGER_ROLLUP_HOURLY = 0,       // Por hora (UTC)
+    DATALOGGER_ROLLUP_DAILY,            // Por dia (meia-noite local)
+    DATALOGGER_ROLLUP_COUNT
+} datalogger_rollup_t;
+
+// Resultado da consolidação dos bancos por execução
+typedef struct {
+    int sources;                // Bancos consolidados e removidos
+    int kept;                   // Bancos mantidos (journal pendente, ilegíveis ou com falha)
+    int partitions;             // Partições que receberam registros
+    long long rows;             // Registros copiados
+    long long duplicates;       // Registros descartados (CollectTime já presente na partição)
+    long long expired;          // Registros anteriores à janela de retenção (não copiados)
+    long long elapsed_ms;       // Duração total
+} datalogger_merge_stats_t;
 
 // Estrutura para configuração do datalogger
 typedef struct {
     char device_name[32];       // Nome do dispositivo (ex: "NI00002")
     char log_file_path[DATALOGGER_MAX_PATH];  // Caminho completo do arquivo de log TXT
     char db_file_path[DATALOGGER_MAX_PATH];   // Caminho completo do arquivo de banco SQLite
+    char ring_file_path[DATALOGGER_MAX_PATH]; // Caminho do anel binário de amostras brutas
     uint32_t record_counter;    // Contador de registros
     bool initialized;           // Flag de inicialização
+    bool txt_crc;               // Anexa CRC32 a cada linha do log TXT
     FILE* log_file;            // Handle do arquivo de log TXT
     sqlite3* db;               // Handle do banco de dados SQLite
+    sqlite3_stmt* stmts[DATALOGGER_STMT_COUNT];  // Cache de statements (preparados em datalogger_init_database)
+    long long db_min_id;       // Menor IndexID de DataGrpData (0 se vazia), mantido pelo escritor
+    long long db_max_id;       // Maior IndexID de DataGrpData (0 se vazia), mantido pelo escritor
+    long long db_last_time;    // CollectTime do último registro (tempo de porta aberta nos agregados)
+    int db_last_porta;         // Porta do último registro (-1 se não há registro)
+    bool rollup_rebuild;       // Agregados recriados: recalcular a partir de DataGrpData
+    int db_schema_target;      // Esquema desejado (0 = DATALOGGER_DB_SCHEMA_VERSION)
+    int db_schema;             // Esquema do banco aberto (DBInfo.version)
+    datalogger_db_profile_t db_profile;  // Perfil de durabilidade (padrão se journal_mode for NULL)
+    bool db_partitioned;       // Partições mensais em db_dir (db_file_path definido ao abrir o banco)
+    char db_dir[DATALOGGER_MAX_PATH];  // Diretório das partições e do catálogo
+    long long db_part_start;   // Início do mês da partição aberta (ms)
+    long long db_part_end;     // Início do mês seguinte (ms)
+    datalogger_catalog_t* catalog;  // Catálogo de partições (NULL se não particionado)
+    int retention_months;      // Meses mantidos (0 = sem limite)
+    uint32_t retention_min_free_mb;  // Espaço livre mínimo em MB (0 = sem limite)
+    time_t retention_checked;  // Última verificação de retenção
+    bool db_txn_open;          // Transação de lote aberta
+    uint32_t db_txn_rows;      // Registros na transação de lote aberta
+    long long db_txn_start_ns; // Início da transação de lote (tempo monotônico)
+    bool db_export_hold;       // Exportação em andamento: confirmações adiadas
+    pthread_t merge_thread;    // Thread de consolidação dos bancos por execução
+    bool merge_running;        // merge_thread criada e ainda não aguardada
+    bool merge_stop;           // Interrupção da consolidação solicitada (acesso atômico)
+    pthread_mutex_t lock;      // Serializa escritores (loop principal) e exportação USB
+    ring_store_t* ring;        // Anel binário de amostras brutas (NULL se indisponível)
+    uint32_t stats_seq;        // Seqlock das estatísticas (ímpar durante atualização)
+    datalogger_stats_t stats;  // Estatísticas mantidas pelos escritores
 } datalogger_context_t;
 
 // Estrutura para um registro de dados (formato TXT)
@@ -42,12 +207,35 @@ typedef struct {
 
 // Estrutura para registro no banco SQLite (sem coluna Degelo)
 typedef struct {
-    int IndexID;               // Chave primária (auto-incremento)
+    int IndexID;               // Chave primária (rowid; AUTOINCREMENT apenas no v1)
     long long CollectTime;     // Timestamp em milissegundos
     float Tprincipal;          // Temperatura principal em °C (2 casas decimais)
     int Porta;                 // Status da porta (0=fechada, 1=aberta)
+    int Traw;                  // Temperatura bruta do 0x200 em décimos de °C (esquema v2)
+    uint8_t Flags;             // TS_FLAG_* de validade e porta aberta (esquema v2)
 } datalogger_db_record_t;
 
+// Resultado de consulta por intervalo de tempo (um registro ou um agregado)
+typedef struct {
+    long long bucket_start;    // Início do intervalo (ms, alinhado a múltiplos de bucket_ms desde epoch)
+    long long first_time;      // CollectTime do primeiro registro do intervalo
+    long long last_time;       // CollectTime do último registro do intervalo
+    uint32_t count;            // Registros no intervalo
+    uint32_t door_open_count;  // Registros com porta aberta
+    double temp_min;           // Menor Tprincipal (°C)
+    double temp_max;           // Maior Tprincipal (°C)
+    double temp_avg;           // Média de Tprincipal (°C)
+    long long door_open_ms;    // Tempo com porta aberta no intervalo (apenas agregados mantidos)
+} datalogger_query_row_t;
+
+/**
+ * @brief Callback de consulta por intervalo
+ * @param row Resultado (válido apenas durante a chamada)
+ * @param user Dado do chamador
+ * @return true para continuar, false para interromper a consulta
+ */
+typedef bool (*datalogger_query_cb_t)(const datalogger_query_row_t* row, void* user);
+
 // Estrutura para informações do banco (tabela DBInfo)
 typedef struct {
     int version;               // Versão do banco
@@ -83,6 +271,17 @@ void datalogger_cleanup(datalogger_context_t* ctx);
  */
 bool datalogger_log_data(datalogger_context_t* ctx, const modbus_data_t* modbus_data);
 
+/**
+ * @brief Registra a amostra bruta no anel binário (uma entrada por registrador)
+ *
+ * Destinado a cada ciclo de leitura: o custo é uma cópia de memória por
+ * registrador, sem formatação de texto nem transação SQLite.
+ * @param ctx Contexto do datalogger
+ * @param modbus_data Dados lidos do Modbus
+ * @return true se registro foi bem-sucedido, false caso contrário
+ */
+bool datalogger_log_raw(datalogger_context_t* ctx, const modbus_data_t* modbus_data);
+
 /**
  * @brief Obtém data e hora do RTC do sistema
  * @param tm_info Estrutura para armazenar data/hora
@@ -97,6 +296,19 @@ bool datalogger_get_rtc_time(struct tm* tm_info);
  */
 bool datalogger_create_header(datalogger_context_t* ctx);
 
+/**
+ * @brief Recupera o final de um log TXT interrompido (ex: queda de energia)
+ *
+ * Lê o arquivo de trás para frente a partir do fim, em janelas de
+ * DATALOGGER_RECOVERY_WINDOW bytes, e trunca no último registro válido
+ * (linha completa e, se presente, com CRC correto). O custo depende apenas
+ * do tamanho do trecho danificado, não do tamanho do arquivo.
+ * @param path Caminho do arquivo de log TXT
+ * @param info Estrutura para o relatório da recuperação (pode ser NULL)
+ * @return true se o arquivo foi verificado (e reparado, se necessário), false em caso de erro
+ */
+bool datalogger_recover_txt_log(const char* path, datalogger_recovery_info_t* info);
+
 /**
  * @brief Converte dados Modbus para registro do datalogger
  * @param modbus_data Dados do Modbus
@@ -123,7 +335,19 @@ bool datalogger_write_record(datalogger_context_t* ctx, const datalogger_record_
 void datalogger_sync(datalogger_context_t* ctx);
 
 /**
- * @brief Obtém informações sobre o arquivo de log atual
+ * @brief Obtém uma cópia consistente das estatísticas de escrita
+ *
+ * Leitura sem bloqueio (seqlock) e sem I/O: pode ser chamada de qualquer
+ * thread enquanto os escritores continuam gravando. Os bytes e
+ * sincronizações do banco vêm dos contadores do VFS datalogger.
+ * @param ctx Contexto do datalogger
+ * @param out Estrutura a ser preenchida
+ * @return true se a cópia foi obtida, false caso contrário
+ */
+bool datalogger_get_stats(const datalogger_context_t* ctx, datalogger_stats_t* out);
+
+/**
+ * @brief Obtém informações sobre o arquivo de log atual (sem acessar o arquivo)
  * @param ctx Contexto do datalogger
  * @param file_size Ponteiro para armazenar tamanho do arquivo (pode ser NULL)
  * @param record_count Ponteiro para armazenar número de registros (pode ser NULL)
@@ -139,6 +363,10 @@ void datalogger_print_stats(datalogger_context_t* ctx);
 
 /**
  * @brief Inicializa o banco de dados SQLite
+ *
+ * Com db_partitioned, abre a partição do mês atual em db_dir, reconcilia
+ * o catálogo com o diretório e aplica a política de retenção; as
+ * inserções trocam de partição quando CollectTime muda de mês.
  * @param ctx Contexto do datalogger
  * @return true se inicialização foi bem-sucedida, false caso contrário
  */
@@ -146,6 +374,11 @@ bool datalogger_init_database(datalogger_context_t* ctx);
 
 /**
  * @brief Cria as tabelas do banco de dados
+ *
+ * Bancos novos são criados no esquema db_schema_target; bancos existentes
+ * são migrados passo a passo a partir de DBInfo.version, cada passo em uma
+ * transação. No esquema v2, DataGrpData é uma visão sobre DataGrpSamples
+ * com o layout do v1 (inválidos como 0), para leitores existentes.
  * @param ctx Contexto do datalogger
  * @return true se criação foi bem-sucedida, false caso contrário
  */
@@ -171,11 +404,220 @@ bool datalogger_insert_db_record(datalogger_context_t* ctx,
 
 /**
  * @brief Atualiza informações do banco (tabela DBInfo)
+ *
+ * Grava MaxID/MinID mantidos em memória pelo escritor (sem varrer
+ * DataGrpData) e EndTime com a hora atual. Chamada dentro da transação
+ * de cada inserção; os valores são reconciliados com a tabela ao abrir
+ * o banco.
  * @param ctx Contexto do datalogger
  * @return true se atualização foi bem-sucedida, false caso contrário
  */
 bool datalogger_update_db_info(datalogger_context_t* ctx);
 
+/**
+ * @brief Consulta registros ou agregados de um intervalo de tempo
+ *
+ * Usa o índice de CollectTime e agrega no próprio SQLite; os resultados
+ * são entregues um a um ao callback, sem montar listas em memória. Com
+ * partições mensais, apenas as partições do catálogo que intersectam o
+ * intervalo são anexadas, uma por vez. O callback roda com o contexto
+ * bloqueado e deve retornar rapidamente.
+ * @param ctx Contexto do datalogger
+ * @param from_ms Início do intervalo (ms desde epoch, inclusivo)
+ * @param to_ms Fim do intervalo (ms desde epoch, inclusivo)
+ * @param bucket_ms Tamanho do agregado em ms (0 = registros individuais)
+ * @param callback Função chamada para cada resultado, em ordem de tempo
+ * @param user Dado repassado ao callback
+ * @return Número de resultados entregues, ou -1 em caso de erro
+ */
+int datalogger_query_range(datalogger_context_t* ctx, long long from_ms, long long to_ms,
+                           long long bucket_ms, datalogger_query_cb_t callback, void* user);
+
+/**
+ * @brief Consulta os agregados horários ou diários de um intervalo de tempo
+ *
+ * Lê RollupHourly/RollupDaily, mantidas na mesma transação de cada
+ * inserção: relatórios de um ano leem centenas de linhas em vez de
+ * centenas de milhares. O tempo de porta aberta é contado entre registros
+ * consecutivos e dividido nas fronteiras dos intervalos; o trecho após o
+ * último registro só é contado quando o próximo registro chega.
+ * @param ctx Contexto do datalogger
+ * @param level DATALOGGER_ROLLUP_HOURLY ou DATALOGGER_ROLLUP_DAILY
+ * @param from_ms Início do primeiro intervalo (ms desde epoch, inclusivo)
+ * @param to_ms Início do último intervalo (ms desde epoch, inclusivo)
+ * @param callback Função chamada para cada intervalo, em ordem de tempo
+ * @param user Dado repassado ao callback
+ * @return Número de resultados entregues, ou -1 em caso de erro
+ */
+int datalogger_query_rollup(datalogger_context_t* ctx, datalogger_rollup_t level,
+                            long long from_ms, long long to_ms,
+                            datalogger_query_cb_t callback, void* user);
+
+/**
+ * @brief Recalcula RollupHourly e RollupDaily a partir de DataGrpData
+ *
+ * Executado automaticamente ao abrir um banco cujo PRAGMA user_version
+ * é anterior a DATALOGGER_ROLLUP_VERSION (tabelas recriadas). No v1,
+ * linhas com 0,0 °C e porta 0 são tratadas como falha de leitura.
+ * @param ctx Contexto do datalogger
+ * @return true se os agregados foram recalculados, false em caso de erro
+ */
+bool datalogger_rebuild_rollups(datalogger_context_t* ctx);
+
+/**
+ * @brief Compacta um intervalo de DataGrpData em blocos na tabela DataGrpBlocks
+ *
+ * Cada linha de DataGrpBlocks guarda um bloco ts_block (BLOB) com seu
+ * intervalo de tempo, contagem e temperatura mínima/máxima, permitindo
+ * descartar blocos por tempo ou faixa de temperatura sem decodificá-los.
+ * As linhas originais de DataGrpData não são removidas. Roda sob o lock
+ * do contexto: o lote pendente é confirmado antes e os blocos ficam em um
+ * savepoint próprio, desfeito sozinho em caso de erro.
+ * @param ctx Contexto do datalogger
+ * @param from_ms Início do intervalo (ms desde epoch, inclusivo)
+ * @param to_ms Fim do intervalo (ms desde epoch, inclusivo)
+ * @return Número de blocos gravados, ou -1 em caso de erro
+ */
+int datalogger_archive_blocks(datalogger_context_t* ctx, long long from_ms, long long to_ms);
+
+/**
+ * @brief Confirma a transação de lote pendente
+ * @param ctx Contexto do datalogger
+ * @return true se não havia lote pendente ou se foi confirmado, false em caso de erro
+ */
+bool datalogger_db_flush(datalogger_context_t* ctx);
+
+/**
+ * @brief Confirma a transação de lote se ela estiver aberta há mais de batch_seconds
+ *
+ * Deve ser chamada periodicamente pelo loop principal, pois entre registros
+ * periódicos pode não haver nenhuma inserção para disparar a confirmação.
+ * @param ctx Contexto do datalogger
+ */
+void datalogger_db_flush_if_due(datalogger_context_t* ctx);
+
+/**
+ * @brief Prepara o banco para cópia externa (exportação USB)
+ *
+ * Confirma o lote pendente, transfere o WAL para o arquivo principal e
+ * volta ao journal DELETE, deixando o .db autocontido (sem -wal/-shm).
+ * Até datalogger_db_end_export(), novos registros ficam em uma transação
+ * aberta, com cache_spill desligado, e o arquivo principal não é
+ * modificado.
+ * @param ctx Contexto do datalogger
+ * @return true se o arquivo está pronto para cópia, false caso contrário
+ */
+bool datalogger_db_begin_export(datalogger_context_t* ctx);
+
+/**
+ * @brief Retoma o perfil de durabilidade após a cópia externa
+ * @param ctx Contexto do datalogger
+ */
+void datalogger_db_end_export(datalogger_context_t* ctx);
+
+/**
+ * @brief Callback de progresso do snapshot
+ * @param bytes_done Bytes já copiados
+ * @param bytes_total Tamanho do banco de origem em bytes (pode crescer durante a cópia)
+ * @param user Dado do chamador
+ */
+typedef void (*datalogger_snapshot_cb_t)(uint64_t bytes_done, uint64_t bytes_total, void* user);
+
+/**
+ * @brief Copia o banco em uso para dest_path sem interromper o escritor
+ *
+ * Confirma o lote pendente e copia o banco com a API de backup do SQLite
+ * por uma conexão separada, DATALOGGER_SNAPSHOT_STEP_PAGES páginas por
+ * passo; o escritor espera no máximo um passo. Registros confirmados
+ * durante a cópia fazem o SQLite reiniciá-la, então o resultado é sempre
+ * um estado confirmado do banco. A cópia é gravada em dest_path.tmp,
+ * sincronizada e renomeada: dest_path nunca fica parcial, e o arquivo é
+ * autocontido (journal DELETE, sem -wal/-shm).
+ * @param ctx Contexto do datalogger
+ * @param dest_path Caminho do arquivo de destino (substituído se existir)
+ * @param progress Callback de progresso (pode ser NULL)
+ * @param user Dado repassado ao callback
+ * @return true se o snapshot foi gravado, false em caso de erro
+ */
+bool datalogger_snapshot(datalogger_context_t* ctx, const char* dest_path,
+                         datalogger_snapshot_cb_t progress, void* user);
+
+/**
+ * @brief Destino do snapshot em fluxo
+ * @param data Bloco do arquivo, na ordem do arquivo
+ * @param len Bytes do bloco
+ * @param user Dado do chamador
+ * @return 0 para continuar, -1 para interromper
+ */
+typedef int (*datalogger_snapshot_sink_t)(const void* data, size_t len, void* user);
+
+/**
+ * @brief Entrega o banco em uso em blocos, do início ao fim do arquivo, sem interromper o escritor
+ *
+ * Mesma cópia consistente de datalogger_snapshot(), feita em um banco em
+ * memória (do tamanho do banco em uso: uma partição mensal) e entregue
+ * em blocos de DATALOGGER_SNAPSHOT_CHUNK_BYTES uma única vez, em ordem. O
+ * destino pode calcular o CRC e gravar em vários arquivos sem reler o
+ * que foi gravado. O arquivo entregue é autocontido (journal DELETE).
+ * @param ctx Contexto do datalogger
+ * @param sink Destino dos blocos
+ * @param user Dado repassado ao destino
+ * @return Bytes entregues, ou -1 em caso de erro ou interrupção pelo destino
+ */
+long long datalogger_snapshot_stream(datalogger_context_t* ctx, datalogger_snapshot_sink_t sink, void* user);
+
+/**
+ * @brief Exporta os registros de um intervalo de tempo em CSV (planilha) sem interromper o escritor
+ *
+ * Confirma o lote pendente e, sob o lock, apenas monta a lista de bancos
+ * do intervalo (partições do catálogo e o banco em uso, em ordem de
+ * tempo). A leitura usa conexões próprias, só de leitura, fora do lock:
+ * o escritor continua gravando durante a exportação. As linhas passam por
+ * datalogger_csv_write_db(), com memória fixa independente do intervalo.
+ * @param ctx Contexto do datalogger
+ * @param dest_path Caminho da planilha (gravada em dest_path.tmp e renomeada)
+ * @param from_ms Início do intervalo (ms desde epoch, inclusivo)
+ * @param to_ms Fim do intervalo (ms desde epoch, inclusivo)
+ * @param gzip Compactar em formato gzip durante a gravação
+ * @param stats Resultado (pode ser NULL)
+ * @return true se a planilha foi gravada, false em caso de erro
+ */
+bool datalogger_export_csv(datalogger_context_t* ctx, const char* dest_path, long long from_ms,
+                           long long to_ms, bool gzip, datalogger_csv_stats_t* stats);
+
+/**
+ * @brief Consolida os bancos por execução do dispositivo nas partições mensais
+ *
+ * Bancos NOME_AAAAMMDD_HHMMSS.db selados (sem journal ou WAL pendente) são
+ * anexados em grupos de até DATALOGGER_MERGE_ATTACH_MAX e copiados para a
+ * partição de cada mês com INSERT ... SELECT em uma única transação por
+ * grupo, junto com o recálculo de DBInfo. Registros cujo CollectTime já
+ * existe na partição são descartados, então repetir a consolidação após
+ * uma interrupção não duplica dados. Meses anteriores à janela de retenção
+ * não são copiados. Cada banco é removido quando todos os seus meses foram
+ * confirmados. Requer partições (db_partitioned).
+ * @param ctx Contexto do datalogger (banco aberto)
+ * @param stats Resultado da consolidação (pode ser NULL)
+ * @return Número de bancos consolidados, ou -1 em caso de erro
+ */
+int datalogger_merge_boot_databases(datalogger_context_t* ctx, datalogger_merge_stats_t* stats);
+
+/**
+ * @brief Inicia a consolidação dos bancos por execução em segundo plano
+ *
+ * A thread roda com prioridade de CPU mínima (nice 19) e classe de I/O
+ * idle, faz uma passada de datalogger_merge_boot_databases() e termina.
+ * @param ctx Contexto do datalogger
+ * @return true se a thread foi criada, false caso contrário
+ */
+bool datalogger_merge_start(datalogger_context_t* ctx);
+
+/**
+ * @brief Interrompe a consolidação (após o grupo em andamento) e aguarda a thread
+ * @param ctx Contexto do datalogger
+ */
+void datalogger_merge_stop(datalogger_context_t* ctx);
+
 /**
  * @brief Finaliza o banco de dados SQLite
  * @param ctx Contexto do datalogger
@@ -0,0 +1,504 @@
+/**
+ * @file datalogger_catalog.c
+ * @brief COEL E33 DataLogger - Catálogo de partições mensais do banco SQLite
+ * @author Nova Instruments
+ */
+
+#include "datalogger_catalog.h"
+#include "datalogger_vfs.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+
+#define CATALOG_MAX_PATH 512
+
+// Contexto do catálogo
+struct datalogger_catalog_s {
+    sqlite3* db;
+    const char* vfs;                    // VFS usado também nas partições anexadas
+    bool attached;
+    char dir[CATALOG_MAX_PATH];
+    char device_name[32];
+};
+
+void datalogger_partition_period(long long t_ms, long long* start_ms, long long* end_ms) {
+    time_t secs = (time_t)(t_ms / 1000);
+    struct tm tm_month;
+    localtime_r(&secs, &tm_month);
+    tm_month.tm_mday = 1;
+    tm_month.tm_hour = 0;
+    tm_month.tm_min = 0;
+    tm_month.tm_sec = 0;
+    tm_month.tm_isdst = -1;
+    *start_ms = (long long)mktime(&tm_month) * 1000;
+
+    // mktime normaliza tm_mon + 1 na virada do ano
+    tm_month.tm_mon += 1;
+    tm_month.tm_isdst = -1;
+    *end_ms = (long long)mktime(&tm_month) * 1000;
+}
+
+void datalogger_partition_name(const char* device_name, long long period_start, char* out, size_t len) {
+    time_t secs = (time_t)(period_start / 1000);
+    struct tm tm_month;
+    localtime_r(&secs, &tm_month);
+    snprintf(out, len, "%s_%04d%02d.db", device_name, tm_month.tm_year + 1900, tm_month.tm_mon + 1);
+}
+
+/**
+ * @brief Verifica se o nome segue o padrão NOME_AAAAMM.db e obtém o período
+ */
+static bool parse_partition_name(const datalogger_catalog_t* cat, const char* name,
+                                 long long* start_ms, long long* end_ms) {
+    size_t prefix_len = strlen(cat->device_name);
+    if (strlen(name) != prefix_len + 1 + 6 + 3 ||
+        strncmp(name, cat->device_name, prefix_len) != 0 || name[prefix_len] != '_' ||
+        strcmp(name + prefix_len + 7, ".db") != 0) {
+        return false;
+    }
+
+    const char* digits = name + prefix_len + 1;
+    for (int i = 0; i < 6; i++) {
+        if (!isdigit((unsigned char)digits[i])) return false;
+    }
+
+    struct tm tm_month;
+    memset(&tm_month, 0, sizeof(tm_month));
+    tm_month.tm_year = (digits[0] - '0') * 1000 + (digits[1] - '0') * 100 +
+                       (digits[2] - '0') * 10 + (digits[3] - '0') - 1900;
+    tm_month.tm_mon = (digits[4] - '0') * 10 + (digits[5] - '0') - 1;
+    if (tm_month.tm_mon < 0 || tm_month.tm_mon > 11) return false;
+    tm_month.tm_mday = 15;
+    tm_month.tm_isdst = -1;
+
+    datalogger_partition_period((long long)mktime(&tm_month) * 1000, start_ms, end_ms);
+    return true;
+}
+
+/**
+ * @brief Sincroniza o diretório para tornar uma remoção durável
+ */
+static void sync_directory(const char* dir_path) {
+    int fd = open(dir_path, O_RDONLY | O_DIRECTORY);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+}
+
+bool datalogger_partition_measure(sqlite3* db, datalogger_partition_t* part) {
+    if (!db || !part) return false;
+
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, "SELECT MIN(CollectTime), MAX(CollectTime), COUNT(*) FROM DataGrpData;",
+                           -1, &stmt, NULL) != SQLITE_OK) {
+        return false;
+    }
+
+    bool ok = sqlite3_step(stmt) == SQLITE_ROW;
+    if (ok) {
+        part->first_time = sqlite3_column_int64(stmt, 0);
+        part->last_time = sqlite3_column_int64(stmt, 1);
+        part->rows = sqlite3_column_int64(stmt, 2);
+    }
+    sqlite3_finalize(stmt);
+    return ok;
+}
+
+datalogger_catalog_t* datalogger_catalog_open(const char* dir, const char* device_name) {
+    if (!dir || !device_name) return NULL;
+
+    datalogger_catalog_t* cat = calloc(1, sizeof(datalogger_catalog_t));
+    if (!cat) return NULL;
+
+    strncpy(cat->dir, dir, sizeof(cat->dir) - 1);
+    strncpy(cat->device_name, device_name, sizeof(cat->device_name) - 1);
+    cat->vfs = datalogger_vfs_register() == SQLITE_OK ? DATALOGGER_VFS_NAME : NULL;
+
+    char path[CATALOG_MAX_PATH + 64];
+    snprintf(path, sizeof(path), "%s/%s%s.db", dir, DATALOGGER_CATALOG_PREFIX, device_name);
+
+    // URI habilitado para anexar partições somente leitura
+    if (sqlite3_open_v2(path, &cat->db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_URI,
+                        cat->vfs) != SQLITE_OK) {
+        fprintf(stderr, "Erro ao abrir catálogo %s: %s\n", path, sqlite3_errmsg(cat->db));
+        sqlite3_close(cat->db);
+        free(cat);
+        return NULL;
+    }
+
+    const char* create_table =
+        "CREATE TABLE IF NOT EXISTS Partitions ("
+        "Name TEXT PRIMARY KEY,"
+        "PeriodStart INTEGER NOT NULL,"
+        "PeriodEnd INTEGER NOT NULL,"
+        "FirstTime INTEGER,"
+        "LastTime INTEGER,"
+        "Rows INTEGER NOT NULL DEFAULT 0,"
+        "FileSize INTEGER NOT NULL DEFAULT 0,"
+        "MTime INTEGER NOT NULL DEFAULT 0"
+        ");"
+        "CREATE INDEX IF NOT EXISTS idx_Partitions_PeriodStart ON Partitions (PeriodStart);";
+
+    char* err_msg = NULL;
+    if (sqlite3_exec(cat->db, create_table, NULL, NULL, &err_msg) != SQLITE_OK) {
+        fprintf(stderr, "Erro ao criar tabela Partitions: %s\n", err_msg);
+        sqlite3_free(err_msg);
+        sqlite3_close(cat->db);
+        free(cat);
+        return NULL;
+    }
+
+    return cat;
+}
+
+void datalogger_catalog_close(datalogger_catalog_t* cat) {
+    if (!cat) return;
+
+    datalogger_catalog_detach(cat);
+    sqlite3_close(cat->db);
+    free(cat);
+}
+
+bool datalogger_catalog_record(datalogger_catalog_t* cat, const datalogger_partition_t* part) {
+    if (!cat || !part) return false;
+
+    char path[CATALOG_MAX_PATH + 64];
+    snprintf(path, sizeof(path), "%s/%s", cat->dir, part->name);
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        memset(&st, 0, sizeof(st));
+    }
+
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(cat->db,
+            "INSERT OR REPLACE INTO Partitions "
+            "(Name, PeriodStart, PeriodEnd, FirstTime, LastTime, Rows, FileSize, MTime) "
+            "VALUES (?, ?, ?, ?, ?, ?, ?, ?);", -1, &stmt, NULL) != SQLITE_OK) {
+        fprintf(stderr, "Erro ao atualizar catálogo: %s\n", sqlite3_errmsg(cat->db));
+        return false;
+    }
+
+    sqlite3_bind_text(stmt, 1, part->name, -1, SQLITE_STATIC);
+    sqlite3_bind_int64(stmt, 2, part->period_start);
+    sqlite3_bind_int64(stmt, 3, part->period_end);
+    if (part->rows > 0) {
+        sqlite3_bind_int64(stmt, 4, part->first_time);
+        sqlite3_bind_int64(stmt, 5, part->last_time);
+    } else {
+        sqlite3_bind_null(stmt, 4);
+        sqlite3_bind_null(stmt, 5);
+    }
+    sqlite3_bind_int64(stmt, 6, part->rows);
+    sqlite3_bind_int64(stmt, 7, (long long)st.st_size);
+    sqlite3_bind_int64(stmt, 8, (long long)st.st_mtime);
+
+    int rc = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+    if (rc != SQLITE_DONE) {
+        fprintf(stderr, "Erro ao atualizar catálogo: %s\n", sqlite3_errmsg(cat->db));
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Verifica se a entrada do catálogo corresponde ao arquivo atual
+ */
+static bool entry_is_current(datalogger_catalog_t* cat, const char* name, const struct stat* st) {
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(cat->db, "SELECT FileSize, MTime FROM Partitions WHERE Name = ?;",
+                           -1, &stmt, NULL) != SQLITE_OK) {
+        return false;
+    }
+    sqlite3_bind_text(stmt, 1, name, -1, SQLITE_STATIC);
+
+    bool current = sqlite3_step(stmt) == SQLITE_ROW &&
+                   sqlite3_column_int64(stmt, 0) == (long long)st->st_size &&
+                   sqlite3_column_int64(stmt, 1) == (long long)st->st_mtime;
+    sqlite3_finalize(stmt);
+    return current;
+}
+
+/**
+ * @brief Abre uma partição somente leitura e grava sua entrada no catálogo
+ */
+static bool catalog_measure_file(datalogger_catalog_t* cat, const char* name, const char* path,
+                                 long long period_start, long long period_end) {
+    datalogger_partition_t part;
+    memset(&part, 0, sizeof(part));
+    snprintf(part.name, sizeof(part.name), "%.63s", name);
+    part.period_start = period_start;
+    part.period_end = period_end;
+
+    sqlite3* db = NULL;
+    bool ok = sqlite3_open_v2(path, &db, SQLITE_OPEN_READONLY, cat->vfs) == SQLITE_OK &&
+              datalogger_partition_measure(db, &part);
+    if (!ok) {
+        fprintf(stderr, "Erro ao catalogar partição %s: %s\n", path, sqlite3_errmsg(db));
+    }
+    sqlite3_close(db);
+
+    return ok && datalogger_catalog_record(cat, &part);
+}
+
+int datalogger_catalog_scan(datalogger_catalog_t* cat, const char* live_name) {
+    if (!cat) return -1;
+
+    DIR* dir = opendir(cat->dir);
+    if (!dir) {
+        fprintf(stderr, "Erro ao abrir diretório %s: %s\n", cat->dir, strerror(errno));
+        return -1;
+    }
+
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        long long period_start, period_end;
+        if (!parse_partition_name(cat, entry->d_name, &period_start, &period_end)) continue;
+        if (live_name && strcmp(entry->d_name, live_name) == 0) continue;
+
+        char path[CATALOG_MAX_PATH + 256];
+        snprintf(path, sizeof(path), "%s/%s", cat->dir, entry->d_name);
+        struct stat st;
+        if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) continue;
+
+        if (!entry_is_current(cat, entry->d_name, &st)) {
+            catalog_measure_file(cat, entry->d_name, path, period_start, period_end);
+        }
+    }
+    closedir(dir);
+
+    // Remover entradas de arquivos apagados fora do catálogo
+    sqlite3_stmt* select;
+    sqlite3_stmt* remove;
+    if (sqlite3_prepare_v2(cat->db, "SELECT Name FROM Partitions;", -1, &select, NULL) != SQLITE_OK) {
+        return -1;
+    }
+    if (sqlite3_prepare_v2(cat->db, "DELETE FROM Partitions WHERE Name = ?;", -1, &remove, NULL) != SQLITE_OK) {
+        sqlite3_finalize(select);
+        return -1;
+    }
+
+    char (*missing)[64] = NULL;
+    int missing_count = 0;
+    int count = 0;
+    while (sqlite3_step(select) == SQLITE_ROW) {
+        const char* name = (const char*)sqlite3_column_text(select, 0);
+        char path[CATALOG_MAX_PATH + 64];
+        snprintf(path, sizeof(path), "%s/%s", cat->dir, name);
+        if (access(path, F_OK) == 0) {
+            count++;
+            continue;
+        }
+
+        char (*grown)[64] = realloc(missing, (size_t)(missing_count + 1) * sizeof(*missing));
+        if (!grown) break;
+        missing = grown;
+        strncpy(missing[missing_count], name, sizeof(missing[0]) - 1);
+        missing[missing_count][sizeof(missing[0]) - 1] = '\0';
+        missing_count++;
+    }
+    sqlite3_finalize(select);
+
+    for (int i = 0; i < missing_count; i++) {
+        sqlite3_bind_text(remove, 1, missing[i], -1, SQLITE_STATIC);
+        sqlite3_step(remove);
+        sqlite3_reset(remove);
+    }
+    sqlite3_finalize(remove);
+    free(missing);
+
+    return count;
+}
+
+int datalogger_catalog_find(datalogger_catalog_t* cat, long long from_ms, long long to_ms,
+                            datalogger_partition_t** out) {
+    if (!cat || !out) return -1;
+    *out = NULL;
+
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(cat->db,
+            "SELECT Name, PeriodStart, PeriodEnd, FirstTime, LastTime, Rows, FileSize FROM Partitions "
+            "WHERE PeriodStart <= ?2 AND PeriodEnd > ?1 AND Rows > 0 "
+            "AND FirstTime <= ?2 AND LastTime >= ?1 ORDER BY PeriodStart;", -1, &stmt, NULL) != SQLITE_OK) {
+        fprintf(stderr, "Erro ao consultar catálogo: %s\n", sqlite3_errmsg(cat->db));
+        return -1;
+    }
+    sqlite3_bind_int64(stmt, 1, from_ms);
+    sqlite3_bind_int64(stmt, 2, to_ms);
+
+    datalogger_partition_t* parts = NULL;
+    int count = 0;
+    int capacity = 0;
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        if (count == capacity) {
+            int new_capacity = capacity ? capacity * 2 : 16;
+            datalogger_partition_t* grown = realloc(parts, (size_t)new_capacity * sizeof(*parts));
+            if (!grown) {
+                rc = SQLITE_NOMEM;
+                break;
+            }
+            parts = grown;
+            capacity = new_capacity;
+        }
+
+        datalogger_partition_t* part = &parts[count++];
+        memset(part, 0, sizeof(*part));
+        strncpy(part->name, (const char*)sqlite3_column_text(stmt, 0), sizeof(part->name) - 1);
+        part->period_start = sqlite3_column_int64(stmt, 1);
+        part->period_end = sqlite3_column_int64(stmt, 2);
+        part->first_time = sqlite3_column_int64(stmt, 3);
+        part->last_time = sqlite3_column_int64(stmt, 4);
+        part->rows = sqlite3_column_int64(stmt, 5);
+        part->file_size = sqlite3_column_int64(stmt, 6);
+    }
+    sqlite3_finalize(stmt);
+
+    if (rc != SQLITE_DONE) {
+        free(parts);
+        return -1;
+    }
+
+    *out = parts;
+    return count;
+}
+
+/**
+ * @brief Partição mais antiga (exceto a em uso) com fim até before_ms
+ */
+static bool oldest_partition(datalogger_catalog_t* cat, const char* live_name, long long before_ms,
+                             char* name, size_t len) {
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(cat->db,
+            "SELECT Name FROM Partitions WHERE Name <> ?1 AND PeriodEnd <= ?2 "
+            "ORDER BY PeriodStart LIMIT 1;", -1, &stmt, NULL) != SQLITE_OK) {
+        return false;
+    }
+    sqlite3_bind_text(stmt, 1, live_name ? live_name : "", -1, SQLITE_STATIC);
+    sqlite3_bind_int64(stmt, 2, before_ms);
+
+    bool found = sqlite3_step(stmt) == SQLITE_ROW;
+    if (found) {
+        snprintf(name, len, "%s", (const char*)sqlite3_column_text(stmt, 0));
+    }
+    sqlite3_finalize(stmt);
+    return found;
+}
+
+/**
+ * @brief Remove o arquivo de uma partição (e auxiliares) e sua entrada no catálogo
+ */
+static bool drop_partition(datalogger_catalog_t* cat, const char* name, const char* reason) {
+    static const char* suffixes[] = { "-journal", "-wal", "-shm", "" };
+    char path[CATALOG_MAX_PATH + 64];
+
+    for (size_t i = 0; i < sizeof(suffixes) / sizeof(suffixes[0]); i++) {
+        snprintf(path, sizeof(path), "%s/%s%s", cat->dir, name, suffixes[i]);
+        if (unlink(path) != 0 && errno != ENOENT) {
+            fprintf(stderr, "Erro ao remover partição %s: %s\n", path, strerror(errno));
+            return false;
+        }
+    }
+    sync_directory(cat->dir);
+
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(cat->db, "DELETE FROM Partitions WHERE Name = ?;", -1, &stmt, NULL) != SQLITE_OK) {
+        return false;
+    }
+    sqlite3_bind_text(stmt, 1, name, -1, SQLITE_STATIC);
+    int rc = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+
+    printf("🗑️  Partição removida (%s): %s\n", reason, name);
+    return rc == SQLITE_DONE;
+}
+
+/**
+ * @brief Espaço livre (bytes) disponível para processos sem privilégio
+ */
+static unsigned long long free_bytes(const char* dir) {
+    struct statvfs vfs;
+    if (statvfs(dir, &vfs) != 0) return ULLONG_MAX;
+    return (unsigned long long)vfs.f_bavail * vfs.f_frsize;
+}
+
+int datalogger_catalog_enforce_retention(datalogger_catalog_t* cat, const char* live_name,
+                                         long long now_ms, int max_months,
+                                         unsigned long long min_free_bytes) {
+    if (!cat) return -1;
+
+    char name[64];
+    int removed = 0;
+
+    if (max_months > 0) {
+        // Início do mês mais antigo mantido
+        time_t secs = (time_t)(now_ms / 1000);
+        struct tm tm_month;
+        localtime_r(&secs, &tm_month);
+        tm_month.tm_mday = 1;
+        tm_month.tm_hour = 0;
+        tm_month.tm_min = 0;
+        tm_month.tm_sec = 0;
+        tm_month.tm_mon -= max_months - 1;
+        tm_month.tm_isdst = -1;
+        long long cutoff = (long long)mktime(&tm_month) * 1000;
+
+        while (oldest_partition(cat, live_name, cutoff, name, sizeof(name))) {
+            if (!drop_partition(cat, name, "idade")) return -1;
+            removed++;
+        }
+    }
+
+    if (min_free_bytes > 0) {
+        while (free_bytes(cat->dir) < min_free_bytes &&
+               oldest_partition(cat, live_name, LLONG_MAX, name, sizeof(name))) {
+            if (!drop_partition(cat, name, "espaço livre")) return -1;
+            removed++;
+        }
+    }
+
+    return removed;
+}
+
+sqlite3* datalogger_catalog_attach(datalogger_catalog_t* cat, const char* name) {
+    if (!cat || !name) return NULL;
+
+    datalogger_catalog_detach(cat);
+
+    char uri[CATALOG_MAX_PATH + 96];
+    snprintf(uri, sizeof(uri), "file:%s/%s?mode=ro", cat->dir, name);
+
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(cat->db, "ATTACH DATABASE ? AS " DATALOGGER_CATALOG_ATTACH_NAME ";",
+                           -1, &stmt, NULL) != SQLITE_OK) {
+        return NULL;
+    }
+    sqlite3_bind_text(stmt, 1, uri, -1, SQLITE_STATIC);
+    int rc = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+
+    if (rc != SQLITE_DONE) {
+        fprintf(stderr, "Erro ao anexar partição %s: %s\n", name, sqlite3_errmsg(cat->db));
+        return NULL;
+    }
+
+    cat->attached = true;
+    return cat->db;
+}
+
+void datalogger_catalog_detach(datalogger_catalog_t* cat) {
+    if (!cat || !cat->attached) return;
+
+    sqlite3_exec(cat->db, "DETACH DATABASE " DATALOGGER_CATALOG_ATTACH_NAME ";", NULL, NULL, NULL);
+    cat->attached = false;
+}
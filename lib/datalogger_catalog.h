@@ -0,0 +1,146 @@
+/**
+ * @file datalogger_catalog.h
+ * @brief COEL E33 DataLogger - Catálogo de partições mensais do banco SQLite
+ * @author Nova Instruments
+ *
+ * Cada mês (hora local) é gravado em um banco próprio, NOME_AAAAMM.db, com
+ * o mesmo esquema dos bancos por execução. O catálogo, um pequeno banco
+ * SQLite separado, guarda o período e o intervalo de tempo de cada
+ * partição: consultas e exportações abrem apenas as partições que
+ * precisam, e a retenção descarta meses inteiros removendo um arquivo, sem
+ * DELETE nem VACUUM.
+ */
+
+#ifndef DATALOGGER_CATALOG_H
+#define DATALOGGER_CATALOG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <sqlite3.h>
+
+#define DATALOGGER_CATALOG_PREFIX "catalog_"      // catalog_NOME.db (fora do padrão NI*.db exportado)
+#define DATALOGGER_CATALOG_ATTACH_NAME "part"     // Esquema usado ao anexar uma partição
+
+// Handle opaco do catálogo
+typedef struct datalogger_catalog_s datalogger_catalog_t;
+
+// Entrada do catálogo (uma partição mensal)
+typedef struct {
+    char name[64];              // Nome do arquivo (ex: NI00002_202409.db)
+    long long period_start;     // Início do mês (ms desde epoch, meia-noite local do dia 1)
+    long long period_end;       // Início do mês seguinte (ms desde epoch)
+    long long first_time;       // Menor CollectTime (0 se vazia)
+    long long last_time;        // Maior CollectTime (0 se vazia)
+    long long rows;             // Registros em DataGrpData
+    long long file_size;        // Tamanho do arquivo quando catalogado
+} datalogger_partition_t;
+
+/**
+ * @brief Calcula o mês (hora local) que contém um instante
+ * @param t_ms Instante em ms desde epoch
+ * @param start_ms Início do mês (ms desde epoch)
+ * @param end_ms Início do mês seguinte (ms desde epoch)
+ */
+void datalogger_partition_period(long long t_ms, long long* start_ms, long long* end_ms);
+
+/**
+ * @brief Monta o nome do arquivo da partição (NOME_AAAAMM.db)
+ * @param device_name Nome do dispositivo
+ * @param period_start Início do mês (retornado por datalogger_partition_period)
+ * @param out Buffer de saída
+ * @param len Tamanho do buffer
+ */
+void datalogger_partition_name(const char* device_name, long long period_start, char* out, size_t len);
+
+/**
+ * @brief Lê intervalo de tempo e contagem de registros de uma partição aberta
+ * @param db Conexão com a partição
+ * @param part Entrada a ser preenchida (first_time, last_time, rows)
+ * @return true se a leitura foi bem-sucedida, false caso contrário
+ */
+bool datalogger_partition_measure(sqlite3* db, datalogger_partition_t* part);
+
+/**
+ * @brief Abre (ou cria) o catálogo de partições de um dispositivo
+ * @param dir Diretório das partições
+ * @param device_name Nome do dispositivo (prefixo das partições)
+ * @return Ponteiro para o catálogo ou NULL em caso de erro
+ */
+datalogger_catalog_t* datalogger_catalog_open(const char* dir, const char* device_name);
+
+/**
+ * @brief Fecha o catálogo
+ * @param cat Catálogo
+ */
+void datalogger_catalog_close(datalogger_catalog_t* cat);
+
+/**
+ * @brief Grava ou atualiza a entrada de uma partição
+ *
+ * Tamanho e data de modificação do arquivo são registrados para que
+ * datalogger_catalog_scan() detecte partições alteradas fora do catálogo.
+ * @param cat Catálogo
+ * @param part Entrada (name, período e intervalo de tempo)
+ * @return true se gravada, false em caso de erro
+ */
+bool datalogger_catalog_record(datalogger_catalog_t* cat, const datalogger_partition_t* part);
+
+/**
+ * @brief Reconcilia o catálogo com os arquivos do diretório
+ *
+ * Partições novas ou modificadas desde a última gravação são medidas
+ * novamente; entradas cujo arquivo não existe mais são removidas.
+ * @param cat Catálogo
+ * @param live_name Partição em uso pelo escritor (não é medida; pode ser NULL)
+ * @return Número de partições no catálogo, ou -1 em caso de erro
+ */
+int datalogger_catalog_scan(datalogger_catalog_t* cat, const char* live_name);
+
+/**
+ * @brief Lista as partições cujo conteúdo pode intersectar um intervalo
+ * @param cat Catálogo
+ * @param from_ms Início do intervalo (ms desde epoch, inclusivo)
+ * @param to_ms Fim do intervalo (ms desde epoch, inclusivo)
+ * @param out Vetor alocado com as partições em ordem de período (liberar com free)
+ * @return Número de partições, ou -1 em caso de erro
+ */
+int datalogger_catalog_find(datalogger_catalog_t* cat, long long from_ms, long long to_ms,
+                            datalogger_partition_t** out);
+
+/**
+ * @brief Remove partições inteiras por idade e por espaço livre
+ *
+ * Mantém os max_months meses mais recentes (incluindo o mês de now_ms) e,
+ * enquanto o sistema de arquivos tiver menos de min_free_bytes livres,
+ * remove a partição mais antiga. A partição em uso nunca é removida. O
+ * custo é uma remoção de arquivo por partição, independente do tamanho.
+ * @param cat Catálogo
+ * @param live_name Partição em uso pelo escritor (pode ser NULL)
+ * @param now_ms Instante de referência para a idade (ms desde epoch)
+ * @param max_months Meses mantidos (0 = sem limite de idade)
+ * @param min_free_bytes Espaço livre mínimo (0 = sem limite de espaço)
+ * @return Número de partições removidas, ou -1 em caso de erro
+ */
+int datalogger_catalog_enforce_retention(datalogger_catalog_t* cat, const char* live_name,
+                                         long long now_ms, int max_months,
+                                         unsigned long long min_free_bytes);
+
+/**
+ * @brief Anexa uma partição à conexão do catálogo como DATALOGGER_CATALOG_ATTACH_NAME
+ *
+ * Permite consultar partições seladas sem afetar a conexão (e a transação
+ * de lote) do escritor. Apenas uma partição é anexada por vez.
+ * @param cat Catálogo
+ * @param name Nome do arquivo da partição
+ * @return Conexão com a partição anexada, ou NULL em caso de erro
+ */
+sqlite3* datalogger_catalog_attach(datalogger_catalog_t* cat, const char* name);
+
+/**
+ * @brief Desanexa a partição anexada por datalogger_catalog_attach()
+ * @param cat Catálogo
+ */
+void datalogger_catalog_detach(datalogger_catalog_t* cat);
+
+#endif // DATALOGGER_CATALOG_H
@@ -0,0 +1,319 @@
+/**
+ * @file datalogger_csv.c
+ * @brief COEL E33 DataLogger - Exportação de registros em CSV (planilha), opcionalmente compactada
+ * @author Nova Instruments
+ */
+
+#include "datalogger_csv.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <zlib.h>
+
+#define CSV_MAX_PATH 1024
+#define CSV_ROW_MAX 64                  // Maior linha possível (data, temperatura, porta)
+#define CSV_HEADER "Data Hora;TPrincipal;PA\r\n"
+
+// Planilha em gravação
+struct datalogger_csv_s {
+    int fd;
+    char path[CSV_MAX_PATH];
+    char tmp_path[CSV_MAX_PATH + 8];
+    bool gzip;
+    z_stream zs;
+    char* buf;                          // CSV pendente (DATALOGGER_CSV_BUFFER_BYTES)
+    size_t len;
+    unsigned char* out;                 // Saída do deflate (DATALOGGER_CSV_BUFFER_BYTES)
+    bool failed;
+    long long hour_start;               // Início da hora local em cache (s desde epoch)
+    char hour_prefix[16];               // "DD/MM/AAAA HH:" da hora em cache
+    size_t hour_prefix_len;
+    long long start_ns;
+    datalogger_csv_stats_t stats;
+};
+
+static long long csv_monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * @brief Grava todo o buffer no arquivo (repete em escritas parciais)
+ */
+static bool csv_write_all(datalogger_csv_t* csv, const void* data, size_t len) {
+    const char* p = data;
+    while (len > 0) {
+        ssize_t n = write(csv->fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            fprintf(stderr, "Erro ao gravar %s: %s\n", csv->tmp_path, strerror(errno));
+            csv->failed = true;
+            return false;
+        }
+        p += n;
+        len -= (size_t)n;
+        csv->stats.file_bytes += (unsigned long long)n;
+    }
+    return true;
+}
+
+/**
+ * @brief Envia o CSV pendente ao arquivo, pelo deflate quando compactado
+ * @param finish Encerra o fluxo gzip (último bloco)
+ */
+static bool csv_flush(datalogger_csv_t* csv, bool finish) {
+    if (csv->failed) return false;
+
+    if (!csv->gzip) {
+        bool ok = csv_write_all(csv, csv->buf, csv->len);
+        csv->len = 0;
+        return ok;
+    }
+
+    csv->zs.next_in = (Bytef*)csv->buf;
+    csv->zs.avail_in = (uInt)csv->len;
+    int rc;
+    do {
+        csv->zs.next_out = csv->out;
+        csv->zs.avail_out = DATALOGGER_CSV_BUFFER_BYTES;
+        rc = deflate(&csv->zs, finish ? Z_FINISH : Z_NO_FLUSH);
+        if (rc == Z_STREAM_ERROR) {
+            fprintf(stderr, "Erro na compressão de %s\n", csv->tmp_path);
+            csv->failed = true;
+            return false;
+        }
+        size_t produced = DATALOGGER_CSV_BUFFER_BYTES - csv->zs.avail_out;
+        if (produced > 0 && !csv_write_all(csv, csv->out, produced)) {
+            return false;
+        }
+    } while (csv->zs.avail_out == 0 || (finish && rc != Z_STREAM_END));
+    csv->len = 0;
+    return true;
+}
+
+/**
+ * @brief Dois dígitos decimais (00-99)
+ */
+static char* csv_put2(char* p, int v) {
+    p[0] = (char)('0' + v / 10);
+    p[1] = (char)('0' + v % 10);
+    return p + 2;
+}
+
+/**
+ * @brief Inteiro não negativo em decimal
+ */
+static char* csv_put_uint(char* p, unsigned int v) {
+    char digits[10];
+    int n = 0;
+    do {
+        digits[n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v > 0);
+    while (n > 0) {
+        *p++ = digits[--n];
+    }
+    return p;
+}
+
+datalogger_csv_t* datalogger_csv_open(const char* path, bool gzip) {
+    if (!path) return NULL;
+
+    datalogger_csv_t* csv = calloc(1, sizeof(*csv));
+    if (!csv) return NULL;
+    csv->fd = -1;
+    csv->gzip = gzip;
+    csv->hour_start = -1;
+    csv->start_ns = csv_monotonic_ns();
+    snprintf(csv->path, sizeof(csv->path), "%s", path);
+    snprintf(csv->tmp_path, sizeof(csv->tmp_path), "%s.tmp", path);
+
+    csv->buf = malloc(DATALOGGER_CSV_BUFFER_BYTES);
+    bool ok = csv->buf != NULL;
+    if (ok && gzip) {
+        // windowBits 15 + 16: saída no formato gzip
+        csv->out = malloc(DATALOGGER_CSV_BUFFER_BYTES);
+        ok = csv->out != NULL &&
+             deflateInit2(&csv->zs, DATALOGGER_CSV_GZIP_LEVEL, Z_DEFLATED, 15 + 16, 8,
+                          Z_DEFAULT_STRATEGY) == Z_OK;
+        if (!ok) {
+            free(csv->out);
+            csv->out = NULL;
+        }
+    }
+    if (ok) {
+        csv->fd = open(csv->tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (csv->fd < 0) {
+            fprintf(stderr, "Erro ao criar %s: %s\n", csv->tmp_path, strerror(errno));
+            ok = false;
+        }
+    }
+    if (!ok) {
+        if (csv->out) deflateEnd(&csv->zs);
+        free(csv->out);
+        free(csv->buf);
+        free(csv);
+        return NULL;
+    }
+
+    memcpy(csv->buf, CSV_HEADER, sizeof(CSV_HEADER) - 1);
+    csv->len = sizeof(CSV_HEADER) - 1;
+    csv->stats.csv_bytes = csv->len;
+    return csv;
+}
+
+bool datalogger_csv_write_sample(datalogger_csv_t* csv, const ts_sample_t* sample) {
+    if (!csv || !sample || csv->failed) return false;
+    if (DATALOGGER_CSV_BUFFER_BYTES - csv->len < CSV_ROW_MAX && !csv_flush(csv, false)) {
+        return false;
+    }
+
+    // Hora local calculada uma vez por hora: o fuso só muda em horas cheias
+    long long secs = sample->collect_time >= 0 ? sample->collect_time / 1000
+                                               : -((-sample->collect_time + 999) / 1000);
+    if (csv->hour_start < 0 || secs < csv->hour_start || secs >= csv->hour_start + 3600) {
+        time_t t = (time_t)secs;
+        struct tm tm_hour;
+        localtime_r(&t, &tm_hour);
+        csv->hour_start = secs - tm_hour.tm_min * 60 - tm_hour.tm_sec;
+        csv->hour_prefix_len = (size_t)snprintf(csv->hour_prefix, sizeof(csv->hour_prefix),
+                                                "%02d/%02d/%04d %02d:", tm_hour.tm_mday,
+                                                tm_hour.tm_mon + 1, tm_hour.tm_year + 1900,
+                                                tm_hour.tm_hour);
+    }
+    int in_hour = (int)(secs - csv->hour_start);
+
+    char* start = csv->buf + csv->len;
+    char* p = start;
+    memcpy(p, csv->hour_prefix, csv->hour_prefix_len);
+    p += csv->hour_prefix_len;
+    p = csv_put2(p, in_hour / 60);
+    *p++ = ':';
+    p = csv_put2(p, in_hour % 60);
+    *p++ = DATALOGGER_CSV_SEPARATOR;
+
+    // Temperatura em ponto fixo: décimos de °C, como no log TXT (231 -> 23.1)
+    if (sample->flags & TS_FLAG_TEMP_VALID) {
+        int t = sample->temperature;
+        if (t < 0) {
+            *p++ = '-';
+            t = -t;
+        }
+        p = csv_put_uint(p, (unsigned int)(t / 10));
+        *p++ = '.';
+        *p++ = (char)('0' + t % 10);
+    } else {
+        memcpy(p, "ERROR", 5);
+        p += 5;
+    }
+    *p++ = DATALOGGER_CSV_SEPARATOR;
+
+    if (sample->flags & TS_FLAG_DOOR_VALID) {
+        *p++ = (sample->flags & TS_FLAG_DOOR_OPEN) ? '1' : '0';
+    } else {
+        memcpy(p, "ERROR", 5);
+        p += 5;
+    }
+    *p++ = '\r';
+    *p++ = '\n';
+
+    size_t row_len = (size_t)(p - start);
+    csv->len += row_len;
+    csv->stats.csv_bytes += row_len;
+    csv->stats.rows++;
+    return true;
+}
+
+long long datalogger_csv_write_db(datalogger_csv_t* csv, sqlite3* db, long long from_ms, long long to_ms) {
+    if (!csv || !db || csv->failed) return -1;
+
+    // v2: temperatura bruta e flags direto de DataGrpSamples (preserva leituras inválidas)
+    bool samples = false;
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, "SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = 'DataGrpSamples';",
+                           -1, &stmt, NULL) == SQLITE_OK) {
+        samples = sqlite3_step(stmt) == SQLITE_ROW;
+        sqlite3_finalize(stmt);
+    }
+
+    const char* sql = samples
+        ? "SELECT CollectTime, Temp, Flags FROM DataGrpSamples "
+          "WHERE CollectTime BETWEEN ?1 AND ?2 ORDER BY CollectTime;"
+        : "SELECT CollectTime, Tprincipal, Porta FROM DataGrpData "
+          "WHERE CollectTime BETWEEN ?1 AND ?2 ORDER BY CollectTime;";
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+        fprintf(stderr, "Erro ao consultar registros para CSV: %s\n", sqlite3_errmsg(db));
+        return -1;
+    }
+    sqlite3_bind_int64(stmt, 1, from_ms);
+    sqlite3_bind_int64(stmt, 2, to_ms);
+
+    long long rows = 0;
+    int rc;
+    ts_sample_t sample;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        sample.collect_time = sqlite3_column_int64(stmt, 0);
+        if (samples) {
+            sample.temperature = (int16_t)sqlite3_column_int(stmt, 1);
+            sample.flags = (uint8_t)sqlite3_column_int(stmt, 2);
+        } else {
+            // v1: Tprincipal REAL (décimos arredondados); 0,0 com porta 0 é a
+            // falha de leitura gravada pelo v1 e sai como ERROR, como na migração
+            double t = sqlite3_column_double(stmt, 1) * 10.0;
+            int porta = sqlite3_column_int(stmt, 2);
+            sample.temperature = (int16_t)(t >= 0 ? t + 0.5 : t - 0.5);
+            sample.flags = sample.temperature == 0 && porta == 0
+                ? 0
+                : TS_FLAG_TEMP_VALID | TS_FLAG_DOOR_VALID | (porta ? TS_FLAG_DOOR_OPEN : 0);
+        }
+        if (!datalogger_csv_write_sample(csv, &sample)) {
+            break;
+        }
+        rows++;
+    }
+
+    if (rc != SQLITE_DONE && rc != SQLITE_ROW) {
+        fprintf(stderr, "Erro ao ler registros para CSV: %s\n", sqlite3_errmsg(db));
+    }
+    sqlite3_finalize(stmt);
+    csv->stats.sources++;
+    return rc == SQLITE_DONE ? rows : -1;
+}
+
+bool datalogger_csv_close(datalogger_csv_t* csv, bool commit, datalogger_csv_stats_t* stats) {
+    if (!csv) return false;
+
+    // Conteúdo no disco antes da renomeação
+    bool ok = commit && !csv->failed && csv_flush(csv, true);
+    if (ok && fdatasync(csv->fd) != 0) {
+        fprintf(stderr, "Erro ao sincronizar %s: %s\n", csv->tmp_path, strerror(errno));
+        ok = false;
+    }
+    if (close(csv->fd) != 0) {
+        ok = false;
+    }
+    if (ok && rename(csv->tmp_path, csv->path) != 0) {
+        fprintf(stderr, "Erro ao renomear %s: %s\n", csv->tmp_path, strerror(errno));
+        ok = false;
+    }
+    if (!ok) {
+        unlink(csv->tmp_path);
+    }
+
+    csv->stats.elapsed_ms = (csv_monotonic_ns() - csv->start_ns) / 1000000;
+    if (stats) {
+        *stats = csv->stats;
+    }
+    if (csv->gzip) {
+        deflateEnd(&csv->zs);
+    }
+    free(csv->out);
+    free(csv->buf);
+    free(csv);
+    return ok;
+}
@@ -0,0 +1,85 @@
+/**
+ * @file datalogger_csv.h
+ * @brief COEL E33 DataLogger - Exportação de registros em CSV (planilha), opcionalmente compactada
+ * @author Nova Instruments
+ *
+ * Os registros de DataGrpData (esquemas v1 e v2) são lidos do SQLite em
+ * ordem de tempo e convertidos em linhas CSV no mesmo formato do log TXT
+ * (Data Hora;TPrincipal;PA), sem printf/strftime por linha: a temperatura
+ * é formatada em ponto fixo (décimos de °C) e a data/hora reaproveita o
+ * prefixo da hora local. As linhas vão para um buffer de tamanho fixo e,
+ * dele, direto para o arquivo ou por um estágio gzip (zlib): a memória não
+ * depende do intervalo exportado.
+ */
+
+#ifndef DATALOGGER_CSV_H
+#define DATALOGGER_CSV_H
+
+#include <stdbool.h>
+#include <sqlite3.h>
+#include "ts_block.h"
+
+#define DATALOGGER_CSV_BUFFER_BYTES (64 * 1024)  // CSV acumulado antes de cada escrita (ou compressão)
+#define DATALOGGER_CSV_GZIP_LEVEL 1              // Nível zlib (1 = mais rápido; CSV comprime bem mesmo assim)
+#define DATALOGGER_CSV_SEPARATOR ';'             // Mesmo separador do log TXT
+#define DATALOGGER_CSV_SUFFIX ".csv"
+#define DATALOGGER_CSV_GZIP_SUFFIX ".csv.gz"
+#define DATALOGGER_CSV_GZIP false                // Planilha do pen drive compactada (.csv.gz)
+#define DATALOGGER_CSV_EXPORT_DAYS 0             // Dias exportados para o pen drive (0 = todo o histórico)
+
+// Handle opaco da planilha em gravação
+typedef struct datalogger_csv_s datalogger_csv_t;
+
+// Resultado de uma exportação
+typedef struct {
+    long long rows;                   // Registros gravados
+    int sources;                      // Bancos (partições) lidos
+    unsigned long long csv_bytes;     // CSV gerado (antes da compressão)
+    unsigned long long file_bytes;    // Bytes gravados no destino
+    long long elapsed_ms;             // Da abertura ao fechamento
+} datalogger_csv_stats_t;
+
+/**
+ * @brief Abre a planilha e grava o cabeçalho
+ *
+ * O conteúdo vai para path.tmp, renomeado em datalogger_csv_close(): path
+ * nunca fica parcial.
+ * @param path Caminho final (ex: /media/usb/NI00002.csv)
+ * @param gzip Compactar (formato gzip) durante a gravação
+ * @return Handle da planilha, ou NULL em caso de erro
+ */
+datalogger_csv_t* datalogger_csv_open(const char* path, bool gzip);
+
+/**
+ * @brief Acrescenta um registro (temperatura em décimos de °C; flags TS_FLAG_*)
+ *
+ * Leituras inválidas são gravadas como ERROR, como no log TXT.
+ * @return true se o registro foi aceito, false após um erro de gravação
+ */
+bool datalogger_csv_write_sample(datalogger_csv_t* csv, const ts_sample_t* sample);
+
+/**
+ * @brief Acrescenta os registros de um intervalo de tempo de um banco
+ *
+ * Lê DataGrpSamples (v2) ou DataGrpData (v1) pelo índice de CollectTime,
+ * em ordem de tempo, um registro por vez. O v1 não tem flags de validade:
+ * uma linha 0,0 °C com porta 0 é a falha de leitura gravada por ele e sai
+ * como ERROR;ERROR (também uma leitura real de 0,0 °C com porta fechada).
+ * @param csv Planilha
+ * @param db Conexão com o banco (apenas leitura)
+ * @param from_ms Início do intervalo (ms desde epoch, inclusivo)
+ * @param to_ms Fim do intervalo (ms desde epoch, inclusivo)
+ * @return Registros gravados, ou -1 em caso de erro
+ */
+long long datalogger_csv_write_db(datalogger_csv_t* csv, sqlite3* db, long long from_ms, long long to_ms);
+
+/**
+ * @brief Finaliza a planilha e libera o handle
+ * @param csv Planilha
+ * @param commit true para concluir (fdatasync e renomeação), false para descartar
+ * @param stats Resultado (pode ser NULL)
+ * @return true se a planilha foi gravada, false em caso de erro ou descarte
+ */
+bool datalogger_csv_close(datalogger_csv_t* csv, bool commit, datalogger_csv_stats_t* stats);
+
+#endif // DATALOGGER_CSV_H
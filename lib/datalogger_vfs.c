@@ -0,0 +1,352 @@
+/**
+ * @file datalogger_vfs.c
+ * @brief COEL E33 DataLogger - VFS SQLite com contadores de I/O
+ * @author Nova Instruments
+ */
+
+#include "datalogger_vfs.h"
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sqlite3.h>
+
+// Contadores de um banco (principal, journal e WAL), identificado pelo caminho completo
+typedef struct {
+    char path[DATALOGGER_VFS_MAX_PATH];
+    int open_files;             // Arquivos abertos contando nesta entrada
+    datalogger_vfs_counters_t counters;
+} db_entry_t;
+
+// Arquivo do VFS: o arquivo real do VFS padrão é alocado logo após esta estrutura
+typedef struct {
+    sqlite3_file base;
+    sqlite3_file* real;
+    db_entry_t* entry;          // NULL: arquivo temporário ou tabela de bancos cheia
+} stats_file_t;
+
+static sqlite3_vfs stats_vfs;
+static sqlite3_vfs* root_vfs = NULL;
+static datalogger_vfs_counters_t counters;
+static db_entry_t db_entries[DATALOGGER_VFS_MAX_DBS];
+static pthread_mutex_t entries_lock = PTHREAD_MUTEX_INITIALIZER;
+
+#define REAL(f) (((stats_file_t*)(f))->real)
+
+static long long monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+int datalogger_latency_bucket(long long latency_ns) {
+    long long us = latency_ns / 1000;
+    int bucket = 0;
+    while (us >= 2 && bucket < DATALOGGER_LATENCY_BUCKETS - 1) {
+        us >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+/**
+ * @brief Entrada do banco db_path, criada (ou reaproveitada de um banco fechado) se preciso
+ */
+static db_entry_t* acquire_entry(const char* db_path) {
+    if (!db_path || strlen(db_path) >= DATALOGGER_VFS_MAX_PATH) return NULL;
+
+    pthread_mutex_lock(&entries_lock);
+    db_entry_t* entry = NULL;
+    db_entry_t* unused = NULL;
+    for (int i = 0; i < DATALOGGER_VFS_MAX_DBS; i++) {
+        if (db_entries[i].path[0] && strcmp(db_entries[i].path, db_path) == 0) {
+            entry = &db_entries[i];
+            break;
+        }
+        // Preferir entrada nunca usada a uma de banco fechado
+        if (db_entries[i].open_files == 0 && (!unused || (unused->path[0] && !db_entries[i].path[0]))) {
+            unused = &db_entries[i];
+        }
+    }
+    if (!entry && unused) {
+        entry = unused;
+        memset(entry, 0, sizeof(*entry));
+        strcpy(entry->path, db_path);
+    }
+    if (entry) entry->open_files++;
+    pthread_mutex_unlock(&entries_lock);
+    return entry;
+}
+
+static void add_write(datalogger_vfs_counters_t* c, int amt) {
+    __atomic_fetch_add(&c->bytes_written, (uint64_t)amt, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&c->writes, 1, __ATOMIC_RELAXED);
+}
+
+static void add_sync(datalogger_vfs_counters_t* c, int bucket) {
+    __atomic_fetch_add(&c->syncs, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&c->sync_latency[bucket], 1, __ATOMIC_RELAXED);
+}
+
+static void load_counters(const datalogger_vfs_counters_t* c, datalogger_vfs_counters_t* out) {
+    out->bytes_written = __atomic_load_n(&c->bytes_written, __ATOMIC_RELAXED);
+    out->writes = __atomic_load_n(&c->writes, __ATOMIC_RELAXED);
+    out->syncs = __atomic_load_n(&c->syncs, __ATOMIC_RELAXED);
+    for (int i = 0; i < DATALOGGER_LATENCY_BUCKETS; i++) {
+        out->sync_latency[i] = __atomic_load_n(&c->sync_latency[i], __ATOMIC_RELAXED);
+    }
+}
+
+// Métodos de I/O: repassam ao arquivo real, contando escritas e sincronizações
+
+static int stats_close(sqlite3_file* f) {
+    stats_file_t* sf = (stats_file_t*)f;
+    int rc = REAL(f)->pMethods->xClose(REAL(f));
+    if (sf->entry) {
+        pthread_mutex_lock(&entries_lock);
+        sf->entry->open_files--;
+        pthread_mutex_unlock(&entries_lock);
+        sf->entry = NULL;
+    }
+    return rc;
+}
+
+static int stats_read(sqlite3_file* f, void* buf, int amt, sqlite3_int64 ofst) {
+    return REAL(f)->pMethods->xRead(REAL(f), buf, amt, ofst);
+}
+
+static int stats_write(sqlite3_file* f, const void* buf, int amt, sqlite3_int64 ofst) {
+    int rc = REAL(f)->pMethods->xWrite(REAL(f), buf, amt, ofst);
+    if (rc == SQLITE_OK) {
+        db_entry_t* entry = ((stats_file_t*)f)->entry;
+        add_write(&counters, amt);
+        if (entry) add_write(&entry->counters, amt);
+    }
+    return rc;
+}
+
+static int stats_truncate(sqlite3_file* f, sqlite3_int64 size) {
+    return REAL(f)->pMethods->xTruncate(REAL(f), size);
+}
+
+static int stats_sync(sqlite3_file* f, int flags) {
+    long long start = monotonic_ns();
+    int rc = REAL(f)->pMethods->xSync(REAL(f), flags);
+    int bucket = datalogger_latency_bucket(monotonic_ns() - start);
+
+    db_entry_t* entry = ((stats_file_t*)f)->entry;
+    add_sync(&counters, bucket);
+    if (entry) add_sync(&entry->counters, bucket);
+    return rc;
+}
+
+static int stats_file_size(sqlite3_file* f, sqlite3_int64* size) {
+    return REAL(f)->pMethods->xFileSize(REAL(f), size);
+}
+
+static int stats_lock(sqlite3_file* f, int lock) {
+    return REAL(f)->pMethods->xLock(REAL(f), lock);
+}
+
+static int stats_unlock(sqlite3_file* f, int lock) {
+    return REAL(f)->pMethods->xUnlock(REAL(f), lock);
+}
+
+static int stats_check_reserved_lock(sqlite3_file* f, int* out) {
+    return REAL(f)->pMethods->xCheckReservedLock(REAL(f), out);
+}
+
+static int stats_file_control(sqlite3_file* f, int op, void* arg) {
+    return REAL(f)->pMethods->xFileControl(REAL(f), op, arg);
+}
+
+static int stats_sector_size(sqlite3_file* f) {
+    return REAL(f)->pMethods->xSectorSize(REAL(f));
+}
+
+static int stats_device_characteristics(sqlite3_file* f) {
+    return REAL(f)->pMethods->xDeviceCharacteristics(REAL(f));
+}
+
+static int stats_shm_map(sqlite3_file* f, int region, int size, int extend, void volatile** out) {
+    return REAL(f)->pMethods->xShmMap(REAL(f), region, size, extend, out);
+}
+
+static int stats_shm_lock(sqlite3_file* f, int offset, int n, int flags) {
+    return REAL(f)->pMethods->xShmLock(REAL(f), offset, n, flags);
+}
+
+static void stats_shm_barrier(sqlite3_file* f) {
+    REAL(f)->pMethods->xShmBarrier(REAL(f));
+}
+
+static int stats_shm_unmap(sqlite3_file* f, int delete_flag) {
+    return REAL(f)->pMethods->xShmUnmap(REAL(f), delete_flag);
+}
+
+static int stats_fetch(sqlite3_file* f, sqlite3_int64 ofst, int amt, void** out) {
+    return REAL(f)->pMethods->xFetch(REAL(f), ofst, amt, out);
+}
+
+static int stats_unfetch(sqlite3_file* f, sqlite3_int64 ofst, void* p) {
+    return REAL(f)->pMethods->xUnfetch(REAL(f), ofst, p);
+}
+
+static const sqlite3_io_methods stats_io_methods_v1 = {
+    1,
+    stats_close, stats_read, stats_write, stats_truncate, stats_sync, stats_file_size,
+    stats_lock, stats_unlock, stats_check_reserved_lock, stats_file_control,
+    stats_sector_size, stats_device_characteristics,
+    NULL, NULL, NULL, NULL, NULL, NULL
+};
+
+static const sqlite3_io_methods stats_io_methods_v3 = {
+    3,
+    stats_close, stats_read, stats_write, stats_truncate, stats_sync, stats_file_size,
+    stats_lock, stats_unlock, stats_check_reserved_lock, stats_file_control,
+    stats_sector_size, stats_device_characteristics,
+    stats_shm_map, stats_shm_lock, stats_shm_barrier, stats_shm_unmap,
+    stats_fetch, stats_unfetch
+};
+
+// Métodos do VFS: apenas xOpen é interceptado, o resto é repassado
+
+static int stats_open(sqlite3_vfs* vfs, const char* name, sqlite3_file* f, int flags, int* out_flags) {
+    (void)vfs;
+    stats_file_t* sf = (stats_file_t*)f;
+    sf->real = (sqlite3_file*)&sf[1];
+
+    sf->entry = NULL;
+
+    int rc = root_vfs->xOpen(root_vfs, name, sf->real, flags, out_flags);
+    if (sf->real->pMethods == NULL) {
+        f->pMethods = NULL;
+        return rc;
+    }
+    f->pMethods = sf->real->pMethods->iVersion >= 3 ? &stats_io_methods_v3 : &stats_io_methods_v1;
+
+    // Journal e WAL contam no banco a que pertencem; bancos anexados têm entrada própria
+    if (name && (flags & (SQLITE_OPEN_MAIN_DB | SQLITE_OPEN_MAIN_JOURNAL | SQLITE_OPEN_WAL))) {
+        sf->entry = acquire_entry(sqlite3_filename_database(name));
+    }
+    return rc;
+}
+
+static int stats_delete(sqlite3_vfs* vfs, const char* name, int sync_dir) {
+    (void)vfs;
+    return root_vfs->xDelete(root_vfs, name, sync_dir);
+}
+
+static int stats_access(sqlite3_vfs* vfs, const char* name, int flags, int* out) {
+    (void)vfs;
+    return root_vfs->xAccess(root_vfs, name, flags, out);
+}
+
+static int stats_full_pathname(sqlite3_vfs* vfs, const char* name, int n, char* out) {
+    (void)vfs;
+    return root_vfs->xFullPathname(root_vfs, name, n, out);
+}
+
+static void* stats_dl_open(sqlite3_vfs* vfs, const char* path) {
+    (void)vfs;
+    return root_vfs->xDlOpen(root_vfs, path);
+}
+
+static void stats_dl_error(sqlite3_vfs* vfs, int n, char* msg) {
+    (void)vfs;
+    root_vfs->xDlError(root_vfs, n, msg);
+}
+
+static void (*stats_dl_sym(sqlite3_vfs* vfs, void* handle, const char* symbol))(void) {
+    (void)vfs;
+    return root_vfs->xDlSym(root_vfs, handle, symbol);
+}
+
+static void stats_dl_close(sqlite3_vfs* vfs, void* handle) {
+    (void)vfs;
+    root_vfs->xDlClose(root_vfs, handle);
+}
+
+static int stats_randomness(sqlite3_vfs* vfs, int n, char* out) {
+    (void)vfs;
+    return root_vfs->xRandomness(root_vfs, n, out);
+}
+
+static int stats_sleep(sqlite3_vfs* vfs, int us) {
+    (void)vfs;
+    return root_vfs->xSleep(root_vfs, us);
+}
+
+static int stats_current_time(sqlite3_vfs* vfs, double* out) {
+    (void)vfs;
+    return root_vfs->xCurrentTime(root_vfs, out);
+}
+
+static int stats_get_last_error(sqlite3_vfs* vfs, int n, char* out) {
+    (void)vfs;
+    return root_vfs->xGetLastError(root_vfs, n, out);
+}
+
+static int stats_current_time_int64(sqlite3_vfs* vfs, sqlite3_int64* out) {
+    (void)vfs;
+    return root_vfs->xCurrentTimeInt64(root_vfs, out);
+}
+
+int datalogger_vfs_register(void) {
+    if (root_vfs) return SQLITE_OK;
+
+    sqlite3_vfs* root = sqlite3_vfs_find(NULL);
+    if (!root) return SQLITE_ERROR;
+
+    memset(&stats_vfs, 0, sizeof(stats_vfs));
+    stats_vfs.iVersion = 2;
+    stats_vfs.szOsFile = (int)sizeof(stats_file_t) + root->szOsFile;
+    stats_vfs.mxPathname = root->mxPathname;
+    stats_vfs.zName = DATALOGGER_VFS_NAME;
+    stats_vfs.xOpen = stats_open;
+    stats_vfs.xDelete = stats_delete;
+    stats_vfs.xAccess = stats_access;
+    stats_vfs.xFullPathname = stats_full_pathname;
+    stats_vfs.xDlOpen = stats_dl_open;
+    stats_vfs.xDlError = stats_dl_error;
+    stats_vfs.xDlSym = stats_dl_sym;
+    stats_vfs.xDlClose = stats_dl_close;
+    stats_vfs.xRandomness = stats_randomness;
+    stats_vfs.xSleep = stats_sleep;
+    stats_vfs.xCurrentTime = stats_current_time;
+    stats_vfs.xGetLastError = stats_get_last_error;
+    stats_vfs.xCurrentTimeInt64 = stats_current_time_int64;
+
+    root_vfs = root;
+    int rc = sqlite3_vfs_register(&stats_vfs, 0);
+    if (rc != SQLITE_OK) {
+        root_vfs = NULL;
+    }
+    return rc;
+}
+
+void datalogger_vfs_get_counters(datalogger_vfs_counters_t* out) {
+    if (!out) return;
+    load_counters(&counters, out);
+}
+
+bool datalogger_vfs_get_db_counters(const char* db_path, datalogger_vfs_counters_t* out) {
+    if (!out) return false;
+    memset(out, 0, sizeof(*out));
+    if (!db_path || !root_vfs) return false;
+
+    // Mesmo caminho completo que o SQLite passa para xOpen
+    char full[DATALOGGER_VFS_MAX_PATH];
+    if (root_vfs->xFullPathname(root_vfs, db_path, (int)sizeof(full), full) != SQLITE_OK) return false;
+
+    bool found = false;
+    pthread_mutex_lock(&entries_lock);
+    for (int i = 0; i < DATALOGGER_VFS_MAX_DBS; i++) {
+        if (db_entries[i].path[0] && strcmp(db_entries[i].path, full) == 0) {
+            load_counters(&db_entries[i].counters, out);
+            found = true;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&entries_lock);
+    return found;
+}
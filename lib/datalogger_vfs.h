@@ -0,0 +1,63 @@
+/**
+ * @file datalogger_vfs.h
+ * @brief COEL E33 DataLogger - VFS SQLite com contadores de I/O
+ * @author Nova Instruments
+ *
+ * Camada fina sobre o VFS padrão do SQLite que contabiliza bytes escritos,
+ * chamadas de sincronização (fsync) e sua latência. Há um total do processo
+ * e contadores por banco (principal, journal e WAL), identificados pelo
+ * caminho do arquivo principal: o catálogo, bancos anexados na consolidação
+ * e snapshots de exportação não se misturam ao banco em uso.
+ */
+
+#ifndef DATALOGGER_VFS_H
+#define DATALOGGER_VFS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define DATALOGGER_VFS_NAME "datalogger"
+#define DATALOGGER_LATENCY_BUCKETS 20     // Histograma log2 em µs: [0] < 2 µs ... [19] >= 2^19 µs
+#define DATALOGGER_VFS_MAX_DBS 16         // Bancos com contadores próprios (entradas de bancos fechados são reaproveitadas)
+#define DATALOGGER_VFS_MAX_PATH 512       // Caminho completo do banco
+
+// Contadores acumulados do VFS
+typedef struct {
+    uint64_t bytes_written;     // Bytes escritos (principal, journal e WAL)
+    uint64_t writes;            // Chamadas de escrita
+    uint64_t syncs;             // Chamadas de sincronização (fsync/fdatasync)
+    uint32_t sync_latency[DATALOGGER_LATENCY_BUCKETS];  // Histograma de latência de sincronização
+} datalogger_vfs_counters_t;
+
+/**
+ * @brief Registra o VFS de contagem (idempotente)
+ * @return SQLITE_OK em caso de sucesso, código de erro SQLite caso contrário
+ */
+int datalogger_vfs_register(void);
+
+/**
+ * @brief Obtém os contadores acumulados de todos os bancos desde o início do processo
+ * @param out Estrutura a ser preenchida
+ */
+void datalogger_vfs_get_counters(datalogger_vfs_counters_t* out);
+
+/**
+ * @brief Obtém os contadores de um banco (arquivo principal, journal e WAL)
+ *
+ * Os contadores acumulam enquanto o banco estiver aberto por alguma conexão
+ * e continuam na reabertura do mesmo caminho; a entrada de um banco fechado
+ * pode ser reaproveitada quando a tabela enche.
+ * @param db_path Caminho do arquivo principal (relativo ou completo)
+ * @param out Estrutura a ser preenchida (zerada se o banco não for encontrado)
+ * @return true se o banco tem contadores
+ */
+bool datalogger_vfs_get_db_counters(const char* db_path, datalogger_vfs_counters_t* out);
+
+/**
+ * @brief Converte uma latência em nanossegundos no índice do histograma log2
+ * @param latency_ns Latência medida
+ * @return Índice entre 0 e DATALOGGER_LATENCY_BUCKETS - 1
+ */
+int datalogger_latency_bucket(long long latency_ns);
+
+#endif // DATALOGGER_VFS_H
@@ -0,0 +1,426 @@
+/**
+ * @file gpio_signal.c
+ * @brief COEL E33 DataLogger - Sinalização assíncrona por buzzer e LEDs (GPIO)
+ * @author Nova Instruments
+ */
+
+#include "gpio_signal.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <gpiod.h>
+
+// Saídas acionadas em cada passo de um padrão
+#define OUT_BUZZER    (1u << 0)
+#define OUT_LED_OK    (1u << 1)
+#define OUT_LED_ERROR (1u << 2)
+#define OUTPUT_COUNT 3
+
+// Passo de um padrão: saídas ligadas durante ms
+typedef struct {
+    uint8_t outputs;
+    uint16_t ms;
+} signal_step_t;
+
+typedef struct {
+    const char* name;
+    const signal_step_t* steps;
+    int count;
+} signal_pattern_t;
+
+// Pausa final de 400 ms: padrões seguidos (um por pen drive) não se emendam
+static const signal_step_t success_steps[] = {
+    { OUT_BUZZER | OUT_LED_OK, 200 }, { 0, 200 },
+    { OUT_BUZZER | OUT_LED_OK, 200 }, { 0, 200 },
+    { OUT_BUZZER | OUT_LED_OK, 200 }, { 0, 200 },
+    { 0, 400 },
+};
+
+static const signal_step_t error_steps[] = {
+    { OUT_BUZZER | OUT_LED_ERROR, 1000 }, { 0, 400 },
+};
+
+static const signal_step_t progress_steps[] = {
+    { OUT_LED_OK, 50 }, { 0, 150 },
+};
+
+static const signal_step_t alarm_steps[] = {
+    { OUT_BUZZER | OUT_LED_ERROR, 100 }, { OUT_LED_ERROR, 100 },
+    { OUT_BUZZER | OUT_LED_ERROR, 100 }, { OUT_LED_ERROR, 100 },
+    { OUT_BUZZER | OUT_LED_ERROR, 100 }, { OUT_LED_ERROR, 100 },
+    { OUT_BUZZER | OUT_LED_ERROR, 100 }, { OUT_LED_ERROR, 100 },
+    { OUT_BUZZER | OUT_LED_ERROR, 100 }, { 0, 400 },
+};
+
+#define PATTERN(name, steps) { name, steps, (int)(sizeof(steps) / sizeof(steps[0])) }
+static const signal_pattern_t patterns[GPIO_SIGNAL_PATTERN_COUNT] = {
+    [GPIO_SIGNAL_SUCCESS]  = PATTERN("success", success_steps),
+    [GPIO_SIGNAL_ERROR]    = PATTERN("error", error_steps),
+    [GPIO_SIGNAL_PROGRESS] = PATTERN("progress", progress_steps),
+    [GPIO_SIGNAL_ALARM]    = PATTERN("alarm", alarm_steps),
+};
+
+// Estado da sinalização: fila circular protegida pelo mutex; o padrão em
+// andamento e as linhas pertencem à thread
+static pthread_t signal_thread;
+static pthread_mutex_t signal_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t signal_idle_cond;
+static bool signal_running = false;
+static bool signal_stop_requested = false;
+static bool signal_busy = false;                 // Padrão em andamento
+static bool progress_waiting = false;            // Pulsação de progresso na fila
+static gpio_signal_pattern_t signal_queue[GPIO_SIGNAL_QUEUE_SIZE];
+static unsigned queue_head = 0;
+static unsigned queue_count = 0;
+static gpio_signal_stats_t signal_stats;
+static int wake_fd = -1;                         // eventfd: novo padrão ou parada
+static int timer_fd = -1;                        // timerfd: fim do passo atual
+static struct gpiod_chip* gpio_chip = NULL;
+static struct gpiod_line* output_lines[OUTPUT_COUNT];
+
+/**
+ * @brief Liga/desliga cada saída configurada conforme a máscara
+ */
+static void set_outputs(unsigned outputs) {
+    for (int i = 0; i < OUTPUT_COUNT; i++) {
+        if (output_lines[i]) {
+            gpiod_line_set_value(output_lines[i], (outputs >> i) & 1u);
+        }
+    }
+}
+
+/**
+ * @brief Arma o timerfd para disparar uma vez após ms
+ */
+static void arm_timer(int ms) {
+    struct itimerspec its;
+    memset(&its, 0, sizeof(its));
+    its.it_value.tv_sec = ms / 1000;
+    its.it_value.tv_nsec = (long)(ms % 1000) * 1000000L;
+    if (ms <= 0) {
+        its.it_value.tv_nsec = 1;  // it_value zerado desarmaria o timer
+    }
+    timerfd_settime(timer_fd, 0, &its, NULL);
+}
+
+/**
+ * @brief Retira o próximo padrão da fila (chamar com o mutex)
+ */
+static const signal_pattern_t* dequeue_pattern(void) {
+    if (queue_count == 0) {
+        return NULL;
+    }
+    gpio_signal_pattern_t pattern = signal_queue[queue_head];
+    queue_head = (queue_head + 1) % GPIO_SIGNAL_QUEUE_SIZE;
+    queue_count--;
+    if (pattern == GPIO_SIGNAL_PROGRESS) {
+        progress_waiting = false;
+    }
+    return &patterns[pattern];
+}
+
+/**
+ * @brief Thread de sinalização: dorme em poll() até um padrão chegar ou o passo atual vencer
+ */
+static void* signal_thread_main(void* arg) {
+    (void)arg;
+    const signal_pattern_t* current = NULL;
+    int step = 0;
+
+    for (;;) {
+        bool start = false;
+        pthread_mutex_lock(&signal_mutex);
+        if (!current) {
+            current = dequeue_pattern();
+            step = 0;
+            start = current != NULL;
+            signal_busy = start;
+            if (!current) {
+                pthread_cond_broadcast(&signal_idle_cond);
+            }
+        }
+        bool stop = signal_stop_requested;
+        pthread_mutex_unlock(&signal_mutex);
+        if (stop) {
+            break;
+        }
+
+        if (start) {
+            set_outputs(current->steps[0].outputs);
+            arm_timer(current->steps[0].ms);
+        }
+
+        struct pollfd fds[2] = {
+            { .fd = wake_fd, .events = POLLIN },
+            { .fd = timer_fd, .events = POLLIN },
+        };
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            printf("Erro no poll da sinalização: %s\n", strerror(errno));
+            break;
+        }
+
+        uint64_t value;
+        if (fds[0].revents & POLLIN) {
+            if (read(wake_fd, &value, sizeof(value)) < 0 && errno != EAGAIN) {
+                printf("Erro ao ler eventfd da sinalização: %s\n", strerror(errno));
+            }
+        }
+
+        if (current && (fds[1].revents & POLLIN) && read(timer_fd, &value, sizeof(value)) > 0) {
+            if (++step < current->count) {
+                set_outputs(current->steps[step].outputs);
+                arm_timer(current->steps[step].ms);
+            } else {
+                set_outputs(0);
+                current = NULL;
+                pthread_mutex_lock(&signal_mutex);
+                signal_stats.played++;
+                pthread_mutex_unlock(&signal_mutex);
+            }
+        }
+    }
+
+    set_outputs(0);
+    pthread_mutex_lock(&signal_mutex);
+    signal_busy = false;
+    pthread_cond_broadcast(&signal_idle_cond);
+    pthread_mutex_unlock(&signal_mutex);
+    return NULL;
+}
+
+/**
+ * @brief Fecha descritores, linhas e chip
+ */
+static void release_resources(void) {
+    for (int i = 0; i < OUTPUT_COUNT; i++) {
+        if (output_lines[i]) {
+            gpiod_line_set_value(output_lines[i], 0);
+            gpiod_line_release(output_lines[i]);
+            output_lines[i] = NULL;
+        }
+    }
+    if (gpio_chip) {
+        gpiod_chip_close(gpio_chip);
+        gpio_chip = NULL;
+    }
+    if (wake_fd >= 0) {
+        close(wake_fd);
+        wake_fd = -1;
+    }
+    if (timer_fd >= 0) {
+        close(timer_fd);
+        timer_fd = -1;
+    }
+}
+
+int gpio_signal_init(const gpio_signal_config_t* config) {
+    gpio_signal_config_t defaults = {
+        .chip = GPIO_SIGNAL_CHIP,
+        .buzzer_line = GPIO_SIGNAL_BUZZER_LINE,
+        .led_ok_line = GPIO_SIGNAL_LED_OK_LINE,
+        .led_error_line = GPIO_SIGNAL_LED_ERROR_LINE
+    };
+    if (!config) {
+        config = &defaults;
+    }
+
+    pthread_mutex_lock(&signal_mutex);
+    bool running = signal_running;
+    pthread_mutex_unlock(&signal_mutex);
+    if (running) {
+        printf("Sinalização já inicializada\n");
+        return 0;
+    }
+
+    // Abrir chip GPIO
+    gpio_chip = gpiod_chip_open_by_name(config->chip);
+    if (!gpio_chip) {
+        printf("Erro ao abrir chip GPIO: %s\n", config->chip);
+        return -1;
+    }
+
+    // Linhas como saída, desligadas; uma linha indisponível não impede as demais
+    const int offsets[OUTPUT_COUNT] = { config->buzzer_line, config->led_ok_line, config->led_error_line };
+    const char* consumers[OUTPUT_COUNT] = { "buzzer", "led_ok", "led_error" };
+    int outputs = 0;
+    for (int i = 0; i < OUTPUT_COUNT; i++) {
+        if (offsets[i] < 0) {
+            continue;
+        }
+        output_lines[i] = gpiod_chip_get_line(gpio_chip, (unsigned int)offsets[i]);
+        if (!output_lines[i] || gpiod_line_request_output(output_lines[i], consumers[i], 0) < 0) {
+            printf("Erro ao configurar GPIO %d (%s) como saída\n", offsets[i], consumers[i]);
+            output_lines[i] = NULL;
+            continue;
+        }
+        outputs++;
+    }
+
+    wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+    if (outputs == 0 || wake_fd < 0 || timer_fd < 0) {
+        if (outputs > 0) {
+            printf("Erro ao criar eventfd/timerfd da sinalização: %s\n", strerror(errno));
+        }
+        release_resources();
+        return -1;
+    }
+
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&signal_idle_cond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    pthread_mutex_lock(&signal_mutex);
+    signal_stop_requested = false;
+    signal_busy = false;
+    progress_waiting = false;
+    queue_head = 0;
+    queue_count = 0;
+    memset(&signal_stats, 0, sizeof(signal_stats));
+    pthread_mutex_unlock(&signal_mutex);
+
+    if (pthread_create(&signal_thread, NULL, signal_thread_main, NULL) != 0) {
+        printf("Erro ao criar thread de sinalização\n");
+        pthread_cond_destroy(&signal_idle_cond);
+        release_resources();
+        return -1;
+    }
+
+    pthread_mutex_lock(&signal_mutex);
+    signal_running = true;
+    pthread_mutex_unlock(&signal_mutex);
+
+    printf("🔊 Sinalização inicializada em %s (buzzer %d, LED %d, LED de erro %d)\n", config->chip,
+           output_lines[0] ? config->buzzer_line : -1, output_lines[1] ? config->led_ok_line : -1,
+           output_lines[2] ? config->led_error_line : -1);
+    return 0;
+}
+
+bool gpio_signal_play(gpio_signal_pattern_t pattern) {
+    if (pattern < 0 || pattern >= GPIO_SIGNAL_PATTERN_COUNT) {
+        return false;
+    }
+
+    pthread_mutex_lock(&signal_mutex);
+    if (!signal_running || signal_stop_requested) {
+        pthread_mutex_unlock(&signal_mutex);
+        return false;
+    }
+    if (pattern == GPIO_SIGNAL_PROGRESS && progress_waiting) {
+        signal_stats.coalesced++;
+        pthread_mutex_unlock(&signal_mutex);
+        return true;
+    }
+    if (queue_count == GPIO_SIGNAL_QUEUE_SIZE) {
+        signal_stats.dropped++;
+        pthread_mutex_unlock(&signal_mutex);
+        return false;
+    }
+    signal_queue[(queue_head + queue_count) % GPIO_SIGNAL_QUEUE_SIZE] = pattern;
+    queue_count++;
+    signal_stats.queued++;
+    if (pattern == GPIO_SIGNAL_PROGRESS) {
+        progress_waiting = true;
+    }
+
+    // Ainda sob o mutex: gpio_signal_cleanup() só fecha wake_fd depois de
+    // marcar signal_running = false, então o descritor continua aberto aqui
+    // (eventfd não bloqueante: a escrita não segura o mutex por tempo algum)
+    uint64_t one = 1;
+    if (write(wake_fd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+        printf("Erro ao acordar thread de sinalização: %s\n", strerror(errno));
+    }
+    pthread_mutex_unlock(&signal_mutex);
+    return true;
+}
+
+bool gpio_signal_flush(int timeout_ms) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&signal_mutex);
+    int ret = 0;
+    while (signal_running && (queue_count > 0 || signal_busy) && ret != ETIMEDOUT) {
+        ret = pthread_cond_timedwait(&signal_idle_cond, &signal_mutex, &deadline);
+    }
+    bool idle = !signal_running || (queue_count == 0 && !signal_busy);
+    pthread_mutex_unlock(&signal_mutex);
+    return idle;
+}
+
+int gpio_signal_pattern_ms(gpio_signal_pattern_t pattern) {
+    if (pattern < 0 || pattern >= GPIO_SIGNAL_PATTERN_COUNT) {
+        return 0;
+    }
+    int total = 0;
+    for (int i = 0; i < patterns[pattern].count; i++) {
+        total += patterns[pattern].steps[i].ms;
+    }
+    return total;
+}
+
+const char* gpio_signal_pattern_name(gpio_signal_pattern_t pattern) {
+    if (pattern < 0 || pattern >= GPIO_SIGNAL_PATTERN_COUNT) {
+        return "desconhecido";
+    }
+    return patterns[pattern].name;
+}
+
+void gpio_signal_get_stats(gpio_signal_stats_t* stats) {
+    if (!stats) {
+        return;
+    }
+    pthread_mutex_lock(&signal_mutex);
+    *stats = signal_stats;
+    pthread_mutex_unlock(&signal_mutex);
+}
+
+void gpio_signal_cleanup(void) {
+    pthread_mutex_lock(&signal_mutex);
+    bool running = signal_running;
+    pthread_mutex_unlock(&signal_mutex);
+    if (!running) {
+        return;
+    }
+
+    // Sinalização final (ex: extração concluída logo antes de finalizar) toca até o fim
+    if (!gpio_signal_flush(GPIO_SIGNAL_DRAIN_MS)) {
+        printf("⚠️  Sinalização interrompida com padrões na fila\n");
+    }
+
+    pthread_mutex_lock(&signal_mutex);
+    signal_stop_requested = true;
+    uint64_t one = 1;
+    if (write(wake_fd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+        printf("Erro ao acordar thread de sinalização: %s\n", strerror(errno));
+    }
+    pthread_mutex_unlock(&signal_mutex);
+    pthread_join(signal_thread, NULL);
+
+    pthread_mutex_lock(&signal_mutex);
+    signal_running = false;
+    queue_count = 0;
+    pthread_mutex_unlock(&signal_mutex);
+
+    pthread_cond_destroy(&signal_idle_cond);
+    release_resources();
+    printf("🔊 Sinalização finalizada\n");
+}
@@ -0,0 +1,95 @@
+/**
+ * @file gpio_signal.h
+ * @brief COEL E33 DataLogger - Sinalização assíncrona por buzzer e LEDs (GPIO)
+ * @author Nova Instruments
+ *
+ * Padrões de sinalização (sucesso, erro, pulsação de progresso, alarme) são
+ * enfileirados em O(1) e tocados por uma thread própria, guiada por um
+ * timerfd: quem sinaliza retorna imediatamente, sem usleep(). As saídas são
+ * o buzzer (GPIO23) e, opcionalmente, um LED de estado e um LED de erro,
+ * via libgpiod. O chip e as linhas são configuráveis, o que permite testar
+ * com o módulo gpio-sim do kernel (ver tools/gpio_signal_bench.c).
+ */
+
+#ifndef GPIO_SIGNAL_H
+#define GPIO_SIGNAL_H
+
+#include <stdbool.h>
+
+// Configurações padrão
+#define GPIO_SIGNAL_CHIP "gpiochip0"
+#define GPIO_SIGNAL_BUZZER_LINE 23
+#define GPIO_SIGNAL_LED_OK_LINE -1        // LED de estado (-1 = sem LED)
+#define GPIO_SIGNAL_LED_ERROR_LINE -1     // LED de erro (-1 = sem LED)
+#define GPIO_SIGNAL_QUEUE_SIZE 16         // Padrões aguardando; fila cheia = padrão descartado
+#define GPIO_SIGNAL_DRAIN_MS 3000         // Espera pelos padrões na fila ao finalizar
+
+// Padrões de sinalização
+typedef enum {
+    GPIO_SIGNAL_SUCCESS = 0,   // 3 beeps curtos com o LED de estado
+    GPIO_SIGNAL_ERROR,         // 1 beep longo com o LED de erro
+    GPIO_SIGNAL_PROGRESS,      // Piscada curta do LED de estado, sem som
+    GPIO_SIGNAL_ALARM,         // 5 beeps rápidos com o LED de erro
+    GPIO_SIGNAL_PATTERN_COUNT
+} gpio_signal_pattern_t;
+
+// Chip e linhas usados
+typedef struct {
+    const char* chip;          // Nome do chip (ex: "gpiochip0")
+    int buzzer_line;           // Linha do buzzer (-1 = sem buzzer)
+    int led_ok_line;           // Linha do LED de estado (-1 = sem LED)
+    int led_error_line;        // Linha do LED de erro (-1 = sem LED)
+} gpio_signal_config_t;
+
+// Estatísticas da sinalização
+typedef struct {
+    unsigned long queued;      // Padrões aceitos na fila
+    unsigned long played;      // Padrões tocados até o fim
+    unsigned long dropped;     // Descartados (fila cheia)
+    unsigned long coalesced;   // Pulsações de progresso ignoradas (outra já aguardando)
+} gpio_signal_stats_t;
+
+/**
+ * @brief Abre o chip, configura as linhas como saída e inicia a thread de sinalização
+ * @param config Chip e linhas (NULL = GPIO_SIGNAL_CHIP e GPIO_SIGNAL_*_LINE)
+ * @return 0 em caso de sucesso, -1 se nenhuma saída pôde ser configurada
+ */
+int gpio_signal_init(const gpio_signal_config_t* config);
+
+/**
+ * @brief Enfileira um padrão e retorna imediatamente (seguro entre threads)
+ *
+ * Pulsações de progresso não se acumulam: com uma já aguardando na fila,
+ * a nova é ignorada.
+ * @return true se o padrão foi enfileirado (ou já havia pulsação aguardando)
+ */
+bool gpio_signal_play(gpio_signal_pattern_t pattern);
+
+/**
+ * @brief Aguarda a fila esvaziar e o padrão em andamento terminar
+ * @param timeout_ms Tempo máximo de espera
+ * @return true se a sinalização terminou dentro do prazo
+ */
+bool gpio_signal_flush(int timeout_ms);
+
+/**
+ * @brief Duração de um padrão em milissegundos (inclui a pausa final)
+ */
+int gpio_signal_pattern_ms(gpio_signal_pattern_t pattern);
+
+/**
+ * @brief Nome do padrão ("success", "error", "progress", "alarm")
+ */
+const char* gpio_signal_pattern_name(gpio_signal_pattern_t pattern);
+
+/**
+ * @brief Copia as estatísticas da sinalização
+ */
+void gpio_signal_get_stats(gpio_signal_stats_t* stats);
+
+/**
+ * @brief Toca o que resta na fila (até GPIO_SIGNAL_DRAIN_MS), desliga as saídas e libera o chip
+ */
+void gpio_signal_cleanup(void);
+
+#endif // GPIO_SIGNAL_H
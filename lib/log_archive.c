@@ -0,0 +1,670 @@
+/**
+ * @file log_archive.c
+ * @brief COEL E33 DataLogger - Arquivamento compactado de segmentos de log
+ * @author Nova Instruments
+ */
+
+#define _GNU_SOURCE  // Para strptime
+#include "log_archive.h"
+#include "thread_priority.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sqlite3.h>
+#include <zlib.h>
+
+// Caminho de um segmento: diretório de origem + "/" + nome da entrada (até 255)
+#define LOG_ARCHIVE_SEGMENT_PATH (LOG_ARCHIVE_MAX_PATH + 256)
+
+// Estado da thread de arquivamento
+static pthread_t archive_thread;
+static pthread_mutex_t archive_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t archive_cond = PTHREAD_COND_INITIALIZER;
+static bool archive_running = false;
+static bool archive_stop_requested = false;
+static log_archive_config_t archive_config;
+
+/**
+ * @brief Retorna tempo em nanossegundos do relógio indicado
+ */
+static long long clock_ns(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * @brief Limita o uso de CPU da compressão a LOG_ARCHIVE_CPU_BUDGET_PERCENT de um núcleo
+ */
+static void throttle_cpu(long long cpu_start, long long wall_start) {
+    long long cpu_used = clock_ns(CLOCK_THREAD_CPUTIME_ID) - cpu_start;
+    long long wall_used = clock_ns(CLOCK_MONOTONIC) - wall_start;
+    long long wall_needed = cpu_used * 100 / LOG_ARCHIVE_CPU_BUDGET_PERCENT;
+
+    if (wall_needed > wall_used) {
+        long long wait_ns = wall_needed - wall_used;
+        struct timespec ts = { wait_ns / 1000000000LL, wait_ns % 1000000000LL };
+        nanosleep(&ts, NULL);
+    }
+}
+
+/**
+ * @brief Escreve todo o buffer, tratando escritas parciais
+ */
+static int write_all(int fd, const void* data, size_t len) {
+    const unsigned char* p = data;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/**
+ * @brief Sincroniza o diretório para tornar um rename durável
+ */
+static void sync_directory(const char* dir_path) {
+    int fd = open(dir_path, O_RDONLY | O_DIRECTORY);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+}
+
+/**
+ * @brief Converte "DD/MM/AAAA HH:MM:SS" (coluna de data do log TXT) em ms desde epoch
+ */
+static long long parse_txt_line_time(const char* line) {
+    if (!isdigit((unsigned char)line[0])) return 0;
+
+    const char* sep = strchr(line, ';');
+    if (!sep) return 0;
+
+    struct tm tm_info;
+    memset(&tm_info, 0, sizeof(tm_info));
+    if (!strptime(sep + 1, "%d/%m/%Y %H:%M:%S", &tm_info)) return 0;
+
+    tm_info.tm_isdst = -1;
+    return (long long)mktime(&tm_info) * 1000;
+}
+
+/**
+ * @brief Obtém o intervalo de tempo de um log TXT (primeira e última linha de dados)
+ */
+static void get_txt_time_range(const char* path, long long* start, long long* end) {
+    FILE* fp = fopen(path, "r");
+    if (!fp) return;
+
+    // Primeiro registro: logo após o cabeçalho
+    char line[1024];
+    while (fgets(line, sizeof(line), fp)) {
+        long long t = parse_txt_line_time(line);
+        if (t > 0) {
+            *start = t;
+            break;
+        }
+    }
+
+    // Último registro: apenas o bloco final do arquivo é lido
+    char tail[4096];
+    if (fseek(fp, 0, SEEK_END) == 0) {
+        long size = ftell(fp);
+        long offset = size > (long)sizeof(tail) - 1 ? size - (long)sizeof(tail) + 1 : 0;
+        fseek(fp, offset, SEEK_SET);
+        size_t n = fread(tail, 1, sizeof(tail) - 1, fp);
+        tail[n] = '\0';
+
+        for (long i = (long)n - 1; i >= 0; i--) {
+            if ((i == 0 && offset == 0) || (i > 0 && tail[i - 1] == '\n')) {
+                long long t = parse_txt_line_time(tail + i);
+                if (t > 0) {
+                    *end = t;
+                    break;
+                }
+            }
+        }
+    }
+
+    fclose(fp);
+}
+
+/**
+ * @brief Obtém o intervalo de tempo de um banco SQLite (MIN/MAX de CollectTime)
+ */
+static void get_db_time_range(const char* path, long long* start, long long* end) {
+    sqlite3* db = NULL;
+    if (sqlite3_open_v2(path, &db, SQLITE_OPEN_READONLY, NULL) != SQLITE_OK) {
+        sqlite3_close(db);
+        return;
+    }
+
+    sqlite3_stmt* stmt = NULL;
+    if (sqlite3_prepare_v2(db, "SELECT MIN(CollectTime), MAX(CollectTime) FROM DataGrpData;",
+                           -1, &stmt, NULL) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            *start = sqlite3_column_int64(stmt, 0);
+            *end = sqlite3_column_int64(stmt, 1);
+        }
+    }
+    sqlite3_finalize(stmt);
+    sqlite3_close(db);
+}
+
+int log_archive_compress_file(const char* src_path, const char* archive_dir, log_archive_entry_t* entry) {
+    if (!src_path || !archive_dir) return -1;
+
+    const char* name = strrchr(src_path, '/') ? strrchr(src_path, '/') + 1 : src_path;
+
+    char gz_path[LOG_ARCHIVE_SEGMENT_PATH];
+    char tmp_path[LOG_ARCHIVE_SEGMENT_PATH + 8];
+    if (snprintf(gz_path, sizeof(gz_path), "%s/%s.gz", archive_dir, name) >= (int)sizeof(gz_path)) {
+        printf("Erro: caminho longo demais para arquivar %s\n", name);
+        return -1;
+    }
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", gz_path);
+
+    int in_fd = open(src_path, O_RDONLY);
+    if (in_fd < 0) {
+        printf("Erro ao abrir %s para arquivamento: %s\n", src_path, strerror(errno));
+        return -1;
+    }
+
+    int out_fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out_fd < 0) {
+        printf("Erro ao criar %s: %s\n", tmp_path, strerror(errno));
+        close(in_fd);
+        return -1;
+    }
+
+    // windowBits 15 + 16: saída no formato gzip
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    if (deflateInit2(&zs, LOG_ARCHIVE_LEVEL, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        printf("Erro ao inicializar compressor zlib\n");
+        close(in_fd);
+        close(out_fd);
+        unlink(tmp_path);
+        return -1;
+    }
+
+    unsigned char in_buf[LOG_ARCHIVE_CHUNK_SIZE];
+    unsigned char out_buf[LOG_ARCHIVE_CHUNK_SIZE];
+    unsigned long long original_bytes = 0;
+    unsigned long long compressed_bytes = 0;
+    long long cpu_start = clock_ns(CLOCK_THREAD_CPUTIME_ID);
+    long long wall_start = clock_ns(CLOCK_MONOTONIC);
+    int result = 0;
+    int flush = Z_NO_FLUSH;
+    // Motivo da falha salvo no ponto em que ocorreu: deflate() e as
+    // chamadas seguintes (fadvise, deflateEnd, close) não preservam errno
+    int saved_errno = 0;
+    const char* zlib_error = NULL;
+
+    while (flush != Z_FINISH && result == 0) {
+        ssize_t n = read(in_fd, in_buf, sizeof(in_buf));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            saved_errno = errno;
+            result = -1;
+            break;
+        }
+
+        original_bytes += (unsigned long long)n;
+        flush = (n == 0) ? Z_FINISH : Z_NO_FLUSH;
+        zs.next_in = in_buf;
+        zs.avail_in = (uInt)n;
+
+        do {
+            zs.next_out = out_buf;
+            zs.avail_out = sizeof(out_buf);
+            int ret = deflate(&zs, flush);
+            if (ret == Z_STREAM_ERROR) {
+                zlib_error = zError(ret);
+                result = -1;
+                break;
+            }
+            size_t produced = sizeof(out_buf) - zs.avail_out;
+            if (produced > 0 && write_all(out_fd, out_buf, produced) != 0) {
+                saved_errno = errno;
+                result = -1;
+                break;
+            }
+            compressed_bytes += produced;
+        } while (zs.avail_out == 0);
+
+        // Não manter o segmento original no page cache
+        if ((original_bytes % (1024 * 1024)) < LOG_ARCHIVE_CHUNK_SIZE) {
+            posix_fadvise(in_fd, 0, 0, POSIX_FADV_DONTNEED);
+            throttle_cpu(cpu_start, wall_start);
+        }
+    }
+
+    long long cpu_used = clock_ns(CLOCK_THREAD_CPUTIME_ID) - cpu_start;
+    deflateEnd(&zs);
+    close(in_fd);
+
+    if (result == 0 && fsync(out_fd) != 0) {
+        saved_errno = errno;
+        result = -1;
+    }
+    if (close(out_fd) != 0 && result == 0) {
+        saved_errno = errno;
+        result = -1;
+    }
+    if (result == 0 && rename(tmp_path, gz_path) != 0) {
+        saved_errno = errno;
+        result = -1;
+    }
+
+    if (result != 0) {
+        printf("Erro ao compactar %s: %s\n", src_path,
+               zlib_error ? zlib_error : strerror(saved_errno));
+        unlink(tmp_path);
+        return -1;
+    }
+    sync_directory(archive_dir);
+
+    if (entry) {
+        memset(entry, 0, sizeof(*entry));
+        strncpy(entry->name, name, sizeof(entry->name) - 1);
+        entry->original_bytes = original_bytes;
+        entry->compressed_bytes = compressed_bytes;
+        entry->cpu_ms = (unsigned long)(cpu_used / 1000000LL);
+
+        size_t len = strlen(name);
+        if (len > 3 && strcmp(name + len - 3, ".db") == 0) {
+            get_db_time_range(src_path, &entry->start_time, &entry->end_time);
+        } else {
+            get_txt_time_range(src_path, &entry->start_time, &entry->end_time);
+        }
+    }
+
+    return 0;
+}
+
+int log_archive_decompress_to(const char* gz_path, log_archive_sink_t sink, void* user,
+                              unsigned long long* bytes_out) {
+    if (!gz_path || !sink) return -1;
+
+    int in_fd = open(gz_path, O_RDONLY);
+    if (in_fd < 0) {
+        printf("Erro ao abrir %s: %s\n", gz_path, strerror(errno));
+        return -1;
+    }
+
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    if (inflateInit2(&zs, 15 + 16) != Z_OK) {
+        close(in_fd);
+        return -1;
+    }
+
+    unsigned char in_buf[LOG_ARCHIVE_CHUNK_SIZE];
+    unsigned char out_buf[LOG_ARCHIVE_CHUNK_SIZE];
+    unsigned long long total = 0;
+    int ret = Z_OK;
+    int result = 0;
+
+    while (ret != Z_STREAM_END && result == 0) {
+        ssize_t n = read(in_fd, in_buf, sizeof(in_buf));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            result = -1;
+            break;
+        }
+        if (n == 0) {
+            // Arquivo terminou antes do fim do fluxo gzip
+            result = -1;
+            break;
+        }
+
+        zs.next_in = in_buf;
+        zs.avail_in = (uInt)n;
+
+        do {
+            zs.next_out = out_buf;
+            zs.avail_out = sizeof(out_buf);
+            ret = inflate(&zs, Z_NO_FLUSH);
+            if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) {
+                result = -1;
+                break;
+            }
+            size_t produced = sizeof(out_buf) - zs.avail_out;
+            if (produced > 0 && sink(out_buf, produced, user) != 0) {
+                result = -1;
+                break;
+            }
+            total += produced;
+        } while (zs.avail_out == 0 && ret != Z_STREAM_END);
+    }
+
+    inflateEnd(&zs);
+    close(in_fd);
+
+    if (result != 0) {
+        printf("Erro ao descompactar %s\n", gz_path);
+        return -1;
+    }
+
+    if (bytes_out) *bytes_out = total;
+    return 0;
+}
+
+/**
+ * @brief Destino de log_archive_decompress_fd: escrita direta no descritor
+ */
+static int write_fd_sink(const void* data, size_t len, void* user) {
+    return write_all(*(int*)user, data, len);
+}
+
+int log_archive_decompress_fd(const char* gz_path, int out_fd, unsigned long long* bytes_out) {
+    if (!gz_path || out_fd < 0) return -1;
+
+    return log_archive_decompress_to(gz_path, write_fd_sink, &out_fd, bytes_out);
+}
+
+int log_archive_decompress_file(const char* gz_path, const char* dest_path) {
+    if (!gz_path || !dest_path) return -1;
+
+    int out_fd = open(dest_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out_fd < 0) {
+        printf("Erro ao criar %s: %s\n", dest_path, strerror(errno));
+        return -1;
+    }
+
+    int result = log_archive_decompress_fd(gz_path, out_fd, NULL);
+    if (close(out_fd) != 0) result = -1;
+
+    if (result != 0) {
+        unlink(dest_path);
+    }
+    return result;
+}
+
+/**
+ * @brief Interpreta uma linha do índice (nome;inicio;fim;original;compactado;cpu_ms)
+ */
+static bool parse_index_line(const char* line, log_archive_entry_t* entry) {
+    if (line[0] == '#' || line[0] == '\n') return false;
+
+    memset(entry, 0, sizeof(*entry));
+    return sscanf(line, "%255[^;];%lld;%lld;%llu;%llu;%lu",
+                  entry->name, &entry->start_time, &entry->end_time,
+                  &entry->original_bytes, &entry->compressed_bytes, &entry->cpu_ms) == 6;
+}
+
+/**
+ * @brief Acrescenta uma entrada ao índice de forma durável
+ */
+static int append_index_entry(const char* archive_dir, const log_archive_entry_t* entry) {
+    char index_path[LOG_ARCHIVE_MAX_PATH + 32];
+    snprintf(index_path, sizeof(index_path), "%s/%s", archive_dir, LOG_ARCHIVE_INDEX_FILE);
+
+    int fd = open(index_path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd < 0) {
+        printf("Erro ao abrir índice %s: %s\n", index_path, strerror(errno));
+        return -1;
+    }
+
+    char line[512];
+    int len = 0;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size == 0) {
+        len = snprintf(line, sizeof(line), "# nome;inicio_ms;fim_ms;bytes_originais;bytes_compactados;cpu_ms\n");
+    }
+    len += snprintf(line + len, sizeof(line) - len, "%s;%lld;%lld;%llu;%llu;%lu\n",
+                    entry->name, entry->start_time, entry->end_time,
+                    entry->original_bytes, entry->compressed_bytes, entry->cpu_ms);
+
+    int result = write_all(fd, line, (size_t)len);
+    if (result == 0) fsync(fd);
+    close(fd);
+    return result;
+}
+
+int log_archive_find(const char* archive_dir, long long from_ms, long long to_ms,
+                     void (*callback)(const log_archive_entry_t* entry, void* user), void* user) {
+    if (!archive_dir) return -1;
+
+    char index_path[LOG_ARCHIVE_MAX_PATH + 32];
+    snprintf(index_path, sizeof(index_path), "%s/%s", archive_dir, LOG_ARCHIVE_INDEX_FILE);
+
+    FILE* fp = fopen(index_path, "r");
+    if (!fp) return errno == ENOENT ? 0 : -1;
+
+    int found = 0;
+    char line[512];
+    log_archive_entry_t entry;
+    while (fgets(line, sizeof(line), fp)) {
+        if (!parse_index_line(line, &entry)) continue;
+        if (entry.end_time < from_ms || entry.start_time > to_ms) continue;
+
+        found++;
+        if (callback) callback(&entry, user);
+    }
+
+    fclose(fp);
+    return found;
+}
+
+/**
+ * @brief Verifica se o nome está no índice carregado
+ */
+static bool index_contains(char (*names)[256], int count, const char* name) {
+    for (int i = 0; i < count; i++) {
+        if (strcmp(names[i], name) == 0) return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Verifica se um arquivo é um segmento selado do dispositivo
+ *
+ * Segmentos seguem o padrão NOME_AAAAMMDD_HHMMSS.txt/.db, não estão em uso,
+ * não possuem journal/WAL pendente e não são modificados há LOG_ARCHIVE_MIN_AGE_SECONDS.
+ * Com keep_db_segments, os .db são deixados para a consolidação nas partições.
+ */
+static bool is_sealed_segment(const log_archive_config_t* config, const char* name, const char* path) {
+    size_t prefix_len = strlen(config->device_name);
+    size_t len = strlen(name);
+
+    // Prefixo + "_" + AAAAMMDD_HHMMSS (15) + extensão
+    if (strncmp(name, config->device_name, prefix_len) != 0 || name[prefix_len] != '_') return false;
+    if (!((len == prefix_len + 16 + 4 && strcmp(name + len - 4, ".txt") == 0) ||
+          (len == prefix_len + 16 + 3 && strcmp(name + len - 3, ".db") == 0 && !config->keep_db_segments))) {
+        return false;
+    }
+
+    for (int i = 0; i < config->live_count; i++) {
+        if (strcmp(config->live_files[i], path) == 0) return false;
+    }
+
+    // Caminho truncado verificaria outro arquivo: segmento não é tocado
+    char side_path[LOG_ARCHIVE_SEGMENT_PATH + 16];
+    if (snprintf(side_path, sizeof(side_path), "%s-journal", path) >= (int)sizeof(side_path) ||
+        access(side_path, F_OK) == 0) {
+        return false;
+    }
+    if (snprintf(side_path, sizeof(side_path), "%s-wal", path) >= (int)sizeof(side_path) ||
+        access(side_path, F_OK) == 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) return false;
+
+    return time(NULL) - st.st_mtime >= LOG_ARCHIVE_MIN_AGE_SECONDS;
+}
+
+/**
+ * @brief Verifica se a parada da thread foi solicitada
+ */
+static bool stop_requested(void) {
+    pthread_mutex_lock(&archive_mutex);
+    bool stop = archive_stop_requested;
+    pthread_mutex_unlock(&archive_mutex);
+    return stop;
+}
+
+int log_archive_run_once(const log_archive_config_t* config) {
+    if (!config) return -1;
+
+    char archive_dir[LOG_ARCHIVE_MAX_PATH + 16];
+    snprintf(archive_dir, sizeof(archive_dir), "%s/%s", config->source_dir, LOG_ARCHIVE_DIR_NAME);
+
+    if (mkdir(archive_dir, 0755) != 0 && errno != EEXIST) {
+        printf("Erro ao criar diretório de arquivo %s: %s\n", archive_dir, strerror(errno));
+        return -1;
+    }
+
+    // Carregar nomes já indexados (segmentos cuja remoção foi interrompida)
+    char (*indexed)[256] = NULL;
+    int indexed_count = 0;
+    int indexed_capacity = 0;
+    char index_path[LOG_ARCHIVE_MAX_PATH + 32];
+    snprintf(index_path, sizeof(index_path), "%s/%s", archive_dir, LOG_ARCHIVE_INDEX_FILE);
+
+    FILE* fp = fopen(index_path, "r");
+    if (fp) {
+        char line[512];
+        log_archive_entry_t entry;
+        while (fgets(line, sizeof(line), fp)) {
+            if (!parse_index_line(line, &entry)) continue;
+            if (indexed_count == indexed_capacity) {
+                int new_capacity = indexed_capacity ? indexed_capacity * 2 : 64;
+                char (*grown)[256] = realloc(indexed, (size_t)new_capacity * sizeof(*indexed));
+                if (!grown) break;
+                indexed = grown;
+                indexed_capacity = new_capacity;
+            }
+            memcpy(indexed[indexed_count++], entry.name, sizeof(entry.name));
+        }
+        fclose(fp);
+    }
+
+    DIR* dir = opendir(config->source_dir);
+    if (!dir) {
+        printf("Erro ao abrir diretório %s: %s\n", config->source_dir, strerror(errno));
+        free(indexed);
+        return -1;
+    }
+
+    int archived = 0;
+    struct dirent* de;
+    while ((de = readdir(dir)) != NULL && !stop_requested()) {
+        char path[LOG_ARCHIVE_SEGMENT_PATH];
+        if (snprintf(path, sizeof(path), "%s/%s", config->source_dir, de->d_name) >= (int)sizeof(path) ||
+            !is_sealed_segment(config, de->d_name, path)) {
+            continue;
+        }
+
+        if (index_contains(indexed, indexed_count, de->d_name)) {
+            // Já arquivado anteriormente; apenas remover o original
+            unlink(path);
+            continue;
+        }
+
+        log_archive_entry_t entry;
+        if (log_archive_compress_file(path, archive_dir, &entry) != 0) continue;
+        if (append_index_entry(archive_dir, &entry) != 0) continue;
+
+        unlink(path);
+        sync_directory(config->source_dir);
+        archived++;
+
+        double ratio = entry.compressed_bytes > 0 ?
+                       (double)entry.original_bytes / (double)entry.compressed_bytes : 0.0;
+        printf("🗜️  Arquivado: %s (%llu → %llu bytes, %.1fx, %lu ms de CPU)\n",
+               entry.name, entry.original_bytes, entry.compressed_bytes, ratio, entry.cpu_ms);
+    }
+
+    closedir(dir);
+    free(indexed);
+    return archived;
+}
+
+/**
+ * @brief Thread de arquivamento periódico
+ */
+static void* archive_thread_main(void* arg) {
+    (void)arg;
+
+    thread_priority_lower("Arquivador");
+
+    pthread_mutex_lock(&archive_mutex);
+    while (!archive_stop_requested) {
+        pthread_mutex_unlock(&archive_mutex);
+        log_archive_run_once(&archive_config);
+        pthread_mutex_lock(&archive_mutex);
+
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += LOG_ARCHIVE_SCAN_INTERVAL_SECONDS;
+        while (!archive_stop_requested &&
+               pthread_cond_timedwait(&archive_cond, &archive_mutex, &deadline) != ETIMEDOUT) {
+        }
+    }
+    pthread_mutex_unlock(&archive_mutex);
+
+    return NULL;
+}
+
+int log_archive_start(const log_archive_config_t* config) {
+    if (!config) return -1;
+
+    pthread_mutex_lock(&archive_mutex);
+    if (archive_running) {
+        pthread_mutex_unlock(&archive_mutex);
+        printf("Arquivador já inicializado\n");
+        return 0;
+    }
+
+    archive_config = *config;
+    archive_stop_requested = false;
+
+    if (pthread_create(&archive_thread, NULL, archive_thread_main, NULL) != 0) {
+        pthread_mutex_unlock(&archive_mutex);
+        printf("Erro ao criar thread de arquivamento\n");
+        return -1;
+    }
+
+    archive_running = true;
+    pthread_mutex_unlock(&archive_mutex);
+
+    printf("🗜️  Arquivador iniciado (nível %d, varredura a cada %d s)\n",
+           LOG_ARCHIVE_LEVEL, LOG_ARCHIVE_SCAN_INTERVAL_SECONDS);
+    return 0;
+}
+
+void log_archive_stop(void) {
+    pthread_mutex_lock(&archive_mutex);
+    if (!archive_running) {
+        pthread_mutex_unlock(&archive_mutex);
+        return;
+    }
+    archive_stop_requested = true;
+    pthread_cond_signal(&archive_cond);
+    pthread_mutex_unlock(&archive_mutex);
+
+    pthread_join(archive_thread, NULL);
+
+    pthread_mutex_lock(&archive_mutex);
+    archive_running = false;
+    pthread_mutex_unlock(&archive_mutex);
+
+    printf("🗜️  Arquivador finalizado\n");
+}
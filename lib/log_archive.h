@@ -0,0 +1,127 @@
+/**
+ * @file log_archive.h
+ * @brief COEL E33 DataLogger - Arquivamento compactado de segmentos de log
+ * @author Nova Instruments
+ */
+
+#ifndef LOG_ARCHIVE_H
+#define LOG_ARCHIVE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Configurações do arquivador
+#define LOG_ARCHIVE_DIR_NAME "archive"            // Subdiretório (dentro do diretório de logs) com os .gz
+#define LOG_ARCHIVE_INDEX_FILE "index.txt"        // Índice de intervalos de tempo dos arquivos
+#define LOG_ARCHIVE_MIN_AGE_SECONDS (24 * 3600)   // Segmentos modificados há menos tempo não são arquivados
+#define LOG_ARCHIVE_SCAN_INTERVAL_SECONDS 3600    // Intervalo entre varreduras do diretório de logs
+#define LOG_ARCHIVE_LEVEL 6                       // Nível de compressão zlib (1=rápido, 9=máximo)
+#define LOG_ARCHIVE_CHUNK_SIZE 16384              // Tamanho do bloco de leitura/compressão
+#define LOG_ARCHIVE_CPU_BUDGET_PERCENT 25         // Uso máximo de um núcleo pela thread de compressão
+#define LOG_ARCHIVE_MAX_LIVE_FILES 4
+#define LOG_ARCHIVE_MAX_PATH 512
+
+// Entrada do índice de arquivos compactados
+typedef struct {
+    char name[256];                 // Nome do segmento original (ex: NI00002_20240915_160000.db)
+    long long start_time;           // Primeiro registro do segmento (ms desde epoch, 0 se desconhecido)
+    long long end_time;             // Último registro do segmento (ms desde epoch, 0 se desconhecido)
+    unsigned long long original_bytes;    // Tamanho original
+    unsigned long long compressed_bytes;  // Tamanho do .gz
+    unsigned long cpu_ms;           // Tempo de CPU gasto na compressão
+} log_archive_entry_t;
+
+// Configuração do arquivador
+typedef struct {
+    char source_dir[LOG_ARCHIVE_MAX_PATH];   // Diretório de logs (ex: "/home/nova")
+    char device_name[32];                    // Prefixo dos segmentos (ex: "NI00002")
+    char live_files[LOG_ARCHIVE_MAX_LIVE_FILES][LOG_ARCHIVE_MAX_PATH];  // Arquivos em uso (nunca arquivados)
+    int live_count;
+    bool keep_db_segments;                   // Bancos .db ficam para a consolidação nas partições (apenas TXT)
+} log_archive_config_t;
+
+/**
+ * @brief Inicia a thread de arquivamento em segundo plano
+ *
+ * A thread roda com prioridade de CPU mínima (nice 19) e classe de I/O idle,
+ * compactando periodicamente os segmentos TXT/DB selados do dispositivo.
+ * @param config Configuração do arquivador (copiada internamente)
+ * @return 0 em caso de sucesso, -1 em caso de erro
+ */
+int log_archive_start(const log_archive_config_t* config);
+
+/**
+ * @brief Sinaliza a thread de arquivamento para terminar e aguarda sua finalização
+ */
+void log_archive_stop(void);
+
+/**
+ * @brief Executa uma varredura de arquivamento na thread atual
+ * @param config Configuração do arquivador
+ * @return Número de segmentos arquivados, ou -1 em caso de erro
+ */
+int log_archive_run_once(const log_archive_config_t* config);
+
+/**
+ * @brief Compacta um arquivo em formato gzip dentro do diretório de arquivo
+ *
+ * O arquivo compactado é escrito com nome temporário e renomeado ao final.
+ * O original não é removido.
+ * @param src_path Caminho do segmento original
+ * @param archive_dir Diretório de destino
+ * @param entry Estrutura preenchida com tamanhos, tempo de CPU e intervalo de tempo (pode ser NULL)
+ * @return 0 em caso de sucesso, -1 em caso de erro
+ */
+int log_archive_compress_file(const char* src_path, const char* archive_dir, log_archive_entry_t* entry);
+
+/**
+ * @brief Destino dos blocos descompactados por log_archive_decompress_to()
+ * @return 0 para continuar, -1 para abortar a descompactação
+ */
+typedef int (*log_archive_sink_t)(const void* data, size_t len, void* user);
+
+/**
+ * @brief Descompacta um arquivo .gz em fluxo, entregando cada bloco ao destino
+ *
+ * Permite processar os dados durante a descompactação (ex: calcular um CRC
+ * enquanto grava), sem uma segunda leitura.
+ * @param gz_path Caminho do arquivo compactado
+ * @param sink Função chamada para cada bloco descompactado
+ * @param user Ponteiro repassado ao destino
+ * @param bytes_out Total de bytes descompactados (pode ser NULL)
+ * @return 0 em caso de sucesso, -1 em caso de erro
+ */
+int log_archive_decompress_to(const char* gz_path, log_archive_sink_t sink, void* user,
+                              unsigned long long* bytes_out);
+
+/**
+ * @brief Descompacta um arquivo .gz em fluxo para um descritor de arquivo
+ * @param gz_path Caminho do arquivo compactado
+ * @param out_fd Descritor de destino (aberto para escrita)
+ * @param bytes_out Total de bytes descompactados (pode ser NULL)
+ * @return 0 em caso de sucesso, -1 em caso de erro
+ */
+int log_archive_decompress_fd(const char* gz_path, int out_fd, unsigned long long* bytes_out);
+
+/**
+ * @brief Descompacta um arquivo .gz em fluxo para um caminho de destino
+ * @param gz_path Caminho do arquivo compactado
+ * @param dest_path Caminho do arquivo a ser criado
+ * @return 0 em caso de sucesso, -1 em caso de erro
+ */
+int log_archive_decompress_file(const char* gz_path, const char* dest_path);
+
+/**
+ * @brief Percorre o índice e reporta os arquivos que cobrem um intervalo de tempo
+ * @param archive_dir Diretório de arquivo
+ * @param from_ms Início do intervalo (ms desde epoch)
+ * @param to_ms Fim do intervalo (ms desde epoch)
+ * @param callback Função chamada para cada entrada que intersecta o intervalo
+ * @param user Ponteiro repassado ao callback
+ * @return Número de entradas reportadas, ou -1 em caso de erro
+ */
+int log_archive_find(const char* archive_dir, long long from_ms, long long to_ms,
+                     void (*callback)(const log_archive_entry_t* entry, void* user), void* user);
+
+#endif // LOG_ARCHIVE_H
@@ -0,0 +1,390 @@
+/**
+ * @file ring_store.c
+ * @brief COEL E33 DataLogger - Armazenamento circular binário mapeado em memória
+ * @author Nova Instruments
+ */
+
+#include "ring_store.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Tentativas de leitura consistente antes de desistir do seqlock
+#define RING_STORE_READ_RETRIES 1000
+
+// Bytes do registro cobertos pelo CRC (todos antes do campo crc)
+#define RING_STORE_CRC_BYTES offsetof(ring_store_record_t, crc)
+
+// Contexto do anel
+struct ring_store_s {
+    int fd;
+    bool read_only;
+    bool check_crc;                 // false ao ler um anel v1 sem conversão
+    size_t map_size;
+    ring_store_header_t* header;    // Início do mapeamento
+    ring_store_record_t* records;   // Slots (após o cabeçalho)
+};
+
+/**
+ * @brief CRC-16/CCITT (polinômio 0x1021, início 0xFFFF) do registro, por nibble
+ *
+ * Um registro zerado (página não gravada) nunca tem CRC válido.
+ */
+static uint16_t record_crc(const ring_store_record_t* record) {
+    static const uint16_t nibble[16] = {
+        0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+        0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+    };
+    const uint8_t* p = (const uint8_t*)record;
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < RING_STORE_CRC_BYTES; i++) {
+        crc = (uint16_t)((crc << 4) ^ nibble[(crc >> 12) ^ (p[i] >> 4)]);
+        crc = (uint16_t)((crc << 4) ^ nibble[(crc >> 12) ^ (p[i] & 0x0F)]);
+    }
+    return crc;
+}
+
+static bool record_valid(const ring_store_t* rs, const ring_store_record_t* record) {
+    return !rs->check_crc || record->crc == record_crc(record);
+}
+
+static ring_store_record_t* slot(const ring_store_t* rs, uint64_t index) {
+    return &rs->records[index % rs->header->capacity];
+}
+
+/**
+ * @brief Converte um anel v1: CRC de cada registro e índice do último ajuste de relógio
+ */
+static void upgrade_v1(ring_store_t* rs) {
+    ring_store_header_t* h = rs->header;
+    h->time_step = 0;
+    for (uint64_t i = h->tail; i < h->head; i++) {
+        ring_store_record_t* r = slot(rs, i);
+        r->crc = record_crc(r);
+        if (i > h->tail && r->timestamp_ms < slot(rs, i - 1)->timestamp_ms) h->time_step = i;
+    }
+    h->version = RING_STORE_VERSION;
+    msync(h, rs->map_size, MS_SYNC);
+    printf("💽 Anel convertido para a versão %d (%llu registros)\n", RING_STORE_VERSION,
+           (unsigned long long)(h->head - h->tail));
+}
+
+/**
+ * @brief Alinha head aos registros realmente gravados após uma queda de energia
+ *
+ * Registros finais com CRC incorreto saem do anel; registros válidos além
+ * de head, em ordem de tempo, voltam a ele (cabeçalho gravado antes das
+ * páginas de registros ou depois). Inválidos no meio são apenas contados.
+ */
+static void recover_records(ring_store_t* rs) {
+    ring_store_header_t* h = rs->header;
+    uint64_t head = h->head;
+
+    while (head > h->tail && !record_valid(rs, slot(rs, head - 1))) head--;
+    uint64_t dropped = h->head - head;
+
+    // Slots além de head só continuam a sequência se forem válidos e não
+    // mais antigos que o anterior (restos da volta anterior são mais antigos)
+    uint64_t tail = h->tail;
+    uint64_t restored = 0;
+    if (dropped == 0 && head > tail) {
+        while (restored < h->capacity && record_valid(rs, slot(rs, head)) &&
+               slot(rs, head)->timestamp_ms >= slot(rs, head - 1)->timestamp_ms) {
+            head++;
+            restored++;
+            if (head - tail > h->capacity) tail = head - h->capacity;
+        }
+    }
+
+    uint64_t invalid = 0;
+    for (uint64_t i = tail; i < head; i++) {
+        if (!record_valid(rs, slot(rs, i))) invalid++;
+    }
+
+    if (head != h->head) {
+        h->head = head;
+        h->tail = tail;
+        h->generation = head / h->capacity;
+        if (h->time_step >= head) h->time_step = 0;
+        msync(h, RING_STORE_HEADER_SIZE, MS_SYNC);
+    }
+    if (dropped > 0 || restored > 0 || invalid > 0) {
+        printf("⚠️  Anel: %llu registros finais incompletos descartados, %llu recuperados, "
+               "%llu inválidos serão ignorados\n", (unsigned long long)dropped,
+               (unsigned long long)restored, (unsigned long long)invalid);
+    }
+}
+
+ring_store_t* ring_store_open(const char* path, uint32_t capacity, bool read_only) {
+    if (!path || (!read_only && capacity == 0)) return NULL;
+
+    int fd = open(path, read_only ? O_RDONLY : (O_RDWR | O_CREAT), 0644);
+    if (fd < 0) {
+        fprintf(stderr, "Erro ao abrir anel %s: %s\n", path, strerror(errno));
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        fprintf(stderr, "Erro ao obter tamanho do anel %s: %s\n", path, strerror(errno));
+        close(fd);
+        return NULL;
+    }
+
+    // Reaproveitar capacidade de um anel existente
+    bool create = true;
+    if (st.st_size >= RING_STORE_HEADER_SIZE) {
+        ring_store_header_t existing;
+        if (pread(fd, &existing, sizeof(existing), 0) == (ssize_t)sizeof(existing) &&
+            existing.magic == RING_STORE_MAGIC &&
+            (existing.version == RING_STORE_VERSION || existing.version == 1) &&
+            existing.record_size == sizeof(ring_store_record_t) &&
+            st.st_size >= (off_t)(RING_STORE_HEADER_SIZE + (off_t)existing.capacity * sizeof(ring_store_record_t))) {
+            capacity = existing.capacity;
+            create = false;
+        }
+    }
+
+    if (create && read_only) {
+        fprintf(stderr, "Erro: %s não é um arquivo de anel válido\n", path);
+        close(fd);
+        return NULL;
+    }
+
+    size_t map_size = RING_STORE_HEADER_SIZE + (size_t)capacity * sizeof(ring_store_record_t);
+
+    if (create) {
+        // Reservar blocos agora para evitar SIGBUS com o cartão cheio
+        int err = posix_fallocate(fd, 0, (off_t)map_size);
+        if (err != 0) {
+            fprintf(stderr, "Erro ao alocar anel %s: %s\n", path, strerror(err));
+            close(fd);
+            return NULL;
+        }
+    }
+
+    void* map = mmap(NULL, map_size, read_only ? PROT_READ : (PROT_READ | PROT_WRITE),
+                     MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "Erro ao mapear anel %s: %s\n", path, strerror(errno));
+        close(fd);
+        return NULL;
+    }
+
+    ring_store_t* rs = calloc(1, sizeof(ring_store_t));
+    if (!rs) {
+        munmap(map, map_size);
+        close(fd);
+        return NULL;
+    }
+
+    rs->fd = fd;
+    rs->read_only = read_only;
+    rs->map_size = map_size;
+    rs->header = (ring_store_header_t*)map;
+    rs->records = (ring_store_record_t*)((char*)map + RING_STORE_HEADER_SIZE);
+    rs->check_crc = create || rs->header->version >= 2;
+
+    if (create) {
+        memset(rs->header, 0, RING_STORE_HEADER_SIZE);
+        rs->header->magic = RING_STORE_MAGIC;
+        rs->header->version = RING_STORE_VERSION;
+        rs->header->record_size = sizeof(ring_store_record_t);
+        rs->header->capacity = capacity;
+        msync(map, RING_STORE_HEADER_SIZE, MS_SYNC);
+    } else if (!read_only) {
+        // Escrita interrompida (queda de energia): liberar o seqlock
+        if (rs->header->seq & 1) rs->header->seq++;
+        if (rs->header->version == 1) {
+            upgrade_v1(rs);
+            rs->check_crc = true;
+        } else {
+            recover_records(rs);
+        }
+    }
+
+    return rs;
+}
+
+void ring_store_close(ring_store_t* rs) {
+    if (!rs) return;
+
+    if (!rs->read_only) {
+        msync(rs->header, rs->map_size, MS_SYNC);
+    }
+    munmap(rs->header, rs->map_size);
+    close(rs->fd);
+    free(rs);
+}
+
+bool ring_store_append(ring_store_t* rs, const ring_store_record_t* record) {
+    if (!rs || rs->read_only || !record) return false;
+
+    ring_store_header_t* h = rs->header;
+    uint64_t head = h->head;
+    ring_store_record_t rec = *record;
+    rec.crc = record_crc(&rec);
+
+    __atomic_store_n(&h->seq, h->seq + 1, __ATOMIC_RELEASE);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    // Relógio ajustado para trás: começa uma nova sequência crescente
+    if (head > h->tail && rec.timestamp_ms < slot(rs, head - 1)->timestamp_ms) {
+        h->time_step = head;
+    }
+    memcpy(slot(rs, head), &rec, sizeof(rec));
+
+    head++;
+    if (head - h->tail > h->capacity) {
+        h->tail = head - h->capacity;
+    }
+    if (head % h->capacity == 0) {
+        h->generation++;
+    }
+    h->head = head;
+
+    __atomic_store_n(&h->seq, h->seq + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+void ring_store_sync(ring_store_t* rs) {
+    if (rs && !rs->read_only) {
+        msync(rs->header, rs->map_size, MS_ASYNC);
+    }
+}
+
+/**
+ * @brief Lê o contador do seqlock aguardando o fim de uma escrita em andamento
+ */
+static uint32_t read_begin(const ring_store_header_t* h) {
+    uint32_t seq;
+    int retries = 0;
+    while (((seq = __atomic_load_n(&h->seq, __ATOMIC_ACQUIRE)) & 1) && retries++ < RING_STORE_READ_RETRIES) {
+    }
+    return seq;
+}
+
+/**
+ * @brief Verifica se nenhuma escrita ocorreu desde read_begin
+ */
+static bool read_retry(const ring_store_header_t* h, uint32_t seq) {
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&h->seq, __ATOMIC_RELAXED) != seq;
+}
+
+void ring_store_get_header(ring_store_t* rs, ring_store_header_t* header) {
+    if (!rs || !header) return;
+
+    int retries = 0;
+    uint32_t seq;
+    do {
+        seq = read_begin(rs->header);
+        memcpy(header, rs->header, sizeof(ring_store_header_t));
+    } while (read_retry(rs->header, seq) && retries++ < RING_STORE_READ_RETRIES);
+}
+
+/**
+ * @brief Primeiro índice em [from, to) com registro válido (to se nenhum); copia o registro
+ */
+static uint64_t next_valid(const ring_store_t* rs, uint64_t from, uint64_t to, ring_store_record_t* out) {
+    for (; from < to; from++) {
+        *out = *slot(rs, from);
+        if (record_valid(rs, out)) break;
+    }
+    return from;
+}
+
+/**
+ * @brief Último índice em [from, to) com registro válido (to se nenhum); copia o registro
+ */
+static uint64_t prev_valid(const ring_store_t* rs, uint64_t from, uint64_t to, ring_store_record_t* out) {
+    for (uint64_t i = to; i > from; i--) {
+        *out = *slot(rs, i - 1);
+        if (record_valid(rs, out)) return i - 1;
+    }
+    return to;
+}
+
+/**
+ * @brief Busca binária em [lo, hi), pulando registros inválidos
+ */
+static uint64_t search_time(const ring_store_t* rs, uint64_t lo, uint64_t hi, int64_t timestamp_ms) {
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        ring_store_record_t r;
+        uint64_t j = next_valid(rs, mid, hi, &r);
+        if (j < hi && r.timestamp_ms < timestamp_ms) {
+            lo = j + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+uint64_t ring_store_find_time(ring_store_t* rs, int64_t timestamp_ms) {
+    if (!rs) return 0;
+
+    uint64_t found;
+    int retries = 0;
+    uint32_t seq;
+    do {
+        seq = read_begin(rs->header);
+        ring_store_header_t h;
+        memcpy(&h, rs->header, sizeof(h));
+
+        // Com ajuste do relógio no anel: sequência atual se timestamp_ms cai
+        // dentro dela; senão a anterior, e a atual se passar do fim da anterior
+        if (h.time_step > h.tail && h.time_step < h.head) {
+            ring_store_record_t first;
+            ring_store_record_t last;
+            uint64_t j = next_valid(rs, h.time_step, h.head, &first);
+            uint64_t k = prev_valid(rs, h.time_step, h.head, &last);
+            if (j < h.head && first.timestamp_ms <= timestamp_ms && timestamp_ms <= last.timestamp_ms) {
+                found = search_time(rs, h.time_step, h.head, timestamp_ms);
+            } else {
+                found = search_time(rs, h.tail, h.time_step, timestamp_ms);
+                if (found == h.time_step && k < h.head) {
+                    found = search_time(rs, h.time_step, h.head, timestamp_ms);
+                }
+            }
+        } else {
+            found = search_time(rs, h.tail, h.head, timestamp_ms);
+        }
+    } while (read_retry(rs->header, seq) && retries++ < RING_STORE_READ_RETRIES);
+
+    return found;
+}
+
+size_t ring_store_read(ring_store_t* rs, uint64_t* index, ring_store_record_t* out, size_t max_records) {
+    if (!rs || !index || !out || max_records == 0) return 0;
+
+    size_t count = 0;
+    int retries = 0;
+    uint64_t start;
+    uint32_t seq;
+
+    do {
+        seq = read_begin(rs->header);
+        uint64_t head = rs->header->head;
+        uint64_t tail = rs->header->tail;
+
+        // Registros inválidos no início são pulados; a leitura para no próximo
+        start = next_valid(rs, *index < tail ? tail : *index, head, &out[0]);
+        count = 0;
+        while (start + count < head && count < max_records) {
+            out[count] = *slot(rs, start + count);
+            if (!record_valid(rs, &out[count])) break;
+            count++;
+        }
+    } while (read_retry(rs->header, seq) && retries++ < RING_STORE_READ_RETRIES);
+
+    *index = start + count;
+    return count;
+}
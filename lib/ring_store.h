@@ -0,0 +1,125 @@
+/**
+ * @file ring_store.h
+ * @brief COEL E33 DataLogger - Armazenamento circular binário mapeado em memória
+ * @author Nova Instruments
+ */
+
+#ifndef RING_STORE_H
+#define RING_STORE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Configurações do anel
+#define RING_STORE_MAGIC 0x5352494Eu      // "NIRS"
+#define RING_STORE_VERSION 2               // v2: CRC por registro e índice do último ajuste de relógio
+#define RING_STORE_HEADER_SIZE 4096       // Cabeçalho ocupa uma página inteira
+
+// Flags de registro
+#define RING_FLAG_VALID 0x01              // Leitura Modbus bem-sucedida
+
+// Registro bruto de amostra (16 bytes, formato em disco)
+typedef struct __attribute__((packed)) {
+    int64_t timestamp_ms;       // Timestamp em ms desde epoch
+    uint16_t register_id;       // Endereço Modbus (ex: 0x200)
+    uint16_t value;             // Valor bruto do registrador
+    uint8_t slave_id;           // Endereço do escravo Modbus
+    uint8_t flags;              // RING_FLAG_*
+    uint16_t crc;               // CRC-16/CCITT dos 14 bytes anteriores (preenchido pelo anel)
+} ring_store_record_t;
+
+// Cabeçalho em disco (início do arquivo)
+typedef struct {
+    uint32_t magic;             // RING_STORE_MAGIC
+    uint16_t version;           // RING_STORE_VERSION
+    uint16_t record_size;       // sizeof(ring_store_record_t)
+    uint32_t capacity;          // Número de slots do anel
+    uint32_t seq;               // Seqlock: ímpar durante escrita
+    uint64_t head;              // Índice (monotônico) do próximo registro a escrever
+    uint64_t tail;              // Índice (monotônico) do registro mais antigo disponível
+    uint64_t generation;        // Número de voltas completas do anel
+    uint64_t time_step;         // Primeiro índice após o último ajuste do relógio para trás (0 = nenhum)
+} ring_store_header_t;
+
+// Handle opaco do anel
+typedef struct ring_store_s ring_store_t;
+
+/**
+ * @brief Abre (ou cria) um arquivo de anel de tamanho fixo
+ *
+ * Se o arquivo já existir com cabeçalho válido, a capacidade existente é mantida.
+ * Na abertura para escrita, os registros são conferidos pelo CRC: o anel é
+ * gravado com msync assíncrono, então uma queda de energia pode deixar o
+ * cabeçalho e as páginas de registros de momentos diferentes. Registros
+ * finais inválidos saem do anel (head recua), registros válidos gravados
+ * além de head voltam a ele, e inválidos no meio são pulados na leitura.
+ * Um anel v1 (sem CRC) é convertido na abertura para escrita.
+ * @param path Caminho do arquivo
+ * @param capacity Número de registros do anel (usado apenas na criação)
+ * @param read_only true para abrir apenas para leitura (ferramentas de dump)
+ * @return Ponteiro para o anel ou NULL em caso de erro
+ */
+ring_store_t* ring_store_open(const char* path, uint32_t capacity, bool read_only);
+
+/**
+ * @brief Sincroniza e fecha o anel
+ * @param rs Anel
+ */
+void ring_store_close(ring_store_t* rs);
+
+/**
+ * @brief Acrescenta um registro, sobrescrevendo o mais antigo quando cheio
+ *
+ * O campo crc é calculado pelo anel (o valor em record é ignorado).
+ * @param rs Anel
+ * @param record Registro a ser escrito
+ * @return true se escrita foi bem-sucedida, false caso contrário
+ */
+bool ring_store_append(ring_store_t* rs, const ring_store_record_t* record);
+
+/**
+ * @brief Agenda a escrita das páginas alteradas no disco (msync assíncrono)
+ * @param rs Anel
+ */
+void ring_store_sync(ring_store_t* rs);
+
+/**
+ * @brief Obtém cópia consistente do cabeçalho
+ * @param rs Anel
+ * @param header Estrutura a ser preenchida
+ */
+void ring_store_get_header(ring_store_t* rs, ring_store_header_t* header);
+
+/**
+ * @brief Localiza o primeiro índice com timestamp >= timestamp_ms (busca binária)
+ *
+ * Os timestamps vêm do relógio de parede e deixam de ser crescentes quando
+ * ele é ajustado para trás (NTP, RTC). O anel guarda o índice do último
+ * ajuste: se timestamp_ms cai dentro da sequência atual, a busca é feita
+ * nela; senão, nos registros anteriores ao ajuste (e na sequência atual se
+ * timestamp_ms passar do último deles). Com mais de um ajuste dentro do anel, os anteriores ao último não
+ * são conhecidos e o índice retornado pode não ser o primeiro; para um
+ * intervalo completo nesse caso, leia a partir de tail e filtre.
+ * @param rs Anel
+ * @param timestamp_ms Timestamp procurado
+ * @return Índice monotônico (entre tail e head)
+ */
+uint64_t ring_store_find_time(ring_store_t* rs, int64_t timestamp_ms);
+
+/**
+ * @brief Lê registros a partir de um índice monotônico
+ *
+ * Índices já sobrescritos são ajustados para o registro mais antigo disponível.
+ * Registros com CRC incorreto são pulados; os registros devolvidos em uma
+ * chamada são sempre consecutivos (índices *index - n a *index - 1 após a
+ * chamada), e a leitura para antes de um registro inválido.
+ * @param rs Anel
+ * @param index Índice inicial (atualizado para o próximo índice a ler)
+ * @param out Buffer de saída
+ * @param max_records Capacidade do buffer
+ * @return Número de registros copiados
+ */
+size_t ring_store_read(ring_store_t* rs, uint64_t* index, ring_store_record_t* out, size_t max_records);
+
+#endif // RING_STORE_H
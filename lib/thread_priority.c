@@ -0,0 +1,41 @@
+/**
+ * @file thread_priority.c
+ * @brief COEL E33 DataLogger - Prioridade das threads de manutenção em segundo plano
+ * @author Nova Instruments
+ */
+
+#define _GNU_SOURCE  // Para syscall
+#include "thread_priority.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/syscall.h>
+#include <sys/resource.h>
+
+// Definições de ioprio_set (não expostas pela glibc)
+#define IOPRIO_CLASS_SHIFT 13
+#define IOPRIO_CLASS_IDLE 3
+#define IOPRIO_WHO_PROCESS 1
+
+bool thread_priority_lower(const char* who) {
+    pid_t tid = (pid_t)syscall(SYS_gettid);
+    bool ok = true;
+
+    if (setpriority(PRIO_PROCESS, tid, THREAD_PRIORITY_BACKGROUND_NICE) != 0) {
+        printf("⚠️  %s: não foi possível reduzir prioridade de CPU: %s\n", who, strerror(errno));
+        ok = false;
+    }
+
+#ifdef SYS_ioprio_set
+    int ioprio = IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT;
+    if (syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, tid, ioprio) != 0) {
+        printf("⚠️  %s: não foi possível definir I/O idle: %s\n", who, strerror(errno));
+        ok = false;
+    }
+#else
+    ok = false;
+#endif
+    return ok;
+}
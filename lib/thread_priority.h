@@ -0,0 +1,25 @@
+/**
+ * @file thread_priority.h
+ * @brief COEL E33 DataLogger - Prioridade das threads de manutenção em segundo plano
+ * @author Nova Instruments
+ */
+
+#ifndef THREAD_PRIORITY_H
+#define THREAD_PRIORITY_H
+
+#include <stdbool.h>
+
+#define THREAD_PRIORITY_BACKGROUND_NICE 19   // nice das threads de manutenção (arquivador, consolidação)
+
+/**
+ * @brief Reduz a prioridade de CPU (nice) e de I/O (classe idle) da thread atual
+ *
+ * Threads com I/O idle só são atendidas pelo disco quando não há outro
+ * I/O pendente: não devem manter locks compartilhados com o loop de
+ * aquisição durante operações longas.
+ * @param who Prefixo das mensagens de aviso (ex: "Arquivador")
+ * @return true se as duas prioridades foram reduzidas
+ */
+bool thread_priority_lower(const char* who);
+
+#endif // THREAD_PRIORITY_H
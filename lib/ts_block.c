@@ -0,0 +1,191 @@
+/**
+ * @file ts_block.c
+ * @brief COEL E33 DataLogger - Blocos compactados de séries temporais
+ * @author Nova Instruments
+ */
+
+#include "ts_block.h"
+#include <string.h>
+
+/**
+ * @brief Mapeia inteiro com sinal para sem sinal (0, -1, 1, -2, ... → 0, 1, 2, 3, ...)
+ */
+static uint64_t zigzag_encode(int64_t v) {
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static int64_t zigzag_decode(uint64_t v) {
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+/**
+ * @brief Escreve varint (7 bits por byte, bit alto indica continuação)
+ */
+static size_t varint_put(uint8_t* out, uint64_t v) {
+    size_t n = 0;
+    while (v >= 0x80) {
+        out[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    out[n++] = (uint8_t)v;
+    return n;
+}
+
+/**
+ * @brief Lê varint; retorna bytes consumidos ou 0 se truncado
+ */
+static size_t varint_get(const uint8_t* in, size_t avail, uint64_t* v) {
+    uint64_t result = 0;
+    for (size_t n = 0; n < avail && n < 10; n++) {
+        result |= (uint64_t)(in[n] & 0x7F) << (7 * n);
+        if (!(in[n] & 0x80)) {
+            *v = result;
+            return n + 1;
+        }
+    }
+    return 0;
+}
+
+static ts_block_header_t* header_of(ts_block_encoder_t* enc) {
+    return (ts_block_header_t*)enc->block;
+}
+
+void ts_block_encoder_init(ts_block_encoder_t* enc) {
+    if (!enc) return;
+
+    memset(enc, 0, sizeof(*enc));
+    enc->pos = sizeof(ts_block_header_t);
+    enc->prev_flags = 0xFF;   // Força a gravação das flags da primeira amostra
+
+    ts_block_header_t* h = header_of(enc);
+    h->magic = TS_BLOCK_MAGIC;
+    h->temp_min = TS_BLOCK_NO_TEMP_MIN;   // Intervalo vazio até a primeira temperatura válida
+    h->temp_max = TS_BLOCK_NO_TEMP_MAX;
+}
+
+bool ts_block_append(ts_block_encoder_t* enc, const ts_sample_t* sample) {
+    if (!enc || !sample) return false;
+
+    ts_block_header_t* h = header_of(enc);
+    if (h->count == UINT16_MAX) return false;
+
+    if (h->count == 0) {
+        h->start_time = sample->collect_time;
+        enc->prev_time = sample->collect_time;
+        enc->prev_delta = 0;
+    }
+
+    // Amostras com temperatura inválida repetem o valor anterior (delta zero)
+    bool temp_valid = (sample->flags & TS_FLAG_TEMP_VALID) != 0;
+    int16_t temp = temp_valid ? sample->temperature : enc->prev_temp;
+
+    uint8_t tmp[TS_BLOCK_MAX_SAMPLE_BYTES];
+    size_t n = 0;
+
+    int64_t delta = sample->collect_time - enc->prev_time;
+    n += varint_put(tmp + n, zigzag_encode(delta - enc->prev_delta));
+
+    // Bit menos significativo do delta de temperatura indica mudança de flags
+    bool flags_changed = sample->flags != enc->prev_flags;
+    uint64_t temp_word = (zigzag_encode((int64_t)temp - enc->prev_temp) << 1) | (flags_changed ? 1 : 0);
+    n += varint_put(tmp + n, temp_word);
+    if (flags_changed) {
+        tmp[n++] = sample->flags;
+    }
+
+    if (enc->pos + n > TS_BLOCK_SIZE) return false;
+
+    memcpy(enc->block + enc->pos, tmp, n);
+    enc->pos += n;
+
+    enc->prev_delta = delta;
+    enc->prev_time = sample->collect_time;
+    enc->prev_temp = temp;
+    enc->prev_flags = sample->flags;
+
+    h->count++;
+    h->end_time = sample->collect_time;
+    if (temp_valid) {
+        if (temp < h->temp_min) h->temp_min = temp;
+        if (temp > h->temp_max) h->temp_max = temp;
+        enc->has_valid_temp = true;
+    }
+
+    return true;
+}
+
+const uint8_t* ts_block_finish(ts_block_encoder_t* enc, bool pad, size_t* len) {
+    if (!enc) return NULL;
+
+    ts_block_header_t* h = header_of(enc);
+    h->data_bytes = (uint16_t)(enc->pos - sizeof(ts_block_header_t));
+
+    size_t size = enc->pos;
+    if (pad) {
+        memset(enc->block + enc->pos, 0, TS_BLOCK_SIZE - enc->pos);
+        size = TS_BLOCK_SIZE;
+    }
+
+    if (len) *len = size;
+    return enc->block;
+}
+
+uint16_t ts_block_count(const ts_block_encoder_t* enc) {
+    return enc ? ((const ts_block_header_t*)enc->block)->count : 0;
+}
+
+bool ts_block_read_header(const uint8_t* data, size_t len, ts_block_header_t* header) {
+    if (!data || !header || len < sizeof(ts_block_header_t)) return false;
+
+    memcpy(header, data, sizeof(ts_block_header_t));
+    return header->magic == TS_BLOCK_MAGIC &&
+           sizeof(ts_block_header_t) + header->data_bytes <= len;
+}
+
+int ts_block_decode(const uint8_t* data, size_t len, ts_sample_t* out, size_t max_samples) {
+    ts_block_header_t h;
+    if (!out || !ts_block_read_header(data, len, &h)) return -1;
+
+    const uint8_t* p = data + sizeof(ts_block_header_t);
+    size_t avail = h.data_bytes;
+
+    int64_t prev_time = h.start_time;
+    int64_t prev_delta = 0;
+    int64_t prev_temp = 0;
+    uint8_t flags = 0;
+    size_t count = 0;
+
+    while (count < h.count && count < max_samples) {
+        uint64_t v;
+        size_t n = varint_get(p, avail, &v);
+        if (n == 0) return -1;
+        p += n;
+        avail -= n;
+
+        int64_t delta = prev_delta + zigzag_decode(v);
+        int64_t t = prev_time + delta;
+
+        n = varint_get(p, avail, &v);
+        if (n == 0) return -1;
+        p += n;
+        avail -= n;
+
+        int64_t temp = prev_temp + zigzag_decode(v >> 1);
+        if (v & 1) {
+            if (avail == 0) return -1;
+            flags = *p++;
+            avail--;
+        }
+
+        out[count].collect_time = t;
+        out[count].temperature = (flags & TS_FLAG_TEMP_VALID) ? (int16_t)temp : 0;
+        out[count].flags = flags;
+        count++;
+
+        prev_time = t;
+        prev_delta = delta;
+        prev_temp = temp;
+    }
+
+    return (int)count;
+}
@@ -0,0 +1,123 @@
+/**
+ * @file ts_block.h
+ * @brief COEL E33 DataLogger - Blocos compactados de séries temporais
+ * @author Nova Instruments
+ *
+ * Codificação no estilo Gorilla para o histórico de temperatura/porta:
+ * timestamps como delta-de-delta e temperaturas como delta, ambos em
+ * varint zigzag, empacotados em blocos de tamanho fixo com cabeçalho de
+ * tempo inicial/final e temperatura mínima/máxima. Amostras regulares
+ * (intervalo constante, temperatura estável) ocupam 2 bytes.
+ */
+
+#ifndef TS_BLOCK_H
+#define TS_BLOCK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Configurações dos blocos
+#define TS_BLOCK_SIZE 4096                // Tamanho fixo do bloco (cabeçalho + dados)
+#define TS_BLOCK_MAGIC 0x4B4C4254u        // "TBLK"
+#define TS_BLOCK_MAX_SAMPLE_BYTES 24      // Pior caso de uma amostra codificada
+#define TS_BLOCK_NO_TEMP_MIN INT16_MAX    // temp_min de um bloco sem temperatura válida
+#define TS_BLOCK_NO_TEMP_MAX INT16_MIN    // temp_max de um bloco sem temperatura válida
+
+// Flags de amostra
+#define TS_FLAG_TEMP_VALID 0x01           // Temperatura lida com sucesso
+#define TS_FLAG_DOOR_VALID 0x02           // Status da porta lido com sucesso
+#define TS_FLAG_DOOR_OPEN  0x04           // Porta aberta
+
+// Amostra de histórico
+typedef struct {
+    int64_t collect_time;       // Timestamp em ms desde epoch
+    int16_t temperature;        // Temperatura em décimos de °C (valor bruto do 0x200)
+    uint8_t flags;              // TS_FLAG_*
+} ts_sample_t;
+
+// Cabeçalho do bloco (formato em disco)
+typedef struct __attribute__((packed)) {
+    uint32_t magic;             // TS_BLOCK_MAGIC
+    uint16_t count;             // Número de amostras
+    uint16_t data_bytes;        // Bytes de dados após o cabeçalho
+    int64_t start_time;         // Timestamp da primeira amostra (ms)
+    int64_t end_time;           // Timestamp da última amostra (ms)
+    int16_t temp_min;           // Menor temperatura válida (décimos de °C; TS_BLOCK_NO_TEMP_MIN se nenhuma)
+    int16_t temp_max;           // Maior temperatura válida (décimos de °C; TS_BLOCK_NO_TEMP_MAX se nenhuma)
+} ts_block_header_t;
+
+// Estado do codificador de um bloco
+typedef struct {
+    uint8_t block[TS_BLOCK_SIZE];   // Cabeçalho + dados
+    size_t pos;                     // Próximo byte livre
+    int64_t prev_time;
+    int64_t prev_delta;
+    int16_t prev_temp;
+    uint8_t prev_flags;
+    bool has_valid_temp;
+} ts_block_encoder_t;
+
+/**
+ * @brief Prepara o codificador para um novo bloco
+ * @param enc Codificador
+ */
+void ts_block_encoder_init(ts_block_encoder_t* enc);
+
+/**
+ * @brief Acrescenta uma amostra ao bloco
+ * @param enc Codificador
+ * @param sample Amostra (timestamps devem ser não decrescentes)
+ * @return true se a amostra coube no bloco, false se o bloco está cheio
+ */
+bool ts_block_append(ts_block_encoder_t* enc, const ts_sample_t* sample);
+
+/**
+ * @brief Finaliza o bloco e retorna seus bytes
+ * @param enc Codificador
+ * @param pad true para completar com zeros até TS_BLOCK_SIZE (arquivos com acesso direto por bloco)
+ * @param len Tamanho do bloco retornado
+ * @return Ponteiro para o bloco (válido até o próximo ts_block_encoder_init)
+ */
+const uint8_t* ts_block_finish(ts_block_encoder_t* enc, bool pad, size_t* len);
+
+/**
+ * @brief Número de amostras no bloco em construção
+ * @param enc Codificador
+ * @return Quantidade de amostras
+ */
+uint16_t ts_block_count(const ts_block_encoder_t* enc);
+
+/**
+ * @brief Lê e valida o cabeçalho de um bloco sem decodificar as amostras
+ * @param data Bytes do bloco
+ * @param len Tamanho disponível
+ * @param header Cabeçalho de saída
+ * @return true se o cabeçalho é válido, false caso contrário
+ */
+bool ts_block_read_header(const uint8_t* data, size_t len, ts_block_header_t* header);
+
+/**
+ * @brief Indica se o bloco tem alguma temperatura válida (temp_min/temp_max significativos)
+ *
+ * Sem temperatura válida, o cabeçalho traz temp_min > temp_max (intervalo
+ * vazio), distinto de um bloco com 0,0 °C. Blocos gravados antes desta
+ * convenção usavam 0/0 nesse caso e não podem ser distinguidos.
+ * @param header Cabeçalho lido por ts_block_read_header()
+ * @return true se temp_min/temp_max vêm de amostras válidas
+ */
+static inline bool ts_block_has_temp(const ts_block_header_t* header) {
+    return header->temp_min <= header->temp_max;
+}
+
+/**
+ * @brief Decodifica as amostras de um bloco
+ * @param data Bytes do bloco
+ * @param len Tamanho disponível
+ * @param out Buffer de saída
+ * @param max_samples Capacidade do buffer
+ * @return Número de amostras decodificadas, ou -1 se o bloco for inválido
+ */
+int ts_block_decode(const uint8_t* data, size_t len, ts_sample_t* out, size_t max_samples);
+
+#endif // TS_BLOCK_H
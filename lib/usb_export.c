@@ -0,0 +1,1247 @@
+/**
+ * @file usb_export.c
+ * @brief COEL E33 DataLogger - Cópia de bancos para o pen drive sem processos externos
+ * @author Nova Instruments
+ */
+
+#define _GNU_SOURCE  // Para copy_file_range e syncfs
+#include "usb_export.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/sendfile.h>
+#if defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#elif defined(__SSE4_2__)
+#include <nmmintrin.h>
+#endif
+
+#if !defined(__ARM_FEATURE_CRC32) && !defined(__SSE4_2__)
+#define CRC32C_SOFTWARE
+#define CRC32C_POLY 0x82F63B78u  // Polinômio Castagnoli (refletido)
+
+// Tabelas do CRC32C, 8 bytes por iteração (slicing-by-8)
+static uint32_t crc32c_table[8][256];
+static pthread_once_t crc32c_once = PTHREAD_ONCE_INIT;
+#endif
+
+// Arquivo selecionado para cópia
+typedef struct {
+    char name[256];
+    unsigned long long size;
+    long long mtime_ns;
+    uint32_t targets;  // Destinos que precisam do arquivo (cópia em leque, bit i = destino i)
+    unsigned long long resume[USB_EXPORT_MAX_TARGETS];  // Bytes já gravados em cada destino
+    uint32_t resume_crc[USB_EXPORT_MAX_TARGETS];        // CRC32C desses bytes
+} export_file_t;
+
+/**
+ * @brief Tempo monotônico em milissegundos
+ */
+static long long monotonic_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
+
+/**
+ * @brief Verifica se o nome segue o padrão prefixo*sufixo
+ */
+static bool name_matches(const char* name, const char* prefix, const char* suffix) {
+    size_t len = strlen(name);
+    size_t prefix_len = strlen(prefix);
+    size_t suffix_len = strlen(suffix);
+
+    return len >= prefix_len + suffix_len &&
+           strncmp(name, prefix, prefix_len) == 0 &&
+           strcmp(name + len - suffix_len, suffix) == 0;
+}
+
+/**
+ * @brief mtime de um arquivo em ns desde epoch
+ */
+static long long stat_mtime_ns(const struct stat* st) {
+    return (long long)st->st_mtim.tv_sec * 1000000000LL + st->st_mtim.tv_nsec;
+}
+
+#ifdef CRC32C_SOFTWARE
+/**
+ * @brief Monta as tabelas do CRC32C
+ */
+static void crc32c_init_tables(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int k = 0; k < 8; k++) {
+            crc = (crc >> 1) ^ (CRC32C_POLY & (0u - (crc & 1u)));
+        }
+        crc32c_table[0][i] = crc;
+    }
+    for (uint32_t i = 0; i < 256; i++) {
+        for (int t = 1; t < 8; t++) {
+            uint32_t prev = crc32c_table[t - 1][i];
+            crc32c_table[t][i] = (prev >> 8) ^ crc32c_table[0][prev & 0xff];
+        }
+    }
+}
+#endif
+
+/**
+ * @brief Erros que indicam mecanismo não suportado entre os dois arquivos
+ */
+static bool method_unsupported(int err) {
+    return err == EXDEV || err == EINVAL || err == ENOSYS || err == EOPNOTSUPP || err == EBADF;
+}
+
+/**
+ * @brief Grava o bloco inteiro, repetindo write() em gravações parciais
+ * @return 0 em caso de sucesso, -1 em caso de erro (errno preservado)
+ */
+static int write_all(int fd, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/**
+ * @brief Copia até len bytes com read()/write(), a partir das posições atuais
+ * @param crc CRC32C acumulado sobre os bytes lidos (pode ser NULL)
+ * @return Bytes copiados (0 no fim da origem), ou -1 em caso de erro
+ */
+static ssize_t copy_read_write(int src_fd, int dest_fd, char* buffer, size_t len, uint32_t* crc) {
+    size_t want = len < USB_EXPORT_BUFFER_BYTES ? len : USB_EXPORT_BUFFER_BYTES;
+    ssize_t got;
+    do {
+        got = read(src_fd, buffer, want);
+    } while (got < 0 && errno == EINTR);
+    if (got <= 0) {
+        return got;
+    }
+    if (crc) {
+        *crc = usb_export_crc32c(*crc, buffer, (size_t)got);
+    }
+
+    return write_all(dest_fd, buffer, (size_t)got) == 0 ? got : -1;
+}
+
+// Função para copiar um arquivo
+int usb_export_copy_file(const char* src_path, const char* dest_path, uint32_t* crc,
+                         usb_export_progress_t progress, void* user, usb_export_stats_t* stats) {
+    if (!src_path || !dest_path || !stats) {
+        return -1;
+    }
+
+    const char* name = strrchr(src_path, '/');
+    name = name ? name + 1 : src_path;
+
+    int src_fd = open(src_path, O_RDONLY | O_CLOEXEC);
+    if (src_fd < 0) {
+        printf("Erro ao abrir %s: %s\n", src_path, strerror(errno));
+        stats->failed++;
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(src_fd, &st) != 0) {
+        printf("Erro ao obter tamanho de %s: %s\n", src_path, strerror(errno));
+        close(src_fd);
+        stats->failed++;
+        return -1;
+    }
+
+    // Gravação em destino.part: o destino só aparece (ou é substituído) completo
+    char part_path[USB_EXPORT_MAX_PATH + 8];
+    snprintf(part_path, sizeof(part_path), "%s%s", dest_path, USB_EXPORT_PART_SUFFIX);
+    int dest_fd = open(part_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (dest_fd < 0) {
+        printf("Erro ao criar %s: %s\n", part_path, strerror(errno));
+        close(src_fd);
+        stats->failed++;
+        return -1;
+    }
+
+    // Leitura sequencial única: leitura antecipada maior no cartão SD
+    posix_fadvise(src_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    unsigned long long size = (unsigned long long)st.st_size;
+    unsigned long long done = 0;
+    uint32_t value = 0;
+    // O CRC precisa ver os bytes: com crc (sempre que há manifesto), a cópia
+    // passa pelo buffer do processo e copy_file_range() não é usado. Copiar no
+    // kernel e calcular o CRC numa segunda leitura da origem mede mais lento
+    // no usb_export_bench (cartão SD lido duas vezes), então o recuo fica aqui
+    usb_export_method_t method = crc ? USB_EXPORT_READ_WRITE : USB_EXPORT_COPY_RANGE;
+    char* buffer = NULL;
+    bool ok = true;
+
+    while (done < size) {
+        size_t len = size - done < USB_EXPORT_CHUNK_BYTES ? (size_t)(size - done) : USB_EXPORT_CHUNK_BYTES;
+        ssize_t n;
+
+        if (method == USB_EXPORT_COPY_RANGE) {
+            n = copy_file_range(src_fd, NULL, dest_fd, NULL, len, 0);
+            // Alguns sistemas de arquivos retornam 0 em vez de erro: confirmar o fim com sendfile()
+            if ((n < 0 && method_unsupported(errno)) || n == 0) {
+                method = USB_EXPORT_SENDFILE;
+                continue;
+            }
+        } else if (method == USB_EXPORT_SENDFILE) {
+            n = sendfile(dest_fd, src_fd, NULL, len);
+            if (n < 0 && (errno == EINVAL || errno == ENOSYS)) {
+                method = USB_EXPORT_READ_WRITE;
+                continue;
+            }
+        } else {
+            if (!buffer && !(buffer = malloc(USB_EXPORT_BUFFER_BYTES))) {
+                printf("Erro ao alocar buffer de cópia\n");
+                ok = false;
+                break;
+            }
+            n = copy_read_write(src_fd, dest_fd, buffer, len, crc ? &value : NULL);
+        }
+
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            printf("Erro ao copiar %s: %s\n", name, strerror(errno));
+            ok = false;
+            break;
+        }
+        if (n == 0) {
+            break;  // Origem encolheu durante a cópia
+        }
+
+        done += (unsigned long long)n;
+        stats->bytes += (unsigned long long)n;
+        if (progress) {
+            progress(name, done, size, stats, user);
+        }
+    }
+
+    free(buffer);
+    close(src_fd);
+    stats->method = method;
+
+    if (ok && done != size) {
+        printf("Erro: cópia incompleta de %s (%llu de %llu bytes)\n", name, done, size);
+        ok = false;
+    }
+    if (close(dest_fd) != 0 && ok) {
+        printf("Erro ao fechar %s: %s\n", part_path, strerror(errno));
+        ok = false;
+    }
+    if (ok && rename(part_path, dest_path) != 0) {
+        printf("Erro ao renomear %s: %s\n", part_path, strerror(errno));
+        ok = false;
+    }
+
+    if (!ok) {
+        unlink(part_path);
+        stats->failed++;
+        return -1;
+    }
+
+    if (progress && size == 0) {
+        progress(name, 0, 0, stats, user);
+    }
+    if (crc) {
+        *crc = value;
+    }
+    stats->files++;
+    return 0;
+}
+
+// Função para copiar os arquivos de um diretório
+int usb_export_copy_dir(const char* source_dir, const char* dest_dir,
+                        const char* prefix, const char* suffix, const char* exclude,
+                        usb_export_manifest_t* manifest,
+                        usb_export_progress_t progress, void* user, usb_export_stats_t* stats) {
+    if (!source_dir || !dest_dir || !prefix || !suffix || !stats) {
+        return -1;
+    }
+
+    // Com manifesto: seleção, CRC durante a cópia e retomada da cópia em leque, com um destino
+    // (sempre por read()/write(); copy_file_range() só na cópia sem manifesto)
+    if (manifest) {
+        usb_export_target_t target;
+        memset(&target, 0, sizeof(target));
+        target.dir = dest_dir;
+        target.manifest = manifest;
+        target.progress = progress;
+        target.user = user;
+        int result = usb_export_copy_dir_multi(source_dir, prefix, suffix, exclude, &target, 1);
+        *stats = target.stats;
+        return result;
+    }
+    memset(stats, 0, sizeof(*stats));
+
+    DIR* dir = opendir(source_dir);
+    if (!dir) {
+        printf("Erro ao abrir diretório %s: %s\n", source_dir, strerror(errno));
+        return -1;
+    }
+
+    // Selecionar os arquivos e somar os tamanhos para o progresso total
+    export_file_t* files = NULL;
+    int capacity = 0;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (!name_matches(entry->d_name, prefix, suffix) ||
+            (exclude && strcmp(entry->d_name, exclude) == 0)) {
+            continue;
+        }
+
+        char path[USB_EXPORT_MAX_PATH];
+        struct stat st;
+        snprintf(path, sizeof(path), "%s/%s", source_dir, entry->d_name);
+        if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) {
+            continue;
+        }
+
+        if (stats->total_files == capacity) {
+            int new_capacity = capacity ? capacity * 2 : 16;
+            export_file_t* grown = realloc(files, (size_t)new_capacity * sizeof(*files));
+            if (!grown) {
+                printf("Erro ao alocar lista de arquivos\n");
+                free(files);
+                closedir(dir);
+                return -1;
+            }
+            files = grown;
+            capacity = new_capacity;
+        }
+        export_file_t* file = &files[stats->total_files++];
+        snprintf(file->name, sizeof(file->name), "%s", entry->d_name);
+        file->size = (unsigned long long)st.st_size;
+        stats->total_bytes += file->size;
+    }
+    closedir(dir);
+
+    long long start = monotonic_ms();
+    for (int i = 0; i < stats->total_files; i++) {
+        char src_path[USB_EXPORT_MAX_PATH];
+        char dest_path[USB_EXPORT_MAX_PATH];
+        snprintf(src_path, sizeof(src_path), "%s/%s", source_dir, files[i].name);
+        snprintf(dest_path, sizeof(dest_path), "%s/%s", dest_dir, files[i].name);
+        usb_export_copy_file(src_path, dest_path, NULL, progress, user, stats);
+    }
+    stats->elapsed_ms = monotonic_ms() - start;
+
+    free(files);
+    return stats->failed == 0 ? 0 : -1;
+}
+
+/**
+ * @brief Descarta um destino da cópia em leque
+ *
+ * Com ponto de controle registrado, o .part fica no pen drive para a
+ * próxima inserção; sem ele, é removido.
+ */
+static void fanout_drop(usb_export_target_t* target, int* fd, const char* part_path, bool keep) {
+    close(*fd);
+    *fd = -1;
+    if (!keep) {
+        unlink(part_path);
+    }
+    target->stats.failed++;
+}
+
+/**
+ * @brief Lê um arquivo da origem uma vez e grava cada bloco nos destinos marcados
+ *
+ * A leitura começa no menor ponto de retomada; cada destino recebe apenas
+ * os bytes após o seu, e o CRC acumulado é conferido ao passar por ele.
+ */
+static void fanout_file(const char* source_dir, const export_file_t* file,
+                        usb_export_target_t* targets, int count, char* buffer) {
+    char src_path[USB_EXPORT_MAX_PATH];
+    char part_paths[USB_EXPORT_MAX_TARGETS][USB_EXPORT_MAX_PATH + 8];
+    int fds[USB_EXPORT_MAX_TARGETS];
+    unsigned long long checkpoint[USB_EXPORT_MAX_TARGETS];  // Bytes no último ponto de controle
+    snprintf(src_path, sizeof(src_path), "%s/%s", source_dir, file->name);
+
+    int src_fd = open(src_path, O_RDONLY | O_CLOEXEC);
+    if (src_fd < 0) {
+        printf("Erro ao abrir %s: %s\n", src_path, strerror(errno));
+        for (int i = 0; i < count; i++) {
+            if (file->targets & (1u << i)) {
+                targets[i].stats.failed++;
+            }
+        }
+        return;
+    }
+    posix_fadvise(src_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    unsigned long long done = file->size;
+    uint32_t crc = 0;
+    int open_count = 0;
+    for (int i = 0; i < count; i++) {
+        fds[i] = -1;
+        if (!(file->targets & (1u << i))) {
+            continue;
+        }
+        snprintf(part_paths[i], sizeof(part_paths[i]), "%s/%s%s", targets[i].dir, file->name,
+                 USB_EXPORT_PART_SUFFIX);
+        checkpoint[i] = file->resume[i];
+
+        if (file->resume[i] > 0) {
+            // Continuação: .part já truncado no ponto de controle
+            fds[i] = open(part_paths[i], O_WRONLY | O_CLOEXEC);
+            if (fds[i] >= 0 && lseek(fds[i], (off_t)file->resume[i], SEEK_SET) < 0) {
+                close(fds[i]);
+                fds[i] = -1;
+            }
+        } else {
+            // A entrada antiga deixa de valer: o arquivo final será substituído pelo .part
+            usb_export_manifest_remove(targets[i].manifest, file->name);
+            fds[i] = open(part_paths[i], O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        }
+        if (fds[i] < 0) {
+            printf("Erro ao abrir %s: %s\n", part_paths[i], strerror(errno));
+            targets[i].stats.failed++;
+            continue;
+        }
+        open_count++;
+
+        if (file->resume[i] < done) {
+            done = file->resume[i];
+            crc = file->resume_crc[i];
+        }
+    }
+
+    // Destinos com o mesmo ponto de retomada do escolhido precisam do mesmo CRC
+    for (int i = 0; i < count; i++) {
+        if (fds[i] >= 0 && done > 0 && file->resume[i] == done && file->resume_crc[i] != crc) {
+            printf("Erro: %s no pen drive diverge da origem, será copiado de novo\n", part_paths[i]);
+            usb_export_manifest_remove(targets[i].manifest, file->name);
+            fanout_drop(&targets[i], &fds[i], part_paths[i], false);
+            open_count--;
+        }
+    }
+
+    bool read_ok = open_count > 0 && (done == 0 || lseek(src_fd, (off_t)done, SEEK_SET) >= 0);
+
+    // Um read() e um CRC por bloco, um write() por destino
+    while (read_ok && open_count > 0 && done < file->size) {
+        size_t want = file->size - done < USB_EXPORT_BUFFER_BYTES ? (size_t)(file->size - done)
+                                                                  : USB_EXPORT_BUFFER_BYTES;
+        // O bloco termina no ponto de retomada de um destino mais adiantado, onde o CRC é conferido
+        for (int i = 0; i < count; i++) {
+            if (fds[i] >= 0 && file->resume[i] > done && file->resume[i] - done < want) {
+                want = (size_t)(file->resume[i] - done);
+            }
+        }
+
+        ssize_t got = read(src_fd, buffer, want);
+        if (got < 0) {
+            if (errno == EINTR) continue;
+            printf("Erro ao ler %s: %s\n", src_path, strerror(errno));
+            read_ok = false;
+            break;
+        }
+        if (got == 0) {
+            break;  // Origem encolheu durante a cópia
+        }
+        unsigned long long offset = done;
+        crc = usb_export_crc32c(crc, buffer, (size_t)got);
+        done += (unsigned long long)got;
+
+        for (int i = 0; i < count; i++) {
+            if (fds[i] < 0 || done < file->resume[i]) {
+                continue;
+            }
+            if (done == file->resume[i]) {
+                // Prefixo gravado em outra inserção: precisa coincidir com a origem
+                if (crc != file->resume_crc[i]) {
+                    printf("Erro: %s no pen drive diverge da origem, será copiado de novo\n", part_paths[i]);
+                    usb_export_manifest_remove(targets[i].manifest, file->name);
+                    fanout_drop(&targets[i], &fds[i], part_paths[i], false);
+                    open_count--;
+                }
+                continue;
+            }
+
+            size_t skip = file->resume[i] > offset ? (size_t)(file->resume[i] - offset) : 0;
+            size_t len = (size_t)got - skip;
+            if (write_all(fds[i], buffer + skip, len) != 0) {
+                printf("Erro ao gravar %s: %s\n", part_paths[i], strerror(errno));
+                fanout_drop(&targets[i], &fds[i], part_paths[i], checkpoint[i] > 0);
+                open_count--;
+                continue;
+            }
+            targets[i].stats.bytes += len;
+            if (targets[i].progress) {
+                targets[i].progress(file->name, done, file->size, &targets[i].stats, targets[i].user);
+            }
+
+            // Ponto de controle: pen drive removido daqui em diante continua deste ponto
+            if (done - checkpoint[i] >= USB_EXPORT_CHECKPOINT_BYTES && done < file->size) {
+                usb_export_entry_t partial;
+                memset(&partial, 0, sizeof(partial));
+                snprintf(partial.name, sizeof(partial.name), "%s", file->name);
+                partial.bytes = done;
+                partial.src_size = file->size;
+                partial.src_mtime_ns = file->mtime_ns;
+                partial.crc = crc;
+                if (usb_export_manifest_checkpoint(targets[i].dir, targets[i].manifest, fds[i], &partial) != 0) {
+                    fanout_drop(&targets[i], &fds[i], part_paths[i], checkpoint[i] > 0);
+                    open_count--;
+                    continue;
+                }
+                checkpoint[i] = done;
+                targets[i].stats.checkpoints++;
+            }
+        }
+    }
+    close(src_fd);
+
+    if (read_ok && open_count > 0 && done != file->size) {
+        printf("Erro: cópia incompleta de %s (%llu de %llu bytes)\n", file->name, done, file->size);
+        read_ok = false;
+    }
+
+    for (int i = 0; i < count; i++) {
+        if (fds[i] < 0) {
+            continue;
+        }
+        if (!read_ok) {
+            // Origem alterada ou ilegível: o ponto de controle não vale mais
+            usb_export_manifest_remove(targets[i].manifest, file->name);
+            fanout_drop(&targets[i], &fds[i], part_paths[i], false);
+            continue;
+        }
+        if (close(fds[i]) != 0 || usb_export_commit_part(targets[i].dir, file->name) != 0) {
+            printf("Erro ao concluir %s: %s\n", part_paths[i], strerror(errno));
+            targets[i].stats.failed++;
+            continue;
+        }
+
+        if (targets[i].progress && file->size == 0) {
+            targets[i].progress(file->name, 0, 0, &targets[i].stats, targets[i].user);
+        }
+
+        usb_export_entry_t copied;
+        memset(&copied, 0, sizeof(copied));
+        snprintf(copied.name, sizeof(copied.name), "%s", file->name);
+        copied.bytes = done;
+        copied.src_size = done;
+        copied.src_mtime_ns = file->mtime_ns;
+        copied.crc = crc;
+        copied.written = true;
+        usb_export_manifest_set(targets[i].manifest, &copied);
+        targets[i].stats.files++;
+    }
+}
+
+// Função para copiar os arquivos de um diretório para vários destinos
+int usb_export_copy_dir_multi(const char* source_dir, const char* prefix, const char* suffix,
+                              const char* exclude, usb_export_target_t* targets, int count) {
+    if (!source_dir || !prefix || !suffix || !targets || count <= 0 || count > USB_EXPORT_MAX_TARGETS) {
+        return -1;
+    }
+    for (int i = 0; i < count; i++) {
+        if (!targets[i].dir || !targets[i].manifest) {
+            return -1;
+        }
+        memset(&targets[i].stats, 0, sizeof(targets[i].stats));
+        targets[i].stats.method = USB_EXPORT_READ_WRITE;
+    }
+
+    DIR* dir = opendir(source_dir);
+    if (!dir) {
+        printf("Erro ao abrir diretório %s: %s\n", source_dir, strerror(errno));
+        return -1;
+    }
+
+    // Cada destino seleciona pelo próprio manifesto; a origem entra na lista se algum precisar dela
+    export_file_t* files = NULL;
+    int file_count = 0;
+    int capacity = 0;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (!name_matches(entry->d_name, prefix, suffix) ||
+            (exclude && strcmp(entry->d_name, exclude) == 0)) {
+            continue;
+        }
+
+        char path[USB_EXPORT_MAX_PATH];
+        struct stat st;
+        snprintf(path, sizeof(path), "%s/%s", source_dir, entry->d_name);
+        if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) {
+            continue;
+        }
+
+        unsigned long long size = (unsigned long long)st.st_size;
+        long long mtime_ns = stat_mtime_ns(&st);
+        uint32_t needed = 0;
+        unsigned long long resume[USB_EXPORT_MAX_TARGETS] = {0};
+        uint32_t resume_crc[USB_EXPORT_MAX_TARGETS] = {0};
+        for (int i = 0; i < count; i++) {
+            usb_export_stats_t* stats = &targets[i].stats;
+            if (usb_export_manifest_current(targets[i].manifest, targets[i].dir, entry->d_name, path,
+                                            size, mtime_ns, stats)) {
+                stats->skipped++;
+                stats->skipped_bytes += size;
+            } else {
+                needed |= 1u << i;
+                resume[i] = usb_export_manifest_resume(targets[i].manifest, targets[i].dir, entry->d_name,
+                                                       size, mtime_ns, &resume_crc[i], stats);
+                stats->total_files++;
+                stats->total_bytes += size - resume[i];
+            }
+        }
+        if (!needed) {
+            continue;
+        }
+
+        if (file_count == capacity) {
+            int new_capacity = capacity ? capacity * 2 : 16;
+            export_file_t* grown = realloc(files, (size_t)new_capacity * sizeof(*files));
+            if (!grown) {
+                printf("Erro ao alocar lista de arquivos\n");
+                free(files);
+                closedir(dir);
+                return -1;
+            }
+            files = grown;
+            capacity = new_capacity;
+        }
+        export_file_t* file = &files[file_count++];
+        snprintf(file->name, sizeof(file->name), "%s", entry->d_name);
+        file->size = size;
+        file->mtime_ns = mtime_ns;
+        file->targets = needed;
+        memcpy(file->resume, resume, sizeof(file->resume));
+        memcpy(file->resume_crc, resume_crc, sizeof(file->resume_crc));
+    }
+    closedir(dir);
+
+    char* buffer = file_count > 0 ? malloc(USB_EXPORT_BUFFER_BYTES) : NULL;
+    if (file_count > 0 && !buffer) {
+        printf("Erro ao alocar buffer de cópia\n");
+        free(files);
+        return -1;
+    }
+
+    long long start = monotonic_ms();
+    for (int f = 0; f < file_count; f++) {
+        fanout_file(source_dir, &files[f], targets, count, buffer);
+    }
+    long long elapsed_ms = monotonic_ms() - start;
+
+    int failed = 0;
+    for (int i = 0; i < count; i++) {
+        targets[i].stats.elapsed_ms = elapsed_ms;
+        failed += targets[i].stats.failed;
+    }
+
+    free(buffer);
+    free(files);
+    return failed == 0 ? 0 : -1;
+}
+
+// Função para remover arquivos de um diretório
+int usb_export_remove_files(const char* dir_path, const char* prefix, const char* suffix) {
+    if (!dir_path || !prefix || !suffix) {
+        return -1;
+    }
+
+    DIR* dir = opendir(dir_path);
+    if (!dir) {
+        return -1;
+    }
+
+    int removed = 0;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (!name_matches(entry->d_name, prefix, suffix)) {
+            continue;
+        }
+
+        char path[USB_EXPORT_MAX_PATH];
+        struct stat st;
+        snprintf(path, sizeof(path), "%s/%s", dir_path, entry->d_name);
+        if (lstat(path, &st) != 0 || !S_ISREG(st.st_mode)) {
+            continue;
+        }
+
+        if (unlink(path) == 0) {
+            removed++;
+        } else {
+            printf("Erro ao remover %s: %s\n", path, strerror(errno));
+        }
+    }
+
+    closedir(dir);
+    return removed;
+}
+
+// Função para sincronizar o sistema de arquivos de destino
+int usb_export_sync(const char* path) {
+    if (!path) {
+        return -1;
+    }
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        printf("Erro ao abrir %s para sincronização: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    int result = syncfs(fd);
+    if (result != 0) {
+        printf("Erro ao sincronizar %s: %s\n", path, strerror(errno));
+    }
+    close(fd);
+    return result == 0 ? 0 : -1;
+}
+
+// Função para carregar o manifesto
+bool usb_export_manifest_load(const char* dir, usb_export_manifest_t* manifest) {
+    if (!dir || !manifest) {
+        return false;
+    }
+    memset(manifest, 0, sizeof(*manifest));
+
+    char path[USB_EXPORT_MAX_PATH];
+    snprintf(path, sizeof(path), "%s/%s", dir, USB_EXPORT_MANIFEST_FILE);
+    FILE* fp = fopen(path, "r");
+    if (!fp) {
+        return false;
+    }
+
+    // Primeira linha identifica formato e hash; outra versão = cópia completa
+    char line[512];
+    int version = 0;
+    if (!fgets(line, sizeof(line), fp) || sscanf(line, "# usb_export %d crc32c", &version) != 1 ||
+        version < 1 || version > USB_EXPORT_MANIFEST_VERSION) {
+        fclose(fp);
+        return false;
+    }
+
+    while (fgets(line, sizeof(line), fp)) {
+        if (line[0] == '#' || line[0] == '\n') continue;
+
+        usb_export_entry_t entry;
+        int verified = 0;
+        int partial = 0;
+        memset(&entry, 0, sizeof(entry));
+        if (sscanf(line, "%255[^;];%llu;%llu;%lld;%x;%d;%d", entry.name, &entry.bytes,
+                   &entry.src_size, &entry.src_mtime_ns, &entry.crc, &verified, &partial) < 5) {
+            continue;
+        }
+        entry.verified = verified != 0;
+        entry.partial = partial != 0;
+        if (usb_export_manifest_set(manifest, &entry) != 0) {
+            break;
+        }
+        manifest->entries[manifest->count - 1].seen = false;
+    }
+
+    fclose(fp);
+    return true;
+}
+
+// Função para gravar o manifesto
+int usb_export_manifest_save(const char* dir, const usb_export_manifest_t* manifest) {
+    if (!dir || !manifest) {
+        return -1;
+    }
+
+    char path[USB_EXPORT_MAX_PATH];
+    char tmp_path[USB_EXPORT_MAX_PATH + 8];
+    snprintf(path, sizeof(path), "%s/%s", dir, USB_EXPORT_MANIFEST_FILE);
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    FILE* fp = fopen(tmp_path, "w");
+    if (!fp) {
+        printf("Erro ao criar manifesto %s: %s\n", tmp_path, strerror(errno));
+        return -1;
+    }
+
+    char stamp[32];
+    time_t now = time(NULL);
+    struct tm tm_info;
+    localtime_r(&now, &tm_info);
+    strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &tm_info);
+
+    fprintf(fp, "# usb_export %d crc32c\n", USB_EXPORT_MANIFEST_VERSION);
+    fprintf(fp, "# exportado em %s\n", stamp);
+    fprintf(fp, "# nome;bytes;bytes_origem;mtime_origem_ns;crc32c;verificado;parcial\n");
+    for (int i = 0; i < manifest->count; i++) {
+        const usb_export_entry_t* entry = &manifest->entries[i];
+        fprintf(fp, "%s;%llu;%llu;%lld;%08x;%d;%d\n", entry->name, entry->bytes,
+                entry->src_size, entry->src_mtime_ns, entry->crc, entry->verified ? 1 : 0,
+                entry->partial ? 1 : 0);
+    }
+
+    int result = 0;
+    if (fflush(fp) != 0 || fsync(fileno(fp)) != 0) {
+        result = -1;
+    }
+    if (fclose(fp) != 0) {
+        result = -1;
+    }
+    if (result == 0 && rename(tmp_path, path) != 0) {
+        result = -1;
+    }
+    if (result != 0) {
+        printf("Erro ao gravar manifesto %s: %s\n", path, strerror(errno));
+        unlink(tmp_path);
+    }
+    return result;
+}
+
+void usb_export_manifest_free(usb_export_manifest_t* manifest) {
+    if (!manifest) {
+        return;
+    }
+    free(manifest->entries);
+    memset(manifest, 0, sizeof(*manifest));
+}
+
+usb_export_entry_t* usb_export_manifest_find(usb_export_manifest_t* manifest, const char* name) {
+    if (!manifest || !name) {
+        return NULL;
+    }
+    for (int i = 0; i < manifest->count; i++) {
+        if (strcmp(manifest->entries[i].name, name) == 0) {
+            return &manifest->entries[i];
+        }
+    }
+    return NULL;
+}
+
+int usb_export_manifest_set(usb_export_manifest_t* manifest, const usb_export_entry_t* entry) {
+    if (!manifest || !entry) {
+        return -1;
+    }
+
+    usb_export_entry_t* slot = usb_export_manifest_find(manifest, entry->name);
+    if (!slot) {
+        if (manifest->count == manifest->capacity) {
+            int new_capacity = manifest->capacity ? manifest->capacity * 2 : 32;
+            usb_export_entry_t* grown = realloc(manifest->entries,
+                                                (size_t)new_capacity * sizeof(*grown));
+            if (!grown) {
+                printf("Erro ao alocar manifesto\n");
+                return -1;
+            }
+            manifest->entries = grown;
+            manifest->capacity = new_capacity;
+        }
+        slot = &manifest->entries[manifest->count++];
+    }
+
+    *slot = *entry;
+    slot->seen = true;
+    return 0;
+}
+
+void usb_export_manifest_remove(usb_export_manifest_t* manifest, const char* name) {
+    usb_export_entry_t* entry = usb_export_manifest_find(manifest, name);
+    if (!entry) {
+        return;
+    }
+
+    int index = (int)(entry - manifest->entries);
+    memmove(entry, entry + 1, (size_t)(manifest->count - index - 1) * sizeof(*entry));
+    manifest->count--;
+}
+
+bool usb_export_manifest_current(usb_export_manifest_t* manifest, const char* dest_dir,
+                                 const char* name, const char* src_path,
+                                 unsigned long long src_size, long long src_mtime_ns,
+                                 usb_export_stats_t* stats) {
+    usb_export_entry_t* entry = usb_export_manifest_find(manifest, name);
+    if (!entry || !dest_dir || entry->partial || entry->src_size != src_size) {
+        return false;
+    }
+
+    // A cópia no pen drive precisa continuar lá, com o tamanho registrado
+    char dest_path[USB_EXPORT_MAX_PATH];
+    struct stat st;
+    snprintf(dest_path, sizeof(dest_path), "%s/%s", dest_dir, name);
+    if (stat(dest_path, &st) != 0 || (unsigned long long)st.st_size != entry->bytes) {
+        return false;
+    }
+
+    // mtime alterado (ex: banco aberto e fechado sem alterações): decide pelo conteúdo
+    if (entry->src_mtime_ns != src_mtime_ns) {
+        if (!src_path) {
+            return false;
+        }
+
+        uint32_t crc = 0;
+        unsigned long long bytes = 0;
+        if (stats) {
+            stats->hashed++;
+        }
+        if (usb_export_crc_file(src_path, &crc, &bytes) != 0 || bytes != src_size || crc != entry->crc) {
+            return false;
+        }
+        entry->src_mtime_ns = src_mtime_ns;
+    }
+
+    entry->seen = true;
+    return true;
+}
+
+unsigned long long usb_export_manifest_resume(usb_export_manifest_t* manifest, const char* dest_dir,
+                                              const char* name, unsigned long long src_size,
+                                              long long src_mtime_ns, uint32_t* crc,
+                                              usb_export_stats_t* stats) {
+    if (!manifest || !dest_dir || !name || !crc) {
+        return 0;
+    }
+
+    char part_path[USB_EXPORT_MAX_PATH + 8];
+    snprintf(part_path, sizeof(part_path), "%s/%s%s", dest_dir, name, USB_EXPORT_PART_SUFFIX);
+    usb_export_entry_t* entry = usb_export_manifest_find(manifest, name);
+    if (!entry || !entry->partial) {
+        return 0;
+    }
+
+    // Mesma origem e ponto de controle inteiro no .part (bytes além dele são descartados)
+    struct stat st;
+    bool ok = entry->src_size == src_size && entry->src_mtime_ns == src_mtime_ns &&
+              entry->bytes > 0 &&
+              stat(part_path, &st) == 0 && (unsigned long long)st.st_size >= entry->bytes &&
+              truncate(part_path, (off_t)entry->bytes) == 0;
+    if (ok && USB_EXPORT_VERIFY_READBACK) {
+        ok = usb_export_verify_file(part_path, entry->crc, entry->bytes, NULL) == 0;
+    }
+    if (!ok) {
+        unlink(part_path);
+        usb_export_manifest_remove(manifest, name);
+        return 0;
+    }
+
+    printf("↪️  Retomando %s a partir de %.1f MB\n", name, entry->bytes / (1024.0 * 1024.0));
+    entry->seen = true;
+    *crc = entry->crc;
+    if (stats) {
+        stats->resumed++;
+        stats->resumed_bytes += entry->bytes;
+    }
+    return entry->bytes;
+}
+
+int usb_export_manifest_checkpoint(const char* dir, usb_export_manifest_t* manifest, int fd,
+                                   const usb_export_entry_t* partial) {
+    if (!dir || !manifest || !partial) {
+        return -1;
+    }
+
+    // Dados antes do registro: o manifesto nunca aponta além do que está no pen drive
+    if (fdatasync(fd) != 0) {
+        printf("Erro ao sincronizar %s%s: %s\n", partial->name, USB_EXPORT_PART_SUFFIX, strerror(errno));
+        return -1;
+    }
+
+    usb_export_entry_t entry = *partial;
+    entry.partial = true;
+    entry.verified = false;
+    entry.written = false;
+    if (usb_export_manifest_set(manifest, &entry) != 0) {
+        return -1;
+    }
+    return usb_export_manifest_save(dir, manifest);
+}
+
+int usb_export_commit_part(const char* dest_dir, const char* name) {
+    if (!dest_dir || !name) {
+        return -1;
+    }
+
+    char path[USB_EXPORT_MAX_PATH];
+    char part_path[USB_EXPORT_MAX_PATH + 8];
+    snprintf(path, sizeof(path), "%s/%s", dest_dir, name);
+    snprintf(part_path, sizeof(part_path), "%s%s", path, USB_EXPORT_PART_SUFFIX);
+    if (rename(part_path, path) != 0) {
+        printf("Erro ao renomear %s: %s\n", part_path, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+int usb_export_manifest_prune(usb_export_manifest_t* manifest, const char* dest_dir,
+                              const char* prefix, const char* suffix, const char* keep) {
+    if (!manifest || !dest_dir || !prefix || !suffix) {
+        return -1;
+    }
+
+    // Entradas sem origem nesta exportação deixam o manifesto
+    for (int i = 0; i < manifest->count; ) {
+        if (!manifest->entries[i].seen || (keep && strcmp(manifest->entries[i].name, keep) == 0)) {
+            usb_export_manifest_remove(manifest, manifest->entries[i].name);
+        } else {
+            i++;
+        }
+    }
+
+    DIR* dir = opendir(dest_dir);
+    if (!dir) {
+        return -1;
+    }
+
+    char part_suffix[64];
+    snprintf(part_suffix, sizeof(part_suffix), "%s%s", suffix, USB_EXPORT_PART_SUFFIX);
+
+    int removed = 0;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        // nome.part: mantido apenas com ponto de controle no manifesto
+        if (name_matches(entry->d_name, prefix, part_suffix)) {
+            char name[256];
+            snprintf(name, sizeof(name), "%.*s", (int)(strlen(entry->d_name) - strlen(USB_EXPORT_PART_SUFFIX)),
+                     entry->d_name);
+            const usb_export_entry_t* partial = usb_export_manifest_find(manifest, name);
+            if (partial && partial->partial) {
+                continue;
+            }
+        } else if (!name_matches(entry->d_name, prefix, suffix) ||
+                   (keep && strcmp(entry->d_name, keep) == 0) ||
+                   usb_export_manifest_find(manifest, entry->d_name)) {
+            continue;
+        }
+
+        char path[USB_EXPORT_MAX_PATH];
+        struct stat st;
+        snprintf(path, sizeof(path), "%s/%s", dest_dir, entry->d_name);
+        if (lstat(path, &st) != 0 || !S_ISREG(st.st_mode)) {
+            continue;
+        }
+
+        if (unlink(path) == 0) {
+            removed++;
+        } else {
+            printf("Erro ao remover %s: %s\n", path, strerror(errno));
+        }
+    }
+
+    closedir(dir);
+    return removed;
+}
+
+int usb_export_verify_file(const char* path, uint32_t crc, unsigned long long bytes, bool* direct) {
+    if (!path) {
+        return -1;
+    }
+
+    // O_DIRECT lê do dispositivo (o kernel grava antes as páginas sujas do intervalo)
+    bool use_direct = true;
+    int fd = open(path, O_RDONLY | O_DIRECT | O_CLOEXEC);
+    if (fd < 0 && errno == EINVAL) {
+        // Sem O_DIRECT (ex: tmpfs): gravar, descartar as páginas do cache e ler
+        use_direct = false;
+        fd = open(path, O_RDWR | O_CLOEXEC);
+        if (fd >= 0) {
+            fdatasync(fd);
+            posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        }
+    }
+    if (fd < 0) {
+        printf("Erro ao abrir %s para verificação: %s\n", path, strerror(errno));
+        return -1;
+    }
+    if (direct) {
+        *direct = use_direct;
+    }
+
+    // O_DIRECT exige buffer e tamanhos alinhados ao bloco do dispositivo
+    void* buffer = NULL;
+    if (posix_memalign(&buffer, 4096, USB_EXPORT_BUFFER_BYTES) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    uint32_t value = 0;
+    unsigned long long total = 0;
+    int result = 0;
+    for (;;) {
+        ssize_t n = read(fd, buffer, USB_EXPORT_BUFFER_BYTES);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            printf("Erro ao reler %s: %s\n", path, strerror(errno));
+            result = -1;
+            break;
+        }
+        if (n == 0) {
+            break;
+        }
+        value = usb_export_crc32c(value, buffer, (size_t)n);
+        total += (unsigned long long)n;
+    }
+
+    free(buffer);
+    close(fd);
+
+    if (result == 0 && (total != bytes || value != crc)) {
+        printf("Erro: verificação de %s divergiu (%llu bytes, crc %08x; esperado %llu bytes, crc %08x)\n",
+               path, total, value, bytes, crc);
+        result = -1;
+    }
+    return result;
+}
+
+int usb_export_manifest_verify(usb_export_manifest_t* manifest, const char* dest_dir,
+                               usb_export_stats_t* stats) {
+    if (!manifest || !dest_dir || !stats) {
+        return 0;
+    }
+
+    long long start = monotonic_ms();
+    int failed = 0;
+    for (int i = 0; i < manifest->count; ) {
+        usb_export_entry_t* entry = &manifest->entries[i];
+        if (!entry->written) {
+            i++;
+            continue;
+        }
+
+        char path[USB_EXPORT_MAX_PATH];
+        snprintf(path, sizeof(path), "%s/%s", dest_dir, entry->name);
+        bool direct = false;
+        if (usb_export_verify_file(path, entry->crc, entry->bytes, &direct) == 0) {
+            entry->verified = true;
+            stats->verified++;
+            stats->verify_bytes += entry->bytes;
+            stats->verify_direct = direct;
+            i++;
+            continue;
+        }
+
+        // Cópia corrompida: fora do pen drive e do manifesto
+        unlink(path);
+        usb_export_manifest_remove(manifest, entry->name);
+        stats->verify_failed++;
+        failed++;
+    }
+    stats->verify_ms = monotonic_ms() - start;
+    return failed;
+}
+
+// CRC32C; as leituras de 32 bits assumem little-endian (ARM e x86)
+uint32_t usb_export_crc32c(uint32_t crc, const void* data, size_t len) {
+    const uint8_t* p = data;
+    crc = ~crc;
+
+#ifndef CRC32C_SOFTWARE
+    // Instrução de CRC32C do processador (ARMv8 com +crc, x86 com SSE4.2)
+    while (len >= 4) {
+        uint32_t word;
+        memcpy(&word, p, 4);
+#if defined(__ARM_FEATURE_CRC32)
+        crc = __crc32cw(crc, word);
+#else
+        crc = _mm_crc32_u32(crc, word);
+#endif
+        p += 4;
+        len -= 4;
+    }
+    while (len > 0) {
+#if defined(__ARM_FEATURE_CRC32)
+        crc = __crc32cb(crc, *p++);
+#else
+        crc = _mm_crc32_u8(crc, *p++);
+#endif
+        len--;
+    }
+    return ~crc;
+#else
+    pthread_once(&crc32c_once, crc32c_init_tables);
+
+    while (len > 0 && ((uintptr_t)p & 7) != 0) {
+        crc = (crc >> 8) ^ crc32c_table[0][(crc ^ *p++) & 0xff];
+        len--;
+    }
+    while (len >= 8) {
+        uint32_t lo, hi;
+        memcpy(&lo, p, 4);
+        memcpy(&hi, p + 4, 4);
+        lo ^= crc;
+        crc = crc32c_table[7][lo & 0xff] ^ crc32c_table[6][(lo >> 8) & 0xff] ^
+              crc32c_table[5][(lo >> 16) & 0xff] ^ crc32c_table[4][lo >> 24] ^
+              crc32c_table[3][hi & 0xff] ^ crc32c_table[2][(hi >> 8) & 0xff] ^
+              crc32c_table[1][(hi >> 16) & 0xff] ^ crc32c_table[0][hi >> 24];
+        p += 8;
+        len -= 8;
+    }
+    while (len > 0) {
+        crc = (crc >> 8) ^ crc32c_table[0][(crc ^ *p++) & 0xff];
+        len--;
+    }
+    return ~crc;
+#endif
+}
+
+// Função para calcular o CRC32C de um arquivo
+int usb_export_crc_file(const char* path, uint32_t* crc, unsigned long long* bytes) {
+    if (!path || !crc) {
+        return -1;
+    }
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        printf("Erro ao abrir %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    char* buffer = malloc(USB_EXPORT_BUFFER_BYTES);
+    if (!buffer) {
+        close(fd);
+        return -1;
+    }
+
+    uint32_t value = 0;
+    unsigned long long total = 0;
+    int result = 0;
+    for (;;) {
+        ssize_t n = read(fd, buffer, USB_EXPORT_BUFFER_BYTES);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            printf("Erro ao ler %s: %s\n", path, strerror(errno));
+            result = -1;
+            break;
+        }
+        if (n == 0) {
+            break;
+        }
+        value = usb_export_crc32c(value, buffer, (size_t)n);
+        total += (unsigned long long)n;
+    }
+
+    free(buffer);
+    close(fd);
+    if (result == 0) {
+        *crc = value;
+        if (bytes) {
+            *bytes = total;
+        }
+    }
+    return result;
+}
+
+const char* usb_export_method_name(usb_export_method_t method) {
+    switch (method) {
+        case USB_EXPORT_COPY_RANGE: return "copy_file_range";
+        case USB_EXPORT_SENDFILE: return "sendfile";
+        case USB_EXPORT_READ_WRITE: return "read/write";
+    }
+    return "?";
+}
@@ -0,0 +1,374 @@
+/**
+ * @file usb_export.h
+ * @brief COEL E33 DataLogger - Cópia de bancos para o pen drive sem processos externos
+ * @author Nova Instruments
+ *
+ * Os arquivos são enumerados com opendir() e copiados dentro do processo com
+ * copy_file_range() (cópia feita pelo kernel, sem passar por buffers do
+ * usuário). Quando origem e destino estão em sistemas de arquivos que não
+ * suportam a chamada entre si (ex: ext4 -> vfat), a cópia recai em
+ * sendfile() e, por último, em read()/write() com buffer grande. A
+ * sincronização usa syncfs() apenas no sistema de arquivos de destino.
+ *
+ * Um manifesto no pen drive (USB_EXPORT_MANIFEST_FILE) guarda, para cada
+ * banco exportado, tamanho, mtime da origem e CRC32C do conteúdo: na
+ * exportação seguinte, bancos selados inalterados não são copiados de novo.
+ * O CRC é calculado durante a cópia, sobre o mesmo buffer que é gravado,
+ * sem segunda leitura; opcionalmente, os arquivos gravados são relidos do
+ * pen drive com O_DIRECT (sem o cache de páginas) e conferidos.
+ *
+ * Com vários pen drives conectados juntos, usb_export_copy_dir_multi() lê
+ * cada banco da origem uma única vez e grava o mesmo buffer (e o mesmo CRC)
+ * em todos os destinos que precisam dele, cada um com seu manifesto.
+ *
+ * A gravação é transacional: cada arquivo é gravado como nome.part e
+ * renomeado ao final, e um pen drive removido no meio da cópia mantém os
+ * bancos da exportação anterior. A cada USB_EXPORT_CHECKPOINT_BYTES o
+ * .part é sincronizado e o manifesto registra o ponto de controle (bytes e
+ * CRC32C do prefixo): na próxima inserção a cópia continua de onde parou,
+ * e arquivos grandes terminam ao longo de várias inserções curtas.
+ */
+
+#ifndef USB_EXPORT_H
+#define USB_EXPORT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Configurações da cópia
+#define USB_EXPORT_DB_PREFIX "NI"                 // Bancos exportados: NI*.db
+#define USB_EXPORT_DB_SUFFIX ".db"
+#define USB_EXPORT_CHUNK_BYTES (8 * 1024 * 1024)  // Bytes por chamada de cópia (granularidade do progresso)
+#define USB_EXPORT_BUFFER_BYTES (1024 * 1024)     // Buffer do caminho read()/write()
+#define USB_EXPORT_MAX_PATH 1024
+#define USB_EXPORT_MANIFEST_FILE "manifest.txt"  // Manifesto da última exportação (no pen drive)
+#define USB_EXPORT_MANIFEST_VERSION 3             // Versões 1 (sem verificado) e 2 (sem parcial) também são lidas
+#define USB_EXPORT_VERIFY_READBACK false          // Reler do pen drive e conferir o CRC após a cópia
+#define USB_EXPORT_MAX_TARGETS 8                  // Destinos de uma cópia em leque
+#define USB_EXPORT_PART_SUFFIX ".part"            // Arquivo em gravação (renomeado ao final)
+#define USB_EXPORT_CHECKPOINT_BYTES (32ULL * 1024 * 1024)  // Ponto de controle de cópia retomável
+
+// Mecanismo usado na cópia
+typedef enum {
+    USB_EXPORT_COPY_RANGE = 0,    // copy_file_range()
+    USB_EXPORT_SENDFILE,          // sendfile()
+    USB_EXPORT_READ_WRITE         // read()/write()
+} usb_export_method_t;
+
+// Estatísticas de uma exportação
+typedef struct {
+    int files;                        // Arquivos copiados
+    int failed;                       // Arquivos com erro
+    int total_files;                  // Arquivos selecionados para cópia
+    int skipped;                      // Arquivos inalterados desde a última exportação
+    int hashed;                       // Origens relidas para comparar o CRC (mtime alterado)
+    unsigned long long bytes;         // Bytes copiados
+    unsigned long long total_bytes;   // Soma dos tamanhos dos arquivos selecionados
+    unsigned long long skipped_bytes; // Bytes não copiados (arquivos inalterados)
+    int verified;                     // Arquivos relidos do destino com CRC conferido
+    int verify_failed;                // Arquivos cuja releitura divergiu (removidos)
+    unsigned long long verify_bytes;  // Bytes relidos do destino
+    long long verify_ms;              // Tempo da releitura
+    bool verify_direct;               // Releitura com O_DIRECT (false = após descartar o cache)
+    int resumed;                      // Cópias interrompidas retomadas do ponto de controle
+    unsigned long long resumed_bytes; // Bytes já gravados em inserções anteriores (não regravados)
+    int checkpoints;                  // Pontos de controle gravados no manifesto
+    long long elapsed_ms;             // Tempo de cópia
+    long long sync_ms;                // Tempo de syncfs() no destino
+    usb_export_method_t method;       // Último mecanismo usado
+} usb_export_stats_t;
+
+// Entrada do manifesto (um arquivo no pen drive)
+typedef struct {
+    char name[256];                   // Nome do arquivo no pen drive
+    unsigned long long bytes;         // Tamanho no pen drive
+    unsigned long long src_size;      // Tamanho da origem quando exportado
+    long long src_mtime_ns;           // mtime da origem quando exportado (ns desde epoch)
+    uint32_t crc;                     // CRC32C do conteúdo gravado
+    bool verified;                    // Conteúdo relido do pen drive e conferido
+    bool partial;                     // Cópia interrompida: nome.part com bytes gravados e CRC do prefixo
+    bool seen;                        // Origem encontrada nesta exportação (não gravado)
+    bool written;                     // Gravado nesta exportação (não gravado)
+} usb_export_entry_t;
+
+// Manifesto da exportação
+typedef struct {
+    usb_export_entry_t* entries;
+    int count;
+    int capacity;
+} usb_export_manifest_t;
+
+/**
+ * @brief Progresso da cópia, chamado a cada bloco e ao fim de cada arquivo
+ * @param name Nome do arquivo em cópia
+ * @param file_bytes Bytes já copiados do arquivo
+ * @param file_size Tamanho do arquivo
+ * @param stats Totais da exportação (bytes inclui o bloco atual)
+ * @param user Dado repassado pelo chamador
+ */
+typedef void (*usb_export_progress_t)(const char* name, unsigned long long file_bytes,
+                                      unsigned long long file_size,
+                                      const usb_export_stats_t* stats, void* user);
+
+// Destino de uma cópia em leque (um pen drive)
+typedef struct {
+    const char* dir;                  // Diretório de destino (ponto de montagem)
+    usb_export_manifest_t* manifest;  // Manifesto do destino (obrigatório)
+    usb_export_progress_t progress;   // Progresso deste destino (pode ser NULL)
+    void* user;                       // Dado repassado ao callback
+    usb_export_stats_t stats;         // Estatísticas deste destino (zeradas no início)
+} usb_export_target_t;
+
+/**
+ * @brief Copia um arquivo para o caminho de destino
+ *
+ * A cópia é gravada em destino.part e renomeada para o destino apenas
+ * quando completa; se falhar, o .part é removido. Atualiza bytes,
+ * files/failed e method em stats. Com crc, a cópia passa por read()/write()
+ * e o CRC32C é calculado sobre cada bloco lido; sem crc, a cópia fica no
+ * kernel (copy_file_range/sendfile).
+ * @param src_path Arquivo de origem
+ * @param dest_path Arquivo de destino
+ * @param crc CRC32C do conteúdo copiado (NULL = não calcular)
+ * @param progress Callback de progresso (pode ser NULL)
+ * @param user Dado repassado ao callback
+ * @param stats Estatísticas acumuladas (obrigatório)
+ * @return 0 em caso de sucesso, -1 em caso de erro
+ */
+int usb_export_copy_file(const char* src_path, const char* dest_path, uint32_t* crc,
+                         usb_export_progress_t progress, void* user, usb_export_stats_t* stats);
+
+/**
+ * @brief Copia os arquivos prefixo*sufixo do diretório de origem para o destino
+ *
+ * Apenas o primeiro nível do diretório é considerado. Os tamanhos são
+ * somados antes da cópia para que o progresso total seja exato. Com
+ * manifesto, a cópia é a de usb_export_copy_dir_multi() com um destino:
+ * arquivos inalterados (ver usb_export_manifest_current) são pulados,
+ * cópias interrompidas continuam do ponto de controle e as entradas dos
+ * copiados são atualizadas.
+ * @param source_dir Diretório de origem
+ * @param dest_dir Diretório de destino
+ * @param prefix Prefixo dos nomes (ex: USB_EXPORT_DB_PREFIX)
+ * @param suffix Sufixo dos nomes (ex: USB_EXPORT_DB_SUFFIX)
+ * @param exclude Nome a ignorar (ex: banco em uso já exportado; pode ser NULL)
+ * @param manifest Manifesto do destino (NULL = cópia completa)
+ * @param progress Callback de progresso (pode ser NULL)
+ * @param user Dado repassado ao callback
+ * @param stats Estatísticas (zeradas no início; obrigatório)
+ * @return 0 se todos os arquivos foram copiados, -1 caso contrário
+ */
+int usb_export_copy_dir(const char* source_dir, const char* dest_dir,
+                        const char* prefix, const char* suffix, const char* exclude,
+                        usb_export_manifest_t* manifest,
+                        usb_export_progress_t progress, void* user, usb_export_stats_t* stats);
+
+/**
+ * @brief Copia os arquivos prefixo*sufixo da origem para vários destinos de uma vez
+ *
+ * Cada destino decide pelo próprio manifesto quais arquivos estão
+ * inalterados. Um arquivo necessário em pelo menos um destino é lido uma
+ * única vez; cada bloco tem o CRC32C calculado uma vez e é gravado em todos
+ * os destinos que precisam dele. A gravação vai para o cache de páginas e o
+ * writeback de cada pen drive corre em paralelo; erro em um destino não
+ * interrompe os demais. As entradas dos copiados são gravadas em cada manifesto.
+ *
+ * Cada destino continua do próprio ponto de controle (ver
+ * usb_export_manifest_resume): a leitura começa no menor deles e os
+ * destinos mais adiantados só recebem os bytes após o seu, conferindo que
+ * o CRC do prefixo coincide. A cada USB_EXPORT_CHECKPOINT_BYTES gravados,
+ * o ponto de controle vai para o manifesto do destino (ver
+ * usb_export_manifest_checkpoint).
+ * @param source_dir Diretório de origem
+ * @param prefix Prefixo dos nomes (ex: USB_EXPORT_DB_PREFIX)
+ * @param suffix Sufixo dos nomes (ex: USB_EXPORT_DB_SUFFIX)
+ * @param exclude Nome a ignorar (pode ser NULL)
+ * @param targets Destinos (até USB_EXPORT_MAX_TARGETS)
+ * @param count Número de destinos
+ * @return 0 se todos os arquivos foram copiados em todos os destinos, -1 caso contrário
+ */
+int usb_export_copy_dir_multi(const char* source_dir, const char* prefix, const char* suffix,
+                              const char* exclude, usb_export_target_t* targets, int count);
+
+/**
+ * @brief Remove os arquivos prefixo*sufixo do primeiro nível de um diretório
+ * @param dir Diretório
+ * @param prefix Prefixo dos nomes
+ * @param suffix Sufixo dos nomes
+ * @return Número de arquivos removidos, ou -1 se o diretório não pôde ser aberto
+ */
+int usb_export_remove_files(const char* dir, const char* prefix, const char* suffix);
+
+/**
+ * @brief Sincroniza apenas o sistema de arquivos que contém o caminho
+ * @param path Arquivo ou diretório no sistema de arquivos (ex: ponto de montagem)
+ * @return 0 em caso de sucesso, -1 em caso de erro
+ */
+int usb_export_sync(const char* path);
+
+/**
+ * @brief Carrega o manifesto gravado no diretório
+ * @param dir Diretório de destino (ponto de montagem do pen drive)
+ * @param manifest Manifesto a preencher (vazio se ausente ou de outra versão)
+ * @return true se um manifesto válido foi carregado, false caso contrário
+ */
+bool usb_export_manifest_load(const char* dir, usb_export_manifest_t* manifest);
+
+/**
+ * @brief Grava o manifesto no diretório (arquivo temporário + rename)
+ * @param dir Diretório de destino
+ * @param manifest Manifesto
+ * @return 0 em caso de sucesso, -1 em caso de erro
+ */
+int usb_export_manifest_save(const char* dir, const usb_export_manifest_t* manifest);
+
+/**
+ * @brief Libera as entradas do manifesto
+ */
+void usb_export_manifest_free(usb_export_manifest_t* manifest);
+
+/**
+ * @brief Procura a entrada de um arquivo
+ * @return Entrada ou NULL se o nome não está no manifesto
+ */
+usb_export_entry_t* usb_export_manifest_find(usb_export_manifest_t* manifest, const char* name);
+
+/**
+ * @brief Grava ou substitui a entrada de um arquivo (marcada como vista)
+ *
+ * seen e written são copiados da entrada informada; seen é sempre marcado.
+ * @return 0 em caso de sucesso, -1 em caso de erro de alocação
+ */
+int usb_export_manifest_set(usb_export_manifest_t* manifest, const usb_export_entry_t* entry);
+
+/**
+ * @brief Remove a entrada de um arquivo, se existir
+ */
+void usb_export_manifest_remove(usb_export_manifest_t* manifest, const char* name);
+
+/**
+ * @brief Verifica se a cópia no destino ainda corresponde à origem
+ *
+ * A cópia é atual quando o arquivo no destino tem o tamanho registrado e a
+ * origem mantém tamanho e mtime. Se apenas o mtime mudou, a origem é relida
+ * e comparada pelo CRC32C (o mtime registrado é então atualizado).
+ * @param manifest Manifesto do destino
+ * @param dest_dir Diretório de destino
+ * @param name Nome do arquivo no destino
+ * @param src_path Caminho da origem usada no CRC (NULL = sem releitura)
+ * @param src_size Tamanho atual da origem
+ * @param src_mtime_ns mtime atual da origem (ns desde epoch)
+ * @param stats Estatísticas (hashed é incrementado; pode ser NULL)
+ * @return true se a cópia pode ser mantida, false se deve ser refeita
+ */
+bool usb_export_manifest_current(usb_export_manifest_t* manifest, const char* dest_dir,
+                                 const char* name, const char* src_path,
+                                 unsigned long long src_size, long long src_mtime_ns,
+                                 usb_export_stats_t* stats);
+
+/**
+ * @brief Ponto de retomada de uma cópia interrompida
+ *
+ * Há retomada quando o manifesto tem a entrada parcial do arquivo, a origem
+ * mantém tamanho e mtime e nome.part no destino tem ao menos os bytes do
+ * ponto de controle (gravados com fdatasync antes de registrados); o .part
+ * é truncado no ponto de controle. Com USB_EXPORT_VERIFY_READBACK, o
+ * prefixo é relido do pen drive e conferido pelo CRC. Sem retomada, a
+ * entrada parcial e o .part são descartados.
+ * @param manifest Manifesto do destino
+ * @param dest_dir Diretório de destino
+ * @param name Nome do arquivo no destino
+ * @param src_size Tamanho atual da origem
+ * @param src_mtime_ns mtime atual da origem (ns desde epoch)
+ * @param crc CRC32C do prefixo já gravado
+ * @param stats Estatísticas (resumed e resumed_bytes; pode ser NULL)
+ * @return Bytes já gravados (0 = copiar desde o início)
+ */
+unsigned long long usb_export_manifest_resume(usb_export_manifest_t* manifest, const char* dest_dir,
+                                              const char* name, unsigned long long src_size,
+                                              long long src_mtime_ns, uint32_t* crc,
+                                              usb_export_stats_t* stats);
+
+/**
+ * @brief Registra o ponto de controle de uma cópia em andamento
+ *
+ * Sincroniza o .part (fdatasync) e só então grava a entrada parcial no
+ * manifesto do destino: o ponto registrado nunca está à frente dos dados.
+ * @param dir Diretório de destino
+ * @param manifest Manifesto do destino
+ * @param fd Descritor do nome.part
+ * @param partial Entrada com nome, bytes gravados, CRC do prefixo e origem
+ * @return 0 em caso de sucesso, -1 em caso de erro (pen drive removido)
+ */
+int usb_export_manifest_checkpoint(const char* dir, usb_export_manifest_t* manifest, int fd,
+                                   const usb_export_entry_t* partial);
+
+/**
+ * @brief Renomeia nome.part para o nome final (cópia completa)
+ * @return 0 em caso de sucesso, -1 em caso de erro
+ */
+int usb_export_commit_part(const char* dest_dir, const char* name);
+
+/**
+ * @brief Remove do destino os arquivos prefixo*sufixo que não foram exportados
+ *
+ * Entradas não vistas nesta exportação (origem removida pela retenção ou
+ * consolidada) saem do manifesto, e arquivos fora do manifesto são
+ * removidos, exceto keep (ex: snapshot do banco em uso, que não é cópia fiel
+ * da origem; o chamador grava sua entrada depois da poda). Arquivos .part
+ * sem entrada parcial (cópia sem ponto de controle) também são removidos.
+ * @return Número de arquivos removidos, ou -1 se o diretório não pôde ser aberto
+ */
+int usb_export_manifest_prune(usb_export_manifest_t* manifest, const char* dest_dir,
+                              const char* prefix, const char* suffix, const char* keep);
+
+/**
+ * @brief Relê os arquivos gravados nesta exportação e confere o CRC32C
+ *
+ * Cada arquivo é lido com O_DIRECT, direto do dispositivo; se o sistema de
+ * arquivos não aceitar, os dados são sincronizados, as páginas descartadas
+ * do cache e o arquivo lido normalmente. Arquivos divergentes são removidos
+ * do destino e do manifesto (serão copiados na próxima exportação).
+ * @param manifest Manifesto do destino
+ * @param dest_dir Diretório de destino
+ * @param stats Estatísticas (verified, verify_failed, verify_bytes, verify_ms)
+ * @return Número de arquivos divergentes
+ */
+int usb_export_manifest_verify(usb_export_manifest_t* manifest, const char* dest_dir,
+                               usb_export_stats_t* stats);
+
+/**
+ * @brief Relê um arquivo do dispositivo e confere tamanho e CRC32C
+ * @param path Caminho do arquivo
+ * @param crc CRC esperado
+ * @param bytes Tamanho esperado
+ * @param direct Indica se a leitura usou O_DIRECT (pode ser NULL)
+ * @return 0 se confere, -1 se diverge ou em caso de erro
+ */
+int usb_export_verify_file(const char* path, uint32_t crc, unsigned long long bytes, bool* direct);
+
+/**
+ * @brief CRC32C (Castagnoli) incremental
+ * @param crc Valor anterior (0 no início)
+ * @param data Dados
+ * @param len Tamanho dos dados
+ * @return CRC atualizado
+ */
+uint32_t usb_export_crc32c(uint32_t crc, const void* data, size_t len);
+
+/**
+ * @brief Calcula o CRC32C de um arquivo
+ * @param path Caminho do arquivo
+ * @param crc CRC calculado
+ * @param bytes Bytes lidos (pode ser NULL)
+ * @return 0 em caso de sucesso, -1 em caso de erro
+ */
+int usb_export_crc_file(const char* path, uint32_t* crc, unsigned long long* bytes);
+
+/**
+ * @brief Nome legível do mecanismo de cópia
+ */
+const char* usb_export_method_name(usb_export_method_t method);
+
+#endif // USB_EXPORT_H
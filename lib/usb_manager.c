@@ -3,31 +3,51 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <sys/stat.h>
 #include <sys/statvfs.h>
 #include <errno.h>
 #include <time.h>
 #include <libudev.h>
-#include <mntent.h>
 #include <sys/mount.h>
-#include <gpiod.h>
+#include <dirent.h>
+#include <poll.h>
+#include <stdint.h>
+#include <sys/eventfd.h>
+#include <pthread.h>
+#include "log_archive.h"
+#include "usb_export.h"
+#include "usb_mount.h"
+#include "gpio_signal.h"
 
 // Definir MNT_FORCE se não estiver definido
 #ifndef MNT_FORCE
 #define MNT_FORCE 1
 #endif
 
-// Configurações do buzzer
-#define BUZZER_GPIO 23
-#define GPIO_CHIP_NAME "gpiochip0"
+// Configurações do monitoramento de pen drives
+#define USB_POLL_INTERVAL_SECONDS 3      // Enumeração periódica (apenas sem monitor udev)
+#define USB_POLL_SETTLE_SECONDS 2        // Espera após detecção por enumeração
+#define USB_MONITOR_STOP_CHECK_MS 1000   // Verificação da flag running sem eventfd
+#define USB_BATCH_WINDOW_MS 1000         // Espera por outros pen drives inseridos junto com o primeiro
+#define USB_MAX_DEVICES 5                // Pen drives extraídos simultaneamente
+#define USB_MAX_MOUNT_ENTRIES 256        // Entradas da tabela de montagens lidas em force_unmount_all_usb
 
 // Estrutura usb_device_info_t definida no header
 
 // Variáveis globais
 static struct udev *udev_context = NULL;
-static usb_device_info_t current_usb = {0};
-static struct gpiod_chip *gpio_chip = NULL;
-static struct gpiod_line *buzzer_line = NULL;
+static usb_export_hooks_t export_hooks = {0};
+static int monitor_wake_fd = -1;  // eventfd que interrompe a espera do monitor
+
+/**
+ * @brief Tempo monotônico em milissegundos
+ */
+static long long monotonic_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
 
 // Função para inicializar o contexto udev
 int usb_manager_init(void) {
@@ -55,6 +75,7 @@ int usb_manager_init(void) {
 void usb_manager_cleanup(void) {
     // Finalizar buzzer
     buzzer_cleanup();
+    usb_mount_table_cleanup();
 
     if (udev_context) {
         udev_unref(udev_context);
@@ -63,28 +84,17 @@ void usb_manager_cleanup(void) {
     }
 }
 
-// Função para verificar se um dispositivo está montado
+// Função para verificar se um dispositivo está montado (consulta o cache da tabela de montagens)
 static bool is_device_mounted(const char* device_path, char* mount_point, size_t mount_point_size) {
-    FILE *fp = fopen("/proc/mounts", "r");
-    if (!fp) {
-        printf("Erro ao abrir /proc/mounts\n");
+    usb_mount_entry_t entry;
+    if (!usb_mount_table_find_device(device_path, &entry)) {
         return false;
     }
-
-    struct mntent *entry;
-    while ((entry = getmntent(fp)) != NULL) {
-        if (strcmp(entry->mnt_fsname, device_path) == 0) {
-            if (mount_point && mount_point_size > 0) {
-                strncpy(mount_point, entry->mnt_dir, mount_point_size - 1);
-                mount_point[mount_point_size - 1] = '\0';
-            }
-            fclose(fp);
-            return true;
-        }
+    if (mount_point && mount_point_size > 0) {
+        strncpy(mount_point, entry.mount_point, mount_point_size - 1);
+        mount_point[mount_point_size - 1] = '\0';
     }
-
-    fclose(fp);
-    return false;
+    return true;
 }
 
 // Função para criar ponto de montagem
@@ -111,32 +121,29 @@ static int create_mount_point(const char* mount_point) {
 }
 
 // Função para montar dispositivo USB
-static int mount_usb_device(const char* device_path, const char* mount_point) {
-    printf("Tentando montar %s em %s\n", device_path, mount_point);
+// O sistema de arquivos vem do udev (fs_type preenchido) ou do superbloco: montagem na primeira tentativa
+static int mount_usb_device(usb_device_info_t* device_info) {
+    printf("Tentando montar %s em %s\n", device_info->device_path, device_info->mount_point);
 
     // Criar ponto de montagem se não existir
-    if (create_mount_point(mount_point) != 0) {
+    if (create_mount_point(device_info->mount_point) != 0) {
         return -1;
     }
 
-    // Tentar montagem com diferentes sistemas de arquivos
-    const char* fs_types[] = {"vfat", "exfat", "ntfs", "ext4", "ext3", "ext2", NULL};
-    
-    for (int i = 0; fs_types[i] != NULL; i++) {
-        printf("Tentando montar como %s...\n", fs_types[i]);
-        
-        if (mount(device_path, mount_point, fs_types[i], MS_NOATIME, NULL) == 0) {
-            printf("USB montado com sucesso como %s\n", fs_types[i]);
-            strncpy(current_usb.fs_type, fs_types[i], sizeof(current_usb.fs_type) - 1);
-            current_usb.fs_type[sizeof(current_usb.fs_type) - 1] = '\0';
-            return 0;
-        }
-        
-        printf("Falha ao montar como %s: %s\n", fs_types[i], strerror(errno));
+    usb_mount_result_t mounted;
+    int result = usb_mount_device(device_info->device_path, device_info->mount_point,
+                                  usb_mount_fs_from_name(device_info->fs_type), &mounted);
+    device_info->mount_ms = mounted.mount_ms;
+    if (result != 0) {
+        printf("Erro: Não foi possível montar o dispositivo USB\n");
+        return -1;
     }
 
-    printf("Erro: Não foi possível montar o dispositivo USB\n");
-    return -1;
+    snprintf(device_info->fs_type, sizeof(device_info->fs_type), "%s", mounted.driver);
+    printf("📁 USB montado como %s em %lld ms (%s, %d tentativa%s%s)\n",
+           mounted.driver, mounted.mount_ms, mounted.source, mounted.attempts,
+           mounted.attempts > 1 ? "s" : "", mounted.options ? ", opções de gravação em lote" : "");
+    return 0;
 }
 
 // Função para obter informações do dispositivo usando udev
@@ -189,6 +196,50 @@ static int get_device_info(const char* device_path, usb_device_info_t* info) {
     return 0;
 }
 
+// Verifica se uma partição pertence a um dispositivo USB removível e preenche info
+static bool usb_partition_info(struct udev_device* dev, usb_device_info_t* info) {
+    // Verificar se é um dispositivo USB removível
+    struct udev_device *parent = udev_device_get_parent_with_subsystem_devtype(dev, "usb", "usb_device");
+    if (!parent) {
+        return false;
+    }
+
+    // Verificar se é removível
+    const char *removable = udev_device_get_sysattr_value(dev, "removable");
+    if (!removable || strcmp(removable, "1") != 0) {
+        // Verificar no dispositivo pai
+        struct udev_device *block_parent = udev_device_get_parent_with_subsystem_devtype(dev, "block", "disk");
+        if (block_parent) {
+            removable = udev_device_get_sysattr_value(block_parent, "removable");
+        }
+    }
+
+    const char *devnode = udev_device_get_devnode(dev);
+    if (!removable || strcmp(removable, "1") != 0 || !devnode) {
+        return false;
+    }
+
+    memset(info, 0, sizeof(usb_device_info_t));
+    strncpy(info->device_path, devnode, sizeof(info->device_path) - 1);
+    info->device_path[sizeof(info->device_path) - 1] = '\0';
+
+    // Verificar se já está montado
+    info->is_mounted = is_device_mounted(devnode, info->mount_point, sizeof(info->mount_point));
+
+    // Sistema de arquivos identificado pelo udev (blkid): a montagem não precisa adivinhar
+    const char* fs_type = udev_device_get_property_value(dev, "ID_FS_TYPE");
+    if (fs_type) {
+        snprintf(info->fs_type, sizeof(info->fs_type), "%s", fs_type);
+    }
+
+    // Obter informações adicionais
+    get_device_info(devnode, info);
+
+    printf("USB encontrado: %s (%s %s, %lu MB)\n",
+           devnode, info->vendor, info->model, info->size_mb);
+    return true;
+}
+
 // Função para detectar dispositivos USB removíveis
 int detect_usb_devices(usb_device_info_t* devices, int max_devices) {
     if (!udev_context) {
@@ -223,43 +274,8 @@ int detect_usb_devices(usb_device_info_t* devices, int max_devices) {
             continue;
         }
 
-        // Verificar se é um dispositivo USB removível
-        struct udev_device *parent = udev_device_get_parent_with_subsystem_devtype(dev, "usb", "usb_device");
-        if (!parent) {
-            udev_device_unref(dev);
-            continue;
-        }
-
-        // Verificar se é removível
-        const char *removable = udev_device_get_sysattr_value(dev, "removable");
-        if (!removable || strcmp(removable, "1") != 0) {
-            // Verificar no dispositivo pai
-            struct udev_device *block_parent = udev_device_get_parent_with_subsystem_devtype(dev, "block", "disk");
-            if (block_parent) {
-                removable = udev_device_get_sysattr_value(block_parent, "removable");
-            }
-        }
-
-        if (removable && strcmp(removable, "1") == 0) {
-            const char *devnode = udev_device_get_devnode(dev);
-            if (devnode) {
-                usb_device_info_t *info = &devices[device_count];
-                memset(info, 0, sizeof(usb_device_info_t));
-                
-                strncpy(info->device_path, devnode, sizeof(info->device_path) - 1);
-                info->device_path[sizeof(info->device_path) - 1] = '\0';
-                
-                // Verificar se já está montado
-                info->is_mounted = is_device_mounted(devnode, info->mount_point, sizeof(info->mount_point));
-                
-                // Obter informações adicionais
-                get_device_info(devnode, info);
-                
-                printf("USB encontrado: %s (%s %s, %lu MB)\n", 
-                       devnode, info->vendor, info->model, info->size_mb);
-                
-                device_count++;
-            }
+        if (usb_partition_info(dev, &devices[device_count])) {
+            device_count++;
         }
 
         udev_device_unref(dev);
@@ -293,7 +309,7 @@ int mount_usb_device_auto(usb_device_info_t* device_info) {
     }
 
     // Tentar montar
-    if (mount_usb_device(device_info->device_path, device_info->mount_point) == 0) {
+    if (mount_usb_device(device_info) == 0) {
         device_info->is_mounted = true;
 
         // Verificar espaço disponível
@@ -317,8 +333,8 @@ int unmount_usb_device(const char* mount_point) {
 
     printf("Desmontando USB: %s\n", mount_point);
 
-    // Forçar sincronização antes da desmontagem
-    sync();
+    // Sincronizar apenas o sistema de arquivos do pen drive antes da desmontagem
+    usb_export_sync(mount_point);
     usleep(100000); // 100ms
 
     // Tentar desmontagem normal primeiro
@@ -464,8 +480,11 @@ int copy_log_to_usb(const usb_device_info_t* usb_device, const char* log_file_pa
     size_t bytes_read;
     size_t total_copied = 0;
     int last_progress = 20;
+    uint32_t crc = 0;
 
     while ((bytes_read = fread(buffer, 1, sizeof(buffer), src)) > 0) {
+        crc = usb_export_crc32c(crc, buffer, bytes_read);
+
         if (fwrite(buffer, 1, bytes_read, dst) != bytes_read) {
             const char* error_msg = "Erro durante a escrita no USB";
             printf("Erro: %s\n", error_msg);
@@ -520,7 +539,19 @@ int copy_log_to_usb(const usb_device_info_t* usb_device, const char* log_file_pa
         return USB_ERROR_COPY_FAILED;
     }
 
-    printf("Arquivo copiado com sucesso: %s (%ld bytes)\n", dest_file_path, file_size);
+    // Releitura opcional do pen drive, conferindo o CRC calculado durante a cópia
+    if (USB_EXPORT_VERIFY_READBACK &&
+        usb_export_verify_file(dest_file_path, crc, (unsigned long long)file_size, NULL) != 0) {
+        const char* error_msg = "Arquivo copiado com conteúdo divergente";
+        printf("Erro: %s\n", error_msg);
+        unlink(dest_file_path);
+        if (callbacks && callbacks->on_error) {
+            callbacks->on_error(USB_ERROR_COPY_FAILED, error_msg);
+        }
+        return USB_ERROR_COPY_FAILED;
+    }
+
+    printf("Arquivo copiado com sucesso: %s (%ld bytes, crc32c %08x)\n", dest_file_path, file_size, crc);
 
     if (callbacks && callbacks->on_complete) {
         char success_msg[256];
@@ -667,19 +698,9 @@ int cleanup_orphaned_mount_points(void) {
             continue; // Diretório não existe
         }
 
-        // Verificar se está montado
-        bool is_mounted = false;
-        FILE *fp = fopen("/proc/mounts", "r");
-        if (fp) {
-            char line[512];
-            while (fgets(line, sizeof(line), fp)) {
-                if (strstr(line, mount_point)) {
-                    is_mounted = true;
-                    break;
-                }
-            }
-            fclose(fp);
-        }
+        // Verificar se está montado (ponto exato: /media/usb não casa com /media/usb_sda1)
+        bool is_mounted = usb_mount_table_find_mount_point(mount_point, NULL);
+        bool unmounted = false;
 
         if (is_mounted) {
             // Tentar desmontar
@@ -687,13 +708,14 @@ int cleanup_orphaned_mount_points(void) {
             if (umount(mount_point) == 0) {
                 printf("Desmontado com sucesso: %s\n", mount_point);
                 cleaned_count++;
+                unmounted = true;
             } else {
                 printf("Erro ao desmontar %s: %s\n", mount_point, strerror(errno));
             }
         }
 
         // Verificar se o diretório está vazio e removê-lo
-        if (!is_mounted || umount(mount_point) == 0) {
+        if (!is_mounted || unmounted) {
             if (rmdir(mount_point) == 0) {
                 printf("Diretório removido: %s\n", mount_point);
             } else if (errno != ENOENT) {
@@ -711,9 +733,11 @@ int force_unmount_all_usb(void) {
     printf("Forçando desmontagem de todos os dispositivos USB...\n");
 
     int unmounted_count = 0;
-    FILE *fp = fopen("/proc/mounts", "r");
-    if (!fp) {
-        printf("Erro ao abrir /proc/mounts\n");
+    usb_mount_entry_t* entries = malloc(USB_MAX_MOUNT_ENTRIES * sizeof(*entries));
+    int entry_count = entries ? usb_mount_table_entries(entries, USB_MAX_MOUNT_ENTRIES) : -1;
+    if (entry_count < 0) {
+        printf("Erro ao ler a tabela de montagens\n");
+        free(entries);
         return -1;
     }
 
@@ -721,22 +745,20 @@ int force_unmount_all_usb(void) {
     int mount_count = 0;
 
     // Primeiro, coletar todos os pontos de montagem USB
-    char line[512];
-    while (fgets(line, sizeof(line), fp) && mount_count < 20) {
-        char device[256], mount_point[256], fs_type[32];
-
-        if (sscanf(line, "%255s %255s %31s", device, mount_point, fs_type) == 3) {
-            // Verificar se é um ponto de montagem USB típico
-            if (strstr(mount_point, "/media/usb") ||
-                (strstr(device, "/dev/sd") && strstr(mount_point, "/media/"))) {
-                strncpy(mount_points[mount_count], mount_point, sizeof(mount_points[mount_count]) - 1);
-                mount_points[mount_count][sizeof(mount_points[mount_count]) - 1] = '\0';
-                mount_count++;
-                printf("Encontrado ponto de montagem USB: %s\n", mount_point);
-            }
+    for (int i = 0; i < entry_count && mount_count < 20; i++) {
+        const char* device = entries[i].device;
+        const char* mount_point = entries[i].mount_point;
+
+        // Verificar se é um ponto de montagem USB típico
+        if (strstr(mount_point, "/media/usb") ||
+            (strstr(device, "/dev/sd") && strstr(mount_point, "/media/"))) {
+            strncpy(mount_points[mount_count], mount_point, sizeof(mount_points[mount_count]) - 1);
+            mount_points[mount_count][sizeof(mount_points[mount_count]) - 1] = '\0';
+            mount_count++;
+            printf("Encontrado ponto de montagem USB: %s\n", mount_point);
         }
     }
-    fclose(fp);
+    free(entries);
 
     // Agora desmontar todos os pontos encontrados
     for (int i = 0; i < mount_count; i++) {
@@ -768,269 +790,1096 @@ int force_unmount_all_usb(void) {
     return unmounted_count;
 }
 
+// Extração em andamento: dados compartilhados pelos pen drives atendidos juntos
+typedef struct {
+    const char* source_dir;
+    const usb_callbacks_t* callbacks;
+    int count;                                    // Pen drives do lote
+    char live_name[256];                          // Snapshot do banco em uso ("" sem gancho)
+    char csv_name[256];                           // Planilha CSV dos registros ("" sem gancho)
+    usb_export_target_t targets[USB_MAX_DEVICES]; // Destinos da cópia em leque (pen drives montados)
+} usb_batch_t;
+
+// Sessão de extração de um pen drive (uma thread por pen drive na montagem e finalização)
+typedef struct {
+    usb_device_info_t device;
+    usb_batch_t* batch;
+    char prefix[64];                  // Prefixo das mensagens ("" com um único pen drive)
+    usb_export_manifest_t manifest;   // Manifesto da exportação anterior neste pen drive
+    usb_export_target_t* target;      // Destino na cópia em leque (estatísticas da cópia)
+    bool active;                      // Montado e participando da cópia
+    bool incremental;                 // Manifesto anterior encontrado
+    int archived;                     // Segmentos arquivados (bancos e TXT) descompactados neste pen drive
+    usb_export_entry_t live;          // Entrada do snapshot do banco em uso
+    bool has_live;
+    int copy_result;                  // 0 se todos os bancos foram gravados
+    int result;                       // Resultado final (USB_SUCCESS ou código de erro)
+} usb_session_t;
+
 /**
- * @brief Extração automática completa de todos os logs para USB
+ * @brief Prefixo das mensagens de um pen drive (ex: "[sdb1] "), vazio se for o único
  */
-int usb_auto_extract_all_logs(const char* source_dir, const usb_callbacks_t* callbacks) {
-    if (!source_dir) {
-        if (callbacks && callbacks->on_error) {
-            callbacks->on_error(USB_ERROR_INVALID_PARAM, "Diretório de origem inválido");
-        }
-        return USB_ERROR_INVALID_PARAM;
+static void device_prefix(const usb_device_info_t* device, int count, char* out, size_t out_size) {
+    const char* name = strrchr(device->device_path, '/');
+    if (count > 1) {
+        snprintf(out, out_size, "[%s] ", name ? name + 1 : device->device_path);
+    } else {
+        out[0] = '\0';
+    }
+}
+
+/**
+ * @brief Mensagem com o prefixo do pen drive da sessão
+ */
+static const char* session_text(const usb_session_t* session, const char* message,
+                                char* buffer, size_t buffer_size) {
+    if (!session->prefix[0]) {
+        return message;
     }
+    snprintf(buffer, buffer_size, "%s%s", session->prefix, message);
+    return buffer;
+}
 
+static void session_progress(const usb_session_t* session, int percentage, const char* message) {
+    const usb_callbacks_t* callbacks = session->batch->callbacks;
     if (callbacks && callbacks->on_progress) {
-        callbacks->on_progress(10, "Detectando dispositivos USB...");
+        char text[320];
+        callbacks->on_progress(percentage, session_text(session, message, text, sizeof(text)));
     }
+}
 
-    // Detectar dispositivos USB
-    usb_device_info_t devices[5];
-    int device_count = detect_usb_devices(devices, 5);
+static void session_error(const usb_session_t* session, usb_result_t error, const char* message) {
+    const usb_callbacks_t* callbacks = session->batch->callbacks;
+    if (callbacks && callbacks->on_error) {
+        char text[320];
+        callbacks->on_error(error, session_text(session, message, text, sizeof(text)));
+    }
+}
 
-    if (device_count <= 0) {
-        if (callbacks && callbacks->on_error) {
-            callbacks->on_error(USB_ERROR_NOT_FOUND, "Nenhum dispositivo USB encontrado");
+// Destino da descompactação: CRC32C calculado uma vez, bloco gravado em cada pen drive
+// a partir do seu ponto de retomada
+typedef struct {
+    usb_session_t** sessions;
+    const char* name;                              // Segmento no pen drive (sem .gz)
+    unsigned long long gz_size;
+    long long gz_mtime_ns;
+    int fds[USB_MAX_DEVICES];
+    bool failed[USB_MAX_DEVICES];
+    char part_paths[USB_MAX_DEVICES][1024];
+    unsigned long long resume[USB_MAX_DEVICES];     // Bytes já gravados em inserções anteriores
+    uint32_t resume_crc[USB_MAX_DEVICES];
+    unsigned long long checkpoint[USB_MAX_DEVICES]; // Bytes no último ponto de controle
+    int count;
+    int open_count;
+    unsigned long long offset;                     // Bytes descompactados até aqui
+    uint32_t crc;
+    bool resumable;                                // Grava pontos de controle no manifesto
+} archive_sink_t;
+
+/**
+ * @brief Tira um pen drive da descompactação; keep mantém o .part (ponto de controle registrado)
+ */
+static void archive_drop(archive_sink_t* sink, int i, bool keep) {
+    close(sink->fds[i]);
+    sink->fds[i] = -1;
+    sink->failed[i] = true;
+    sink->open_count--;
+    if (!keep) {
+        unlink(sink->part_paths[i]);
+        usb_export_manifest_remove(&sink->sessions[i]->manifest, sink->name);
+    }
+}
+
+static int write_archive_chunk(const void* data, size_t len, void* user) {
+    archive_sink_t* sink = user;
+    const char* p = data;
+
+    while (len > 0) {
+        // Segmento até o próximo ponto de retomada, onde o CRC do prefixo é conferido
+        size_t seg = len;
+        for (int i = 0; i < sink->count; i++) {
+            if (sink->fds[i] >= 0 && sink->resume[i] > sink->offset && sink->resume[i] - sink->offset < seg) {
+                seg = (size_t)(sink->resume[i] - sink->offset);
+            }
         }
-        return USB_ERROR_NOT_FOUND;
+        sink->crc = usb_export_crc32c(sink->crc, p, seg);
+        sink->offset += seg;
+
+        for (int i = 0; i < sink->count; i++) {
+            if (sink->fds[i] < 0 || sink->offset < sink->resume[i]) {
+                continue;
+            }
+            if (sink->offset == sink->resume[i]) {
+                if (sink->crc != sink->resume_crc[i]) {
+                    printf("Erro: %s no pen drive diverge do arquivo, será extraído de novo\n",
+                           sink->part_paths[i]);
+                    archive_drop(sink, i, false);
+                }
+                continue;
+            }
+
+            // Erro em um pen drive não interrompe os demais
+            usb_session_t* session = sink->sessions[i];
+            const char* q = p;
+            size_t left = seg;
+            while (left > 0) {
+                ssize_t n = write(sink->fds[i], q, left);
+                if (n < 0) {
+                    if (errno == EINTR) continue;
+                    break;
+                }
+                q += n;
+                left -= (size_t)n;
+            }
+            if (left > 0) {
+                archive_drop(sink, i, sink->checkpoint[i] > 0);
+                continue;
+            }
+            session->target->stats.bytes += seg;
+
+            // Ponto de controle: a próxima inserção continua daqui
+            if (sink->resumable && sink->offset - sink->checkpoint[i] >= USB_EXPORT_CHECKPOINT_BYTES) {
+                usb_export_entry_t partial;
+                memset(&partial, 0, sizeof(partial));
+                snprintf(partial.name, sizeof(partial.name), "%s", sink->name);
+                partial.bytes = sink->offset;
+                partial.src_size = sink->gz_size;
+                partial.src_mtime_ns = sink->gz_mtime_ns;
+                partial.crc = sink->crc;
+                if (usb_export_manifest_checkpoint(session->device.mount_point, &session->manifest,
+                                                   sink->fds[i], &partial) != 0) {
+                    archive_drop(sink, i, sink->checkpoint[i] > 0);
+                    continue;
+                }
+                sink->checkpoint[i] = sink->offset;
+                session->target->stats.checkpoints++;
+            }
+        }
+
+        p += seg;
+        len -= seg;
     }
+    return sink->open_count > 0 ? 0 : -1;
+}
 
-    // Usar o primeiro dispositivo encontrado
-    usb_device_info_t* usb_device = &devices[0];
+// Função para descompactar segmentos arquivados (NI*.db.gz e NI*.txt.gz) diretamente nos pen drives
+// O arquivador apaga o original depois de compactar, então o histórico TXT só chega ao
+// pen drive por aqui. Os .gz não mudam depois de gravados: com manifesto, os já extraídos
+// são pulados e extrações interrompidas continuam do ponto de controle (o início é
+// descompactado de novo, mas não regravado). Cada .gz é descompactado uma vez, para
+// todos os pen drives que precisam dele
+static void extract_archived_segments(const char* source_dir, usb_session_t** sessions, int count) {
+    char archive_dir[512];
+    snprintf(archive_dir, sizeof(archive_dir), "%s/%s", source_dir, LOG_ARCHIVE_DIR_NAME);
+
+    DIR *dir = opendir(archive_dir);
+    if (!dir) {
+        return;
+    }
 
-    if (callbacks && callbacks->on_progress) {
-        callbacks->on_progress(20, "Montando dispositivo USB...");
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        size_t len = strlen(entry->d_name);
+        if (strncmp(entry->d_name, "NI", 2) != 0 ||
+            !((len > 6 && strcmp(entry->d_name + len - 6, ".db.gz") == 0) ||
+              (len > 7 && strcmp(entry->d_name + len - 7, ".txt.gz") == 0))) {
+            continue;
+        }
+
+        char gz_path[1024];
+        char dest_name[256];
+        struct stat gz_st;
+        snprintf(gz_path, sizeof(gz_path), "%s/%s", archive_dir, entry->d_name);
+        snprintf(dest_name, sizeof(dest_name), "%.*s", (int)(len - 3), entry->d_name);
+        if (stat(gz_path, &gz_st) != 0) {
+            continue;
+        }
+
+        bool needed[USB_MAX_DEVICES];
+        bool any_needed = false;
+        archive_sink_t sink;
+        memset(&sink, 0, sizeof(sink));
+        sink.sessions = sessions;
+        sink.name = dest_name;
+        sink.gz_size = (unsigned long long)gz_st.st_size;
+        sink.gz_mtime_ns = (long long)gz_st.st_mtim.tv_sec * 1000000000LL + gz_st.st_mtim.tv_nsec;
+        sink.count = count;
+        sink.resumable = true;
+
+        for (int i = 0; i < count; i++) {
+            usb_session_t* session = sessions[i];
+            usb_export_stats_t* stats = &session->target->stats;
+            const char* mount_point = session->device.mount_point;
+            sink.fds[i] = -1;
+            needed[i] = false;
+
+            if (usb_export_manifest_current(&session->manifest, mount_point, dest_name, NULL,
+                                            sink.gz_size, sink.gz_mtime_ns, NULL)) {
+                usb_export_entry_t* current = usb_export_manifest_find(&session->manifest, dest_name);
+                stats->skipped++;
+                stats->skipped_bytes += current->bytes;
+                continue;
+            }
+
+            // Gravação em .part; extração interrompida continua do ponto de controle
+            snprintf(sink.part_paths[i], sizeof(sink.part_paths[i]), "%s/%s%s", mount_point, dest_name,
+                     USB_EXPORT_PART_SUFFIX);
+            sink.resume[i] = usb_export_manifest_resume(&session->manifest, mount_point, dest_name,
+                                                        sink.gz_size, sink.gz_mtime_ns,
+                                                        &sink.resume_crc[i], stats);
+            sink.checkpoint[i] = sink.resume[i];
+            needed[i] = true;
+            any_needed = true;
+            if (sink.resume[i] > 0) {
+                sink.fds[i] = open(sink.part_paths[i], O_WRONLY | O_CLOEXEC);
+                if (sink.fds[i] >= 0 && lseek(sink.fds[i], (off_t)sink.resume[i], SEEK_SET) < 0) {
+                    close(sink.fds[i]);
+                    sink.fds[i] = -1;
+                }
+            } else {
+                usb_export_manifest_remove(&session->manifest, dest_name);
+                sink.fds[i] = open(sink.part_paths[i], O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            }
+            if (sink.fds[i] < 0) {
+                sink.failed[i] = true;
+            } else {
+                sink.open_count++;
+            }
+        }
+        if (!any_needed) {
+            continue;
+        }
+
+        // CRC calculado sobre os blocos descompactados, durante a gravação
+        unsigned long long bytes = 0;
+        int result = sink.open_count > 0 ? log_archive_decompress_to(gz_path, write_archive_chunk, &sink,
+                                                                     &bytes) : -1;
+
+        for (int i = 0; i < count; i++) {
+            if (!needed[i]) {
+                continue;
+            }
+
+            usb_session_t* session = sessions[i];
+            const char* mount_point = session->device.mount_point;
+            if (sink.fds[i] >= 0 && (result != 0 || sink.offset != bytes)) {
+                archive_drop(&sink, i, false);  // Erro no arquivo: o ponto de controle não vale mais
+            }
+            bool ok = !sink.failed[i];
+            if (ok && close(sink.fds[i]) != 0) {
+                ok = false;
+            }
+            if (ok && usb_export_commit_part(mount_point, dest_name) != 0) {
+                ok = false;
+            }
+            if (!ok) {
+                printf("Erro ao extrair segmento arquivado: %s (%s)\n", entry->d_name, mount_point);
+                session->copy_result = -1;
+                continue;
+            }
+            session->archived++;
+
+            usb_export_entry_t archived;
+            memset(&archived, 0, sizeof(archived));
+            snprintf(archived.name, sizeof(archived.name), "%s", dest_name);
+            archived.bytes = bytes;
+            archived.src_size = sink.gz_size;
+            archived.src_mtime_ns = sink.gz_mtime_ns;
+            archived.crc = sink.crc;
+            archived.written = true;
+            usb_export_manifest_set(&session->manifest, &archived);
+        }
+    }
+
+    closedir(dir);
+}
+
+/**
+ * @brief Extração automática completa de todos os logs para USB
+ */
+// Função para definir os ganchos de exportação
+void usb_set_export_hooks(const usb_export_hooks_t* hooks) {
+    if (hooks) {
+        export_hooks = *hooks;
+    } else {
+        memset(&export_hooks, 0, sizeof(export_hooks));
+    }
+}
+
+/**
+ * @brief Repassa o progresso em bytes da cópia aos callbacks USB
+ *
+ * on_bytes recebe cada bloco copiado; on_progress (30% a 75%) apenas o fim
+ * de cada arquivo, para não inundar a saída. Cada bloco pede uma pulsação do
+ * LED de estado; a sinalização descarta as que chegam com outra aguardando.
+ */
+static void report_export_progress(const char* name, unsigned long long file_bytes,
+                                   unsigned long long file_size,
+                                   const usb_export_stats_t* stats, void* user) {
+    const usb_session_t* session = user;
+    gpio_signal_play(GPIO_SIGNAL_PROGRESS);
+    const usb_callbacks_t* callbacks = session->batch->callbacks;
+    if (!callbacks) {
+        return;
+    }
+
+    if (callbacks->on_bytes) {
+        callbacks->on_bytes(session->device.device_path, name, file_bytes, file_size,
+                            stats->bytes, stats->total_bytes);
+    }
+
+    if (callbacks->on_progress && file_bytes == file_size) {
+        int percentage = 75;
+        if (stats->total_bytes > 0) {
+            percentage = 30 + (int)(45 * stats->bytes / stats->total_bytes);
+        }
+
+        char progress_msg[256];
+        snprintf(progress_msg, sizeof(progress_msg), "Copiado %s (%d/%d, %.1f/%.1f MB)",
+                 name, stats->files + stats->failed + 1, stats->total_files,
+                 stats->bytes / (1024.0 * 1024.0), stats->total_bytes / (1024.0 * 1024.0));
+        session_progress(session, percentage, progress_msg);
     }
+}
+
+/**
+ * @brief Monta o pen drive e carrega o manifesto da exportação anterior (thread da sessão)
+ */
+static void* session_prepare(void* arg) {
+    usb_session_t* session = arg;
+    const char* mount_point = session->device.mount_point;
+
+    session_progress(session, 20, "Montando dispositivo USB...");
 
     // Montar dispositivo se necessário
-    if (!usb_device->is_mounted) {
-        int mount_result = mount_usb_device_auto(usb_device);
+    if (!session->device.is_mounted) {
+        int mount_result = mount_usb_device_auto(&session->device);
         if (mount_result != 0) {
-            if (callbacks && callbacks->on_error) {
-                callbacks->on_error(USB_ERROR_MOUNT_FAILED, "Falha ao montar dispositivo USB");
-            }
-            return USB_ERROR_MOUNT_FAILED;
+            session_error(session, USB_ERROR_MOUNT_FAILED, "Falha ao montar dispositivo USB");
+            session->result = USB_ERROR_MOUNT_FAILED;
+            return NULL;
         }
     }
 
-    if (callbacks && callbacks->on_progress) {
-        callbacks->on_progress(25, "Limpando arquivos antigos do pen drive...");
+    // Manifesto da exportação anterior: bancos inalterados não são copiados de novo
+    session->incremental = usb_export_manifest_load(mount_point, &session->manifest);
+
+    // Sem manifesto, a procedência dos bancos no pen drive é desconhecida: cópia completa.
+    // Nada é apagado antes: cada banco é gravado em .part e substitui o anterior só
+    // quando completo, e os que não vieram da origem saem na poda, no fim
+    session_progress(session, 25, session->incremental ? "Comparando com a exportação anterior..."
+                                                       : "Preparando cópia completa...");
+
+    session->active = true;
+    return NULL;
+}
+
+// Destino do snapshot do banco em uso: os .part são abertos no primeiro bloco,
+// quando o gancho já gravou o nome do banco
+typedef struct {
+    archive_sink_t sink;
+    bool opened;
+} live_sink_t;
+
+static int write_live_chunk(const void* data, size_t len, void* user) {
+    live_sink_t* live = user;
+    archive_sink_t* sink = &live->sink;
+
+    if (!live->opened) {
+        live->opened = true;
+        for (int i = 0; i < sink->count; i++) {
+            usb_session_t* session = sink->sessions[i];
+            usb_export_manifest_remove(&session->manifest, sink->name);
+            snprintf(sink->part_paths[i], sizeof(sink->part_paths[i]), "%s/%s%s",
+                     session->device.mount_point, sink->name, USB_EXPORT_PART_SUFFIX);
+            sink->fds[i] = open(sink->part_paths[i], O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            if (sink->fds[i] < 0) {
+                sink->failed[i] = true;
+            } else {
+                sink->open_count++;
+            }
+        }
     }
+    return write_archive_chunk(data, len, sink);
+}
 
-    // Limpar arquivos de banco antigos do pen drive (apenas NI*.db)
-    char cleanup_command[1024];
-    snprintf(cleanup_command, sizeof(cleanup_command),
-             "find \"%s\" -name \"NI*.db\" -type f -delete 2>/dev/null",
-             usb_device->mount_point);
-    system(cleanup_command);
+/**
+ * @brief Snapshot do banco em uso gravado em fluxo em todos os pen drives
+ *
+ * O gancho entrega o banco em blocos, uma única vez: cada bloco vai para
+ * todos os pen drives e o CRC32C do manifesto é calculado durante a
+ * gravação, sem reler o pen drive. Sem ponto de controle: o banco em uso
+ * muda entre exportações e nunca é retomado.
+ * @return false se o gancho falhou
+ */
+static bool export_live_snapshot(usb_batch_t* batch, usb_session_t** sessions, int count) {
+    live_sink_t live;
+    memset(&live, 0, sizeof(live));
+    live.sink.sessions = sessions;
+    live.sink.name = batch->live_name;
+    live.sink.count = count;
+    for (int i = 0; i < count; i++) {
+        live.sink.fds[i] = -1;
+    }
 
-    if (callbacks && callbacks->on_progress) {
-        callbacks->on_progress(30, "Copiando bancos de dados...");
+    bool ok = export_hooks.export_live(batch->live_name, sizeof(batch->live_name), write_live_chunk, &live,
+                                       export_hooks.user);
+    if (!batch->live_name[0]) {
+        return ok;
     }
 
-    // Copiar apenas arquivos de banco do DataLogger (padrão: NI*.db)
-    char command[1024];
-    snprintf(command, sizeof(command),
-             "find \"%s\" -name \"NI*.db\" -type f -exec cp {} \"%s/\" \\; 2>/dev/null",
-             source_dir, usb_device->mount_point);
+    for (int i = 0; i < count; i++) {
+        if (live.sink.fds[i] >= 0 && !ok) {
+            archive_drop(&live.sink, i, false);
+        }
+        bool written = live.opened && !live.sink.failed[i];
+        if (written && close(live.sink.fds[i]) != 0) {
+            unlink(live.sink.part_paths[i]);
+            written = false;
+        }
+        if (written && usb_export_commit_part(sessions[i]->device.mount_point, batch->live_name) != 0) {
+            written = false;
+        }
+        if (!written) {
+            sessions[i]->copy_result = -1;
+            continue;
+        }
 
-    int copy_result = system(command);
+        // Origem com tamanho 0 nunca é considerada inalterada
+        usb_export_entry_t* entry = &sessions[i]->live;
+        memset(entry, 0, sizeof(*entry));
+        snprintf(entry->name, sizeof(entry->name), "%s", batch->live_name);
+        entry->bytes = live.sink.offset;
+        entry->crc = live.sink.crc;
+        entry->written = true;
+        sessions[i]->has_live = true;
+    }
+    return ok;
+}
 
-    // Verificar quantos arquivos foram copiados
-    char count_command[1024];
-    snprintf(count_command, sizeof(count_command),
-             "find \"%s\" -name \"NI*.db\" -type f | wc -l",
-             usb_device->mount_point);
+/**
+ * @brief Planilha CSV gerada do SQLite no primeiro pen drive e copiada para os demais
+ *
+ * Fica fora do manifesto e da poda (não é NI*.db): cada exportação substitui
+ * a planilha anterior de mesmo nome.
+ */
+static void export_csv_sheet(usb_batch_t* batch, usb_session_t** sessions, int count) {
+    for (int i = 0; i < count; i++) {
+        session_progress(sessions[i], 35, "Gerando planilha CSV...");
+    }
 
-    FILE* count_fp = popen(count_command, "r");
-    int file_count = 0;
-    if (count_fp) {
-        fscanf(count_fp, "%d", &file_count);
-        pclose(count_fp);
+    if (!export_hooks.export_csv(sessions[0]->device.mount_point, batch->csv_name,
+                                 sizeof(batch->csv_name), export_hooks.user)) {
+        printf("Erro ao gerar planilha CSV no pen drive\n");
+        batch->csv_name[0] = '\0';
+        for (int i = 0; i < count; i++) {
+            sessions[i]->copy_result = -1;
+        }
+        return;
     }
 
-    if (callbacks && callbacks->on_progress) {
-        char progress_msg[256];
-        snprintf(progress_msg, sizeof(progress_msg),
-                 "Sincronizando dados... (%d bancos copiados)", file_count);
-        callbacks->on_progress(80, progress_msg);
+    char csv_path[512];
+    snprintf(csv_path, sizeof(csv_path), "%s/%s", sessions[0]->device.mount_point, batch->csv_name);
+    for (int i = 1; i < count; i++) {
+        char dest_path[512];
+        usb_export_stats_t stats;
+        memset(&stats, 0, sizeof(stats));
+        snprintf(dest_path, sizeof(dest_path), "%s/%s", sessions[i]->device.mount_point, batch->csv_name);
+        if (usb_export_copy_file(csv_path, dest_path, NULL, NULL, NULL, &stats) != 0) {
+            sessions[i]->copy_result = -1;
+        }
     }
+}
 
-    // Sincronizar dados
-    sync();
-    sleep(1);
+/**
+ * @brief Poda, sincroniza, verifica, grava o manifesto e desmonta (thread da sessão)
+ */
+static void* session_finish(void* arg) {
+    usb_session_t* session = arg;
+    usb_batch_t* batch = session->batch;
+    const char* mount_point = session->device.mount_point;
+    usb_export_stats_t* copy_stats = &session->target->stats;
+    int copy_result = session->copy_result;
+
+    // Bancos que saíram da origem (retenção, consolidação) saem do pen drive
+    int removed_count = usb_export_manifest_prune(&session->manifest, mount_point,
+                                                  USB_EXPORT_DB_PREFIX, USB_EXPORT_DB_SUFFIX,
+                                                  batch->live_name);
+    if (session->has_live) {
+        usb_export_manifest_set(&session->manifest, &session->live);
+    }
+
+    int copied_count = copy_stats->files + session->archived + (batch->live_name[0] ? 1 : 0);
+    int file_count = copied_count + copy_stats->skipped;
+    printf("📦 %sCópia%s: %d bancos gravados (%.1f MB), %d inalterados (%.1f MB não copiados), "
+           "%d removidos, %lld ms (%s)\n",
+           session->prefix, session->incremental ? " incremental" : " completa", copied_count,
+           copy_stats->bytes / (1024.0 * 1024.0), copy_stats->skipped,
+           copy_stats->skipped_bytes / (1024.0 * 1024.0), removed_count > 0 ? removed_count : 0,
+           copy_stats->elapsed_ms, usb_export_method_name(copy_stats->method));
+    if (copy_stats->resumed > 0 || copy_stats->checkpoints > 0) {
+        printf("↪️  %sRetomada: %d bancos continuados (%.1f MB já gravados), %d pontos de controle\n",
+               session->prefix, copy_stats->resumed, copy_stats->resumed_bytes / (1024.0 * 1024.0),
+               copy_stats->checkpoints);
+    }
+
+    char progress_msg[256];
+    snprintf(progress_msg, sizeof(progress_msg),
+             "Sincronizando dados... (%d bancos copiados)", file_count);
+    session_progress(session, 80, progress_msg);
+
+    // Sincronizar apenas o pen drive (syncfs), sem esperar pelo cartão SD
+    if (usb_export_sync(mount_point) != 0) {
+        copy_result = -1;
+    }
+
+    // Releitura opcional do que foi gravado, direto do dispositivo
+    if (USB_EXPORT_VERIFY_READBACK) {
+        session_progress(session, 85, "Verificando bancos no pen drive...");
+        if (usb_export_manifest_verify(&session->manifest, mount_point, copy_stats) > 0) {
+            copy_result = -1;
+        }
+        printf("🔎 %sVerificação: %d bancos relidos (%.1f MB, %s) em %lld ms, %d divergentes\n",
+               session->prefix, copy_stats->verified, copy_stats->verify_bytes / (1024.0 * 1024.0),
+               copy_stats->verify_direct ? "O_DIRECT" : "cache descartado",
+               copy_stats->verify_ms, copy_stats->verify_failed);
+    }
 
-    if (callbacks && callbacks->on_progress) {
-        callbacks->on_progress(90, "Desmontando dispositivo USB...");
+    // Manifesto com nome, tamanho e CRC32C de cada banco: prova de integridade no pen drive
+    if (usb_export_manifest_save(mount_point, &session->manifest) != 0) {
+        copy_result = -1;
     }
 
+    session_progress(session, 90, "Desmontando dispositivo USB...");
+
     // Desmontar dispositivo
-    int unmount_result = unmount_usb_device(usb_device->mount_point);
+    int unmount_result = unmount_usb_device(mount_point);
 
-    if (callbacks && callbacks->on_progress) {
-        callbacks->on_progress(100, "Extração concluída com sucesso!");
-    }
+    session_progress(session, 100, "Extração concluída com sucesso!");
 
     if (copy_result == 0 && unmount_result == 0) {
+        const usb_callbacks_t* callbacks = batch->callbacks;
         if (callbacks && callbacks->on_complete) {
             char complete_msg[256];
+            char text[320];
             snprintf(complete_msg, sizeof(complete_msg),
                      "%d bancos de dados extraídos com sucesso para USB", file_count);
-            callbacks->on_complete(USB_SUCCESS, complete_msg);
+            callbacks->on_complete(USB_SUCCESS, session_text(session, complete_msg, text, sizeof(text)));
+        }
+
+        session->result = USB_SUCCESS;
+    } else {
+        session_error(session, USB_ERROR_COPY_FAILED, "Erro durante cópia ou desmontagem");
+        session->result = USB_ERROR_COPY_FAILED;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Executa fn em uma thread por sessão e aguarda todas (sem threads com uma sessão)
+ */
+static void run_sessions(usb_session_t** sessions, int count, void* (*fn)(void*)) {
+    pthread_t threads[USB_MAX_DEVICES];
+    bool started[USB_MAX_DEVICES];
+
+    for (int i = 0; i < count; i++) {
+        started[i] = count > 1 && pthread_create(&threads[i], NULL, fn, sessions[i]) == 0;
+        if (!started[i]) {
+            fn(sessions[i]);
+        }
+    }
+    for (int i = 0; i < count; i++) {
+        if (started[i]) {
+            pthread_join(threads[i], NULL);
+        }
+    }
+}
+
+/**
+ * @brief Monta os pen drives, copia os bancos, desmonta e sinaliza o resultado de cada um
+ *
+ * Montagem e finalização (syncfs, verificação, desmontagem) rodam em uma
+ * thread por pen drive. A cópia lê cada banco da origem uma única vez e
+ * grava em todos os pen drives que precisam dele; ganchos de exportação e
+ * snapshot do banco em uso rodam uma vez por lote.
+ * @param results Resultado de cada pen drive (USB_SUCCESS ou código de erro)
+ * @return USB_SUCCESS se todos foram extraídos, ou o primeiro código de erro
+ */
+static int extract_all_logs_to_devices(const char* source_dir, usb_device_info_t* devices, int count,
+                                       const usb_callbacks_t* callbacks, int* results) {
+    if (count > USB_MAX_DEVICES) {
+        count = USB_MAX_DEVICES;
+    }
+
+    usb_batch_t batch;
+    usb_session_t sessions[USB_MAX_DEVICES];
+    usb_session_t* all[USB_MAX_DEVICES];
+    memset(&batch, 0, sizeof(batch));
+    batch.source_dir = source_dir;
+    batch.callbacks = callbacks;
+    batch.count = count;
+
+    for (int i = 0; i < count; i++) {
+        memset(&sessions[i], 0, sizeof(sessions[i]));
+        sessions[i].device = devices[i];
+        sessions[i].batch = &batch;
+        sessions[i].result = USB_ERROR_MOUNT_FAILED;
+        device_prefix(&devices[i], count, sessions[i].prefix, sizeof(sessions[i].prefix));
+        all[i] = &sessions[i];
+    }
+
+    if (count > 1) {
+        printf("🔌 %d pen drives conectados: extração simultânea\n", count);
+    }
+
+    run_sessions(all, count, session_prepare);
+
+    // Pen drives montados participam da cópia em leque
+    usb_session_t* active[USB_MAX_DEVICES];
+    int active_count = 0;
+    for (int i = 0; i < count; i++) {
+        if (!sessions[i].active) {
+            continue;
+        }
+        usb_export_target_t* target = &batch.targets[active_count];
+        target->dir = sessions[i].device.mount_point;
+        target->manifest = &sessions[i].manifest;
+        target->progress = report_export_progress;
+        target->user = &sessions[i];
+        sessions[i].target = target;
+        active[active_count++] = &sessions[i];
+    }
+
+    if (active_count > 0) {
+        for (int i = 0; i < active_count; i++) {
+            session_progress(active[i], 30, "Copiando bancos de dados...");
+        }
+
+        // Deixar o banco em uso autocontido antes da cópia
+        if (export_hooks.before_export) {
+            export_hooks.before_export(export_hooks.user);
         }
 
-        // Sinalizar sucesso com buzzer
+        // Banco em uso: snapshot consistente gerado pelo próprio escritor, uma vez por lote
+        bool live_ok = true;
+        if (export_hooks.export_live) {
+            live_ok = export_live_snapshot(&batch, active, active_count);
+        }
+
+        // Planilha CSV: gerada uma vez por lote, em fluxo do SQLite para o pen drive
+        if (export_hooks.export_csv) {
+            export_csv_sheet(&batch, active, active_count);
+        }
+
+        // Copiar apenas arquivos de banco do DataLogger (padrão: NI*.db), exceto o banco em uso
+        int copy_result = usb_export_copy_dir_multi(source_dir, USB_EXPORT_DB_PREFIX, USB_EXPORT_DB_SUFFIX,
+                                                    batch.live_name, batch.targets, active_count);
+        int failed_total = 0;
+        for (int i = 0; i < active_count; i++) {
+            failed_total += active[i]->target->stats.failed;
+        }
+        for (int i = 0; i < active_count; i++) {
+            // Sem falha por arquivo, o erro foi na origem e vale para todos
+            if (!live_ok || active[i]->target->stats.failed > 0 || (copy_result != 0 && failed_total == 0)) {
+                active[i]->copy_result = -1;
+            }
+        }
+
+        // Bancos e logs TXT arquivados são descompactados em fluxo direto para os pen drives
+        extract_archived_segments(source_dir, active, active_count);
+
+        if (export_hooks.after_export) {
+            export_hooks.after_export(export_hooks.user);
+        }
+
+        run_sessions(active, active_count, session_finish);
+    }
+
+    int result = USB_SUCCESS;
+    int failed = 0;
+    for (int i = 0; i < count; i++) {
+        usb_export_manifest_free(&sessions[i].manifest);
+        devices[i] = sessions[i].device;
+        if (results) {
+            results[i] = sessions[i].result;
+        }
+        if (sessions[i].result != USB_SUCCESS) {
+            failed++;
+            if (result == USB_SUCCESS) {
+                result = sessions[i].result;
+            }
+        }
+    }
+
+    // Um único sinal para o lote: sequência de sucesso se todos foram extraídos,
+    // senão um beep longo por pen drive com falha (padrões iguais por pen drive
+    // não diriam quantos falharam)
+    if (count > 0 && failed == 0) {
         buzzer_signal_extraction_complete();
+    }
+    for (int i = 0; i < failed; i++) {
+        buzzer_signal_extraction_failed();
+    }
+    if (failed > 0 && count > 1) {
+        printf("🔊 %d de %d pen drives com falha: %d beeps longos\n", failed, count, failed);
+    }
+    return result;
+}
 
-        return USB_SUCCESS;
-    } else {
-        if (callbacks && callbacks->on_error) {
-            callbacks->on_error(USB_ERROR_COPY_FAILED, "Erro durante cópia ou desmontagem");
+/**
+ * @brief Nó do disco (ex: /dev/sda) que contém a partição
+ */
+static bool partition_disk_node(struct udev_device* dev, char* out, size_t out_size) {
+    struct udev_device* disk = udev_device_get_parent_with_subsystem_devtype(dev, "block", "disk");
+    const char* node = disk ? udev_device_get_devnode(disk) : NULL;
+    if (!node) {
+        return false;
+    }
+    snprintf(out, out_size, "%s", node);
+    return true;
+}
+
+/**
+ * @brief Verifica se a partição (ex: /dev/sda1, /dev/mmcblk1p1) pertence ao disco
+ */
+static bool partition_of_disk(const char* partition, const char* disk) {
+    size_t len = strlen(disk);
+    if (len == 0 || strncmp(partition, disk, len) != 0) {
+        return false;
+    }
+    char next = partition[len];
+    return next == 'p' || next == '\0' || (next >= '0' && next <= '9');
+}
+
+/**
+ * @brief Verifica se o disco está na lista
+ */
+static bool disk_listed(const char* disk, char disks[][256], int count) {
+    for (int i = 0; i < count; i++) {
+        if (strcmp(disks[i], disk) == 0) {
+            return true;
         }
-        return USB_ERROR_COPY_FAILED;
     }
+    return false;
 }
 
 /**
- * @brief Monitora continuamente inserção de pen drives para extração automática
+ * @brief Mantém uma partição por disco (a primeira encontrada) e preenche o nó de cada disco
+ * @return Número de dispositivos mantidos no início do array
  */
-void usb_monitor_and_extract(const char* source_dir, volatile bool* running, const usb_callbacks_t* callbacks) {
-    if (!source_dir || !running) {
+static int unique_disks(usb_device_info_t* devices, int count, char disks[][256]) {
+    int unique = 0;
+    for (int i = 0; i < count; i++) {
+        char disk[256] = "";
+        struct stat st;
+        struct udev_device* dev = stat(devices[i].device_path, &st) == 0
+            ? udev_device_new_from_devnum(udev_context, 'b', st.st_rdev) : NULL;
+        if (dev) {
+            partition_disk_node(dev, disk, sizeof(disk));
+            udev_device_unref(dev);
+        }
+        if (disk[0] == '\0') {
+            snprintf(disk, sizeof(disk), "%s", devices[i].device_path);
+        }
+
+        if (disk_listed(disk, disks, unique)) {
+            continue;
+        }
+        if (unique != i) {
+            devices[unique] = devices[i];
+        }
+        snprintf(disks[unique], 256, "%s", disk);
+        unique++;
+    }
+    return unique;
+}
+
+int usb_auto_extract_all_logs(const char* source_dir, const usb_callbacks_t* callbacks) {
+    if (!source_dir) {
         if (callbacks && callbacks->on_error) {
-            callbacks->on_error(USB_ERROR_INVALID_PARAM, "Parâmetros inválidos para monitoramento");
+            callbacks->on_error(USB_ERROR_INVALID_PARAM, "Diretório de origem inválido");
         }
-        return;
+        return USB_ERROR_INVALID_PARAM;
     }
 
-    printf("🔍 Iniciando monitoramento de pen drives para extração automática...\n");
-    printf("📁 Diretório de logs: %s\n", source_dir);
-    printf("💡 Insira um pen drive para iniciar extração automática\n");
+    if (callbacks && callbacks->on_progress) {
+        callbacks->on_progress(10, "Detectando dispositivos USB...");
+    }
+
+    // Detectar dispositivos USB
+    usb_device_info_t devices[USB_MAX_DEVICES];
+    char disks[USB_MAX_DEVICES][256];
+    int device_count = detect_usb_devices(devices, USB_MAX_DEVICES);
+
+    if (device_count <= 0) {
+        if (callbacks && callbacks->on_error) {
+            callbacks->on_error(USB_ERROR_NOT_FOUND, "Nenhum dispositivo USB encontrado");
+        }
+        return USB_ERROR_NOT_FOUND;
+    }
+
+    // Todos os pen drives conectados, uma partição por disco
+    device_count = unique_disks(devices, device_count, disks);
+    return extract_all_logs_to_devices(source_dir, devices, device_count, callbacks, NULL);
+}
+
+/**
+ * @brief Executa a extração nos pen drives e mostra o resultado de cada um
+ */
+static void run_extraction(const char* source_dir, usb_device_info_t* devices, int count,
+                           const usb_callbacks_t* callbacks) {
+    int results[USB_MAX_DEVICES];
+    extract_all_logs_to_devices(source_dir, devices, count, callbacks, results);
+
+    for (int i = 0; i < count && i < USB_MAX_DEVICES; i++) {
+        char prefix[64];
+        device_prefix(&devices[i], count, prefix, sizeof(prefix));
+        if (results[i] == USB_SUCCESS) {
+            printf("✅ %sExtração concluída com sucesso!\n", prefix);
+            printf("💡 %sPen drive pode ser removido com segurança\n", prefix);
+        } else {
+            printf("❌ %sErro durante extração (código: %d)\n", prefix, results[i]);
+        }
+    }
 
+    printf("💡 Aguardando próximo pen drive...\n");
+}
+
+/**
+ * @brief Verificação periódica (sem monitor udev): enumera os dispositivos a cada USB_POLL_INTERVAL_SECONDS
+ */
+static void poll_usb_devices(const char* source_dir, volatile bool* running, const usb_callbacks_t* callbacks) {
     time_t last_check = 0;
-    bool last_usb_detected = false;
+    char known_disks[USB_MAX_DEVICES][256];
+    int known_count = 0;
 
     while (*running) {
         time_t current_time = time(NULL);
 
-        // Verificar a cada 3 segundos
-        if (current_time - last_check >= 3) {
+        if (current_time - last_check >= USB_POLL_INTERVAL_SECONDS) {
             last_check = current_time;
 
             // Detectar dispositivos USB
-            usb_device_info_t devices[5];
-            int device_count = detect_usb_devices(devices, 5);
-
-            bool usb_detected = (device_count > 0);
+            usb_device_info_t devices[USB_MAX_DEVICES];
+            char disks[USB_MAX_DEVICES][256];
+            int device_count = detect_usb_devices(devices, USB_MAX_DEVICES);
+            device_count = device_count > 0 ? unique_disks(devices, device_count, disks) : 0;
+
+            // Pen drives inseridos desde a última enumeração
+            usb_device_info_t inserted[USB_MAX_DEVICES];
+            int inserted_count = 0;
+            for (int i = 0; i < device_count; i++) {
+                if (!disk_listed(disks[i], known_disks, known_count)) {
+                    inserted[inserted_count++] = devices[i];
+                }
+            }
+            memcpy(known_disks, disks, sizeof(disks[0]) * (size_t)device_count);
+            known_count = device_count;
 
-            // Se USB foi inserido (transição de não detectado para detectado)
-            if (usb_detected && !last_usb_detected) {
+            if (inserted_count > 0) {
                 printf("\n🔌 Pen drive detectado! Iniciando extração automática...\n");
 
                 // Aguardar um pouco para estabilizar
-                sleep(2);
-
-                // Executar extração automática
-                int result = usb_auto_extract_all_logs(source_dir, callbacks);
-
-                if (result == USB_SUCCESS) {
-                    printf("✅ Extração concluída com sucesso!\n");
-                    printf("💡 Pen drive pode ser removido com segurança\n");
-                } else {
-                    printf("❌ Erro durante extração (código: %d)\n", result);
-                }
+                sleep(USB_POLL_SETTLE_SECONDS);
 
-                printf("💡 Aguardando próximo pen drive...\n");
+                run_extraction(source_dir, inserted, inserted_count, callbacks);
             }
-
-            last_usb_detected = usb_detected;
         }
 
         // Aguardar 1 segundo antes da próxima verificação
         sleep(1);
     }
+}
 
-    printf("🛑 Monitoramento de pen drives finalizado\n");
+void usb_monitor_wakeup(void) {
+    int fd = __atomic_load_n(&monitor_wake_fd, __ATOMIC_ACQUIRE);
+    if (fd >= 0) {
+        uint64_t one = 1;
+        ssize_t written = write(fd, &one, sizeof(one));
+        (void)written;
+    }
 }
 
 /**
- * @brief Inicializa o buzzer no GPIO23 usando libgpiod
+ * @brief Monitora continuamente inserção de pen drives para extração automática
+ *
+ * Inscreve-se nos eventos udev de partições de bloco (netlink) e bloqueia em
+ * poll() até um evento ou usb_monitor_wakeup(). A enumeração completa roda
+ * apenas uma vez, para pen drives já conectados na inicialização. O evento
+ * "add" da fonte udev só é enviado depois que as regras do udev terminaram,
+ * então o nó da partição já existe. Pen drives inseridos dentro de
+ * USB_BATCH_WINDOW_MS do primeiro são extraídos juntos; os inseridos durante
+ * uma extração são atendidos logo após o fim dela.
  */
-int buzzer_init(void) {
-    if (gpio_chip && buzzer_line) {
-        printf("Buzzer já inicializado\n");
-        return 0;
+void usb_monitor_and_extract(const char* source_dir, volatile bool* running, const usb_callbacks_t* callbacks) {
+    if (!source_dir || !running) {
+        if (callbacks && callbacks->on_error) {
+            callbacks->on_error(USB_ERROR_INVALID_PARAM, "Parâmetros inválidos para monitoramento");
+        }
+        return;
     }
 
-    // Abrir chip GPIO
-    gpio_chip = gpiod_chip_open_by_name(GPIO_CHIP_NAME);
-    if (!gpio_chip) {
-        printf("Erro ao abrir chip GPIO: %s\n", GPIO_CHIP_NAME);
-        return -1;
+    printf("🔍 Iniciando monitoramento de pen drives para extração automática...\n");
+    printf("📁 Diretório de logs: %s\n", source_dir);
+    printf("💡 Insira um pen drive para iniciar extração automática\n");
+
+    // Recepção habilitada antes da enumeração: nenhuma inserção entre as duas é perdida
+    struct udev_monitor* monitor = udev_context ? udev_monitor_new_from_netlink(udev_context, "udev") : NULL;
+    if (monitor &&
+        (udev_monitor_filter_add_match_subsystem_devtype(monitor, "block", "partition") < 0 ||
+         udev_monitor_enable_receiving(monitor) < 0)) {
+        udev_monitor_unref(monitor);
+        monitor = NULL;
     }
 
-    // Obter linha do GPIO23
-    buzzer_line = gpiod_chip_get_line(gpio_chip, BUZZER_GPIO);
-    if (!buzzer_line) {
-        printf("Erro ao obter linha GPIO %d\n", BUZZER_GPIO);
-        gpiod_chip_close(gpio_chip);
-        gpio_chip = NULL;
-        return -1;
+    if (!monitor) {
+        printf("⚠️  Monitor udev indisponível: verificando pen drives a cada %d s\n", USB_POLL_INTERVAL_SECONDS);
+        poll_usb_devices(source_dir, running, callbacks);
+        printf("🛑 Monitoramento de pen drives finalizado\n");
+        return;
     }
 
-    // Configurar linha como saída
-    int ret = gpiod_line_request_output(buzzer_line, "buzzer", 0);
-    if (ret < 0) {
-        printf("Erro ao configurar GPIO %d como saída\n", BUZZER_GPIO);
-        gpiod_chip_close(gpio_chip);
-        gpio_chip = NULL;
-        buzzer_line = NULL;
-        return -1;
+    int wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    __atomic_store_n(&monitor_wake_fd, wake_fd, __ATOMIC_RELEASE);
+
+    // Discos dos pen drives já atendidos: outras partições deles são ignoradas até a remoção
+    char active_disks[USB_MAX_DEVICES][256];
+    int active_count = 0;
+
+    // Pen drives conectados na inicialização: extraídos juntos
+    usb_device_info_t pending[USB_MAX_DEVICES];
+    int pending_count = *running ? detect_usb_devices(pending, USB_MAX_DEVICES) : 0;
+    if (pending_count > 0) {
+        pending_count = unique_disks(pending, pending_count, active_disks);
+        active_count = pending_count;
+
+        printf("\n🔌 Pen drive detectado! Iniciando extração automática...\n");
+        run_extraction(source_dir, pending, pending_count, callbacks);
     }
+    pending_count = 0;
+    long long batch_deadline = 0;
 
-    printf("🔊 Buzzer inicializado no GPIO %d\n", BUZZER_GPIO);
-    return 0;
+    struct pollfd fds[2] = {
+        { .fd = udev_monitor_get_fd(monitor), .events = POLLIN },
+        { .fd = wake_fd, .events = POLLIN },
+    };
+
+    while (*running) {
+        // Sem eventfd, a flag running é verificada a cada USB_MONITOR_STOP_CHECK_MS
+        int timeout = wake_fd >= 0 ? -1 : USB_MONITOR_STOP_CHECK_MS;
+
+        // Janela de agrupamento encerrada: extrair os pen drives pendentes juntos
+        if (pending_count > 0) {
+            long long remaining = batch_deadline - monotonic_ms();
+            if (remaining <= 0) {
+                run_extraction(source_dir, pending, pending_count, callbacks);
+                pending_count = 0;
+                continue;
+            }
+            if (timeout < 0 || remaining < timeout) {
+                timeout = (int)remaining;
+            }
+        }
+
+        int ready = poll(fds, wake_fd >= 0 ? 2 : 1, timeout);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            printf("Erro ao aguardar eventos udev: %s\n", strerror(errno));
+            break;
+        }
+        if (ready == 0 || !(fds[0].revents & POLLIN)) {
+            continue;
+        }
+
+        struct udev_device* dev = udev_monitor_receive_device(monitor);
+        if (!dev) {
+            continue;
+        }
+
+        const char* action = udev_device_get_action(dev);
+        const char* devnode = udev_device_get_devnode(dev);
+
+        if (action && strcmp(action, "remove") == 0 && devnode) {
+            for (int i = 0; i < active_count; i++) {
+                if (!partition_of_disk(devnode, active_disks[i])) {
+                    continue;
+                }
+                printf("🔌 Pen drive removido: %s\n", active_disks[i]);
+
+                // Removido antes do fim da janela: sai do lote pendente
+                for (int k = 0; k < pending_count; k++) {
+                    if (partition_of_disk(pending[k].device_path, active_disks[i])) {
+                        pending[k--] = pending[--pending_count];
+                    }
+                }
+                snprintf(active_disks[i], sizeof(active_disks[i]), "%s", active_disks[active_count - 1]);
+                active_count--;
+                break;
+            }
+        } else if (action && strcmp(action, "add") == 0 && active_count < USB_MAX_DEVICES) {
+            char disk[256] = "";
+            usb_device_info_t info;
+            partition_disk_node(dev, disk, sizeof(disk));
+            if (!disk_listed(disk, active_disks, active_count) && usb_partition_info(dev, &info)) {
+                if (disk[0] == '\0') {
+                    snprintf(disk, sizeof(disk), "%s", info.device_path);
+                }
+                snprintf(active_disks[active_count++], sizeof(active_disks[0]), "%s", disk);
+                pending[pending_count++] = info;
+
+                if (pending_count == 1) {
+                    printf("\n🔌 Pen drive detectado! Iniciando extração automática...\n");
+                    batch_deadline = monotonic_ms() + USB_BATCH_WINDOW_MS;
+                } else {
+                    printf("🔌 Outro pen drive detectado (%s): extração simultânea\n", info.device_path);
+                }
+            }
+        }
+
+        udev_device_unref(dev);
+    }
+
+    __atomic_store_n(&monitor_wake_fd, -1, __ATOMIC_RELEASE);
+    if (wake_fd >= 0) {
+        close(wake_fd);
+    }
+    udev_monitor_unref(monitor);
+
+    printf("🛑 Monitoramento de pen drives finalizado\n");
+}
+
+/**
+ * @brief Inicializa o buzzer no GPIO23 (thread de sinalização em lib/gpio_signal.c)
+ */
+int buzzer_init(void) {
+    return gpio_signal_init(NULL);
 }
 
 /**
  * @brief Finaliza o buzzer e libera recursos
  */
 void buzzer_cleanup(void) {
-    if (buzzer_line) {
-        // Garantir que o buzzer está desligado
-        gpiod_line_set_value(buzzer_line, 0);
-        gpiod_line_release(buzzer_line);
-        buzzer_line = NULL;
-    }
-
-    if (gpio_chip) {
-        gpiod_chip_close(gpio_chip);
-        gpio_chip = NULL;
-    }
-
-    printf("🔊 Buzzer finalizado\n");
+    gpio_signal_cleanup();
 }
 
 /**
- * @brief Toca o buzzer para sinalizar sucesso na extração
- * Executa sequência de 3 beeps curtos
+ * @brief Enfileira a sinalização de extração concluída
+ * Sequência de 3 beeps curtos, uma vez por lote de pen drives
  */
 void buzzer_signal_extraction_complete(void) {
-    if (!buzzer_line) {
+    if (!gpio_signal_play(GPIO_SIGNAL_SUCCESS)) {
         printf("⚠️  Buzzer não inicializado, pulando sinalização sonora\n");
         return;
     }
-
     printf("🔊 Sinalizando extração concluída...\n");
+}
 
-    // Sequência de 3 beeps curtos
-    for (int i = 0; i < 3; i++) {
-        // Ligar buzzer
-        gpiod_line_set_value(buzzer_line, 1);
-        usleep(200000); // 200ms ligado
-
-        // Desligar buzzer
-        gpiod_line_set_value(buzzer_line, 0);
-        usleep(200000); // 200ms desligado
-    }
-
-    printf("🔊 Sinalização sonora concluída\n");
+/**
+ * @brief Enfileira a sinalização de falha na extração
+ * Um beep longo
+ */
+void buzzer_signal_extraction_failed(void) {
+    gpio_signal_play(GPIO_SIGNAL_ERROR);
 }
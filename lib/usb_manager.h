@@ -2,6 +2,7 @@
 #define USB_MANAGER_H
 
 #include <stdbool.h>
+#include <stddef.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -11,11 +12,12 @@ extern "C" {
 typedef struct {
     char device_path[256];
     char mount_point[256];
-    char fs_type[32];
+    char fs_type[32];          // ID_FS_TYPE do udev antes da montagem; driver usado depois
     unsigned long size_mb;
     bool is_mounted;
     char vendor[64];
     char model[64];
+    long long mount_ms;        // Tempo da última montagem (identificação + mount)
 } usb_device_info_t;
 
 // Códigos de retorno
@@ -29,12 +31,35 @@ typedef enum {
 } usb_result_t;
 
 // Estrutura para callback de progresso
+// Com vários pen drives, os callbacks são chamados pelas threads de cada um e as
+// mensagens levam o dispositivo como prefixo (ex: "[sdb1] ")
 typedef struct {
     void (*on_progress)(int percentage, const char* message);
     void (*on_complete)(usb_result_t result, const char* message);
     void (*on_error)(usb_result_t error, const char* message);
+    // Progresso em bytes da cópia dos bancos (opcional): pen drive, arquivo atual e total da exportação
+    void (*on_bytes)(const char* device, const char* file, unsigned long long file_bytes,
+                     unsigned long long file_size, unsigned long long total_bytes,
+                     unsigned long long total_size);
 } usb_callbacks_t;
 
+// Destino de um arquivo gerado em fluxo: recebe os blocos em ordem (0 = continuar, -1 = interromper)
+typedef int (*usb_export_sink_t)(const void* data, size_t len, void* sink);
+
+// Ganchos chamados em torno da cópia dos bancos (ex: preparar o banco em uso)
+typedef struct {
+    void (*before_export)(void* user);   // Antes de copiar os bancos para o pen drive
+    void (*after_export)(void* user);    // Após a cópia (com sucesso ou não)
+    // Cópia consistente do banco em uso, entregue em fluxo a write(sink) e gravada
+    // em todos os pen drives; grava em name, antes do primeiro bloco, o nome do
+    // banco, que não é copiado novamente (NULL = copiado como os demais)
+    bool (*export_live)(char* name, size_t name_len, usb_export_sink_t write, void* sink, void* user);
+    // Planilha CSV dos registros em dest_dir (opcional); grava em name o nome do
+    // arquivo gerado, copiado depois para os demais pen drives do lote
+    bool (*export_csv)(const char* dest_dir, char* name, size_t name_len, void* user);
+    void* user;                          // Dado repassado aos ganchos
+} usb_export_hooks_t;
+
 /**
  * @brief Inicializa o gerenciador USB
  * @return 0 em caso de sucesso, -1 em caso de erro
@@ -68,23 +93,37 @@ int mount_usb_device_auto(usb_device_info_t* device_info);
  */
 int unmount_usb_device(const char* mount_point);
 
+/**
+ * @brief Define os ganchos de exportação usados por usb_auto_extract_all_logs
+ * @param hooks Ganchos (copiados internamente); NULL remove os ganchos
+ */
+void usb_set_export_hooks(const usb_export_hooks_t* hooks);
+
 /**
  * @brief Extração automática completa de todos os logs para USB
- * Detecta USB, monta, copia todos os arquivos .txt, desmonta e ejeta
+ * Detecta os pen drives conectados, monta, copia os bancos, desmonta e ejeta.
+ * Com vários pen drives, cada banco é lido uma vez e gravado em todos
  * @param source_dir Diretório com arquivos de log (ex: "/home/nova")
  * @param callbacks Callbacks para notificação de progresso (pode ser NULL)
- * @return 0 em caso de sucesso, código de erro negativo caso contrário
+ * @return 0 se todos os pen drives foram extraídos, código de erro negativo caso contrário
  */
 int usb_auto_extract_all_logs(const char* source_dir, const usb_callbacks_t* callbacks);
 
 /**
  * @brief Monitora continuamente inserção de pen drives para extração automática
+ * Orientado a eventos udev (netlink); sem monitor disponível, volta à enumeração periódica
  * @param source_dir Diretório com arquivos de log
  * @param running Ponteiro para flag de controle do loop
  * @param callbacks Callbacks para notificação de progresso (pode ser NULL)
  */
 void usb_monitor_and_extract(const char* source_dir, volatile bool* running, const usb_callbacks_t* callbacks);
 
+/**
+ * @brief Acorda usb_monitor_and_extract() para que verifique a flag running
+ * Segura para uso em handlers de sinal (apenas write() em um eventfd)
+ */
+void usb_monitor_wakeup(void);
+
 /**
  * @brief Inicializa o buzzer no GPIO23
  * @return 0 em caso de sucesso, -1 em caso de erro
@@ -97,11 +136,17 @@ int buzzer_init(void);
 void buzzer_cleanup(void);
 
 /**
- * @brief Toca o buzzer para sinalizar sucesso na extração
- * Executa sequência de 3 beeps curtos
+ * @brief Sinaliza sucesso na extração sem bloquear (padrão tocado pela thread de sinalização)
+ * Sequência de 3 beeps curtos, tocada uma vez quando todos os pen drives do lote foram extraídos
  */
 void buzzer_signal_extraction_complete(void);
 
+/**
+ * @brief Sinaliza falha na extração sem bloquear
+ * Um beep longo, tocado uma vez por pen drive com falha no lote
+ */
+void buzzer_signal_extraction_failed(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,465 @@
+/**
+ * @file usb_mount.c
+ * @brief COEL E33 DataLogger - Detecção do sistema de arquivos e montagem do pen drive
+ * @author Nova Instruments
+ */
+
+#include "usb_mount.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <mntent.h>
+#include <pthread.h>
+#include <sys/mount.h>
+
+// Recursos do superbloco ext que o ext3 suporta; além deles, o volume é ext4
+#define EXT_SUPERBLOCK_OFFSET 1024
+#define EXT_MAGIC 0xEF53
+#define EXT_COMPAT_HAS_JOURNAL 0x0004
+#define EXT_INCOMPAT_JOURNAL_DEV 0x0008
+#define EXT3_INCOMPAT_SUPPORTED 0x0016   // filetype, recover, meta_bg
+#define EXT3_RO_COMPAT_SUPPORTED 0x0007  // sparse_super, large_file, btree_dir
+
+// Drivers e opções de cada sistema de arquivos
+typedef struct {
+    usb_fs_t fs;
+    const char* name;          // Nome em ID_FS_TYPE (blkid)
+    const char* drivers[3];    // Drivers do kernel, na ordem de tentativa
+    const char* options;       // Opções de montagem
+} fs_profile_t;
+
+static const fs_profile_t fs_profiles[] = {
+    { USB_FS_VFAT,  "vfat",  { "vfat", NULL },          USB_MOUNT_OPTIONS_VFAT },
+    { USB_FS_EXFAT, "exfat", { "exfat", NULL },         USB_MOUNT_OPTIONS_EXFAT },
+    // ntfs3 (kernel 5.15+) grava; o driver ntfs antigo fica como alternativa
+    { USB_FS_NTFS,  "ntfs",  { "ntfs3", "ntfs", NULL }, USB_MOUNT_OPTIONS_NTFS },
+    // O driver ext4 monta também volumes ext2/ext3
+    { USB_FS_EXT2,  "ext2",  { "ext4", "ext2", NULL },  USB_MOUNT_OPTIONS_EXT2 },
+    { USB_FS_EXT3,  "ext3",  { "ext4", "ext3", NULL },  USB_MOUNT_OPTIONS_EXT },
+    { USB_FS_EXT4,  "ext4",  { "ext4", NULL },          USB_MOUNT_OPTIONS_EXT },
+};
+
+// Sem identificação: tentativas em sequência
+static const char* fallback_types[] = {"vfat", "exfat", "ntfs", "ext4", "ext3", "ext2", NULL};
+
+/**
+ * @brief Tempo monotônico em microssegundos
+ */
+static long long monotonic_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+static uint16_t read_le16(const unsigned char* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t read_le32(const unsigned char* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static bool power_of_two(unsigned value) {
+    return value != 0 && (value & (value - 1)) == 0;
+}
+
+static const fs_profile_t* find_profile(usb_fs_t fs) {
+    for (size_t i = 0; i < sizeof(fs_profiles) / sizeof(fs_profiles[0]); i++) {
+        if (fs_profiles[i].fs == fs) {
+            return &fs_profiles[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Identifica o sistema de arquivos nos primeiros bytes da partição
+ */
+static usb_fs_t probe_buffer(const unsigned char* sb, size_t len) {
+    // NTFS e exFAT: identificador OEM no setor de boot
+    if (memcmp(sb + 3, "NTFS    ", 8) == 0) {
+        return USB_FS_NTFS;
+    }
+    if (memcmp(sb + 3, "EXFAT   ", 8) == 0) {
+        return USB_FS_EXFAT;
+    }
+
+    // ext2/3/4: magic do superbloco; o conjunto de recursos separa as versões
+    const unsigned char* ext = sb + EXT_SUPERBLOCK_OFFSET;
+    if (len >= EXT_SUPERBLOCK_OFFSET + 104 && read_le16(ext + 56) == EXT_MAGIC) {
+        uint32_t compat = read_le32(ext + 92);
+        uint32_t incompat = read_le32(ext + 96);
+        uint32_t ro_compat = read_le32(ext + 100);
+        if (incompat & EXT_INCOMPAT_JOURNAL_DEV) {
+            return USB_FS_UNKNOWN;  // Dispositivo de journal externo, não montável
+        }
+        if ((incompat & ~EXT3_INCOMPAT_SUPPORTED) || (ro_compat & ~EXT3_RO_COMPAT_SUPPORTED)) {
+            return USB_FS_EXT4;
+        }
+        return (compat & EXT_COMPAT_HAS_JOURNAL) ? USB_FS_EXT3 : USB_FS_EXT2;
+    }
+
+    // FAT12/16/32: assinatura do setor de boot, geometria coerente e tipo no BPB
+    if (sb[510] == 0x55 && sb[511] == 0xAA) {
+        uint16_t sector_size = read_le16(sb + 11);
+        bool geometry = sector_size >= 512 && sector_size <= 4096 && power_of_two(sector_size) &&
+                        power_of_two(sb[13]) && sb[16] >= 1 && sb[16] <= 2;
+        if (geometry && (memcmp(sb + 54, "FAT", 3) == 0 || memcmp(sb + 82, "FAT32", 5) == 0)) {
+            return USB_FS_VFAT;
+        }
+    }
+
+    return USB_FS_UNKNOWN;
+}
+
+// Função para identificar o sistema de arquivos pelo superbloco
+usb_fs_t usb_mount_probe(const char* device_path) {
+    if (!device_path) {
+        return USB_FS_UNKNOWN;
+    }
+
+    int fd = open(device_path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        printf("Erro ao abrir %s para identificar o sistema de arquivos: %s\n", device_path, strerror(errno));
+        return USB_FS_UNKNOWN;
+    }
+
+    unsigned char sb[USB_MOUNT_PROBE_BYTES];
+    ssize_t n;
+    do {
+        n = pread(fd, sb, sizeof(sb), 0);
+    } while (n < 0 && errno == EINTR);
+    close(fd);
+
+    if (n < 512) {
+        return USB_FS_UNKNOWN;
+    }
+    if ((size_t)n < sizeof(sb)) {
+        memset(sb + n, 0, sizeof(sb) - (size_t)n);
+    }
+    return probe_buffer(sb, (size_t)n);
+}
+
+usb_fs_t usb_mount_fs_from_name(const char* name) {
+    if (!name) {
+        return USB_FS_UNKNOWN;
+    }
+    if (strcmp(name, "ntfs3") == 0) {
+        return USB_FS_NTFS;
+    }
+    for (size_t i = 0; i < sizeof(fs_profiles) / sizeof(fs_profiles[0]); i++) {
+        if (strcmp(fs_profiles[i].name, name) == 0) {
+            return fs_profiles[i].fs;
+        }
+    }
+    return USB_FS_UNKNOWN;
+}
+
+const char* usb_mount_fs_name(usb_fs_t fs) {
+    const fs_profile_t* profile = find_profile(fs);
+    return profile ? profile->name : "desconhecido";
+}
+
+/**
+ * @brief Uma tentativa de mount(); opções recusadas pelo driver (EINVAL) = nova tentativa sem opções
+ */
+static bool try_mount(const char* device_path, const char* mount_point, const char* driver,
+                      const char* options, usb_mount_result_t* result) {
+    result->attempts++;
+    if (mount(device_path, mount_point, driver, MS_NOATIME, options) == 0) {
+        snprintf(result->driver, sizeof(result->driver), "%s", driver);
+        result->options = options != NULL;
+        return true;
+    }
+
+    if (options && errno == EINVAL) {
+        printf("Aviso: %s recusou as opções \"%s\", montando sem opções\n", driver, options);
+        result->attempts++;
+        if (mount(device_path, mount_point, driver, MS_NOATIME, NULL) == 0) {
+            snprintf(result->driver, sizeof(result->driver), "%s", driver);
+            result->options = false;
+            return true;
+        }
+    }
+
+    printf("Falha ao montar como %s: %s\n", driver, strerror(errno));
+    return false;
+}
+
+// Função para montar a partição
+int usb_mount_device(const char* device_path, const char* mount_point, usb_fs_t fs,
+                     usb_mount_result_t* result) {
+    if (!device_path || !mount_point || !result) {
+        return -1;
+    }
+    memset(result, 0, sizeof(*result));
+    long long start = monotonic_us();
+
+    result->source = "udev";
+    if (fs == USB_FS_UNKNOWN) {
+        fs = usb_mount_probe(device_path);
+        result->probe_us = monotonic_us() - start;
+        result->source = "superbloco";
+    }
+    result->fs = fs;
+
+    // Sistema de arquivos identificado: driver e opções dele, sem tentativas às cegas
+    const fs_profile_t* profile = find_profile(fs);
+    for (int i = 0; profile && profile->drivers[i]; i++) {
+        if (try_mount(device_path, mount_point, profile->drivers[i], profile->options, result)) {
+            result->mount_ms = (monotonic_us() - start) / 1000;
+            return 0;
+        }
+    }
+
+    // Sem identificação (ou identificação que não montou): demais tipos em sequência
+    result->fs = USB_FS_UNKNOWN;
+    result->source = "tentativas";
+    for (int i = 0; fallback_types[i]; i++) {
+        bool tried = false;
+        for (int k = 0; profile && profile->drivers[k]; k++) {
+            tried = tried || strcmp(profile->drivers[k], fallback_types[i]) == 0;
+        }
+        if (tried) {
+            continue;
+        }
+
+        printf("Tentando montar como %s...\n", fallback_types[i]);
+        if (try_mount(device_path, mount_point, fallback_types[i], NULL, result)) {
+            result->fs = usb_mount_fs_from_name(fallback_types[i]);
+            result->mount_ms = (monotonic_us() - start) / 1000;
+            return 0;
+        }
+    }
+
+    result->mount_ms = (monotonic_us() - start) / 1000;
+    return -1;
+}
+
+// Cache da tabela de montagens: entradas na ordem do arquivo e dois índices
+// hash (endereçamento aberto, capacidade potência de 2) com posição + 1 (0 = vazio)
+typedef struct {
+    usb_mount_entry_t* entries;
+    int count;
+    int capacity;
+    unsigned* by_device;
+    unsigned* by_mount_point;
+    unsigned buckets;
+    bool valid;                // Tabela lida ao menos uma vez
+    int watch_fd;              // USB_MOUNT_TABLE_FILE aberto para poll(); -1 = reler a cada consulta
+    unsigned long refreshes;
+} mount_table_t;
+
+static mount_table_t mount_table = { .watch_fd = -1 };
+static pthread_mutex_t mount_table_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static uint32_t hash_string(const char* s) {
+    uint32_t h = 2166136261u;  // FNV-1a
+    while (*s) {
+        h = (h ^ (unsigned char)*s++) * 16777619u;
+    }
+    return h;
+}
+
+/**
+ * @brief Insere a entrada no índice; replace decide quem fica com a chave repetida
+ */
+static void index_insert(unsigned* index, const char* key, int position, bool replace) {
+    unsigned mask = mount_table.buckets - 1;
+    for (unsigned slot = hash_string(key) & mask;; slot = (slot + 1) & mask) {
+        if (index[slot] == 0) {
+            index[slot] = (unsigned)position + 1;
+            return;
+        }
+        const usb_mount_entry_t* e = &mount_table.entries[index[slot] - 1];
+        const char* existing = (index == mount_table.by_device) ? e->device : e->mount_point;
+        if (strcmp(existing, key) == 0) {
+            if (replace) {
+                index[slot] = (unsigned)position + 1;
+            }
+            return;
+        }
+    }
+}
+
+static const usb_mount_entry_t* index_find(const unsigned* index, const char* key, bool by_device) {
+    if (mount_table.buckets == 0) {
+        return NULL;
+    }
+    unsigned mask = mount_table.buckets - 1;
+    for (unsigned slot = hash_string(key) & mask; index[slot] != 0; slot = (slot + 1) & mask) {
+        const usb_mount_entry_t* e = &mount_table.entries[index[slot] - 1];
+        if (strcmp(by_device ? e->device : e->mount_point, key) == 0) {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Relê a tabela e reconstrói os índices
+ */
+static bool mount_table_reload(void) {
+    FILE* fp = setmntent(USB_MOUNT_TABLE_FILE, "r");
+    if (!fp) {
+        printf("Erro ao ler %s: %s\n", USB_MOUNT_TABLE_FILE, strerror(errno));
+        return false;
+    }
+
+    int count = 0;
+    struct mntent* m;
+    while ((m = getmntent(fp)) != NULL) {
+        if (count == mount_table.capacity) {
+            int capacity = mount_table.capacity ? mount_table.capacity * 2 : 64;
+            usb_mount_entry_t* entries = realloc(mount_table.entries, (size_t)capacity * sizeof(*entries));
+            if (!entries) {
+                printf("Erro: sem memória para a tabela de montagens\n");
+                endmntent(fp);
+                return false;
+            }
+            mount_table.entries = entries;
+            mount_table.capacity = capacity;
+        }
+        usb_mount_entry_t* e = &mount_table.entries[count++];
+        snprintf(e->device, sizeof(e->device), "%s", m->mnt_fsname);
+        snprintf(e->mount_point, sizeof(e->mount_point), "%s", m->mnt_dir);
+        snprintf(e->fs_type, sizeof(e->fs_type), "%s", m->mnt_type);
+    }
+    endmntent(fp);
+
+    unsigned buckets = 16;
+    while (buckets < (unsigned)count * 2) {
+        buckets *= 2;
+    }
+    if (buckets != mount_table.buckets) {
+        unsigned* by_device = realloc(mount_table.by_device, buckets * sizeof(unsigned));
+        if (by_device) {
+            mount_table.by_device = by_device;
+        }
+        unsigned* by_mount_point = realloc(mount_table.by_mount_point, buckets * sizeof(unsigned));
+        if (by_mount_point) {
+            mount_table.by_mount_point = by_mount_point;
+        }
+        if (!by_device || !by_mount_point) {
+            printf("Erro: sem memória para a tabela de montagens\n");
+            mount_table.buckets = 0;
+            return false;
+        }
+        mount_table.buckets = buckets;
+    }
+    memset(mount_table.by_device, 0, buckets * sizeof(unsigned));
+    memset(mount_table.by_mount_point, 0, buckets * sizeof(unsigned));
+
+    // Dispositivo montado em vários pontos: vale o primeiro (como na busca linear antiga);
+    // montagens empilhadas no mesmo ponto: vale a última, que é a visível
+    for (int i = 0; i < count; i++) {
+        index_insert(mount_table.by_device, mount_table.entries[i].device, i, false);
+        index_insert(mount_table.by_mount_point, mount_table.entries[i].mount_point, i, true);
+    }
+    mount_table.count = count;
+    mount_table.refreshes++;
+    return true;
+}
+
+/**
+ * @brief Garante o cache atualizado (chamar com o mutex)
+ *
+ * O kernel sinaliza POLLERR|POLLPRI em /proc/self/mounts a cada montagem ou
+ * desmontagem desde o último poll(); sem sinal, o cache vale e nada é lido.
+ * O poll() vem antes da releitura: uma mudança durante a leitura gera novo
+ * sinal e, no pior caso, uma releitura a mais.
+ */
+static bool mount_table_refresh(void) {
+    if (mount_table.watch_fd < 0) {
+        mount_table.watch_fd = open(USB_MOUNT_TABLE_FILE, O_RDONLY | O_CLOEXEC);
+        if (mount_table.watch_fd < 0) {
+            printf("Aviso: %s sem notificação de mudanças (%s), relendo a cada consulta\n",
+                   USB_MOUNT_TABLE_FILE, strerror(errno));
+            mount_table.valid = false;
+        }
+    }
+
+    if (mount_table.valid) {
+        struct pollfd pfd = { .fd = mount_table.watch_fd, .events = POLLPRI };
+        int ready = poll(&pfd, 1, 0);
+        if (ready == 0) {
+            return true;
+        }
+        if (ready < 0 && errno != EINTR) {
+            printf("Erro no poll de %s: %s\n", USB_MOUNT_TABLE_FILE, strerror(errno));
+        }
+    }
+
+    mount_table.valid = mount_table_reload() && mount_table.watch_fd >= 0;
+    return mount_table.buckets > 0;
+}
+
+bool usb_mount_table_find_device(const char* device, usb_mount_entry_t* entry) {
+    if (!device) {
+        return false;
+    }
+    pthread_mutex_lock(&mount_table_mutex);
+    const usb_mount_entry_t* e = mount_table_refresh() ?
+        index_find(mount_table.by_device, device, true) : NULL;
+    if (e && entry) {
+        *entry = *e;
+    }
+    pthread_mutex_unlock(&mount_table_mutex);
+    return e != NULL;
+}
+
+bool usb_mount_table_find_mount_point(const char* mount_point, usb_mount_entry_t* entry) {
+    if (!mount_point) {
+        return false;
+    }
+    pthread_mutex_lock(&mount_table_mutex);
+    const usb_mount_entry_t* e = mount_table_refresh() ?
+        index_find(mount_table.by_mount_point, mount_point, false) : NULL;
+    if (e && entry) {
+        *entry = *e;
+    }
+    pthread_mutex_unlock(&mount_table_mutex);
+    return e != NULL;
+}
+
+int usb_mount_table_entries(usb_mount_entry_t* entries, int max_entries) {
+    if (!entries || max_entries <= 0) {
+        return 0;
+    }
+    pthread_mutex_lock(&mount_table_mutex);
+    int count = -1;
+    if (mount_table_refresh()) {
+        count = mount_table.count < max_entries ? mount_table.count : max_entries;
+        memcpy(entries, mount_table.entries, (size_t)count * sizeof(*entries));
+    }
+    pthread_mutex_unlock(&mount_table_mutex);
+    return count;
+}
+
+unsigned long usb_mount_table_refreshes(void) {
+    pthread_mutex_lock(&mount_table_mutex);
+    unsigned long refreshes = mount_table.refreshes;
+    pthread_mutex_unlock(&mount_table_mutex);
+    return refreshes;
+}
+
+void usb_mount_table_cleanup(void) {
+    pthread_mutex_lock(&mount_table_mutex);
+    if (mount_table.watch_fd >= 0) {
+        close(mount_table.watch_fd);
+    }
+    free(mount_table.entries);
+    free(mount_table.by_device);
+    free(mount_table.by_mount_point);
+    unsigned long refreshes = mount_table.refreshes;
+    memset(&mount_table, 0, sizeof(mount_table));
+    mount_table.watch_fd = -1;
+    mount_table.refreshes = refreshes;
+    pthread_mutex_unlock(&mount_table_mutex);
+}
@@ -0,0 +1,129 @@
+/**
+ * @file usb_mount.h
+ * @brief COEL E33 DataLogger - Detecção do sistema de arquivos e montagem do pen drive
+ * @author Nova Instruments
+ *
+ * O sistema de arquivos é identificado antes do mount(): pela propriedade
+ * ID_FS_TYPE do udev (blkid) quando disponível, ou lendo o setor de boot e o
+ * superbloco da partição (vfat, exfat, ntfs, ext2/3/4). A montagem acerta na
+ * primeira tentativa, com opções próprias de cada sistema de arquivos para a
+ * gravação sequencial em lote da exportação. Sem identificação, a montagem
+ * recai nas tentativas em sequência (vfat, exfat, ntfs, ext4, ext3, ext2).
+ *
+ * A tabela de montagens (/proc/self/mounts) fica em cache, indexada por
+ * dispositivo e por ponto de montagem, e só é relida quando poll() no
+ * arquivo indica mudança: em regime, as consultas não fazem I/O.
+ */
+
+#ifndef USB_MOUNT_H
+#define USB_MOUNT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Opções de montagem por sistema de arquivos (rejeitadas pelo driver = montagem sem opções)
+#define USB_MOUNT_OPTIONS_VFAT "utf8"
+#define USB_MOUNT_OPTIONS_EXFAT "iocharset=utf8"
+#define USB_MOUNT_OPTIONS_NTFS "iocharset=utf8,prealloc"  // ntfs3: pré-alocação ao crescer o arquivo
+#define USB_MOUNT_OPTIONS_EXT "commit=60,noauto_da_alloc" // Sem commits/flush intermediários: syncfs no fim
+#define USB_MOUNT_OPTIONS_EXT2 "noauto_da_alloc"          // Sem journal: commit= é recusado
+#define USB_MOUNT_PROBE_BYTES 4096                         // Setor de boot + superbloco ext (offset 1024)
+#define USB_MOUNT_TABLE_FILE "/proc/self/mounts"           // Tabela de montagens (poll sinaliza mudanças)
+
+// Sistemas de arquivos reconhecidos
+typedef enum {
+    USB_FS_UNKNOWN = 0,
+    USB_FS_VFAT,
+    USB_FS_EXFAT,
+    USB_FS_NTFS,
+    USB_FS_EXT2,
+    USB_FS_EXT3,
+    USB_FS_EXT4
+} usb_fs_t;
+
+// Resultado de uma montagem
+typedef struct {
+    usb_fs_t fs;              // Sistema de arquivos identificado (USB_FS_UNKNOWN = tentativas)
+    const char* source;       // Origem da identificação: "udev", "superbloco" ou "tentativas"
+    char driver[32];          // Driver usado no mount() (ex: "ntfs3")
+    bool options;             // Montado com as opções de USB_MOUNT_OPTIONS_*
+    int attempts;             // Chamadas a mount()
+    long long probe_us;       // Tempo da leitura do superbloco
+    long long mount_ms;       // Tempo total (identificação + mount)
+} usb_mount_result_t;
+
+// Entrada da tabela de montagens
+typedef struct {
+    char device[256];         // Dispositivo (ex: /dev/sda1)
+    char mount_point[256];    // Ponto de montagem
+    char fs_type[32];         // Tipo do sistema de arquivos
+} usb_mount_entry_t;
+
+/**
+ * @brief Identifica o sistema de arquivos pelo setor de boot e superbloco
+ * @param device_path Partição (ex: /dev/sda1) ou imagem
+ * @return Sistema de arquivos, ou USB_FS_UNKNOWN se não reconhecido ou ilegível
+ */
+usb_fs_t usb_mount_probe(const char* device_path);
+
+/**
+ * @brief Converte o nome do udev/blkid (ID_FS_TYPE, ex: "vfat") no tipo
+ * @return Sistema de arquivos, ou USB_FS_UNKNOWN para nomes não suportados ou NULL
+ */
+usb_fs_t usb_mount_fs_from_name(const char* name);
+
+/**
+ * @brief Nome do sistema de arquivos (como em ID_FS_TYPE)
+ */
+const char* usb_mount_fs_name(usb_fs_t fs);
+
+/**
+ * @brief Monta a partição no ponto de montagem (que deve existir)
+ *
+ * Sem fs informado, lê o superbloco. Com o sistema de arquivos identificado,
+ * usa o driver e as opções dele; sem identificação (ou se a montagem
+ * falhar), tenta os demais tipos conhecidos em sequência, sem opções.
+ * @param device_path Partição a montar
+ * @param mount_point Ponto de montagem
+ * @param fs Sistema de arquivos informado pelo udev (USB_FS_UNKNOWN = ler o superbloco)
+ * @param result Resultado (obrigatório)
+ * @return 0 em caso de sucesso, -1 em caso de erro
+ */
+int usb_mount_device(const char* device_path, const char* mount_point, usb_fs_t fs,
+                     usb_mount_result_t* result);
+
+/**
+ * @brief Procura a montagem de um dispositivo (a primeira, se montado em mais de um ponto)
+ * @param device Dispositivo (ex: /dev/sda1)
+ * @param entry Entrada encontrada (pode ser NULL)
+ * @return true se o dispositivo está montado
+ */
+bool usb_mount_table_find_device(const char* device, usb_mount_entry_t* entry);
+
+/**
+ * @brief Procura o que está montado em um ponto de montagem (a montagem visível)
+ * @param mount_point Ponto de montagem
+ * @param entry Entrada encontrada (pode ser NULL)
+ * @return true se há algo montado no ponto
+ */
+bool usb_mount_table_find_mount_point(const char* mount_point, usb_mount_entry_t* entry);
+
+/**
+ * @brief Copia as entradas da tabela, na ordem de /proc/self/mounts
+ * @param entries Destino
+ * @param max_entries Capacidade do destino
+ * @return Número de entradas copiadas, ou -1 se a tabela não pôde ser lida
+ */
+int usb_mount_table_entries(usb_mount_entry_t* entries, int max_entries);
+
+/**
+ * @brief Número de leituras da tabela desde o início (uma por mudança nas montagens)
+ */
+unsigned long usb_mount_table_refreshes(void);
+
+/**
+ * @brief Fecha o arquivo monitorado e libera o cache
+ */
+void usb_mount_table_cleanup(void);
+
+#endif // USB_MOUNT_H
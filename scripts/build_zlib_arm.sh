@@ -0,0 +1,86 @@
+#!/bin/bash
+
+# Script para compilar zlib para ARM (cross-compilation)
+
+set -e  # Parar em caso de erro
+
+# Configurações
+ZLIB_VERSION="1.3.1"
+ZLIB_URL="https://zlib.net/fossils/zlib-${ZLIB_VERSION}.tar.gz"
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+PROJECT_ROOT="$(dirname "$SCRIPT_DIR")"
+DEPS_DIR="$PROJECT_ROOT/deps"
+ZLIB_DIR="$DEPS_DIR/zlib"
+INSTALL_DIR="$ZLIB_DIR/install"
+
+# Configuração do cross-compiler
+export CC=arm-linux-gnueabihf-gcc
+export AR=arm-linux-gnueabihf-ar
+export RANLIB=arm-linux-gnueabihf-ranlib
+export STRIP=arm-linux-gnueabihf-strip
+export PKG_CONFIG_PATH=""
+
+# Cores para output
+RED='\033[0;31m'
+GREEN='\033[0;32m'
+YELLOW='\033[1;33m'
+NC='\033[0m' # No Color
+
+echo -e "${GREEN}=== Compilando zlib para ARM ===${NC}"
+
+# Verificar se cross-compiler existe
+if ! command -v arm-linux-gnueabihf-gcc &> /dev/null; then
+    echo -e "${RED}Erro: Cross-compiler ARM não encontrado!${NC}"
+    echo "Execute: sudo apt-get install gcc-arm-linux-gnueabihf"
+    exit 1
+fi
+
+# Criar diretórios
+mkdir -p "$DEPS_DIR"
+mkdir -p "$ZLIB_DIR"
+mkdir -p "$INSTALL_DIR"
+
+cd "$ZLIB_DIR"
+
+# Baixar zlib se não existir
+if [ ! -f "zlib-${ZLIB_VERSION}.tar.gz" ]; then
+    echo -e "${YELLOW}Baixando zlib ${ZLIB_VERSION}...${NC}"
+    wget "$ZLIB_URL" -O "zlib-${ZLIB_VERSION}.tar.gz"
+fi
+
+# Extrair se não existir
+if [ ! -d "zlib-${ZLIB_VERSION}" ]; then
+    echo "Extraindo zlib..."
+    tar -xzf "zlib-${ZLIB_VERSION}.tar.gz"
+fi
+
+cd "zlib-${ZLIB_VERSION}"
+
+# Configurar para cross-compilation (o configure da zlib usa CC do ambiente)
+echo -e "${YELLOW}Configurando zlib para ARM32...${NC}"
+CFLAGS="-O2 -fPIC" ./configure --prefix="$INSTALL_DIR"
+
+# Compilar
+echo -e "${YELLOW}Compilando zlib...${NC}"
+make -j$(nproc)
+
+# Instalar
+echo -e "${YELLOW}Instalando zlib...${NC}"
+make install
+
+# Verificar instalação
+if [ -f "$INSTALL_DIR/lib/libz.so" ] && [ -f "$INSTALL_DIR/lib/libz.a" ]; then
+    echo -e "${GREEN}✅ zlib compilada com sucesso!${NC}"
+    echo -e "${GREEN}   Biblioteca: $INSTALL_DIR/lib/libz.so${NC}"
+    echo -e "${GREEN}   Headers: $INSTALL_DIR/include/zlib.h${NC}"
+
+    # Mostrar informações da biblioteca
+    echo -e "${YELLOW}Informações da biblioteca:${NC}"
+    file "$INSTALL_DIR/lib/libz.so"
+    ls -lh "$INSTALL_DIR"/lib/libz.*
+else
+    echo -e "${RED}❌ Erro: zlib não foi compilada corretamente!${NC}"
+    exit 1
+fi
+
+echo -e "${GREEN}=== zlib ARM build concluído ===${NC}"
@@ -78,6 +78,7 @@ DEPS_DIR="$PROJECT_ROOT/deps"
 LIBMODBUS_PATH="$DEPS_DIR/libmodbus/install/lib/libmodbus.so"
 LIBGPIOD_PATH="$DEPS_DIR/libgpiod/install/lib/libgpiod.so"
 LIBUDEV_PATH="$DEPS_DIR/eudev/install/lib/libudev.a"
+ZLIB_PATH="$DEPS_DIR/zlib/install/lib/libz.so"
 
 if [ -f "$LIBMODBUS_PATH" ]; then
     log_success "libmodbus ARM encontrada: $LIBMODBUS_PATH"
@@ -103,6 +104,14 @@ else
     log_error "Execute: ./scripts/build_libudev_arm.sh"
 fi
 
+if [ -f "$ZLIB_PATH" ]; then
+    log_success "zlib ARM encontrada: $ZLIB_PATH"
+    file "$ZLIB_PATH" | grep -q "ARM" && log_success "  ✓ Arquitetura ARM confirmada" || log_warning "  ⚠ Pode não ser ARM"
+else
+    log_error "zlib ARM não encontrada!"
+    log_error "Execute: ./scripts/build_zlib_arm.sh"
+fi
+
 # Verificar arquivo de configuração
 log_info "Verificando CMakeLists.txt..."
 CMAKE_FILE="$PROJECT_ROOT/CMakeLists.txt"
@@ -179,6 +188,7 @@ if ! command_exists cmake; then ((ERRORS++)); fi
 if [ ! -f "$LIBMODBUS_PATH" ]; then ((ERRORS++)); fi
 if [ ! -f "$LIBGPIOD_PATH" ]; then ((ERRORS++)); fi
 if [ ! -f "$LIBUDEV_PATH" ]; then ((ERRORS++)); fi
+if [ ! -f "$ZLIB_PATH" ]; then ((ERRORS++)); fi
 if [ ! -f "$CMAKE_FILE" ]; then ((ERRORS++)); fi
 if [ ! -f "$TOOLCHAIN_FILE" ]; then ((ERRORS++)); fi
 
@@ -187,6 +187,22 @@ else
     exit 1
 fi
 
+# Compilar zlib para ARM
+log_info "Compilando zlib para ARM..."
+if [ -f "$SCRIPT_DIR/build_zlib_arm.sh" ]; then
+    chmod +x "$SCRIPT_DIR/build_zlib_arm.sh"
+    "$SCRIPT_DIR/build_zlib_arm.sh"
+    if [ $? -eq 0 ]; then
+        log_success "zlib compilada com sucesso!"
+    else
+        log_error "Falha na compilação da zlib!"
+        exit 1
+    fi
+else
+    log_error "Script build_zlib_arm.sh não encontrado!"
+    exit 1
+fi
+
 # Verificar se as bibliotecas foram compiladas corretamente
 log_info "Verificando bibliotecas compiladas..."
 
@@ -228,6 +244,16 @@ else
     exit 1
 fi
 
+# Verificar zlib
+ZLIB_PATH="$PROJECT_ROOT/deps/zlib/install/lib/libz.so"
+if [ -f "$ZLIB_PATH" ]; then
+    log_success "zlib encontrada: $ZLIB_PATH"
+    file "$ZLIB_PATH" | grep -q "ARM" && log_success "zlib é ARM" || log_warning "zlib pode não ser ARM"
+else
+    log_error "zlib não encontrada em $ZLIB_PATH"
+    exit 1
+fi
+
 # Verificar se CMakeLists.txt existe
 log_info "Verificando CMakeLists.txt..."
 CMAKE_FILE="$PROJECT_ROOT/CMakeLists.txt"
@@ -290,6 +316,7 @@ log_info "✅ libmodbus compilada para ARM"
 log_info "✅ libgpiod 1.6.3 compilada para ARM"
 log_info "✅ libudev (eudev) compilada para ARM"
 log_info "✅ SQLite3 compilado para ARM"
+log_info "✅ zlib compilada para ARM"
 log_info "✅ CMakeLists.txt verificado"
 log_info "✅ CMake configurado com toolchain ARM"
 log_info "✅ Projeto modbus_reader compila corretamente"
@@ -11,9 +11,13 @@
 #include <stdbool.h>
 #include <pthread.h>
 #include <time.h>
+#include <string.h>
+#include <limits.h>
 #include "modbus.h"
 #include "datalogger.h"
 #include "usb_manager.h"
+#include "log_archive.h"
+#include "gpio_signal.h"
 
 // Configurações da aplicação
 #define LOOP_INTERVAL_SECONDS 300  // 5 minutos = 300 segundos
@@ -34,6 +38,7 @@ typedef struct {
 static void signal_handler(int sig) {
     printf("\nSinal %d recebido. Finalizando aplicação...\n", sig);
     running = false;
+    usb_monitor_wakeup();
 }
 
 /**
@@ -51,6 +56,34 @@ void usb_on_error(usb_result_t error, const char* message) {
     printf("❌ USB Erro [%d]: %s\n", error, message);
 }
 
+/**
+ * @brief Gancho de exportação: snapshot consistente do banco em uso, em fluxo para os pen drives
+ */
+static bool on_export_live(char* name, size_t name_len, usb_export_sink_t write, void* sink, void* user) {
+    datalogger_context_t* ctx = (datalogger_context_t*)user;
+    const char* base = strrchr(ctx->db_file_path, '/');
+    snprintf(name, name_len, "%s", base ? base + 1 : ctx->db_file_path);
+    return datalogger_snapshot_stream(ctx, write, sink) >= 0;
+}
+
+/**
+ * @brief Gancho de exportação: planilha CSV dos registros (últimos DATALOGGER_CSV_EXPORT_DAYS dias)
+ */
+static bool on_export_csv(const char* dest_dir, char* name, size_t name_len, void* user) {
+    datalogger_context_t* ctx = (datalogger_context_t*)user;
+    snprintf(name, name_len, "%s%s", ctx->device_name,
+             DATALOGGER_CSV_GZIP ? DATALOGGER_CSV_GZIP_SUFFIX : DATALOGGER_CSV_SUFFIX);
+
+    long long from_ms = 0;
+    if (DATALOGGER_CSV_EXPORT_DAYS > 0) {
+        from_ms = ((long long)time(NULL) - DATALOGGER_CSV_EXPORT_DAYS * 24LL * 3600) * 1000;
+    }
+
+    char dest_path[DATALOGGER_MAX_PATH * 2];
+    snprintf(dest_path, sizeof(dest_path), "%s/%s", dest_dir, name);
+    return datalogger_export_csv(ctx, dest_path, from_ms, LLONG_MAX, DATALOGGER_CSV_GZIP, NULL);
+}
+
 /**
  * @brief Thread para monitoramento de pen drives
  */
@@ -113,7 +146,41 @@ int main(void) {
         return EXIT_FAILURE;
     }
 
+    // Iniciar arquivamento compactado dos segmentos de execuções anteriores
+    // Um caminho truncado não identificaria o arquivo em uso: sem arquivador nesse caso
+    log_archive_config_t archive_config = {0};
+    bool archive_paths_ok =
+        snprintf(archive_config.source_dir, sizeof(archive_config.source_dir), "%s",
+                 DATALOGGER_LOG_DIR) < (int)sizeof(archive_config.source_dir) &&
+        snprintf(archive_config.device_name, sizeof(archive_config.device_name), "%s",
+                 DEVICE_NAME) < (int)sizeof(archive_config.device_name) &&
+        snprintf(archive_config.live_files[archive_config.live_count++], sizeof(archive_config.live_files[0]),
+                 "%s", datalogger_ctx->log_file_path) < (int)sizeof(archive_config.live_files[0]) &&
+        snprintf(archive_config.live_files[archive_config.live_count++], sizeof(archive_config.live_files[0]),
+                 "%s", datalogger_ctx->db_file_path) < (int)sizeof(archive_config.live_files[0]);
+
+    // Bancos por execução anteriores às partições mensais são consolidados, não compactados
+    bool merge_boot_dbs = DATALOGGER_MERGE_BOOT_DBS && datalogger_ctx->db_partitioned && datalogger_ctx->db;
+    archive_config.keep_db_segments = merge_boot_dbs;
+
+    if (!archive_paths_ok) {
+        printf("⚠️  Aviso: Caminho de log longo demais para o arquivador (continuando sem compactação)\n");
+    } else if (log_archive_start(&archive_config) != 0) {
+        printf("⚠️  Aviso: Falha ao iniciar arquivador (continuando sem compactação)\n");
+    }
+
+    if (merge_boot_dbs && !datalogger_merge_start(datalogger_ctx)) {
+        printf("⚠️  Aviso: Falha ao iniciar consolidação dos bancos por execução\n");
+    }
+
     // Inicializar thread de monitoramento USB
+    usb_export_hooks_t export_hooks = {
+        .export_live = on_export_live,
+        .export_csv = on_export_csv,
+        .user = datalogger_ctx
+    };
+    usb_set_export_hooks(&export_hooks);
+
     pthread_t usb_thread;
     usb_thread_data_t usb_data = {
         .source_dir = "/home/nova",
@@ -136,6 +203,7 @@ int main(void) {
     bool previous_door_state_valid = false;
     uint16_t previous_door_state = 0;
     uint32_t door_change_logs = 0;
+    bool modbus_failing = false;  // Alarme apenas na transição para falha
 
     // Controle de tempo para log periódico
     time_t last_periodic_log = time(NULL);
@@ -148,9 +216,14 @@ int main(void) {
         printf("Lendo registradores Modbus...\n");
 
         if (modbus_read_all(modbus_ctx, &data)) {
+            modbus_failing = false;
+
             // Exibir dados na tela
             modbus_print_data(&data);
 
+            // Amostra bruta de cada ciclo vai para o anel binário
+            datalogger_log_raw(datalogger_ctx, &data);
+
             // Verificar mudança de estado da porta
             if (data.valid_0x20d && previous_door_state_valid) {
                 if (data.addr_0x20d != previous_door_state) {
@@ -191,11 +264,19 @@ int main(void) {
 
         } else {
             printf("❌ Erro: Falha na leitura de todos os registradores\n");
+            if (!modbus_failing) {
+                gpio_signal_play(GPIO_SIGNAL_ALARM);
+                modbus_failing = true;
+            }
 
             // Mesmo com erro, tentar registrar no log para manter histórico
+            datalogger_log_raw(datalogger_ctx, &data);
             datalogger_log_data(datalogger_ctx, &data);
         }
 
+        // Confirmar lote do SQLite aberto há mais de DATALOGGER_DB_BATCH_SECONDS
+        datalogger_db_flush_if_due(datalogger_ctx);
+
         printf("----------------------------------------\n");
 
         // Aguardar próxima leitura (verificação mais frequente para detectar mudanças)
@@ -212,6 +293,9 @@ int main(void) {
     printf("🔌 Finalizando monitoramento USB...\n");
     pthread_join(usb_thread, NULL);
 
+    // Finalizar arquivador
+    log_archive_stop();
+
     // Mostrar estatísticas finais
     datalogger_print_stats(datalogger_ctx);
     printf("Mudanças de porta registradas: %u\n", door_change_logs);
@@ -0,0 +1,82 @@
+/**
+ * @file test_archive_blocks.c
+ * @brief COEL E33 DataLogger - Regressão da compactação em blocos com lote aberto
+ * @author Nova Instruments
+ *
+ * datalogger_archive_blocks() roda na conexão do escritor. Com um lote de
+ * registros ainda não confirmado, uma falha na compactação não pode
+ * descartar os registros já aceitos, e uma compactação bem-sucedida não
+ * pode deixar o estado do lote inconsistente para as inserções seguintes.
+ */
+
+#include "test_common.h"
+#include "datalogger.h"
+
+#define START_MS 1699999200000LL
+#define STEP_MS 300000LL
+
+static bool insert(datalogger_context_t* ctx, int i) {
+    datalogger_db_record_t rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.CollectTime = START_MS + i * STEP_MS;
+    rec.Traw = 40 + i;
+    rec.Tprincipal = rec.Traw / 10.0f;
+    rec.Flags = TS_FLAG_TEMP_VALID | TS_FLAG_DOOR_VALID;
+    return datalogger_insert_db_record(ctx, &rec);
+}
+
+static long long count_rows(const char* path, const char* table) {
+    sqlite3* db = NULL;
+    sqlite3_stmt* stmt = NULL;
+    long long rows = -1;
+    char sql[128];
+    snprintf(sql, sizeof(sql), "SELECT COUNT(*) FROM %s;", table);
+    if (sqlite3_open_v2(path, &db, SQLITE_OPEN_READONLY, NULL) == SQLITE_OK &&
+        sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) == SQLITE_OK &&
+        sqlite3_step(stmt) == SQLITE_ROW) {
+        rows = sqlite3_column_int64(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    sqlite3_close(db);
+    return rows;
+}
+
+static void open_db(datalogger_context_t* ctx, const char* dir, const char* name) {
+    // Lote maior que os registros gravados: a compactação roda com o lote aberto
+    datalogger_db_profile_t profile = DATALOGGER_DB_PROFILE_DEFAULT;
+    profile.batch_rows = 12;
+    profile.batch_seconds = 0;
+    test_open_db(ctx, dir, name, DATALOGGER_DB_SCHEMA_V2, &profile);
+}
+
+int main(void) {
+    char dir[32];
+    if (!test_make_dir(dir)) return EXIT_FAILURE;
+    datalogger_context_t ctx;
+
+    // Compactação bem-sucedida no meio de um lote
+    open_db(&ctx, dir, "ok.db");
+    for (int i = 0; i < 5; i++) CHECK(insert(&ctx, i));
+    CHECK(ctx.db_txn_open);
+    CHECK(datalogger_archive_blocks(&ctx, START_MS, START_MS + 10 * STEP_MS) == 1);
+    for (int i = 5; i < 8; i++) CHECK(insert(&ctx, i));
+    datalogger_cleanup_database(&ctx);
+    CHECK(count_rows(ctx.db_file_path, "DataGrpSamples") == 8);
+    CHECK(count_rows(ctx.db_file_path, "DataGrpBlocks") == 1);
+
+    // Falha na gravação dos blocos (CHECK sempre falso) com lote aberto
+    open_db(&ctx, dir, "fail.db");
+    CHECK(sqlite3_exec(ctx.db, "CREATE TABLE DataGrpBlocks (StartTime INTEGER PRIMARY KEY, "
+                               "EndTime INTEGER NOT NULL, Count INTEGER NOT NULL CHECK (Count < 0), "
+                               "TMin INTEGER NOT NULL, TMax INTEGER NOT NULL, Data BLOB NOT NULL);",
+                       NULL, NULL, NULL) == SQLITE_OK);
+    for (int i = 0; i < 5; i++) CHECK(insert(&ctx, i));
+    CHECK(datalogger_archive_blocks(&ctx, START_MS, START_MS + 10 * STEP_MS) == -1);
+    for (int i = 5; i < 8; i++) CHECK(insert(&ctx, i));
+    datalogger_cleanup_database(&ctx);
+    CHECK(count_rows(ctx.db_file_path, "DataGrpSamples") == 8);
+    CHECK(count_rows(ctx.db_file_path, "DataGrpBlocks") == 0);
+
+    test_remove_dir(dir);
+    return test_summary("compactação em blocos com lote aberto");
+}
@@ -0,0 +1,103 @@
+/**
+ * @file test_common.h
+ * @brief COEL E33 DataLogger - Verificações compartilhadas pelos testes de regressão
+ * @author Nova Instruments
+ *
+ * Cada teste é um executável independente (registrado no CTest) que
+ * termina com EXIT_FAILURE se alguma verificação falhar. Os arquivos de
+ * trabalho ficam em um diretório temporário removido no fim; os testes do
+ * banco abrem a conexão por test_open_db().
+ */
+
+#ifndef TEST_COMMON_H
+#define TEST_COMMON_H
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE  // mkdtemp, nftw
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <ftw.h>
+#include <unistd.h>
+
+#include "datalogger.h"
+
+static int test_checks = 0;
+static int test_failures = 0;
+
+// Registra uma verificação; em caso de falha mostra arquivo, linha e expressão
+#define CHECK(cond) do { \
+    test_checks++; \
+    if (!(cond)) { \
+        fprintf(stderr, "❌ %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+        test_failures++; \
+    } \
+} while (0)
+
+#define CHECK_NEAR(a, b, eps) CHECK(fabs((double)(a) - (double)(b)) <= (eps))
+
+/**
+ * @brief Cria um diretório temporário de trabalho (/tmp/coel_test_XXXXXX)
+ * @param dir Buffer de pelo menos 32 bytes
+ * @return true se o diretório foi criado
+ */
+static inline bool test_make_dir(char* dir) {
+    strcpy(dir, "/tmp/coel_test_XXXXXX");
+    if (!mkdtemp(dir)) {
+        perror("mkdtemp");
+        return false;
+    }
+    return true;
+}
+
+static inline int test_remove_entry(const char* path, const struct stat* st, int type, struct FTW* ftw) {
+    (void)st;
+    (void)type;
+    (void)ftw;
+    return remove(path);
+}
+
+/**
+ * @brief Remove o diretório de trabalho e seu conteúdo
+ */
+static inline void test_remove_dir(const char* dir) {
+    nftw(dir, test_remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+/**
+ * @brief Abre um banco novo no diretório de trabalho
+ * @param ctx Contexto zerado e preenchido aqui
+ * @param name Nome do arquivo .db dentro de dir
+ * @param schema Esquema alvo (DATALOGGER_DB_SCHEMA_V1/V2)
+ * @param profile Perfil do banco; NULL usa DATALOGGER_DB_PROFILE_DEFAULT
+ * @return true se a conexão foi aberta
+ */
+static inline bool test_open_db(datalogger_context_t* ctx, const char* dir, const char* name, int schema,
+                                const datalogger_db_profile_t* profile) {
+    memset(ctx, 0, sizeof(*ctx));
+    snprintf(ctx->db_file_path, sizeof(ctx->db_file_path), "%s/%s", dir, name);
+    ctx->db_schema_target = schema;
+    if (profile) {
+        ctx->db_profile = *profile;
+    }
+    CHECK(datalogger_init_database(ctx));
+    return ctx->db != NULL;
+}
+
+/**
+ * @brief Mostra o resumo do teste
+ * @return Código de saída do processo
+ */
+static inline int test_summary(const char* name) {
+    if (test_failures > 0) {
+        printf("❌ %s: %d de %d verificações falharam\n", name, test_failures, test_checks);
+        return EXIT_FAILURE;
+    }
+    printf("✅ %s: %d verificações\n", name, test_checks);
+    return EXIT_SUCCESS;
+}
+
+#endif // TEST_COMMON_H
@@ -0,0 +1,193 @@
+/**
+ * @file test_csv_export.c
+ * @brief COEL E33 DataLogger - Regressão da exportação CSV (planilha)
+ * @author Nova Instruments
+ *
+ * A planilha é formatada sem printf/strftime por linha (ponto fixo e
+ * prefixo de hora em cache). Compara a saída, byte a byte, com uma
+ * formatação de referência por snprintf/strftime: temperaturas negativas
+ * e 0,0 °C, leituras inválidas (ERROR), viradas de hora e dia, mais linhas
+ * que o buffer, intervalo inclusivo, saída gzip e bancos v1 e v2.
+ */
+
+#include "test_common.h"
+#include "datalogger.h"
+
+#include <zlib.h>
+
+#define START_MS 1699999200000LL    // 14/11/2023 22:00:00 UTC
+#define STEP_MS 60000LL
+#define ROWS 5000                   // ~120 KB de CSV: mais de um buffer
+
+static char* read_file(const char* path, size_t* len) {
+    FILE* fp = fopen(path, "rb");
+    if (!fp) return NULL;
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    char* data = malloc((size_t)size + 1);
+    *len = data ? fread(data, 1, (size_t)size, fp) : 0;
+    if (data) data[*len] = '\0';
+    fclose(fp);
+    return data;
+}
+
+static char* read_gzip(const char* path, size_t* len) {
+    gzFile gz = gzopen(path, "rb");
+    if (!gz) return NULL;
+    size_t capacity = 1 << 20;
+    char* data = malloc(capacity);
+    *len = 0;
+    int n;
+    while (data && (n = gzread(gz, data + *len, (unsigned)(capacity - *len - 1))) > 0) {
+        *len += (size_t)n;
+        if (capacity - *len < 4096) {
+            capacity *= 2;
+            data = realloc(data, capacity);
+        }
+    }
+    gzclose(gz);
+    if (data) data[*len] = '\0';
+    return data;
+}
+
+/**
+ * @brief Linha de referência (formato do log TXT, CRLF)
+ */
+static size_t reference_row(char* out, size_t size, long long t_ms, int temp, uint8_t flags) {
+    time_t secs = (time_t)(t_ms / 1000);
+    struct tm tm_info;
+    char datetime[32];
+    char temp_str[16];
+    localtime_r(&secs, &tm_info);
+    strftime(datetime, sizeof(datetime), "%d/%m/%Y %H:%M:%S", &tm_info);
+    if (flags & TS_FLAG_TEMP_VALID) {
+        snprintf(temp_str, sizeof(temp_str), "%.1f", temp / 10.0);
+    } else {
+        snprintf(temp_str, sizeof(temp_str), "ERROR");
+    }
+    return (size_t)snprintf(out, size, "%s;%s;%s\r\n", datetime, temp_str,
+                            !(flags & TS_FLAG_DOOR_VALID) ? "ERROR" : (flags & TS_FLAG_DOOR_OPEN) ? "1" : "0");
+}
+
+static int sample_temp(int i) {
+    return (i % 400) - 150;    // -15,0 °C a 24,9 °C, passando por 0,0 °C
+}
+
+static uint8_t sample_flags(int i) {
+    uint8_t flags = TS_FLAG_TEMP_VALID | TS_FLAG_DOOR_VALID | ((i % 5 == 0) ? TS_FLAG_DOOR_OPEN : 0);
+    if (i % 7 == 3) flags &= (uint8_t)~TS_FLAG_TEMP_VALID;                      // Falha na temperatura
+    if (i % 11 == 4) flags &= (uint8_t)~(TS_FLAG_DOOR_VALID | TS_FLAG_DOOR_OPEN); // Falha na porta
+    return flags;
+}
+
+/**
+ * @brief CSV esperado para as amostras [first, last]
+ */
+static char* reference_csv(int first, int last, size_t* len) {
+    char* data = malloc(64 + (size_t)(last - first + 1) * 64);
+    if (!data) return NULL;
+    *len = (size_t)sprintf(data, "Data Hora;TPrincipal;PA\r\n");
+    for (int i = first; i <= last; i++) {
+        *len += reference_row(data + *len, 64, START_MS + i * STEP_MS, sample_temp(i), sample_flags(i));
+    }
+    return data;
+}
+
+static bool open_db(datalogger_context_t* ctx, const char* dir, int schema) {
+    char name[32];
+    snprintf(name, sizeof(name), "csv_v%d.db", schema);
+    return test_open_db(ctx, dir, name, schema, NULL);
+}
+
+static void check_export(datalogger_context_t* ctx, const char* path, long long from_ms, long long to_ms,
+                         bool gzip, const char* expected, size_t expected_len, long long rows) {
+    datalogger_csv_stats_t stats;
+    CHECK(datalogger_export_csv(ctx, path, from_ms, to_ms, gzip, &stats));
+    CHECK(stats.rows == rows);
+    CHECK(stats.csv_bytes == expected_len);
+
+    size_t len = 0;
+    char* data = gzip ? read_gzip(path, &len) : read_file(path, &len);
+    CHECK(data != NULL);
+    CHECK(len == expected_len);
+    if (data && len == expected_len) {
+        CHECK(memcmp(data, expected, len) == 0);
+    }
+    free(data);
+}
+
+int main(void) {
+    setenv("TZ", "UTC", 1);
+    tzset();
+
+    char dir[32];
+    if (!test_make_dir(dir)) return EXIT_FAILURE;
+    char path[64];
+    datalogger_context_t ctx;
+
+    // v2: temperatura bruta e flags, incluindo negativas e leituras inválidas
+    if (open_db(&ctx, dir, DATALOGGER_DB_SCHEMA_V2)) {
+        for (int i = 0; i < ROWS; i++) {
+            datalogger_db_record_t rec;
+            memset(&rec, 0, sizeof(rec));
+            rec.CollectTime = START_MS + i * STEP_MS;
+            rec.Flags = sample_flags(i);
+            rec.Traw = (rec.Flags & TS_FLAG_TEMP_VALID) ? sample_temp(i) : 0;
+            rec.Tprincipal = rec.Traw / 10.0f;
+            rec.Porta = (rec.Flags & TS_FLAG_DOOR_OPEN) ? 1 : 0;
+            CHECK(datalogger_insert_db_record(&ctx, &rec));
+        }
+
+        size_t len;
+        char* expected = reference_csv(0, ROWS - 1, &len);
+        snprintf(path, sizeof(path), "%s/all.csv", dir);
+        check_export(&ctx, path, 0, LLONG_MAX, false, expected, len, ROWS);
+        snprintf(path, sizeof(path), "%s/all.csv.gz", dir);
+        check_export(&ctx, path, 0, LLONG_MAX, true, expected, len, ROWS);
+        free(expected);
+
+        // Intervalo inclusivo nas duas pontas
+        expected = reference_csv(100, 250, &len);
+        snprintf(path, sizeof(path), "%s/range.csv", dir);
+        check_export(&ctx, path, START_MS + 100 * STEP_MS, START_MS + 250 * STEP_MS, false, expected, len, 151);
+        free(expected);
+
+        // Intervalo vazio: apenas o cabeçalho
+        expected = reference_csv(1, 0, &len);
+        snprintf(path, sizeof(path), "%s/empty.csv", dir);
+        check_export(&ctx, path, 0, START_MS - 1, false, expected, len, 0);
+        free(expected);
+
+        CHECK(access(path, F_OK) == 0);
+        snprintf(path, sizeof(path), "%s/empty.csv.tmp", dir);
+        CHECK(access(path, F_OK) != 0);
+        datalogger_cleanup_database(&ctx);
+    }
+
+    // v1: Tprincipal REAL arredondado para décimos; sem flags de validade,
+    // 0,0 °C com porta 0 (falha de leitura no v1) sai como ERROR
+    if (open_db(&ctx, dir, DATALOGGER_DB_SCHEMA_V1)) {
+        const int temps[] = { 231, 0, 5, 249, 0 };
+        char expected[512];
+        size_t len = (size_t)sprintf(expected, "Data Hora;TPrincipal;PA\r\n");
+        for (int i = 0; i < 5; i++) {
+            datalogger_db_record_t rec;
+            memset(&rec, 0, sizeof(rec));
+            rec.CollectTime = START_MS + i * STEP_MS;
+            rec.Tprincipal = temps[i] / 10.0f;
+            rec.Porta = i % 2;
+            CHECK(datalogger_insert_db_record(&ctx, &rec));
+            uint8_t flags = temps[i] == 0 && rec.Porta == 0
+                ? 0
+                : TS_FLAG_TEMP_VALID | TS_FLAG_DOOR_VALID | (rec.Porta ? TS_FLAG_DOOR_OPEN : 0);
+            len += reference_row(expected + len, sizeof(expected) - len, rec.CollectTime, temps[i], flags);
+        }
+        snprintf(path, sizeof(path), "%s/v1.csv", dir);
+        check_export(&ctx, path, 0, LLONG_MAX, false, expected, len, 5);
+        datalogger_cleanup_database(&ctx);
+    }
+
+    test_remove_dir(dir);
+    return test_summary("exportação CSV");
+}
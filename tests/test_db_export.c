@@ -0,0 +1,115 @@
+/**
+ * @file test_db_export.c
+ * @brief COEL E33 DataLogger - Regressão da cópia do banco em uso para o pen drive
+ * @author Nova Instruments
+ *
+ * Entre datalogger_db_begin_export() e datalogger_db_end_export() o .db é
+ * copiado enquanto o escritor continua gravando em uma transação aberta.
+ * Com um cache pequeno, o lote passa do tamanho do cache: o arquivo
+ * principal não pode mudar durante a cópia, e os registros do lote devem
+ * ser confirmados no fim. O snapshot em fluxo (banco em WAL) deve chegar
+ * em blocos que formam um banco íntegro e autocontido.
+ */
+
+#include "test_common.h"
+#include "datalogger.h"
+
+#define START_MS 1699999200000LL
+#define STEP_MS 300000LL
+#define ROWS 3000                   // Bem mais páginas que o cache de 16 KiB
+
+static unsigned char* read_file(const char* path, size_t* len) {
+    FILE* fp = fopen(path, "rb");
+    if (!fp) return NULL;
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    unsigned char* data = malloc((size_t)size + 1);
+    *len = data ? fread(data, 1, (size_t)size, fp) : 0;
+    fclose(fp);
+    return data;
+}
+
+static int collect_chunk(const void* data, size_t len, void* user) {
+    FILE* fp = user;
+    return fwrite(data, 1, len, fp) == len ? 0 : -1;
+}
+
+static long long query_int(const char* path, const char* sql) {
+    sqlite3* db = NULL;
+    sqlite3_stmt* stmt = NULL;
+    long long value = -1;
+    if (sqlite3_open_v2(path, &db, SQLITE_OPEN_READONLY, NULL) == SQLITE_OK &&
+        sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) == SQLITE_OK &&
+        sqlite3_step(stmt) == SQLITE_ROW) {
+        value = sqlite3_column_type(stmt, 0) == SQLITE_TEXT
+            ? (strcmp((const char*)sqlite3_column_text(stmt, 0), "ok") == 0 ? 1 : 0)
+            : sqlite3_column_int64(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    sqlite3_close(db);
+    return value;
+}
+
+static bool insert(datalogger_context_t* ctx, int i) {
+    datalogger_db_record_t rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.CollectTime = START_MS + i * STEP_MS;
+    rec.Traw = (int16_t)(i % 300);
+    rec.Tprincipal = rec.Traw / 10.0f;
+    rec.Flags = TS_FLAG_TEMP_VALID | TS_FLAG_DOOR_VALID;
+    return datalogger_insert_db_record(ctx, &rec);
+}
+
+int main(void) {
+    char dir[32];
+    if (!test_make_dir(dir)) return EXIT_FAILURE;
+
+    datalogger_context_t ctx;
+    datalogger_db_profile_t profile = DATALOGGER_DB_PROFILE_DEFAULT;
+    profile.cache_kb = 16;
+    if (!test_open_db(&ctx, dir, "export.db", DATALOGGER_DB_SCHEMA_V2, &profile)) return EXIT_FAILURE;
+    CHECK(insert(&ctx, 0));
+
+    CHECK(datalogger_db_begin_export(&ctx));
+    size_t before_len = 0;
+    unsigned char* before = read_file(ctx.db_file_path, &before_len);
+    CHECK(before != NULL);
+
+    // Registros gravados durante a cópia: nenhuma página vai para o .db
+    for (int i = 1; i < ROWS; i++) CHECK(insert(&ctx, i));
+    size_t during_len = 0;
+    unsigned char* during = read_file(ctx.db_file_path, &during_len);
+    CHECK(during != NULL);
+    CHECK(during_len == before_len);
+    if (before && during && during_len == before_len) {
+        CHECK(memcmp(before, during, before_len) == 0);
+    }
+    free(before);
+    free(during);
+
+    datalogger_db_end_export(&ctx);
+
+    // Snapshot em fluxo do banco de volta ao WAL, com um registro gravado após a cópia externa
+    CHECK(insert(&ctx, ROWS));
+    char snap_path[64];
+    snprintf(snap_path, sizeof(snap_path), "%s/snapshot.db", dir);
+    FILE* fp = fopen(snap_path, "wb");
+    CHECK(fp != NULL);
+    long long bytes = fp ? datalogger_snapshot_stream(&ctx, collect_chunk, fp) : -1;
+    if (fp) fclose(fp);
+    CHECK(bytes > 0);
+    size_t snap_len = 0;
+    unsigned char* snap = read_file(snap_path, &snap_len);
+    CHECK(snap != NULL && (long long)snap_len == bytes);
+    CHECK(snap != NULL && snap_len > 19 && snap[18] == 1 && snap[19] == 1);   // Cabeçalho sem WAL
+    free(snap);
+    CHECK(query_int(snap_path, "PRAGMA integrity_check;") == 1);
+    CHECK(query_int(snap_path, "SELECT COUNT(*) FROM DataGrpSamples;") == ROWS + 1);
+    datalogger_cleanup_database(&ctx);
+
+    CHECK(query_int(ctx.db_file_path, "SELECT COUNT(*) FROM DataGrpSamples;") == ROWS + 1);
+
+    test_remove_dir(dir);
+    return test_summary("cópia do banco em uso");
+}
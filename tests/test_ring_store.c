@@ -0,0 +1,135 @@
+/**
+ * @file test_ring_store.c
+ * @brief COEL E33 DataLogger - Regressão do anel binário após escrita interrompida
+ * @author Nova Instruments
+ *
+ * O anel é gravado com msync assíncrono: após uma queda de energia, o
+ * cabeçalho e as páginas de registros podem estar em momentos diferentes.
+ * Simula um registro final zerado, um cabeçalho atrasado e um bit trocado
+ * no meio do anel, editando o arquivo entre aberturas, e confere a busca
+ * por tempo após um ajuste do relógio para trás.
+ */
+
+#include "test_common.h"
+#include "ring_store.h"
+
+#include <fcntl.h>
+#include <stddef.h>
+
+#define CAPACITY 64
+
+static ring_store_record_t make_record(int64_t ts, uint16_t value) {
+    ring_store_record_t r;
+    memset(&r, 0, sizeof(r));
+    r.timestamp_ms = ts;
+    r.register_id = 0x200;
+    r.value = value;
+    r.slave_id = 1;
+    r.flags = RING_FLAG_VALID;
+    return r;
+}
+
+static ring_store_t* create_ring(const char* path, int count) {
+    remove(path);
+    ring_store_t* rs = ring_store_open(path, CAPACITY, false);
+    CHECK(rs != NULL);
+    if (!rs) return NULL;
+    for (int i = 0; i < count; i++) {
+        ring_store_record_t r = make_record(1000 + i, (uint16_t)i);
+        CHECK(ring_store_append(rs, &r));
+    }
+    return rs;
+}
+
+static void write_at(const char* path, off_t offset, const void* data, size_t size) {
+    int fd = open(path, O_WRONLY);
+    CHECK(fd >= 0);
+    if (fd < 0) return;
+    CHECK(pwrite(fd, data, size, offset) == (ssize_t)size);
+    close(fd);
+}
+
+static off_t record_offset(uint64_t index) {
+    return RING_STORE_HEADER_SIZE + (off_t)(index % CAPACITY) * (off_t)sizeof(ring_store_record_t);
+}
+
+static uint64_t head_of(ring_store_t* rs) {
+    ring_store_header_t h;
+    ring_store_get_header(rs, &h);
+    return h.head;
+}
+
+int main(void) {
+    char dir[32];
+    if (!test_make_dir(dir)) return EXIT_FAILURE;
+    char path[64];
+    snprintf(path, sizeof(path), "%s/test.ring", dir);
+    ring_store_record_t out[CAPACITY];
+    uint64_t index;
+
+    // Registro final zerado (página não gravada): sai do anel na reabertura
+    ring_store_close(create_ring(path, 10));
+    ring_store_record_t zero;
+    memset(&zero, 0, sizeof(zero));
+    write_at(path, record_offset(9), &zero, sizeof(zero));
+    ring_store_t* rs = ring_store_open(path, CAPACITY, false);
+    CHECK(rs != NULL);
+    if (!rs) return EXIT_FAILURE;
+    CHECK(head_of(rs) == 9);
+    index = 0;
+    CHECK(ring_store_read(rs, &index, out, CAPACITY) == 9);
+    CHECK(index == 9);
+    CHECK(out[8].timestamp_ms == 1008);
+    ring_store_record_t next = make_record(1009, 9);
+    CHECK(ring_store_append(rs, &next));
+    ring_store_close(rs);
+
+    // Cabeçalho atrasado: registros válidos além de head voltam ao anel
+    uint64_t stale_head = 7;
+    write_at(path, offsetof(ring_store_header_t, head), &stale_head, sizeof(stale_head));
+    rs = ring_store_open(path, CAPACITY, false);
+    CHECK(head_of(rs) == 10);
+    ring_store_close(rs);
+
+    // Bit trocado no meio: pulado na leitura, índices continuam consecutivos
+    ring_store_close(create_ring(path, 10));
+    uint16_t corrupt = 0x0201;
+    write_at(path, record_offset(4) + offsetof(ring_store_record_t, register_id), &corrupt, sizeof(corrupt));
+    rs = ring_store_open(path, 0, true);
+    index = 0;
+    CHECK(ring_store_read(rs, &index, out, CAPACITY) == 4);
+    CHECK(index == 4);
+    CHECK(ring_store_read(rs, &index, out, CAPACITY) == 5);
+    CHECK(index == 10);
+    CHECK(out[0].timestamp_ms == 1005);
+    index = ring_store_find_time(rs, 1004);       // Índice 4 (inválido): a leitura pula para 1005
+    CHECK(ring_store_read(rs, &index, out, 1) == 1);
+    CHECK(out[0].timestamp_ms == 1005);
+    CHECK(ring_store_find_time(rs, 1003) == 3);
+    ring_store_close(rs);
+
+    // Relógio ajustado para trás: 1000..1009 e depois 500..505
+    rs = create_ring(path, 10);
+    for (int i = 0; i < 6; i++) {
+        ring_store_record_t r = make_record(500 + i, (uint16_t)(100 + i));
+        CHECK(ring_store_append(rs, &r));
+    }
+    ring_store_header_t h;
+    ring_store_get_header(rs, &h);
+    CHECK(h.time_step == 10);
+    CHECK(ring_store_find_time(rs, 503) == 13);   // Sequência após o ajuste
+    CHECK(ring_store_find_time(rs, 499) == 0);    // Anterior às duas sequências
+    CHECK(ring_store_find_time(rs, 1005) == 5);   // Sequência antes do ajuste
+    CHECK(ring_store_find_time(rs, 2000) == 16);  // Posterior às duas: head
+    ring_store_close(rs);
+
+    // O índice do ajuste sobrevive à reabertura
+    rs = ring_store_open(path, 0, true);
+    ring_store_get_header(rs, &h);
+    CHECK(h.time_step == 10);
+    CHECK(ring_store_find_time(rs, 504) == 14);
+    ring_store_close(rs);
+
+    test_remove_dir(dir);
+    return test_summary("anel após escrita interrompida");
+}
@@ -0,0 +1,104 @@
+/**
+ * @file test_rollup.c
+ * @brief COEL E33 DataLogger - Regressão dos agregados horários com leituras inválidas
+ * @author Nova Instruments
+ *
+ * Grava, nos esquemas v1 e v2, uma hora com temperatura válida, uma falha
+ * de leitura Modbus (temperatura e porta inválidas) e outra temperatura
+ * válida, com a porta aberta antes da falha e fechada depois. O agregado
+ * não pode contar a falha como 0,0 °C nem como porta fechada, nem na
+ * reconstrução a partir das linhas gravadas (no v1, 0,0 / porta 0) nem
+ * depois de migrar o banco v1 para o v2.
+ */
+
+#include "test_common.h"
+#include "datalogger.h"
+
+#define HOUR_START 1699999200000LL   // Início de uma hora UTC
+#define STEP_MS 60000LL
+
+typedef struct {
+    int rows;
+    datalogger_query_row_t row;
+} rollup_result_t;
+
+static bool keep_row(const datalogger_query_row_t* row, void* user) {
+    rollup_result_t* r = user;
+    r->row = *row;
+    r->rows++;
+    return true;
+}
+
+static bool insert(datalogger_context_t* ctx, long long t_ms, bool temp_valid, uint16_t temp,
+                   bool door_valid, bool door_open) {
+    datalogger_record_t txt;
+    memset(&txt, 0, sizeof(txt));
+    time_t secs = (time_t)(t_ms / 1000);
+    localtime_r(&secs, &txt.timestamp);
+    txt.temperature = temp;
+    txt.temp_valid = temp_valid;
+    txt.door_open = door_open;
+    txt.door_valid = door_valid;
+
+    datalogger_db_record_t rec;
+    return datalogger_convert_to_db_record(&txt, &rec) && datalogger_insert_db_record(ctx, &rec);
+}
+
+static void check_hour(datalogger_context_t* ctx) {
+    rollup_result_t r = { 0 };
+    CHECK(datalogger_query_rollup(ctx, DATALOGGER_ROLLUP_HOURLY, HOUR_START, HOUR_START,
+                                  keep_row, &r) == 1);
+    CHECK(r.rows == 1);
+    CHECK(r.row.count == 2);                          // Falha de leitura fora da contagem
+    CHECK_NEAR(r.row.temp_min, 4.0, 1e-6);            // E fora do mínimo (não 0,0 °C)
+    CHECK_NEAR(r.row.temp_max, 6.5, 1e-6);
+    CHECK_NEAR(r.row.temp_avg, 5.25, 1e-6);
+    CHECK(r.row.door_open_count == 1);
+    CHECK(r.row.door_open_ms == 2 * STEP_MS);         // Aberta até a leitura válida seguinte
+}
+
+static void run_schema(const char* dir, int schema) {
+    datalogger_context_t ctx;
+    char name[32];
+    snprintf(name, sizeof(name), "rollup_v%d.db", schema);
+    if (!test_open_db(&ctx, dir, name, schema, NULL)) return;
+
+    CHECK(insert(&ctx, HOUR_START, true, 40, true, true));
+    CHECK(insert(&ctx, HOUR_START + STEP_MS, false, 0, false, false));
+    CHECK(insert(&ctx, HOUR_START + 2 * STEP_MS, true, 65, true, false));
+    CHECK(datalogger_db_flush(&ctx));
+    check_hour(&ctx);
+
+    // No v1 a falha fica gravada como 0,0 / porta 0 e sai da reconstrução
+    CHECK(datalogger_rebuild_rollups(&ctx));
+    check_hour(&ctx);
+
+    datalogger_cleanup_database(&ctx);
+}
+
+/**
+ * @brief Banco v1 com a falha de leitura migrado para o v2 e recalculado
+ */
+static void run_migration(const char* dir) {
+    datalogger_context_t ctx;
+    char name[32];
+    snprintf(name, sizeof(name), "rollup_v%d.db", DATALOGGER_DB_SCHEMA_V1);
+    if (!test_open_db(&ctx, dir, name, DATALOGGER_DB_SCHEMA_V2, NULL)) return;
+    CHECK(ctx.db_schema == DATALOGGER_DB_SCHEMA_V2);
+    CHECK(datalogger_rebuild_rollups(&ctx));
+    check_hour(&ctx);
+
+    datalogger_cleanup_database(&ctx);
+}
+
+int main(void) {
+    char dir[32];
+    if (!test_make_dir(dir)) return EXIT_FAILURE;
+
+    run_schema(dir, DATALOGGER_DB_SCHEMA_V1);
+    run_schema(dir, DATALOGGER_DB_SCHEMA_V2);
+    run_migration(dir);
+
+    test_remove_dir(dir);
+    return test_summary("agregados com leituras inválidas");
+}
@@ -0,0 +1,111 @@
+/**
+ * @file test_ts_block.c
+ * @brief COEL E33 DataLogger - Regressão dos blocos compactados de histórico
+ * @author Nova Instruments
+ *
+ * Codifica amostras com intervalo irregular, temperaturas negativas,
+ * leituras inválidas e mudanças de porta, e confere a decodificação e o
+ * cabeçalho. Um bloco só com leituras inválidas não pode ter o mesmo
+ * cabeçalho de um bloco a 0,0 °C.
+ */
+
+#include "test_common.h"
+#include "ts_block.h"
+
+#define START_MS 1699999200000LL
+#define STEP_MS 300000LL
+
+static ts_sample_t make_sample(long long t_ms, int16_t temp, uint8_t flags) {
+    ts_sample_t s = { .collect_time = t_ms, .temperature = temp, .flags = flags };
+    return s;
+}
+
+static ts_block_header_t encode(const ts_sample_t* samples, int count, bool pad, const uint8_t** block,
+                                size_t* len, ts_block_encoder_t* enc) {
+    ts_block_encoder_init(enc);
+    for (int i = 0; i < count; i++) {
+        CHECK(ts_block_append(enc, &samples[i]));
+    }
+    *block = ts_block_finish(enc, pad, len);
+    ts_block_header_t header;
+    memset(&header, 0, sizeof(header));
+    CHECK(ts_block_read_header(*block, *len, &header));
+    return header;
+}
+
+int main(void) {
+    static ts_block_encoder_t enc;
+    const uint8_t* block;
+    size_t len;
+    ts_sample_t out[64];
+    const uint8_t ok = TS_FLAG_TEMP_VALID | TS_FLAG_DOOR_VALID;
+
+    // Ida e volta: intervalo irregular, negativas, leitura inválida e porta aberta
+    const ts_sample_t samples[] = {
+        make_sample(START_MS, 45, ok),
+        make_sample(START_MS + STEP_MS, 44, ok),
+        make_sample(START_MS + 2 * STEP_MS, 0, 0),                            // Falha Modbus
+        make_sample(START_MS + 2 * STEP_MS + 7000, -12, ok | TS_FLAG_DOOR_OPEN),
+        make_sample(START_MS + 3 * STEP_MS, -180, ok),
+        make_sample(START_MS + 3 * STEP_MS, 310, ok),                        // Mesmo instante
+    };
+    const int count = (int)(sizeof(samples) / sizeof(samples[0]));
+    ts_block_header_t h = encode(samples, count, false, &block, &len, &enc);
+    CHECK(h.count == count);
+    CHECK(h.start_time == START_MS);
+    CHECK(h.end_time == START_MS + 3 * STEP_MS);
+    CHECK(ts_block_has_temp(&h));
+    CHECK(h.temp_min == -180);
+    CHECK(h.temp_max == 310);
+    CHECK(len == sizeof(ts_block_header_t) + h.data_bytes);
+
+    CHECK(ts_block_decode(block, len, out, 64) == count);
+    for (int i = 0; i < count; i++) {
+        CHECK(out[i].collect_time == samples[i].collect_time);
+        CHECK(out[i].temperature == samples[i].temperature);
+        CHECK(out[i].flags == samples[i].flags);
+    }
+    CHECK(ts_block_decode(block, len, out, 2) == 2);        // Buffer menor que o bloco
+    CHECK(ts_block_decode(block, len - 1, out, 64) == -1);  // Bloco truncado
+
+    // Bloco completado até TS_BLOCK_SIZE decodifica igual
+    h = encode(samples, count, true, &block, &len, &enc);
+    CHECK(len == TS_BLOCK_SIZE);
+    CHECK(ts_block_decode(block, len, out, 64) == count);
+
+    // Só leituras inválidas: sem mínimo/máximo, distinto de um bloco a 0,0 °C
+    const ts_sample_t invalid[] = {
+        make_sample(START_MS, 0, 0),
+        make_sample(START_MS + STEP_MS, 0, TS_FLAG_DOOR_VALID),
+    };
+    h = encode(invalid, 2, false, &block, &len, &enc);
+    CHECK(h.count == 2);
+    CHECK(!ts_block_has_temp(&h));
+    CHECK(h.temp_min == TS_BLOCK_NO_TEMP_MIN);
+    CHECK(h.temp_max == TS_BLOCK_NO_TEMP_MAX);
+    CHECK(ts_block_decode(block, len, out, 64) == 2);
+    CHECK(out[1].flags == TS_FLAG_DOOR_VALID);
+
+    const ts_sample_t zero[] = { make_sample(START_MS, 0, ok) };
+    h = encode(zero, 1, false, &block, &len, &enc);
+    CHECK(ts_block_has_temp(&h));
+    CHECK(h.temp_min == 0);
+    CHECK(h.temp_max == 0);
+
+    // Bloco cheio: a amostra que não cabe é recusada e as anteriores continuam legíveis
+    ts_block_encoder_init(&enc);
+    int appended = 0;
+    for (int i = 0; i < 100000; i++) {
+        ts_sample_t s = make_sample(START_MS + (long long)i * i * 1000, (int16_t)((i % 2) ? -3000 : 3000), ok);
+        if (!ts_block_append(&enc, &s)) break;
+        appended++;
+    }
+    CHECK(appended > 0 && appended < 100000);
+    CHECK(ts_block_count(&enc) == appended);
+    block = ts_block_finish(&enc, true, &len);
+    static ts_sample_t full[TS_BLOCK_SIZE];
+    CHECK(ts_block_decode(block, len, full, TS_BLOCK_SIZE) == appended);
+    CHECK(full[appended - 1].collect_time == START_MS + (long long)(appended - 1) * (appended - 1) * 1000);
+
+    return test_summary("blocos compactados");
+}
@@ -0,0 +1,160 @@
+/**
+ * @file test_usb_resume.c
+ * @brief COEL E33 DataLogger - Regressão da retomada de cópia para o pen drive
+ * @author Nova Instruments
+ *
+ * Monta no "pen drive" (diretório temporário) o estado deixado por uma
+ * extração interrompida: nome.part com o prefixo gravado e a entrada
+ * parcial no manifesto (bytes e CRC32C do prefixo). A exportação seguinte
+ * deve continuar do ponto de controle, chegar ao mesmo arquivo e CRC de
+ * uma cópia completa e recomeçar do zero quando a origem mudou ou o .part
+ * ficou menor que o ponto registrado.
+ */
+
+#include "test_common.h"
+#include "usb_export.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#define FILE_NAME "NI00002_20240915_160000.db"
+#define FILE_BYTES (3 * 1024 * 1024 + 123)
+#define CHECKPOINT_BYTES (1024 * 1024)
+
+static unsigned char* source_data;
+
+static bool write_file(const char* path, const void* data, size_t len) {
+    FILE* fp = fopen(path, "wb");
+    if (!fp) return false;
+    bool ok = fwrite(data, 1, len, fp) == len;
+    return fclose(fp) == 0 && ok;
+}
+
+static bool same_as_source(const char* path) {
+    FILE* fp = fopen(path, "rb");
+    if (!fp) return false;
+    unsigned char* data = malloc(FILE_BYTES + 1);
+    size_t got = data ? fread(data, 1, FILE_BYTES + 1, fp) : 0;
+    fclose(fp);
+    bool same = got == FILE_BYTES && memcmp(data, source_data, FILE_BYTES) == 0;
+    free(data);
+    return same;
+}
+
+/**
+ * @brief Estado de uma cópia interrompida após o ponto de controle
+ * @param part_bytes Bytes gravados no .part (podem passar do ponto de controle)
+ */
+static void interrupted_copy(const char* src_dir, const char* usb_dir, size_t part_bytes) {
+    char path[128];
+    struct stat st;
+    snprintf(path, sizeof(path), "%s/%s", src_dir, FILE_NAME);
+    CHECK(stat(path, &st) == 0);
+
+    snprintf(path, sizeof(path), "%s/%s%s", usb_dir, FILE_NAME, USB_EXPORT_PART_SUFFIX);
+    CHECK(write_file(path, source_data, part_bytes));
+
+    usb_export_manifest_t manifest = { 0 };
+    usb_export_entry_t partial;
+    memset(&partial, 0, sizeof(partial));
+    snprintf(partial.name, sizeof(partial.name), "%s", FILE_NAME);
+    partial.bytes = CHECKPOINT_BYTES;
+    partial.src_size = (unsigned long long)st.st_size;
+    partial.src_mtime_ns = (long long)st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+    partial.crc = usb_export_crc32c(0, source_data, CHECKPOINT_BYTES);
+    partial.partial = true;
+    CHECK(usb_export_manifest_set(&manifest, &partial) == 0);
+    CHECK(usb_export_manifest_save(usb_dir, &manifest) == 0);
+    usb_export_manifest_free(&manifest);
+}
+
+/**
+ * @brief Exportação seguinte: carrega o manifesto do pen drive, copia e grava o manifesto
+ */
+static usb_export_stats_t export_again(const char* src_dir, const char* usb_dir, uint32_t* crc) {
+    usb_export_manifest_t manifest;
+    CHECK(usb_export_manifest_load(usb_dir, &manifest));
+    usb_export_stats_t stats;
+    CHECK(usb_export_copy_dir(src_dir, usb_dir, USB_EXPORT_DB_PREFIX, USB_EXPORT_DB_SUFFIX, NULL,
+                              &manifest, NULL, NULL, &stats) == 0);
+    usb_export_entry_t* entry = usb_export_manifest_find(&manifest, FILE_NAME);
+    CHECK(entry != NULL);
+    if (entry) {
+        CHECK(!entry->partial);
+        CHECK(entry->bytes == FILE_BYTES);
+        *crc = entry->crc;
+    }
+    CHECK(usb_export_manifest_save(usb_dir, &manifest) == 0);
+    usb_export_manifest_free(&manifest);
+    return stats;
+}
+
+int main(void) {
+    char dir[32];
+    if (!test_make_dir(dir)) return EXIT_FAILURE;
+    char src_dir[64];
+    char usb_dir[64];
+    char path[128];
+    snprintf(src_dir, sizeof(src_dir), "%s/src", dir);
+    snprintf(usb_dir, sizeof(usb_dir), "%s/usb", dir);
+    CHECK(mkdir(src_dir, 0755) == 0);
+    CHECK(mkdir(usb_dir, 0755) == 0);
+
+    source_data = malloc(FILE_BYTES);
+    if (!source_data) return EXIT_FAILURE;
+    uint32_t x = 12345;
+    for (size_t i = 0; i < FILE_BYTES; i++) {
+        x = x * 1103515245u + 12345u;
+        source_data[i] = (unsigned char)(x >> 16);
+    }
+    const uint32_t full_crc = usb_export_crc32c(0, source_data, FILE_BYTES);
+    snprintf(path, sizeof(path), "%s/%s", src_dir, FILE_NAME);
+    CHECK(write_file(path, source_data, FILE_BYTES));
+    char dest_path[128];
+    snprintf(dest_path, sizeof(dest_path), "%s/%s", usb_dir, FILE_NAME);
+    char part_path[160];
+    snprintf(part_path, sizeof(part_path), "%s%s", dest_path, USB_EXPORT_PART_SUFFIX);
+    uint32_t crc = 0;
+
+    // .part além do ponto de controle (bytes sem fdatasync): truncado e retomado
+    interrupted_copy(src_dir, usb_dir, CHECKPOINT_BYTES + 4096);
+    usb_export_stats_t stats = export_again(src_dir, usb_dir, &crc);
+    CHECK(stats.resumed == 1);
+    CHECK(stats.resumed_bytes == CHECKPOINT_BYTES);
+    CHECK(stats.bytes == FILE_BYTES - CHECKPOINT_BYTES);
+    CHECK(stats.files == 1 && stats.failed == 0);
+    CHECK(crc == full_crc);
+    CHECK(same_as_source(dest_path));
+    CHECK(access(part_path, F_OK) != 0);
+
+    // Nada mudou: a próxima exportação pula o arquivo
+    stats = export_again(src_dir, usb_dir, &crc);
+    CHECK(stats.skipped == 1 && stats.bytes == 0);
+
+    // .part menor que o ponto de controle (pen drive sem os dados): cópia completa
+    remove(dest_path);
+    interrupted_copy(src_dir, usb_dir, CHECKPOINT_BYTES / 2);
+    stats = export_again(src_dir, usb_dir, &crc);
+    CHECK(stats.resumed == 0);
+    CHECK(stats.bytes == FILE_BYTES);
+    CHECK(crc == full_crc);
+    CHECK(same_as_source(dest_path));
+
+    // Origem alterada depois da interrupção: o prefixo não vale mais
+    remove(dest_path);
+    interrupted_copy(src_dir, usb_dir, CHECKPOINT_BYTES);
+    source_data[10] ^= 0xFF;
+    struct timespec later[2] = { { 0, UTIME_OMIT }, { 2000000000, 0 } };
+    snprintf(path, sizeof(path), "%s/%s", src_dir, FILE_NAME);
+    CHECK(write_file(path, source_data, FILE_BYTES));
+    CHECK(utimensat(AT_FDCWD, path, later, 0) == 0);
+    stats = export_again(src_dir, usb_dir, &crc);
+    CHECK(stats.resumed == 0);
+    CHECK(stats.bytes == FILE_BYTES);
+    CHECK(crc == usb_export_crc32c(0, source_data, FILE_BYTES));
+    CHECK(same_as_source(dest_path));
+
+    free(source_data);
+    test_remove_dir(dir);
+    return test_summary("retomada da cópia para o pen drive");
+}
@@ -0,0 +1,1640 @@
+/**
+ * @file datalogger_bench.c
+ * @brief COEL E33 DataLogger - Benchmarks de armazenamento
+ * @author Nova Instruments
+ *
+ * Uso: datalogger_bench <comando> [argumentos]
+ *   blocks [arquivo.db] [-o saida.tsb]
+ *       Codifica DataGrpData em blocos ts_block e mede taxa de compressão e
+ *       vazão de codificação/decodificação. Sem arquivo, usa um ano sintético
+ *       de amostras a cada 5 minutos.
+ *   insert [-n linhas] [-l atraso_us] [diretório]
+ *       Compara a inserção antiga (prepare/finalize por linha, UPDATE via
+ *       sqlite3_exec, journal DELETE) com o caminho e perfil atuais. A latência
+ *       de fsync de um cartão SD (padrão 3000 µs) é somada ao tempo medido,
+ *       uma vez por sincronização contada no VFS.
+ *   fsync [-H horas] [-r registros_por_hora] [diretório]
+ *       Compara sincronizações e bytes escritos por hora entre o perfil
+ *       antigo (journal DELETE, synchronous FULL, um registro por transação)
+ *       e o perfil padrão atual (DATALOGGER_DB_PROFILE_DEFAULT), incluindo
+ *       o fechamento do banco. O lote por tempo não é simulado.
+ *   query [arquivo.db]
+ *       Latência de datalogger_query_range() (brutos e agregados) e de
+ *       datalogger_query_rollup() no banco
+ *       informado ou em um ano sintético; no ano sintético, repete as
+ *       consultas sem o índice de CollectTime para comparação.
+ *   partition [diretório]
+ *       Grava um ano sintético em partições mensais e em um banco único,
+ *       compara consultas de um ano nos dois arranjos e o custo de descartar
+ *       o mês mais antigo (remoção da partição x DELETE + VACUUM).
+ *   schema [diretório]
+ *       Grava um ano sintético nos esquemas v1 e v2 com o perfil padrão e
+ *       compara vazão de inserção, bytes escritos e bytes em disco por
+ *       registro; confere a visão de compatibilidade e mede a migração de
+ *       um banco v1 para o v2.
+ *   profile [diretório]
+ *       Repete um ano de inserções e um conjunto de consultas por intervalo
+ *       para cada variação de cache_size, mmap_size, page_size e
+ *       journal_size_limit (um processo por perfil) e mostra vazão,
+ *       latência de inserção, amplificação de escrita, RSS de pico e
+ *       memória do SQLite.
+ *   merge [diretório]
+ *       Divide um ano sintético em bancos por execução no formato antigo
+ *       (com uma hora repetida entre execuções), consolida-os nas partições
+ *       mensais e mostra vazão, bytes escritos, arquivos antes e depois e a
+ *       deduplicação ao repetir um banco já consolidado.
+ *   csv [diretório] [destino]
+ *       Grava um ano sintético em partições mensais e exporta o ano em CSV
+ *       (um processo por caso): datalogger_query_range() com strftime() e
+ *       fprintf() por linha x datalogger_export_csv(), sem e com gzip, e um
+ *       mês com gzip (memória independente do intervalo). Mostra vazão,
+ *       tamanho e RSS de pico e confere que as saídas são idênticas. O
+ *       destino (padrão: o diretório) pode ser um pen drive montado.
+ *   archive [-d diretório] [segmento...]
+ *       Compacta segmentos (TXT ou .db de execuções anteriores; sem
+ *       argumento, uma execução sintética de 30 dias nos dois formatos) em
+ *       gzip nos níveis 1, LOG_ARCHIVE_LEVEL e 9, com razão e tempo de CPU
+ *       de cada um, e pelo caminho real do arquivador (limite de CPU,
+ *       fsync, índice de tempo), conferindo a descompactação.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <sqlite3.h>
+#include <zlib.h>
+#include "ts_block.h"
+#include "datalogger.h"
+#include "log_archive.h"
+
+#define BENCH_SYNTH_INTERVAL_MS (300 * 1000LL)
+#define BENCH_SYNTH_SAMPLES (365 * 24 * 12)
+#define BENCH_ITERATIONS 5
+#define BENCH_INSERT_ROWS 500
+#define BENCH_SD_SYNC_DELAY_US 3000
+#define BENCH_FSYNC_HOURS 24
+#define BENCH_FSYNC_ROWS_PER_HOUR 20      // 12 periódicos + mudanças de porta
+#define BENCH_LOGICAL_ROW_BYTES 11        // CollectTime (8) + temperatura (2) + flags (1)
+#define BENCH_MERGE_BOOT_DAYS 3           // Duração de cada execução sintética no comando merge
+#define BENCH_ARCHIVE_DAYS 30             // Duração da execução sintética no comando archive
+
+/**
+ * @brief Tempo monotônico em nanossegundos
+ */
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * @brief Gera amostras sintéticas no padrão do E33 (log periódico + mudanças de porta)
+ */
+static size_t synth_samples(ts_sample_t** out) {
+    ts_sample_t* samples = malloc(sizeof(ts_sample_t) * BENCH_SYNTH_SAMPLES);
+    if (!samples) return 0;
+
+    int64_t t = 1704067200000LL;   // 01/01/2024 00:00:00 UTC
+    int temp = 40;                 // 4.0 °C
+    srand(33);
+
+    for (size_t i = 0; i < BENCH_SYNTH_SAMPLES; i++) {
+        temp += (rand() % 3) - 1;
+        if (temp < 20) temp = 20;
+        if (temp > 80) temp = 80;
+
+        bool door = (rand() % 50) == 0;
+        samples[i].collect_time = t;
+        samples[i].temperature = (int16_t)temp;
+        samples[i].flags = TS_FLAG_TEMP_VALID | TS_FLAG_DOOR_VALID | (door ? TS_FLAG_DOOR_OPEN : 0);
+
+        // Mudanças de porta geram registros fora do intervalo periódico
+        t += door ? 37000 : BENCH_SYNTH_INTERVAL_MS;
+    }
+
+    *out = samples;
+    return BENCH_SYNTH_SAMPLES;
+}
+
+/**
+ * @brief Carrega DataGrpData de um banco real
+ */
+static size_t load_samples(const char* path, ts_sample_t** out, double* sqlite_bytes_per_row) {
+    sqlite3* db = NULL;
+    if (sqlite3_open_v2(path, &db, SQLITE_OPEN_READONLY, NULL) != SQLITE_OK) {
+        fprintf(stderr, "Erro ao abrir %s: %s\n", path, sqlite3_errmsg(db));
+        sqlite3_close(db);
+        return 0;
+    }
+
+    sqlite3_stmt* stmt = NULL;
+    size_t capacity = 4096;
+    size_t count = 0;
+    ts_sample_t* samples = malloc(sizeof(ts_sample_t) * capacity);
+
+    if (samples && sqlite3_prepare_v2(db, "SELECT CollectTime, Tprincipal, Porta FROM DataGrpData "
+                                          "ORDER BY CollectTime;", -1, &stmt, NULL) == SQLITE_OK) {
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            if (count == capacity) {
+                capacity *= 2;
+                ts_sample_t* grown = realloc(samples, sizeof(ts_sample_t) * capacity);
+                if (!grown) break;
+                samples = grown;
+            }
+            samples[count].collect_time = sqlite3_column_int64(stmt, 0);
+            samples[count].temperature = (int16_t)lround(sqlite3_column_double(stmt, 1) * 10.0);
+            samples[count].flags = TS_FLAG_TEMP_VALID | TS_FLAG_DOOR_VALID |
+                                   (sqlite3_column_int(stmt, 2) ? TS_FLAG_DOOR_OPEN : 0);
+            count++;
+        }
+    }
+    sqlite3_finalize(stmt);
+
+    // Tamanho do arquivo dividido pelo número de linhas (inclui índices e DBInfo)
+    long long page_count = 0, page_size = 0;
+    if (sqlite3_prepare_v2(db, "PRAGMA page_count;", -1, &stmt, NULL) == SQLITE_OK &&
+        sqlite3_step(stmt) == SQLITE_ROW) {
+        page_count = sqlite3_column_int64(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    if (sqlite3_prepare_v2(db, "PRAGMA page_size;", -1, &stmt, NULL) == SQLITE_OK &&
+        sqlite3_step(stmt) == SQLITE_ROW) {
+        page_size = sqlite3_column_int64(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    sqlite3_close(db);
+
+    *sqlite_bytes_per_row = count > 0 ? (double)(page_count * page_size) / (double)count : 0.0;
+    *out = samples;
+    return count;
+}
+
+/**
+ * @brief Codifica todas as amostras; retorna número de blocos e bytes usados
+ */
+static size_t encode_all(const ts_sample_t* samples, size_t count, uint8_t* blocks,
+                         size_t* used_bytes) {
+    ts_block_encoder_t enc;
+    ts_block_encoder_init(&enc);
+    size_t nblocks = 0;
+    size_t used = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        if (!ts_block_append(&enc, &samples[i])) {
+            size_t len;
+            const uint8_t* b = ts_block_finish(&enc, true, &len);
+            used += sizeof(ts_block_header_t) + ((const ts_block_header_t*)b)->data_bytes;
+            memcpy(blocks + nblocks * TS_BLOCK_SIZE, b, TS_BLOCK_SIZE);
+            nblocks++;
+            ts_block_encoder_init(&enc);
+            ts_block_append(&enc, &samples[i]);
+        }
+    }
+
+    if (ts_block_count(&enc) > 0) {
+        size_t len;
+        const uint8_t* b = ts_block_finish(&enc, true, &len);
+        used += sizeof(ts_block_header_t) + ((const ts_block_header_t*)b)->data_bytes;
+        memcpy(blocks + nblocks * TS_BLOCK_SIZE, b, TS_BLOCK_SIZE);
+        nblocks++;
+    }
+
+    *used_bytes = used;
+    return nblocks;
+}
+
+static int bench_blocks(int argc, char* argv[]) {
+    const char* db_path = NULL;
+    const char* out_path = NULL;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "o:")) != -1) {
+        if (opt == 'o') out_path = optarg;
+        else return EXIT_FAILURE;
+    }
+    if (optind < argc) db_path = argv[optind];
+
+    ts_sample_t* samples = NULL;
+    double sqlite_bpr = 0.0;
+    size_t count = db_path ? load_samples(db_path, &samples, &sqlite_bpr) : synth_samples(&samples);
+    if (count == 0) {
+        fprintf(stderr, "Nenhuma amostra para codificar\n");
+        free(samples);
+        return EXIT_FAILURE;
+    }
+
+    // Pior caso: uma amostra por bloco não acontece; 2 bytes/amostra é o típico
+    size_t max_blocks = count / 100 + 16;
+    uint8_t* blocks = malloc(max_blocks * TS_BLOCK_SIZE);
+    ts_sample_t* decoded = malloc(sizeof(ts_sample_t) * (UINT16_MAX + 1));
+    if (!blocks || !decoded) {
+        fprintf(stderr, "Memória insuficiente\n");
+        return EXIT_FAILURE;
+    }
+
+    size_t used = 0;
+    size_t nblocks = 0;
+    long long t0 = now_ns();
+    for (int it = 0; it < BENCH_ITERATIONS; it++) {
+        nblocks = encode_all(samples, count, blocks, &used);
+    }
+    long long encode_ns = (now_ns() - t0) / BENCH_ITERATIONS;
+
+    size_t decoded_total = 0;
+    bool match = true;
+    t0 = now_ns();
+    for (int it = 0; it < BENCH_ITERATIONS; it++) {
+        decoded_total = 0;
+        for (size_t b = 0; b < nblocks; b++) {
+            int n = ts_block_decode(blocks + b * TS_BLOCK_SIZE, TS_BLOCK_SIZE, decoded, UINT16_MAX + 1);
+            if (n < 0) {
+                match = false;
+                break;
+            }
+            if (it == 0) {
+                for (int i = 0; i < n; i++) {
+                    const ts_sample_t* a = &samples[decoded_total + i];
+                    if (a->collect_time != decoded[i].collect_time ||
+                        a->temperature != decoded[i].temperature || a->flags != decoded[i].flags) {
+                        match = false;
+                    }
+                }
+            }
+            decoded_total += (size_t)n;
+        }
+    }
+    long long decode_ns = (now_ns() - t0) / BENCH_ITERATIONS;
+
+    if (out_path) {
+        FILE* fp = fopen(out_path, "wb");
+        if (fp) {
+            fwrite(blocks, TS_BLOCK_SIZE, nblocks, fp);
+            fclose(fp);
+        }
+    }
+
+    printf("=== Blocos ts_block (%s) ===\n", db_path ? db_path : "ano sintético");
+    printf("Amostras:               %zu\n", count);
+    printf("Blocos (%d bytes):    %zu\n", TS_BLOCK_SIZE, nblocks);
+    printf("Bytes/amostra (dados):  %.2f\n", (double)used / (double)count);
+    printf("Bytes/amostra (blocos): %.2f\n", (double)(nblocks * TS_BLOCK_SIZE) / (double)count);
+    if (sqlite_bpr > 0.0) {
+        printf("Bytes/linha SQLite:     %.2f (%.1fx maior)\n", sqlite_bpr,
+               sqlite_bpr / ((double)(nblocks * TS_BLOCK_SIZE) / (double)count));
+    }
+    printf("Codificação:            %.2f M amostras/s\n", (double)count * 1000.0 / (double)encode_ns);
+    printf("Decodificação:          %.2f M amostras/s\n", (double)decoded_total * 1000.0 / (double)decode_ns);
+    printf("Ida e volta:            %s\n", (match && decoded_total == count) ? "OK" : "DIVERGENTE");
+
+    free(blocks);
+    free(decoded);
+    free(samples);
+    return (match && decoded_total == count) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * @brief Tempo de CPU do processo em nanossegundos
+ */
+static long long cpu_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * @brief Remove o banco e seus arquivos auxiliares
+ */
+static void remove_db_files(const char* path) {
+    static const char* suffixes[] = { "", "-journal", "-wal", "-shm" };
+    char buf[DATALOGGER_MAX_PATH + 16];
+    for (size_t i = 0; i < sizeof(suffixes) / sizeof(suffixes[0]); i++) {
+        snprintf(buf, sizeof(buf), "%s%s", path, suffixes[i]);
+        unlink(buf);
+    }
+}
+
+/**
+ * @brief Caminho de inserção anterior ao cache de statements
+ */
+static bool insert_legacy(sqlite3* db, const datalogger_db_record_t* rec) {
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, "INSERT INTO DataGrpData (CollectTime, Tprincipal, Porta) "
+                               "VALUES (?, ROUND(?, 2), ?);", -1, &stmt, NULL) != SQLITE_OK) {
+        return false;
+    }
+    sqlite3_bind_int64(stmt, 1, rec->CollectTime);
+    sqlite3_bind_double(stmt, 2, rec->Tprincipal);
+    sqlite3_bind_int(stmt, 3, rec->Porta);
+    int rc = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+    if (rc != SQLITE_DONE) return false;
+
+    return sqlite3_exec(db, "UPDATE DBInfo SET "
+                            "MaxID = (SELECT MAX(IndexID) FROM DataGrpData),"
+                            "MinID = (SELECT MIN(IndexID) FROM DataGrpData),"
+                            "EndTime = strftime('%s', 'now') * 1000 "
+                            "WHERE rowid = 1;", NULL, NULL, NULL) == SQLITE_OK;
+}
+
+// Perfil anterior ao WAL: journal DELETE, synchronous FULL, um registro por transação
+static const datalogger_db_profile_t legacy_profile = { "DELETE", 2, 1, 0, 0, 0, 0, 0, 0, 0 };
+
+// Resultado de uma execução de inserção
+typedef struct {
+    long long wall_ns;
+    long long cpu_ns;
+    uint64_t syncs;
+    uint64_t bytes;
+} insert_result_t;
+
+/**
+ * @brief Insere linhas sintéticas em um banco novo (inclui abertura e fechamento)
+ * @param profile Perfil de durabilidade (NULL = padrão)
+ */
+static bool run_insert(const char* path, int rows, bool legacy, const datalogger_db_profile_t* profile,
+                       insert_result_t* result) {
+    datalogger_context_t ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    snprintf(ctx.db_file_path, sizeof(ctx.db_file_path), "%s", path);
+    if (profile) ctx.db_profile = *profile;
+    remove_db_files(path);
+
+    datalogger_vfs_counters_t before, after;
+    datalogger_vfs_register();
+    datalogger_vfs_get_db_counters(path, &before);
+    long long wall0 = now_ns();
+    long long cpu0 = cpu_ns();
+
+    if (!datalogger_init_database(&ctx)) return false;
+
+    bool ok = true;
+    datalogger_db_record_t rec = { 0, 1726410000000LL, 4.0f, 0, 40, 0 };
+    for (int i = 0; i < rows && ok; i++) {
+        rec.CollectTime += BENCH_SYNTH_INTERVAL_MS;
+        rec.Tprincipal = 4.0f + (float)(i % 7) / 10.0f;
+        rec.Porta = (i % 50) == 0;
+        rec.Traw = 40 + i % 7;
+        rec.Flags = TS_FLAG_TEMP_VALID | TS_FLAG_DOOR_VALID | (rec.Porta ? TS_FLAG_DOOR_OPEN : 0);
+        ok = legacy ? insert_legacy(ctx.db, &rec) : datalogger_insert_db_record(&ctx, &rec);
+    }
+
+    datalogger_cleanup_database(&ctx);
+    result->wall_ns = now_ns() - wall0;
+    result->cpu_ns = cpu_ns() - cpu0;
+    datalogger_vfs_get_db_counters(path, &after);
+    result->syncs = after.syncs - before.syncs;
+    result->bytes = after.bytes_written - before.bytes_written;
+
+    // Banco fechado deve estar autocontido
+    char aux[DATALOGGER_MAX_PATH + 8];
+    snprintf(aux, sizeof(aux), "%s-wal", path);
+    if (access(aux, F_OK) == 0) {
+        fprintf(stderr, "Arquivo -wal restante após o fechamento: %s\n", aux);
+        ok = false;
+    }
+    remove_db_files(path);
+    return ok;
+}
+
+/**
+ * @brief Imprime uma linha de resultado de inserção
+ */
+static void print_insert_result(const char* label, int rows, const insert_result_t* r) {
+    printf("%-10s %10.0f %10.1f %10.1f %10.2f %10.0f\n", label,
+           (double)rows * 1e9 / (double)r->wall_ns,
+           (double)r->wall_ns / 1000.0 / rows,
+           (double)r->cpu_ns / 1000.0 / rows,
+           (double)r->syncs / rows,
+           (double)r->bytes / rows);
+}
+
+static int bench_insert(int argc, char* argv[]) {
+    int rows = BENCH_INSERT_ROWS;
+    unsigned int delay_us = BENCH_SD_SYNC_DELAY_US;
+    const char* dir = "/tmp";
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:l:")) != -1) {
+        if (opt == 'n') rows = atoi(optarg);
+        else if (opt == 'l') delay_us = (unsigned int)atoi(optarg);
+        else return EXIT_FAILURE;
+    }
+    if (optind < argc) dir = argv[optind];
+    if (rows <= 0) return EXIT_FAILURE;
+
+    char path[DATALOGGER_MAX_PATH];
+    snprintf(path, sizeof(path), "%s/datalogger_bench_insert.db", dir);
+
+    printf("=== Inserção SQLite (%d linhas, fsync +%u µs) ===\n", rows, delay_us);
+    printf("%-10s %10s %10s %10s %10s %10s\n", "caminho", "linhas/s", "µs/linha", "CPU µs", "fsync/lin", "bytes/lin");
+    insert_result_t r;
+    bool ok = run_insert(path, rows, true, &legacy_profile, &r);
+    r.wall_ns += (long long)r.syncs * delay_us * 1000;
+    print_insert_result("antigo", rows, &r);
+    if (run_insert(path, rows, false, NULL, &r)) {
+        r.wall_ns += (long long)r.syncs * delay_us * 1000;
+        print_insert_result("atual", rows, &r);
+    } else {
+        ok = false;
+    }
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static int bench_fsync(int argc, char* argv[]) {
+    int hours = BENCH_FSYNC_HOURS;
+    int rows_per_hour = BENCH_FSYNC_ROWS_PER_HOUR;
+    const char* dir = "/tmp";
+    int opt;
+
+    while ((opt = getopt(argc, argv, "H:r:")) != -1) {
+        if (opt == 'H') hours = atoi(optarg);
+        else if (opt == 'r') rows_per_hour = atoi(optarg);
+        else return EXIT_FAILURE;
+    }
+    if (optind < argc) dir = argv[optind];
+    if (hours <= 0 || rows_per_hour <= 0) return EXIT_FAILURE;
+
+    char path[DATALOGGER_MAX_PATH];
+    snprintf(path, sizeof(path), "%s/datalogger_bench_fsync.db", dir);
+
+    static const datalogger_db_profile_t current = DATALOGGER_DB_PROFILE_DEFAULT;
+    const struct {
+        const char* label;
+        const datalogger_db_profile_t* profile;
+    } runs[] = { { "antigo", &legacy_profile }, { "atual", &current } };
+
+    int rows = hours * rows_per_hour;
+    printf("=== Sincronizações SQLite (%d h, %d registros/h) ===\n", hours, rows_per_hour);
+    printf("%-10s %-8s %4s %6s %10s %12s %10s\n",
+           "perfil", "journal", "sync", "lote", "fsync/h", "bytes/h", "fsync/reg");
+
+    bool ok = true;
+    for (size_t i = 0; i < sizeof(runs) / sizeof(runs[0]); i++) {
+        insert_result_t r;
+        if (!run_insert(path, rows, false, runs[i].profile, &r)) {
+            ok = false;
+            continue;
+        }
+        printf("%-10s %-8s %4d %6u %10.1f %12.0f %10.2f\n", runs[i].label,
+               runs[i].profile->journal_mode, runs[i].profile->synchronous,
+               runs[i].profile->batch_rows,
+               (double)r.syncs / hours, (double)r.bytes / hours, (double)r.syncs / rows);
+    }
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static bool count_query_row(const datalogger_query_row_t* row, void* user) {
+    (void)row;
+    (*(int*)user)++;
+    return true;
+}
+
+/**
+ * @brief Latência média (ms) de uma consulta por intervalo
+ */
+static double time_query(datalogger_context_t* ctx, long long from, long long to,
+                         long long bucket, int rollup, int* rows) {
+    long long t0 = now_ns();
+    for (int it = 0; it < BENCH_ITERATIONS; it++) {
+        *rows = 0;
+        int rc = rollup >= 0
+            ? datalogger_query_rollup(ctx, (datalogger_rollup_t)rollup, from, to, count_query_row, rows)
+            : datalogger_query_range(ctx, from, to, bucket, count_query_row, rows);
+        if (rc < 0) return -1.0;
+    }
+    return (double)(now_ns() - t0) / 1e6 / BENCH_ITERATIONS;
+}
+
+/**
+ * @brief Converte uma amostra sintética em registro do banco (inválidos como no v1: 0)
+ */
+static void sample_to_record(const ts_sample_t* sample, datalogger_db_record_t* rec) {
+    memset(rec, 0, sizeof(*rec));
+    rec->CollectTime = sample->collect_time;
+    if (sample->flags & TS_FLAG_TEMP_VALID) {
+        rec->Tprincipal = sample->temperature / 10.0f;
+        rec->Traw = sample->temperature;
+    }
+    rec->Porta = (sample->flags & TS_FLAG_DOOR_VALID) && (sample->flags & TS_FLAG_DOOR_OPEN) ? 1 : 0;
+    rec->Flags = sample->flags;
+}
+
+/**
+ * @brief Cria um banco com um ano sintético de registros
+ */
+static bool build_year_db(datalogger_context_t* ctx) {
+    ts_sample_t* samples = NULL;
+    size_t count = synth_samples(&samples);
+    if (count == 0) return false;
+
+    bool ok = true;
+    for (size_t i = 0; i < count && ok; i++) {
+        datalogger_db_record_t rec;
+        sample_to_record(&samples[i], &rec);
+        ok = datalogger_insert_db_record(ctx, &rec);
+    }
+    free(samples);
+    return ok && datalogger_db_flush(ctx);
+}
+
+static int bench_query(int argc, char* argv[]) {
+    const char* db_path = argc > 1 ? argv[1] : NULL;
+    bool synthetic = db_path == NULL;
+
+    // Lotes grandes e sem fsync apenas para gerar o banco sintético rapidamente
+    static const datalogger_db_profile_t build_profile = { "WAL", 0, 10000, 0, 0, 0, 0, 0, 0, 0 };
+
+    datalogger_context_t ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    snprintf(ctx.db_file_path, sizeof(ctx.db_file_path), "%s",
+             synthetic ? "/tmp/datalogger_bench_query.db" : db_path);
+    if (synthetic) {
+        ctx.db_profile = build_profile;
+        remove_db_files(ctx.db_file_path);
+    }
+
+    if (!datalogger_init_database(&ctx)) return EXIT_FAILURE;
+    if (synthetic && !build_year_db(&ctx)) {
+        fprintf(stderr, "Erro ao gerar banco sintético\n");
+        datalogger_cleanup_database(&ctx);
+        return EXIT_FAILURE;
+    }
+
+    long long end = 0;
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(ctx.db, "SELECT MAX(CollectTime) FROM DataGrpData;", -1, &stmt, NULL) == SQLITE_OK &&
+        sqlite3_step(stmt) == SQLITE_ROW) {
+        end = sqlite3_column_int64(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+
+    const long long hour = 3600 * 1000LL;
+    const long long day = 24 * hour;
+    const struct {
+        const char* label;
+        long long span;
+        long long bucket;
+        int rollup;
+    } cases[] = {
+        { "24 h, brutos", day, 0, -1 },
+        { "24 h, por hora", day, hour, -1 },
+        { "30 dias, por hora", 30 * day, hour, -1 },
+        { "1 ano, por hora", 365 * day, hour, -1 },
+        { "1 ano, por dia", 365 * day, day, -1 },
+        { "1 ano, RollupHourly", 365 * day, 0, DATALOGGER_ROLLUP_HOURLY },
+        { "1 ano, RollupDaily", 365 * day, 0, DATALOGGER_ROLLUP_DAILY },
+    };
+    const size_t ncases = sizeof(cases) / sizeof(cases[0]);
+    double indexed_ms[sizeof(cases) / sizeof(cases[0])];
+    int rows[sizeof(cases) / sizeof(cases[0])];
+
+    for (size_t i = 0; i < ncases; i++) {
+        indexed_ms[i] = time_query(&ctx, end - cases[i].span, end, cases[i].bucket, cases[i].rollup, &rows[i]);
+    }
+
+    printf("=== Consultas por intervalo (%s) ===\n", synthetic ? "ano sintético" : db_path);
+    printf("%-20s %10s %12s", "consulta", "linhas", "ms");
+    if (synthetic) {
+        // Mesmo conjunto sem índice (varredura completa de DataGrpData)
+        sqlite3_exec(ctx.db, "DROP INDEX idx_DataGrpData_CollectTime;", NULL, NULL, NULL);
+        printf(" %12s", "ms s/ índice");
+    }
+    printf("\n");
+
+    for (size_t i = 0; i < ncases; i++) {
+        printf("%-20s %10d %12.2f", cases[i].label, rows[i], indexed_ms[i]);
+        if (synthetic) {
+            int unused;
+            printf(" %12.2f", time_query(&ctx, end - cases[i].span, end, cases[i].bucket, cases[i].rollup, &unused));
+        }
+        printf("\n");
+    }
+
+    datalogger_cleanup_database(&ctx);
+    if (synthetic) remove_db_files(ctx.db_file_path);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Remove todos os arquivos de um diretório e o próprio diretório
+ */
+static void remove_dir(const char* dir) {
+    DIR* d = opendir(dir);
+    if (!d) return;
+
+    struct dirent* entry;
+    char path[DATALOGGER_MAX_PATH + 256];
+    while ((entry = readdir(d)) != NULL) {
+        if (entry->d_name[0] == '.') continue;
+        snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+        unlink(path);
+    }
+    closedir(d);
+    rmdir(dir);
+}
+
+/**
+ * @brief Bytes escritos pelo VFS desde before
+ */
+static uint64_t vfs_bytes_since(const datalogger_vfs_counters_t* before) {
+    datalogger_vfs_counters_t now;
+    datalogger_vfs_get_counters(&now);
+    return now.bytes_written - before->bytes_written;
+}
+
+static int bench_partition(int argc, char* argv[]) {
+    const char* dir = argc > 1 ? argv[1] : "/tmp";
+    static const datalogger_db_profile_t build_profile = { "WAL", 0, 10000, 0, 0, 0, 0, 0, 0, 0 };
+
+    datalogger_context_t single;
+    memset(&single, 0, sizeof(single));
+    snprintf(single.db_file_path, sizeof(single.db_file_path), "%s/datalogger_bench_single.db", dir);
+    single.db_profile = build_profile;
+    remove_db_files(single.db_file_path);
+
+    // Partições sem retenção automática (o ano sintético é antigo)
+    datalogger_context_t part;
+    memset(&part, 0, sizeof(part));
+    snprintf(part.device_name, sizeof(part.device_name), "BENCH");
+    snprintf(part.db_dir, sizeof(part.db_dir), "%s/datalogger_bench_part", dir);
+    part.db_partitioned = true;
+    part.db_profile = build_profile;
+    remove_dir(part.db_dir);
+    mkdir(part.db_dir, 0755);
+
+    bool ok = datalogger_init_database(&single) && build_year_db(&single) &&
+              datalogger_init_database(&part) && build_year_db(&part);
+    if (!ok) {
+        fprintf(stderr, "Erro ao gerar bancos sintéticos\n");
+        datalogger_cleanup_database(&single);
+        datalogger_cleanup_database(&part);
+        remove_db_files(single.db_file_path);
+        remove_dir(part.db_dir);
+        return EXIT_FAILURE;
+    }
+
+    long long end = 0;
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(single.db, "SELECT MAX(CollectTime) FROM DataGrpData;", -1, &stmt, NULL) == SQLITE_OK &&
+        sqlite3_step(stmt) == SQLITE_ROW) {
+        end = sqlite3_column_int64(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+
+    const long long hour = 3600 * 1000LL;
+    const long long day = 24 * hour;
+    const struct {
+        const char* label;
+        long long span;
+        long long bucket;
+        int rollup;
+    } cases[] = {
+        { "24 h, brutos", day, 0, -1 },
+        { "1 ano, brutos", 366 * day, 0, -1 },
+        { "1 ano, por dia", 366 * day, day, -1 },
+        { "1 ano, RollupHourly", 366 * day, 0, DATALOGGER_ROLLUP_HOURLY },
+        { "1 ano, RollupDaily", 366 * day, 0, DATALOGGER_ROLLUP_DAILY },
+    };
+
+    printf("=== Partições mensais x banco único (ano sintético) ===\n");
+    printf("%-20s %10s %10s %10s %10s\n", "consulta", "linhas", "ms único", "linhas", "ms part.");
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        int rows_single = 0;
+        int rows_part = 0;
+        double ms_single = time_query(&single, end - cases[i].span, end, cases[i].bucket,
+                                      cases[i].rollup, &rows_single);
+        double ms_part = time_query(&part, end - cases[i].span, end, cases[i].bucket,
+                                    cases[i].rollup, &rows_part);
+        printf("%-20s %10d %10.2f %10d %10.2f\n", cases[i].label,
+               rows_single, ms_single, rows_part, ms_part);
+        if (rows_single != rows_part) ok = false;
+    }
+
+    // Descartar o mês mais antigo nos dois arranjos
+    long long month_start, month_end;
+    datalogger_partition_period(1704067200000LL, &month_start, &month_end);
+
+    datalogger_vfs_counters_t before;
+    datalogger_vfs_get_counters(&before);
+    long long t0 = now_ns();
+    char sql[256];
+    snprintf(sql, sizeof(sql),
+             "DELETE FROM DataGrpData WHERE CollectTime < %lld; "
+             "DELETE FROM RollupHourly WHERE BucketStart < %lld; "
+             "DELETE FROM RollupDaily WHERE BucketStart < %lld; VACUUM;",
+             month_end, month_end, month_end);
+    datalogger_db_flush(&single);
+    ok = sqlite3_exec(single.db, sql, NULL, NULL, NULL) == SQLITE_OK && ok;
+    double delete_ms = (double)(now_ns() - t0) / 1e6;
+    uint64_t delete_bytes = vfs_bytes_since(&before);
+
+    char live[64];
+    datalogger_partition_name(part.device_name, part.db_part_start, live, sizeof(live));
+    datalogger_vfs_get_counters(&before);
+    t0 = now_ns();
+    int removed = datalogger_catalog_enforce_retention(part.catalog, live, end, 11, 0);
+    double drop_ms = (double)(now_ns() - t0) / 1e6;
+    uint64_t drop_bytes = vfs_bytes_since(&before);
+    if (removed < 1) ok = false;
+
+    printf("\n=== Descarte do mês mais antigo ===\n");
+    printf("%-28s %10s %12s\n", "método", "ms", "bytes escr.");
+    printf("%-28s %10.2f %12llu\n", "DELETE + VACUUM (único)", delete_ms, (unsigned long long)delete_bytes);
+    printf("%-28s %10.2f %12llu\n", "remoção da partição", drop_ms, (unsigned long long)drop_bytes);
+
+    datalogger_cleanup_database(&single);
+    datalogger_cleanup_database(&part);
+    remove_db_files(single.db_file_path);
+    remove_dir(part.db_dir);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Resultado da gravação de um ano sintético em um esquema
+typedef struct {
+    long long wall_ns;
+    long long cpu_ns;
+    uint64_t bytes;             // Bytes escritos (VFS, inclui WAL)
+    long long file_size;        // Tamanho do .db fechado
+    long long table_size;       // Páginas da tabela de amostras e do índice (dbstat), -1 se indisponível
+    long long rows;
+    double temp_sum;            // Soma de Tprincipal lida por DataGrpData (compatibilidade)
+    long long door_sum;
+} schema_result_t;
+
+/**
+ * @brief Lê tamanho, contagem e somas de DataGrpData de um banco fechado
+ */
+static bool measure_schema_db(const char* path, schema_result_t* r) {
+    struct stat st;
+    r->file_size = stat(path, &st) == 0 ? (long long)st.st_size : 0;
+
+    sqlite3* db;
+    if (sqlite3_open_v2(path, &db, SQLITE_OPEN_READONLY, NULL) != SQLITE_OK) {
+        sqlite3_close(db);
+        return false;
+    }
+
+    bool ok = false;
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, "SELECT COUNT(*), TOTAL(Tprincipal), TOTAL(Porta) FROM DataGrpData;",
+                           -1, &stmt, NULL) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            r->rows = sqlite3_column_int64(stmt, 0);
+            r->temp_sum = sqlite3_column_double(stmt, 1);
+            r->door_sum = (long long)sqlite3_column_double(stmt, 2);
+            ok = true;
+        }
+        sqlite3_finalize(stmt);
+    }
+
+    r->table_size = -1;
+    if (sqlite3_prepare_v2(db, "SELECT SUM(pgsize) FROM dbstat WHERE name IN "
+                               "('DataGrpData', 'idx_DataGrpData_CollectTime', "
+                               "'DataGrpSamples', 'idx_DataGrpSamples_CollectTime');",
+                           -1, &stmt, NULL) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            r->table_size = sqlite3_column_int64(stmt, 0);
+        }
+        sqlite3_finalize(stmt);
+    }
+
+    sqlite3_close(db);
+    return ok;
+}
+
+/**
+ * @brief Grava um ano sintético (com leituras inválidas) em um banco novo no esquema informado
+ */
+static bool run_schema(const char* path, int schema, const ts_sample_t* samples, size_t count,
+                       schema_result_t* r) {
+    datalogger_context_t ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    snprintf(ctx.db_file_path, sizeof(ctx.db_file_path), "%s", path);
+    ctx.db_schema_target = schema;
+    remove_db_files(path);
+
+    datalogger_vfs_counters_t before;
+    datalogger_vfs_register();
+    datalogger_vfs_get_counters(&before);
+    long long wall0 = now_ns();
+    long long cpu0 = cpu_ns();
+
+    if (!datalogger_init_database(&ctx)) return false;
+    bool ok = true;
+    for (size_t i = 0; i < count && ok; i++) {
+        datalogger_db_record_t rec;
+        sample_to_record(&samples[i], &rec);
+        ok = datalogger_insert_db_record(&ctx, &rec);
+    }
+    datalogger_cleanup_database(&ctx);
+
+    r->wall_ns = now_ns() - wall0;
+    r->cpu_ns = cpu_ns() - cpu0;
+    r->bytes = vfs_bytes_since(&before);
+    return ok && measure_schema_db(path, r);
+}
+
+/**
+ * @brief Imprime uma linha de resultado por esquema
+ */
+static void print_schema_result(const char* label, const schema_result_t* r) {
+    printf("%-10s %10.0f %10.1f %12.0f %12.1f", label,
+           (double)r->rows * 1e9 / (double)r->wall_ns,
+           (double)r->cpu_ns / 1000.0 / (double)r->rows,
+           (double)r->bytes / (double)r->rows,
+           (double)r->file_size / (double)r->rows);
+    if (r->table_size >= 0) {
+        printf(" %12.1f\n", (double)r->table_size / (double)r->rows);
+    } else {
+        printf(" %12s\n", "-");
+    }
+}
+
+static int bench_schema(int argc, char* argv[]) {
+    const char* dir = argc > 1 ? argv[1] : "/tmp";
+
+    ts_sample_t* samples = NULL;
+    size_t count = synth_samples(&samples);
+    if (count == 0) return EXIT_FAILURE;
+
+    // Falhas de leitura Modbus ocasionais: gravadas como 0 no v1, NULL + flags no v2
+    for (size_t i = 0; i < count; i += 997) {
+        samples[i].flags = 0;
+    }
+
+    char path_v1[DATALOGGER_MAX_PATH];
+    char path_v2[DATALOGGER_MAX_PATH];
+    snprintf(path_v1, sizeof(path_v1), "%s/datalogger_bench_schema_v1.db", dir);
+    snprintf(path_v2, sizeof(path_v2), "%s/datalogger_bench_schema_v2.db", dir);
+
+    printf("=== Esquema de armazenamento (%zu registros, perfil padrão) ===\n", count);
+    printf("%-10s %10s %10s %12s %12s %12s\n",
+           "esquema", "linhas/s", "CPU µs", "escr./lin", "arquivo/lin", "tabela/lin");
+
+    schema_result_t v1, v2;
+    memset(&v1, 0, sizeof(v1));
+    memset(&v2, 0, sizeof(v2));
+    bool ok = run_schema(path_v1, DATALOGGER_DB_SCHEMA_V1, samples, count, &v1);
+    if (ok) print_schema_result("v1", &v1);
+    ok = run_schema(path_v2, DATALOGGER_DB_SCHEMA_V2, samples, count, &v2) && ok;
+    if (ok) print_schema_result("v2", &v2);
+    free(samples);
+
+    // Visão de compatibilidade deve apresentar exatamente os dados do v1
+    bool same = ok && v1.rows == v2.rows && v1.door_sum == v2.door_sum &&
+                fabs(v1.temp_sum - v2.temp_sum) < 0.01;
+    printf("Visão DataGrpData (v2) igual à tabela v1: %s\n", same ? "sim" : "NÃO");
+
+    // Migração do banco v1 para o v2 na abertura
+    if (ok) {
+        datalogger_context_t ctx;
+        memset(&ctx, 0, sizeof(ctx));
+        snprintf(ctx.db_file_path, sizeof(ctx.db_file_path), "%s", path_v1);
+        ctx.db_schema_target = DATALOGGER_DB_SCHEMA_V2;
+
+        long long t0 = now_ns();
+        bool migrated = datalogger_init_database(&ctx) && ctx.db_schema == DATALOGGER_DB_SCHEMA_V2;
+        double migrate_ms = (double)(now_ns() - t0) / 1e6;
+        datalogger_cleanup_database(&ctx);
+
+        schema_result_t m;
+        memset(&m, 0, sizeof(m));
+        migrated = migrated && measure_schema_db(path_v1, &m) && m.rows == v1.rows &&
+                   m.door_sum == v1.door_sum && fabs(m.temp_sum - v1.temp_sum) < 0.01;
+        printf("Migração v1 -> v2: %.1f ms, %s\n", migrate_ms, migrated ? "dados preservados" : "FALHOU");
+        ok = migrated;
+    }
+
+    remove_db_files(path_v1);
+    remove_db_files(path_v2);
+    return ok && same ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * @brief Compara dois tempos (qsort)
+ */
+static int compare_ll(const void* a, const void* b) {
+    long long x = *(const long long*)a;
+    long long y = *(const long long*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Replay de um ano de inserções e consultas com um perfil (executado em um processo filho)
+ */
+static bool run_profile(const char* label, const char* path, const datalogger_db_profile_t* profile,
+                        FILE* out) {
+    ts_sample_t* samples = NULL;
+    size_t count = synth_samples(&samples);
+    long long* latency = malloc(sizeof(long long) * (count > 0 ? count : 1));
+    if (count == 0 || !latency) {
+        free(samples);
+        free(latency);
+        return false;
+    }
+
+    datalogger_context_t ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    snprintf(ctx.db_file_path, sizeof(ctx.db_file_path), "%s", path);
+    ctx.db_profile = *profile;
+    remove_db_files(path);
+
+    datalogger_vfs_counters_t before;
+    datalogger_vfs_register();
+    datalogger_vfs_get_counters(&before);
+
+    bool ok = datalogger_init_database(&ctx);
+    long long wall0 = now_ns();
+    for (size_t i = 0; i < count && ok; i++) {
+        datalogger_db_record_t rec;
+        sample_to_record(&samples[i], &rec);
+        long long t0 = now_ns();
+        ok = datalogger_insert_db_record(&ctx, &rec);
+        latency[i] = now_ns() - t0;
+    }
+    long long wall_ns = now_ns() - wall0;
+    ok = ok && datalogger_db_flush(&ctx);
+
+    // Consultas típicas de exibição local e relatório
+    const long long hour = 3600 * 1000LL;
+    const long long day = 24 * hour;
+    const long long end = samples[count - 1].collect_time;
+    const struct {
+        long long span;
+        long long bucket;
+        int rollup;
+    } cases[] = {
+        { day, 0, -1 },
+        { 30 * day, hour, -1 },
+        { 366 * day, day, -1 },
+        { 366 * day, 0, DATALOGGER_ROLLUP_DAILY },
+    };
+    double query_ms = 0.0;
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]) && ok; i++) {
+        int rows;
+        double ms = time_query(&ctx, end - cases[i].span, end, cases[i].bucket, cases[i].rollup, &rows);
+        if (ms < 0) ok = false;
+        query_ms += ms;
+    }
+
+    long long sqlite_peak = sqlite3_memory_highwater(0);
+    datalogger_cleanup_database(&ctx);
+    uint64_t bytes = vfs_bytes_since(&before);
+
+    struct stat st;
+    long long file_size = stat(path, &st) == 0 ? (long long)st.st_size : 0;
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    qsort(latency, count, sizeof(long long), compare_ll);
+    if (ok) {
+        fprintf(out, "%-12s %9.0f %8.1f %8.1f %9.1f %9.2f %9ld %9lld %9lld\n", label,
+               (double)count * 1e9 / (double)wall_ns,
+               (double)latency[count / 2] / 1000.0,
+               (double)latency[count * 99 / 100] / 1000.0,
+               (double)bytes / ((double)count * BENCH_LOGICAL_ROW_BYTES),
+               query_ms, usage.ru_maxrss, sqlite_peak / 1024, file_size / 1024);
+        fflush(out);
+    }
+
+    free(samples);
+    free(latency);
+    remove_db_files(path);
+    return ok;
+}
+
+static int bench_profile(int argc, char* argv[]) {
+    const char* dir = argc > 1 ? argv[1] : "/tmp";
+    char path[DATALOGGER_MAX_PATH];
+    snprintf(path, sizeof(path), "%s/datalogger_bench_profile.db", dir);
+
+    // Mesma durabilidade em todos; variam apenas memória, páginas e journal
+    const datalogger_db_profile_t base = DATALOGGER_DB_PROFILE_DEFAULT;
+    datalogger_db_profile_t sqlite_default = base;
+    sqlite_default.cache_kb = 0;
+    sqlite_default.mmap_bytes = 0;
+    sqlite_default.page_size = 0;
+    sqlite_default.temp_store = 0;
+    sqlite_default.journal_limit_kb = 0;
+    datalogger_db_profile_t small_cache = base;
+    small_cache.cache_kb = 256;
+    datalogger_db_profile_t mmap_64m = base;
+    mmap_64m.mmap_bytes = 64 * 1024 * 1024;
+    datalogger_db_profile_t page_4k = base;
+    page_4k.page_size = 4096;
+    datalogger_db_profile_t page_8k = base;
+    page_8k.page_size = 8192;
+    datalogger_db_profile_t temp_file = base;
+    temp_file.temp_store = 1;
+    datalogger_db_profile_t no_limit = base;
+    no_limit.journal_limit_kb = 0;
+
+    const struct {
+        const char* label;
+        const datalogger_db_profile_t* profile;
+    } runs[] = {
+        { "sqlite", &sqlite_default },
+        { "padrão", &base },
+        { "cache 256K", &small_cache },
+        { "mmap 64M", &mmap_64m },
+        { "pág. 4K", &page_4k },
+        { "pág. 8K", &page_8k },
+        { "temp arq.", &temp_file },
+        { "WAL s/ lim.", &no_limit },
+    };
+
+    printf("=== Perfis de memória do SQLite (ano sintético, %d registros/lote) ===\n", base.batch_rows);
+    printf("%-12s %9s %8s %8s %9s %9s %9s %9s %9s\n", "perfil", "linhas/s", "p50 µs", "p99 µs",
+           "escr/lóg", "cons. ms", "RSS KB", "SQLite KB", "arq. KB");
+    fflush(stdout);
+
+    // Um processo por perfil: RSS de pico e memória do SQLite não se acumulam entre execuções
+    bool ok = true;
+    for (size_t i = 0; i < sizeof(runs) / sizeof(runs[0]); i++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            // Mensagens de abertura/fechamento do banco ficam fora da tabela
+            int fd = dup(STDOUT_FILENO);
+            FILE* out = fd >= 0 ? fdopen(fd, "w") : NULL;
+            if (!out || !freopen("/dev/null", "w", stdout)) _exit(EXIT_FAILURE);
+            bool child_ok = run_profile(runs[i].label, path, runs[i].profile, out);
+            fclose(out);
+            _exit(child_ok ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+
+        int status = 0;
+        if (pid < 0 || waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) ||
+            WEXITSTATUS(status) != EXIT_SUCCESS) {
+            fprintf(stderr, "Erro no perfil %s\n", runs[i].label);
+            ok = false;
+        }
+    }
+
+    printf("escr/lóg: bytes escritos (VFS, inclui WAL) por byte lógico (%d por registro)\n",
+           BENCH_LOGICAL_ROW_BYTES);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * @brief Grava um banco por execução no formato antigo (esquema v1, sem agregados)
+ */
+static bool build_boot_db(const char* path, const ts_sample_t* samples, size_t count) {
+    sqlite3* db = NULL;
+    sqlite3_stmt* stmt = NULL;
+    bool ok = sqlite3_open(path, &db) == SQLITE_OK &&
+              sqlite3_exec(db, "PRAGMA synchronous=OFF;"
+                               "CREATE TABLE DBInfo (version INTEGER DEFAULT 1, MaxID INTEGER DEFAULT 0,"
+                               "MinID INTEGER DEFAULT 0, StartTime INTEGER DEFAULT 0, EndTime INTEGER DEFAULT 0);"
+                               "INSERT INTO DBInfo (version) VALUES (1);"
+                               "CREATE TABLE DataGrpData (IndexID INTEGER PRIMARY KEY AUTOINCREMENT,"
+                               "CollectTime INTEGER NOT NULL, Tprincipal REAL NOT NULL, Porta INTEGER NOT NULL);"
+                               "CREATE INDEX idx_DataGrpData_CollectTime ON DataGrpData (CollectTime);"
+                               "BEGIN;", NULL, NULL, NULL) == SQLITE_OK &&
+              sqlite3_prepare_v2(db, "INSERT INTO DataGrpData (CollectTime, Tprincipal, Porta) "
+                                     "VALUES (?, ROUND(?, 2), ?);", -1, &stmt, NULL) == SQLITE_OK;
+
+    for (size_t i = 0; i < count && ok; i++) {
+        datalogger_db_record_t rec;
+        sample_to_record(&samples[i], &rec);
+        sqlite3_bind_int64(stmt, 1, rec.CollectTime);
+        sqlite3_bind_double(stmt, 2, rec.Tprincipal);
+        sqlite3_bind_int(stmt, 3, rec.Porta);
+        ok = sqlite3_step(stmt) == SQLITE_DONE;
+        sqlite3_reset(stmt);
+    }
+    sqlite3_finalize(stmt);
+
+    ok = ok && sqlite3_exec(db, "UPDATE DBInfo SET MaxID = (SELECT MAX(IndexID) FROM DataGrpData),"
+                                "MinID = (SELECT MIN(IndexID) FROM DataGrpData); COMMIT;",
+                            NULL, NULL, NULL) == SQLITE_OK;
+    sqlite3_close(db);
+    return ok;
+}
+
+/**
+ * @brief Soma o tamanho dos arquivos .db de um diretório
+ */
+static long long dir_db_bytes(const char* dir, int* files) {
+    DIR* d = opendir(dir);
+    if (!d) return 0;
+
+    long long total = 0;
+    *files = 0;
+    struct dirent* entry;
+    char path[DATALOGGER_MAX_PATH + 256];
+    while ((entry = readdir(d)) != NULL) {
+        size_t len = strlen(entry->d_name);
+        if (len < 3 || strcmp(entry->d_name + len - 3, ".db") != 0) continue;
+        snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+        struct stat st;
+        if (stat(path, &st) == 0) {
+            total += st.st_size;
+            (*files)++;
+        }
+    }
+    closedir(d);
+    return total;
+}
+
+static int bench_merge(int argc, char* argv[]) {
+    const char* base = argc > 1 ? argv[1] : "/tmp";
+
+    datalogger_context_t part;
+    memset(&part, 0, sizeof(part));
+    snprintf(part.device_name, sizeof(part.device_name), "BENCH");
+    snprintf(part.db_dir, sizeof(part.db_dir), "%s/datalogger_bench_merge", base);
+    part.db_partitioned = true;
+    remove_dir(part.db_dir);
+    mkdir(part.db_dir, 0755);
+
+    ts_sample_t* samples = NULL;
+    size_t count = synth_samples(&samples);
+    if (count == 0) return EXIT_FAILURE;
+
+    // Um banco por execução a cada BENCH_MERGE_BOOT_DAYS dias; cada um repete
+    // a primeira hora do seguinte (registros duplicados entre execuções)
+    const long long boot_ms = BENCH_MERGE_BOOT_DAYS * 24 * 3600 * 1000LL;
+    const long long overlap_ms = 3600 * 1000LL;
+    int boots = 0;
+    long long source_rows = 0;
+    bool ok = true;
+    char path[DATALOGGER_MAX_PATH + 128];
+    for (size_t first = 0; first < count && ok; boots++) {
+        long long boot_end = samples[first].collect_time + boot_ms;
+        size_t next = first;
+        while (next < count && samples[next].collect_time < boot_end) next++;
+        size_t last = next;
+        while (last < count && samples[last].collect_time < boot_end + overlap_ms) last++;
+
+        time_t stamp = (time_t)(samples[first].collect_time / 1000);
+        struct tm tm_info;
+        localtime_r(&stamp, &tm_info);
+        snprintf(path, sizeof(path), "%s/%s_%04d%02d%02d_%02d%02d%02d.db", part.db_dir, part.device_name,
+                 tm_info.tm_year + 1900, tm_info.tm_mon + 1, tm_info.tm_mday,
+                 tm_info.tm_hour, tm_info.tm_min, tm_info.tm_sec);
+        ok = build_boot_db(path, &samples[first], last - first);
+        source_rows += (long long)(last - first);
+        first = next;
+    }
+
+    int files_before = 0;
+    long long bytes_before = dir_db_bytes(part.db_dir, &files_before);
+
+    datalogger_merge_stats_t stats;
+    datalogger_vfs_counters_t before;
+    datalogger_vfs_get_counters(&before);
+    long long t0 = now_ns();
+    ok = ok && datalogger_init_database(&part) && datalogger_merge_boot_databases(&part, &stats) == boots;
+    double merge_ms = (double)(now_ns() - t0) / 1e6;
+    uint64_t merge_bytes = vfs_bytes_since(&before);
+
+    // Todos os registros do ano, uma única vez, nas partições
+    int rows = 0;
+    if (ok) {
+        time_query(&part, samples[0].collect_time, samples[count - 1].collect_time, 0, -1, &rows);
+        ok = rows == (int)count && stats.rows == (long long)count &&
+             stats.duplicates == source_rows - (long long)count;
+    }
+
+    // Repetir um banco já consolidado: nenhum registro novo
+    datalogger_merge_stats_t again;
+    memset(&again, 0, sizeof(again));
+    snprintf(path, sizeof(path), "%s/%s_20240101_000000.db", part.db_dir, part.device_name);
+    size_t day = 0;
+    while (day < count && samples[day].collect_time < samples[0].collect_time + 24 * 3600 * 1000LL) day++;
+    if (ok) {
+        ok = build_boot_db(path, samples, day) && datalogger_merge_boot_databases(&part, &again) == 1 &&
+             again.rows == 0 && again.duplicates == (long long)day;
+    }
+
+    datalogger_cleanup_database(&part);
+    int files_after = 0;
+    long long bytes_after = dir_db_bytes(part.db_dir, &files_after);
+
+    printf("\n=== Consolidação de bancos por execução (ano sintético) ===\n");
+    printf("bancos por execução:   %d (%lld registros, %lld duplicados entre execuções)\n",
+           boots, source_rows, source_rows - (long long)count);
+    printf("partições:             %d\n", stats.partitions);
+    printf("registros copiados:    %lld (%lld descartados)\n", stats.rows, stats.duplicates);
+    printf("tempo:                 %.1f ms (%.0f registros/s, inclui abertura das partições)\n",
+           merge_ms, merge_ms > 0 ? (double)source_rows / (merge_ms / 1000.0) : 0.0);
+    printf("bytes escritos (VFS):  %llu (%.1f por registro)\n", (unsigned long long)merge_bytes,
+           stats.rows > 0 ? (double)merge_bytes / (double)stats.rows : 0.0);
+    printf("arquivos .db:          %d → %d (%lld → %lld bytes, inclui catálogo)\n",
+           files_before, files_after, bytes_before, bytes_after);
+    printf("consulta do ano:       %d registros (esperado %zu)\n", rows, count);
+    printf("repetição de 1 dia:    %lld copiados, %lld descartados\n", again.rows, again.duplicates);
+
+    free(samples);
+    remove_dir(part.db_dir);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Partições do comando csv (mesma configuração ao gerar e ao exportar)
+static void csv_context(datalogger_context_t* ctx, const char* dir) {
+    static const datalogger_db_profile_t build_profile = { "WAL", 0, 10000, 0, 0, 0, 0, 0, 0, 0 };
+    memset(ctx, 0, sizeof(*ctx));
+    snprintf(ctx->device_name, sizeof(ctx->device_name), "BENCH");
+    snprintf(ctx->db_dir, sizeof(ctx->db_dir), "%s/datalogger_bench_csv", dir);
+    ctx->db_partitioned = true;
+    ctx->db_profile = build_profile;
+}
+
+// Caminho antigo: uma consulta por intervalo com strftime() e fprintf() por linha
+typedef struct {
+    FILE* out;
+    long long rows;
+} printf_export_t;
+
+static bool printf_row(const datalogger_query_row_t* row, void* user) {
+    printf_export_t* e = user;
+    time_t t = (time_t)(row->first_time / 1000);
+    struct tm tm_info;
+    char stamp[32];
+    localtime_r(&t, &tm_info);
+    strftime(stamp, sizeof(stamp), "%d/%m/%Y %H:%M:%S", &tm_info);
+    e->rows++;
+    return fprintf(e->out, "%s;%.1f;%d\r\n", stamp, row->temp_min, row->door_open_count ? 1 : 0) > 0;
+}
+
+/**
+ * @brief Um caso do comando csv (executado em um processo filho)
+ */
+static bool run_csv(const char* label, const char* dir, const char* dest, int mode, long long from,
+                    long long to, FILE* out) {
+    datalogger_context_t ctx;
+    csv_context(&ctx, dir);
+    if (!datalogger_init_database(&ctx)) return false;
+
+    datalogger_csv_stats_t stats;
+    memset(&stats, 0, sizeof(stats));
+    long long t0 = now_ns();
+    bool ok;
+    if (mode == 0) {
+        printf_export_t e = { fopen(dest, "w"), 0 };
+        ok = e.out && fputs("Data Hora;TPrincipal;PA\r\n", e.out) >= 0 &&
+             datalogger_query_range(&ctx, from, to, 0, printf_row, &e) >= 0;
+        ok = e.out && fflush(e.out) == 0 && fdatasync(fileno(e.out)) == 0 && ok;
+        if (e.out) fclose(e.out);
+        stats.rows = e.rows;
+    } else {
+        ok = datalogger_export_csv(&ctx, dest, from, to, mode == 2, &stats);
+    }
+    double ms = (double)(now_ns() - t0) / 1e6;
+    datalogger_cleanup_database(&ctx);
+
+    struct stat st;
+    long long file_size = stat(dest, &st) == 0 ? (long long)st.st_size : 0;
+    long long csv_bytes = mode == 0 ? file_size : (long long)stats.csv_bytes;
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    if (ok) {
+        fprintf(out, "%-18s %9lld %9.1f %10.0f %9.1f %10lld %9ld\n", label, stats.rows, ms,
+                stats.rows * 1000.0 / ms, csv_bytes / (1024.0 * 1024.0) / (ms / 1000.0),
+                file_size / 1024, usage.ru_maxrss);
+        fflush(out);
+    }
+    return ok;
+}
+
+/**
+ * @brief Confere se dois arquivos têm o mesmo conteúdo (gzread lê .gz e arquivos sem compressão)
+ */
+static bool same_content(const char* a_path, const char* b_path) {
+    gzFile a = gzopen(a_path, "rb");
+    gzFile b = gzopen(b_path, "rb");
+    bool same = a && b;
+    static char buf_a[65536], buf_b[65536];
+    while (same) {
+        int na = gzread(a, buf_a, sizeof(buf_a));
+        int nb = gzread(b, buf_b, sizeof(buf_b));
+        same = na >= 0 && na == nb && memcmp(buf_a, buf_b, (size_t)na) == 0;
+        if (na <= 0) break;
+    }
+    if (a) gzclose(a);
+    if (b) gzclose(b);
+    return same;
+}
+
+static int bench_csv(int argc, char* argv[]) {
+    const char* dir = argc > 1 ? argv[1] : "/tmp";
+    const char* dest_dir = argc > 2 ? argv[2] : dir;
+
+    ts_sample_t* samples = NULL;
+    size_t count = synth_samples(&samples);
+    if (count == 0) return EXIT_FAILURE;
+    const long long first = samples[0].collect_time;
+    const long long last = samples[count - 1].collect_time;
+
+    // Ano gerado em um processo filho: os casos partem do mesmo RSS
+    datalogger_context_t part;
+    csv_context(&part, dir);
+    remove_dir(part.db_dir);
+    mkdir(part.db_dir, 0755);
+    pid_t pid = fork();
+    if (pid == 0) {
+        if (!freopen("/dev/null", "w", stdout)) _exit(EXIT_FAILURE);
+        bool built = datalogger_init_database(&part) && build_year_db(&part);
+        datalogger_cleanup_database(&part);
+        _exit(built ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+    free(samples);
+    int status = 0;
+    if (pid < 0 || waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) {
+        fprintf(stderr, "Erro ao gerar partições sintéticas\n");
+        remove_dir(part.db_dir);
+        return EXIT_FAILURE;
+    }
+
+    char paths[4][DATALOGGER_MAX_PATH + 64];
+    snprintf(paths[0], sizeof(paths[0]), "%s/datalogger_bench_printf.csv", dest_dir);
+    snprintf(paths[1], sizeof(paths[1]), "%s/datalogger_bench%s", dest_dir, DATALOGGER_CSV_SUFFIX);
+    snprintf(paths[2], sizeof(paths[2]), "%s/datalogger_bench%s", dest_dir, DATALOGGER_CSV_GZIP_SUFFIX);
+    snprintf(paths[3], sizeof(paths[3]), "%s/datalogger_bench_month%s", dest_dir, DATALOGGER_CSV_GZIP_SUFFIX);
+    const struct {
+        const char* label;
+        int mode;                   // 0 = printf, 1 = CSV, 2 = CSV + gzip
+        long long from;
+    } cases[] = {
+        { "printf por linha", 0, first },
+        { "CSV", 1, first },
+        { "CSV + gzip", 2, first },
+        { "CSV + gzip, 1 mês", 2, last - 30 * 24 * 3600 * 1000LL },
+    };
+
+    printf("=== Exportação CSV de um ano sintético (%zu registros, %s -> %s) ===\n", count, dir, dest_dir);
+    printf("%-18s %9s %9s %10s %9s %10s %9s\n", "caso", "linhas", "ms", "linhas/s", "MB/s CSV",
+           "arq. KB", "RSS KB");
+    fflush(stdout);
+
+    // Um processo por caso: RSS de pico de cada exportação isolado
+    bool ok = true;
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        pid = fork();
+        if (pid == 0) {
+            int fd = dup(STDOUT_FILENO);
+            FILE* out = fd >= 0 ? fdopen(fd, "w") : NULL;
+            if (!out || !freopen("/dev/null", "w", stdout)) _exit(EXIT_FAILURE);
+            bool child_ok = run_csv(cases[i].label, dir, paths[i], cases[i].mode, cases[i].from, last, out);
+            fclose(out);
+            _exit(child_ok ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+        if (pid < 0 || waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) ||
+            WEXITSTATUS(status) != EXIT_SUCCESS) {
+            fprintf(stderr, "Erro no caso %s\n", cases[i].label);
+            ok = false;
+        }
+    }
+
+    // Mesmo conteúdo nos três caminhos do ano
+    bool same = ok && same_content(paths[0], paths[1]) && same_content(paths[1], paths[2]);
+    printf("saídas: %s\n", same ? "idênticas" : "DIVERGENTES");
+
+    for (int i = 0; i < 4; i++) unlink(paths[i]);
+    remove_dir(part.db_dir);
+    return ok && same ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * @brief Grava um log TXT no formato do DataLogger (R;Data Hora;TPrincipal;PA)
+ */
+static bool build_txt_log(const char* path, const ts_sample_t* samples, size_t count) {
+    FILE* fp = fopen(path, "w");
+    if (!fp) return false;
+
+    fprintf(fp, "NAME: BENCH\nR;Data Hora;TPrincipal;PA\n");
+    for (size_t i = 0; i < count; i++) {
+        time_t secs = (time_t)(samples[i].collect_time / 1000);
+        struct tm tm_local;
+        char datetime[32];
+        localtime_r(&secs, &tm_local);
+        strftime(datetime, sizeof(datetime), "%d/%m/%Y %H:%M:%S", &tm_local);
+        fprintf(fp, "%zu;%s;%.1f;%d\n", i + 1, datetime, samples[i].temperature / 10.0f,
+                (samples[i].flags & TS_FLAG_DOOR_OPEN) ? 1 : 0);
+    }
+    return fclose(fp) == 0;
+}
+
+/**
+ * @brief Lê um arquivo inteiro para a memória
+ */
+static uint8_t* read_file(const char* path, size_t* size) {
+    FILE* fp = fopen(path, "rb");
+    if (!fp) return NULL;
+
+    struct stat st;
+    uint8_t* data = NULL;
+    if (fstat(fileno(fp), &st) == 0 && st.st_size > 0 && (data = malloc((size_t)st.st_size)) != NULL &&
+        fread(data, 1, (size_t)st.st_size, fp) != (size_t)st.st_size) {
+        free(data);
+        data = NULL;
+    }
+    fclose(fp);
+    *size = data ? (size_t)st.st_size : 0;
+    return data;
+}
+
+/**
+ * @brief Compacta em gzip na memória (mesmo fluxo do arquivador) e mede o tempo de CPU
+ * @return Bytes compactados, ou 0 em caso de erro
+ */
+static size_t gzip_cpu(const uint8_t* data, size_t size, int level, long long* cpu_out) {
+    uint8_t out[LOG_ARCHIVE_CHUNK_SIZE];
+    size_t total = 0;
+    long long t0 = cpu_ns();
+
+    for (int it = 0; it < BENCH_ITERATIONS; it++) {
+        z_stream zs;
+        memset(&zs, 0, sizeof(zs));
+        if (deflateInit2(&zs, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) return 0;
+        zs.next_in = (Bytef*)data;
+        zs.avail_in = (uInt)size;
+        total = 0;
+        int rc;
+        do {
+            zs.next_out = out;
+            zs.avail_out = sizeof(out);
+            rc = deflate(&zs, Z_FINISH);
+            total += sizeof(out) - zs.avail_out;
+        } while (rc == Z_OK);
+        deflateEnd(&zs);
+        if (rc != Z_STREAM_END) return 0;
+    }
+
+    *cpu_out = (cpu_ns() - t0) / BENCH_ITERATIONS;
+    return total;
+}
+
+static int count_bytes(const void* data, size_t len, void* user) {
+    (void)data;
+    *(unsigned long long*)user += len;
+    return 0;
+}
+
+/**
+ * @brief Níveis de gzip e o caminho real do arquivador para um segmento
+ */
+static bool bench_archive_file(const char* path, const char* archive_dir) {
+    static const int levels[] = { 1, LOG_ARCHIVE_LEVEL, 9 };
+    size_t size = 0;
+    uint8_t* data = read_file(path, &size);
+    if (!data) {
+        fprintf(stderr, "Erro ao ler %s\n", path);
+        return false;
+    }
+
+    const char* name = strrchr(path, '/') ? strrchr(path, '/') + 1 : path;
+    printf("\n%s (%.1f KB)\n", name, size / 1024.0);
+    printf("nível  razão   CPU (ms)  MB/s de CPU\n");
+    bool ok = true;
+    for (size_t i = 0; i < sizeof(levels) / sizeof(levels[0]); i++) {
+        long long cpu = 0;
+        size_t packed = gzip_cpu(data, size, levels[i], &cpu);
+        if (packed == 0) {
+            ok = false;
+            continue;
+        }
+        printf("%5d  %5.1fx  %8.1f  %11.1f%s\n", levels[i], (double)size / (double)packed, cpu / 1e6,
+               cpu > 0 ? (double)size / (1024.0 * 1024.0) / (cpu / 1e9) : 0.0,
+               levels[i] == LOG_ARCHIVE_LEVEL ? "  (arquivador)" : "");
+    }
+    free(data);
+
+    // Caminho real: leitura em blocos, fsync, limite de CPU e índice de tempo
+    log_archive_entry_t entry;
+    long long t0 = now_ns();
+    ok = ok && log_archive_compress_file(path, archive_dir, &entry) == 0;
+    double wall_ms = (double)(now_ns() - t0) / 1e6;
+    if (ok) {
+        char gz_path[DATALOGGER_MAX_PATH + 256];
+        unsigned long long restored = 0;
+        snprintf(gz_path, sizeof(gz_path), "%s/%s.gz", archive_dir, name);
+        long long c0 = cpu_ns();
+        ok = log_archive_decompress_to(gz_path, count_bytes, &restored, NULL) == 0 &&
+             restored == entry.original_bytes;
+        long long inflate_cpu = cpu_ns() - c0;
+        printf("arquivador: %.1fx, %lu ms de CPU em %.0f ms (limite de %d%% de um núcleo), "
+               "intervalo %s; descompactação %.1f ms de CPU%s\n",
+               entry.compressed_bytes > 0 ? (double)entry.original_bytes / (double)entry.compressed_bytes : 0.0,
+               entry.cpu_ms, wall_ms, LOG_ARCHIVE_CPU_BUDGET_PERCENT,
+               entry.start_time > 0 && entry.end_time >= entry.start_time ? "indexado" : "NÃO indexado",
+               inflate_cpu / 1e6, ok ? "" : " (DIVERGENTE)");
+        unlink(gz_path);
+    }
+    return ok;
+}
+
+static int bench_archive(int argc, char* argv[]) {
+    const char* dir = "/tmp";
+    int opt;
+    while ((opt = getopt(argc, argv, "d:")) != -1) {
+        if (opt == 'd') dir = optarg;
+        else return EXIT_FAILURE;
+    }
+
+    char archive_dir[DATALOGGER_MAX_PATH];
+    snprintf(archive_dir, sizeof(archive_dir), "%s/datalogger_bench_archive", dir);
+    remove_dir(archive_dir);
+    if (mkdir(archive_dir, 0755) != 0) {
+        fprintf(stderr, "Erro ao criar %s\n", archive_dir);
+        return EXIT_FAILURE;
+    }
+
+    printf("=== Arquivamento gzip: nível x razão x CPU ===\n");
+    bool ok = true;
+    if (optind < argc) {
+        // Segmentos reais (TXT ou .db de execuções anteriores)
+        for (int i = optind; i < argc; i++) {
+            ok = bench_archive_file(argv[i], archive_dir) && ok;
+        }
+    } else {
+        // Uma execução sintética de BENCH_ARCHIVE_DAYS dias, em TXT e em .db
+        ts_sample_t* samples = NULL;
+        size_t count = synth_samples(&samples);
+        size_t used = 0;
+        while (used < count && samples[used].collect_time - samples[0].collect_time <
+                                   BENCH_ARCHIVE_DAYS * 24 * 3600 * 1000LL) {
+            used++;
+        }
+        char txt_path[DATALOGGER_MAX_PATH + 64];
+        char db_path[DATALOGGER_MAX_PATH + 64];
+        snprintf(txt_path, sizeof(txt_path), "%s/BENCH_20240101_000000.txt", dir);
+        snprintf(db_path, sizeof(db_path), "%s/BENCH_20240101_000000.db", dir);
+        remove_db_files(db_path);
+        ok = count > 0 && build_txt_log(txt_path, samples, used) && build_boot_db(db_path, samples, used) &&
+             bench_archive_file(txt_path, archive_dir) && bench_archive_file(db_path, archive_dir);
+        unlink(txt_path);
+        remove_db_files(db_path);
+        free(samples);
+    }
+
+    remove_dir(archive_dir);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static void print_usage(const char* prog) {
+    fprintf(stderr, "Uso: %s <comando> [argumentos]\n", prog);
+    fprintf(stderr, "  blocks [arquivo.db] [-o saida.tsb]  Compressão ts_block e vazão\n");
+    fprintf(stderr, "  insert [-n linhas] [-l atraso_us] [dir]  Inserção SQLite: caminho antigo x atual\n");
+    fprintf(stderr, "  fsync [-H horas] [-r reg/h] [dir]  Sincronizações por hora por perfil\n");
+    fprintf(stderr, "  query [arquivo.db]  Latência de consultas por intervalo\n");
+    fprintf(stderr, "  partition [dir]  Partições mensais: consultas e descarte do mês mais antigo\n");
+    fprintf(stderr, "  schema [dir]  Esquema v1 x v2: bytes por registro, inserção e migração\n");
+    fprintf(stderr, "  profile [dir]  Perfis de memória/páginas do SQLite: RSS, amplificação e latência\n");
+    fprintf(stderr, "  merge [dir]  Consolidação de bancos por execução nas partições mensais\n");
+    fprintf(stderr, "  csv [dir] [destino]  Exportação CSV de um ano: printf por linha x streaming, gzip\n");
+    fprintf(stderr, "  archive [-d dir] [segmento...]  Arquivamento gzip: razão e CPU por nível\n");
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const char* command = argv[1];
+    if (strcmp(command, "blocks") == 0) {
+        return bench_blocks(argc - 1, argv + 1);
+    }
+    if (strcmp(command, "insert") == 0) {
+        return bench_insert(argc - 1, argv + 1);
+    }
+    if (strcmp(command, "fsync") == 0) {
+        return bench_fsync(argc - 1, argv + 1);
+    }
+    if (strcmp(command, "query") == 0) {
+        return bench_query(argc - 1, argv + 1);
+    }
+    if (strcmp(command, "partition") == 0) {
+        return bench_partition(argc - 1, argv + 1);
+    }
+    if (strcmp(command, "schema") == 0) {
+        return bench_schema(argc - 1, argv + 1);
+    }
+    if (strcmp(command, "profile") == 0) {
+        return bench_profile(argc - 1, argv + 1);
+    }
+    if (strcmp(command, "merge") == 0) {
+        return bench_merge(argc - 1, argv + 1);
+    }
+    if (strcmp(command, "csv") == 0) {
+        return bench_csv(argc - 1, argv + 1);
+    }
+    if (strcmp(command, "archive") == 0) {
+        return bench_archive(argc - 1, argv + 1);
+    }
+
+    print_usage(argv[0]);
+    return EXIT_FAILURE;
+}
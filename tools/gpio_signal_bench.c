@@ -0,0 +1,232 @@
+/**
+ * @file gpio_signal_bench.c
+ * @brief COEL E33 DataLogger - Teste da sinalização assíncrona (buzzer e LEDs)
+ * @author Nova Instruments
+ *
+ * Uso: gpio_signal_bench [-c chip] [-b linha] [-l linha] [-e linha] [-v arquivo] [padrões...]
+ *   Enfileira os padrões (padrão: success error alarm progress), mede quanto
+ *   tempo quem sinaliza fica bloqueado em gpio_signal_play() e quanto a
+ *   sinalização leva para tocar tudo. Com -v, amostra a cada 1 ms o valor da
+ *   linha do buzzer (ex: sim_gpio23/value do gpio-sim) e confere o número
+ *   de beeps de cada padrão e a duração total.
+ *
+ *   Com o módulo gpio-sim do kernel (configfs), sem hardware:
+ *     modprobe gpio-sim
+ *     mkdir -p /sys/kernel/config/gpio-sim/sinal/bank0
+ *     echo 32 > /sys/kernel/config/gpio-sim/sinal/bank0/num_lines
+ *     echo 1 > /sys/kernel/config/gpio-sim/sinal/live
+ *     chip=$(cat /sys/kernel/config/gpio-sim/sinal/bank0/chip_name)
+ *     dev=$(cat /sys/kernel/config/gpio-sim/sinal/dev_name)
+ *     gpio_signal_bench -c $chip -b 23 -l 24 -e 25 \
+ *         -v /sys/devices/platform/$dev/$chip/sim_gpio23/value
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "gpio_signal.h"
+
+#define BENCH_MAX_EDGES 256
+#define BENCH_TOLERANCE_MS 50         // Atraso aceito na duração total
+
+// Beeps esperados na linha do buzzer por padrão
+static const int expected_beeps[GPIO_SIGNAL_PATTERN_COUNT] = {
+    [GPIO_SIGNAL_SUCCESS] = 3,
+    [GPIO_SIGNAL_ERROR] = 1,
+    [GPIO_SIGNAL_PROGRESS] = 0,
+    [GPIO_SIGNAL_ALARM] = 5,
+};
+
+// Amostragem da linha do buzzer
+typedef struct {
+    const char* path;
+    volatile bool stop;
+    long long start_ns;
+    int rising;
+    int edges;
+    long long edge_ms[BENCH_MAX_EDGES];
+    int edge_value[BENCH_MAX_EDGES];
+    bool failed;
+} sampler_t;
+
+/**
+ * @brief Tempo monotônico em nanossegundos
+ */
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int read_value(int fd) {
+    char c;
+    if (pread(fd, &c, 1, 0) != 1) {
+        return -1;
+    }
+    return c == '1';
+}
+
+static void* sample_line(void* arg) {
+    sampler_t* s = arg;
+    int fd = open(s->path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        fprintf(stderr, "Erro ao abrir %s: %s\n", s->path, strerror(errno));
+        s->failed = true;
+        return NULL;
+    }
+
+    int last = read_value(fd);
+    while (!s->stop) {
+        int value = read_value(fd);
+        if (value < 0) {
+            s->failed = true;
+            break;
+        }
+        if (value != last) {
+            if (s->edges < BENCH_MAX_EDGES) {
+                s->edge_ms[s->edges] = (now_ns() - s->start_ns) / 1000000;
+                s->edge_value[s->edges] = value;
+                s->edges++;
+            }
+            s->rising += value;
+            last = value;
+        }
+        usleep(1000);
+    }
+    close(fd);
+    return NULL;
+}
+
+static bool parse_pattern(const char* name, gpio_signal_pattern_t* pattern) {
+    for (int p = 0; p < GPIO_SIGNAL_PATTERN_COUNT; p++) {
+        if (strcmp(name, gpio_signal_pattern_name((gpio_signal_pattern_t)p)) == 0) {
+            *pattern = (gpio_signal_pattern_t)p;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void print_usage(const char* prog) {
+    fprintf(stderr, "Uso: %s [-c chip] [-b linha] [-l linha] [-e linha] [-v arquivo] [padrões...]\n", prog);
+    fprintf(stderr, "  -c  Chip GPIO (padrão %s)\n", GPIO_SIGNAL_CHIP);
+    fprintf(stderr, "  -b  Linha do buzzer (padrão %d)\n", GPIO_SIGNAL_BUZZER_LINE);
+    fprintf(stderr, "  -l  Linha do LED de estado (padrão: sem LED)\n");
+    fprintf(stderr, "  -e  Linha do LED de erro (padrão: sem LED)\n");
+    fprintf(stderr, "  -v  Valor da linha do buzzer para amostrar (gpio-sim: .../sim_gpioN/value)\n");
+    fprintf(stderr, "  padrões: success, error, progress, alarm\n");
+}
+
+int main(int argc, char* argv[]) {
+    gpio_signal_config_t config = {
+        .chip = GPIO_SIGNAL_CHIP,
+        .buzzer_line = GPIO_SIGNAL_BUZZER_LINE,
+        .led_ok_line = GPIO_SIGNAL_LED_OK_LINE,
+        .led_error_line = GPIO_SIGNAL_LED_ERROR_LINE
+    };
+    const char* value_path = NULL;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "c:b:l:e:v:h")) != -1) {
+        switch (opt) {
+            case 'c': config.chip = optarg; break;
+            case 'b': config.buzzer_line = atoi(optarg); break;
+            case 'l': config.led_ok_line = atoi(optarg); break;
+            case 'e': config.led_error_line = atoi(optarg); break;
+            case 'v': value_path = optarg; break;
+            default: print_usage(argv[0]); return EXIT_FAILURE;
+        }
+    }
+
+    gpio_signal_pattern_t sequence[GPIO_SIGNAL_QUEUE_SIZE];
+    int count = 0;
+    for (int i = optind; i < argc && count < GPIO_SIGNAL_QUEUE_SIZE; i++) {
+        if (!parse_pattern(argv[i], &sequence[count++])) {
+            fprintf(stderr, "Erro: padrão desconhecido: %s\n", argv[i]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (count == 0) {
+        const gpio_signal_pattern_t defaults[] = {
+            GPIO_SIGNAL_SUCCESS, GPIO_SIGNAL_ERROR, GPIO_SIGNAL_ALARM, GPIO_SIGNAL_PROGRESS
+        };
+        for (size_t i = 0; i < sizeof(defaults) / sizeof(defaults[0]); i++) {
+            sequence[count++] = defaults[i];
+        }
+    }
+
+    if (gpio_signal_init(&config) != 0) {
+        fprintf(stderr, "Erro: não foi possível inicializar a sinalização em %s\n", config.chip);
+        return EXIT_FAILURE;
+    }
+
+    sampler_t sampler = { .path = value_path };
+    pthread_t sampler_thread;
+    bool sampling = false;
+    if (value_path) {
+        sampler.start_ns = now_ns();
+        sampling = pthread_create(&sampler_thread, NULL, sample_line, &sampler) == 0;
+        usleep(5000);  // Primeira leitura antes do primeiro padrão
+    }
+
+    // Quem sinaliza: tempo bloqueado em cada gpio_signal_play()
+    int expected_ms = 0;
+    int beeps = 0;
+    long long play_max_ns = 0;
+    long long start = now_ns();
+    if (sampling) {
+        sampler.start_ns = start;
+    }
+    for (int i = 0; i < count; i++) {
+        long long t0 = now_ns();
+        bool queued = gpio_signal_play(sequence[i]);
+        long long elapsed = now_ns() - t0;
+        if (elapsed > play_max_ns) play_max_ns = elapsed;
+        if (!queued) {
+            fprintf(stderr, "Erro: padrão %s não enfileirado\n", gpio_signal_pattern_name(sequence[i]));
+        }
+        expected_ms += gpio_signal_pattern_ms(sequence[i]);
+        beeps += expected_beeps[sequence[i]];
+    }
+    long long queued_ns = now_ns() - start;
+
+    bool ok = gpio_signal_flush(expected_ms + 2000);
+    double played_ms = (double)(now_ns() - start) / 1e6;
+
+    if (sampling) {
+        usleep(20000);
+        sampler.stop = true;
+        pthread_join(sampler_thread, NULL);
+    }
+
+    gpio_signal_stats_t stats;
+    gpio_signal_get_stats(&stats);
+    gpio_signal_cleanup();
+    expected_ms -= (int)stats.coalesced * gpio_signal_pattern_ms(GPIO_SIGNAL_PROGRESS);
+
+    printf("\n=== Sinalização em %s (buzzer %d), %d padrões ===\n", config.chip, config.buzzer_line, count);
+    printf("%-34s %10.1f us (máx. %.1f us)\n", "bloqueio de quem sinaliza", queued_ns / 1e3 / count,
+           play_max_ns / 1e3);
+    printf("%-34s %10.1f ms (esperado %d ms)\n", "padrões tocados", played_ms, expected_ms);
+    printf("%-34s %lu enfileirados, %lu tocados, %lu descartados, %lu agrupados\n", "estatísticas",
+           stats.queued, stats.played, stats.dropped, stats.coalesced);
+    ok = ok && stats.played == stats.queued && played_ms <= expected_ms + BENCH_TOLERANCE_MS;
+
+    if (value_path) {
+        printf("%-34s %d (esperado %d)\n", "beeps na linha do buzzer", sampler.rising, beeps);
+        for (int i = 0; i + 1 < sampler.edges; i += 2) {
+            printf("  beep %2d: %6lld ms -> %6lld ms (%lld ms)\n", i / 2 + 1, sampler.edge_ms[i],
+                   sampler.edge_ms[i + 1], sampler.edge_ms[i + 1] - sampler.edge_ms[i]);
+        }
+        ok = ok && sampling && !sampler.failed && sampler.rising == beeps;
+    }
+
+    printf("resultado: %s\n", ok ? "OK" : "FALHOU");
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
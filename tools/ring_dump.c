@@ -0,0 +1,98 @@
+/**
+ * @file ring_dump.c
+ * @brief COEL E33 DataLogger - Leitor do anel binário de amostras brutas
+ * @author Nova Instruments
+ *
+ * Uso: ring_dump <arquivo.ring> [-f inicio_ms] [-t fim_ms] [-H]
+ *   -f  Primeiro timestamp (ms desde epoch) a exibir
+ *   -t  Último timestamp (ms desde epoch) a exibir
+ *   -H  Exibe apenas o cabeçalho do anel
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "ring_store.h"
+
+#define DUMP_BATCH 1024
+
+static void print_usage(const char* prog) {
+    fprintf(stderr, "Uso: %s <arquivo.ring> [-f inicio_ms] [-t fim_ms] [-H]\n", prog);
+}
+
+int main(int argc, char* argv[]) {
+    int64_t from_ms = INT64_MIN;
+    int64_t to_ms = INT64_MAX;
+    int header_only = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "f:t:H")) != -1) {
+        switch (opt) {
+            case 'f': from_ms = strtoll(optarg, NULL, 10); break;
+            case 't': to_ms = strtoll(optarg, NULL, 10); break;
+            case 'H': header_only = 1; break;
+            default:
+                print_usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    if (optind >= argc) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    ring_store_t* rs = ring_store_open(argv[optind], 0, true);
+    if (!rs) {
+        return EXIT_FAILURE;
+    }
+
+    ring_store_header_t h;
+    ring_store_get_header(rs, &h);
+    fprintf(stderr, "Capacidade: %u registros | head: %llu | tail: %llu | geração: %llu | disponíveis: %llu\n",
+            h.capacity, (unsigned long long)h.head, (unsigned long long)h.tail,
+            (unsigned long long)h.generation, (unsigned long long)(h.head - h.tail));
+    if (h.time_step > h.tail) {
+        fprintf(stderr, "Relógio ajustado para trás no índice %llu\n", (unsigned long long)h.time_step);
+    }
+
+    if (header_only) {
+        ring_store_close(rs);
+        return EXIT_SUCCESS;
+    }
+
+    printf("Indice;CollectTime;Data Hora;Escravo;Registrador;Valor;Valido\n");
+
+    ring_store_record_t batch[DUMP_BATCH];
+    uint64_t index = (from_ms == INT64_MIN) ? h.tail : ring_store_find_time(rs, from_ms);
+    size_t count;
+    int done = 0;
+
+    while (!done && (count = ring_store_read(rs, &index, batch, DUMP_BATCH)) > 0) {
+        uint64_t first = index - count;
+        for (size_t i = 0; i < count; i++) {
+            const ring_store_record_t* r = &batch[i];
+            if (r->timestamp_ms > to_ms) {
+                done = 1;
+                break;
+            }
+
+            time_t seconds = (time_t)(r->timestamp_ms / 1000);
+            struct tm tm_info;
+            char datetime_str[32];
+            localtime_r(&seconds, &tm_info);
+            strftime(datetime_str, sizeof(datetime_str), "%d/%m/%Y %H:%M:%S", &tm_info);
+
+            printf("%llu;%lld;%s.%03d;%u;0x%03X;%u;%d\n",
+                   (unsigned long long)(first + i), (long long)r->timestamp_ms, datetime_str,
+                   (int)(r->timestamp_ms % 1000), r->slave_id, r->register_id, r->value,
+                   (r->flags & RING_FLAG_VALID) ? 1 : 0);
+        }
+    }
+
+    ring_store_close(rs);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,1188 @@
+/**
+ * @file usb_export_bench.c
+ * @brief COEL E33 DataLogger - Benchmarks da exportação para pen drive
+ * @author Nova Instruments
+ *
+ * Uso: usb_export_bench <comando> [argumentos]
+ *   copy [-n arquivos] [-s MB] [-o origem] [destino]
+ *       Gera bancos sintéticos NI*.db na origem (padrão /tmp) e compara a
+ *       cópia antiga (system("find ... -exec cp") + sync() global) com a
+ *       cópia dentro do processo (usb_export_copy_dir + syncfs no destino).
+ *       O destino deve estar em outro sistema de arquivos, como um tmpfs
+ *       (padrão /dev/shm) ou uma imagem montada em loop, para simular o
+ *       pen drive. O sleep(1) que seguia o sync() antigo não é medido.
+ *   incremental [-n meses] [-s MB] [-o origem] [destino]
+ *       Exporta um histórico de partições mensais para o destino sem
+ *       manifesto (cópia completa), simula a virada do mês (partição em uso
+ *       selada, uma removida pela retenção, outra apenas com mtime
+ *       alterado) e repete a exportação com o manifesto, mostrando bytes
+ *       copiados x pulados e conferindo o conteúdo do destino.
+ *   verify [-n arquivos] [-s MB] [-o origem] [destino]
+ *       Compara a cópia no kernel sem CRC, a cópia com CRC32C calculado
+ *       durante a cópia, a cópia seguida de uma segunda leitura da origem
+ *       para o CRC e a cópia com releitura do destino (O_DIRECT ou após
+ *       descartar o cache); corrompe um byte no destino e confere que a
+ *       releitura detecta. Mostra também a vazão do CRC32C em memória.
+ *   multi [-n arquivos] [-s MB] [-d destinos] [-o origem] [destino]
+ *       Exporta para vários diretórios de destino (pen drives conectados
+ *       juntos) um após o outro, relendo a origem a cada um, e em leque
+ *       (usb_export_copy_dir_multi: origem lida uma vez, syncfs em paralelo).
+ *       O cache da origem é descartado antes de cada passada. Repete com um
+ *       destino novo entre destinos já exportados e confere que apenas ele
+ *       recebe os bancos.
+ *   mount [-i iterações] <partição> [ponto de montagem]
+ *       Confere a identificação do sistema de arquivos em setores de boot e
+ *       superblocos sintéticos e compara, na partição (ex: imagem em
+ *       /dev/loopN), a montagem por tentativas em sequência com a montagem
+ *       após ler o superbloco e com o tipo já informado pelo udev. Requer root.
+ *   mounttab [-n consultas] [ponto de montagem]
+ *       Compara a consulta antiga (abrir e percorrer /proc/mounts a cada
+ *       dispositivo candidato) com o cache da tabela de montagens, contando
+ *       as releituras. Como root, monta um tmpfs no ponto de montagem e
+ *       confere que o cache percebe a montagem e a desmontagem.
+ *   resume [-n arquivos] [-s MB] [-o origem] [ponto de montagem]
+ *       Exporta para um tmpfs pequeno demais (o pen drive "sai" no meio de
+ *       um banco, com ENOSPC), aumenta o tmpfs (a reinserção) e exporta de
+ *       novo com o manifesto lido do destino: mostra os bytes retomados do
+ *       ponto de controle x regravados e confere o conteúdo e que nenhum
+ *       .part ficou no destino. Requer root.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <mntent.h>
+#include <sys/stat.h>
+#include <sys/mount.h>
+#include "usb_export.h"
+#include "usb_mount.h"
+
+#define BENCH_COPY_FILES 12           // Um ano de partições mensais
+#define BENCH_COPY_FILE_MB 4
+#define BENCH_ITERATIONS 3
+#define BENCH_MULTI_TARGETS 3         // Pen drives conectados juntos
+
+/**
+ * @brief Tempo monotônico em nanossegundos
+ */
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * @brief Remove um diretório e seus arquivos (um nível)
+ */
+static void remove_dir(const char* path) {
+    DIR* dir = opendir(path);
+    if (dir) {
+        struct dirent* entry;
+        char file[USB_EXPORT_MAX_PATH];
+        while ((entry = readdir(dir)) != NULL) {
+            if (entry->d_name[0] == '.') continue;
+            snprintf(file, sizeof(file), "%s/%s", path, entry->d_name);
+            unlink(file);
+        }
+        closedir(dir);
+    }
+    rmdir(path);
+}
+
+/**
+ * @brief Grava um arquivo com conteúdo pseudoaleatório (sem blocos esparsos)
+ */
+static bool write_synthetic_file(const char* path, size_t bytes, uint32_t seed) {
+    FILE* f = fopen(path, "wb");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+
+    uint32_t block[4096];
+    size_t written = 0;
+    while (written < bytes) {
+        for (size_t i = 0; i < sizeof(block) / sizeof(block[0]); i++) {
+            seed = seed * 1664525u + 1013904223u;
+            block[i] = seed;
+        }
+        size_t n = bytes - written < sizeof(block) ? bytes - written : sizeof(block);
+        if (fwrite(block, 1, n, f) != n) {
+            perror(path);
+            fclose(f);
+            return false;
+        }
+        written += n;
+    }
+    return fclose(f) == 0;
+}
+
+/**
+ * @brief Confere se dois arquivos têm o mesmo conteúdo
+ */
+static bool same_content(const char* a, const char* b) {
+    FILE* fa = fopen(a, "rb");
+    FILE* fb = fopen(b, "rb");
+    bool same = fa && fb;
+    static char buf_a[65536], buf_b[65536];
+    while (same) {
+        size_t na = fread(buf_a, 1, sizeof(buf_a), fa);
+        size_t nb = fread(buf_b, 1, sizeof(buf_b), fb);
+        if (na != nb || memcmp(buf_a, buf_b, na) != 0) same = false;
+        if (na == 0) break;
+    }
+    if (fa) fclose(fa);
+    if (fb) fclose(fb);
+    return same;
+}
+
+/**
+ * @brief Confere todos os arquivos copiados para o destino
+ */
+static bool verify_copy(const char* src_dir, const char* dest_dir, int files) {
+    char src[USB_EXPORT_MAX_PATH];
+    char dest[USB_EXPORT_MAX_PATH];
+    for (int i = 0; i < files; i++) {
+        snprintf(src, sizeof(src), "%s/NIBENCH_2024%02d.db", src_dir, i + 1);
+        snprintf(dest, sizeof(dest), "%s/NIBENCH_2024%02d.db", dest_dir, i + 1);
+        if (!same_content(src, dest)) {
+            fprintf(stderr, "Erro: cópia divergente de %s\n", src);
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Caminho antigo: find + um cp por arquivo + sync() global
+ */
+static bool copy_with_shell(const char* src_dir, const char* dest_dir, double* ms) {
+    char command[3 * USB_EXPORT_MAX_PATH];
+    snprintf(command, sizeof(command),
+             "find \"%s\" -name \"NI*.db\" -type f -exec cp {} \"%s/\" \\; 2>/dev/null",
+             src_dir, dest_dir);
+
+    long long t0 = now_ns();
+    int result = system(command);
+    sync();
+    *ms = (double)(now_ns() - t0) / 1e6;
+    return result == 0;
+}
+
+/**
+ * @brief Caminho atual: cópia no processo + syncfs() no destino
+ */
+static bool copy_in_process(const char* src_dir, const char* dest_dir, double* ms,
+                            usb_export_stats_t* stats) {
+    long long t0 = now_ns();
+    int result = usb_export_copy_dir(src_dir, dest_dir, USB_EXPORT_DB_PREFIX, USB_EXPORT_DB_SUFFIX,
+                                     NULL, NULL, NULL, NULL, stats);
+    long long t1 = now_ns();
+    int sync_result = usb_export_sync(dest_dir);
+    stats->sync_ms = (now_ns() - t1) / 1000000;
+    *ms = (double)(now_ns() - t0) / 1e6;
+    return result == 0 && sync_result == 0;
+}
+
+/**
+ * @brief Progresso em bytes usado para conferir a contagem exata
+ */
+static void count_progress(const char* name, unsigned long long file_bytes,
+                           unsigned long long file_size,
+                           const usb_export_stats_t* stats, void* user) {
+    (void)name;
+    (void)stats;
+    if (file_bytes == file_size) {
+        *(unsigned long long*)user += file_size;
+    }
+}
+
+static int bench_copy(int argc, char* argv[]) {
+    int files = BENCH_COPY_FILES;
+    int file_mb = BENCH_COPY_FILE_MB;
+    const char* base = "/tmp";
+    const char* target = "/dev/shm";
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:s:o:")) != -1) {
+        switch (opt) {
+            case 'n': files = atoi(optarg); break;
+            case 's': file_mb = atoi(optarg); break;
+            case 'o': base = optarg; break;
+            default: return EXIT_FAILURE;
+        }
+    }
+    if (optind < argc) target = argv[optind];
+    if (files <= 0 || files > 99 || file_mb <= 0) {
+        fprintf(stderr, "Erro: parâmetros inválidos\n");
+        return EXIT_FAILURE;
+    }
+
+    char src_dir[USB_EXPORT_MAX_PATH];
+    char dest_dir[USB_EXPORT_MAX_PATH];
+    snprintf(src_dir, sizeof(src_dir), "%s/usb_export_bench_src", base);
+    snprintf(dest_dir, sizeof(dest_dir), "%s/usb_export_bench_dest", target);
+    remove_dir(src_dir);
+    remove_dir(dest_dir);
+    if (mkdir(src_dir, 0755) != 0 || mkdir(dest_dir, 0755) != 0) {
+        perror("mkdir");
+        return EXIT_FAILURE;
+    }
+
+    char path[USB_EXPORT_MAX_PATH + 32];
+    bool ok = true;
+    for (int i = 0; i < files && ok; i++) {
+        snprintf(path, sizeof(path), "%s/NIBENCH_2024%02d.db", src_dir, i + 1);
+        ok = write_synthetic_file(path, (size_t)file_mb * 1024 * 1024, (uint32_t)(i + 1));
+    }
+    // Catálogo e arquivos de outros tipos não devem ser copiados
+    snprintf(path, sizeof(path), "%s/catalog_NIBENCH.db", src_dir);
+    ok = ok && write_synthetic_file(path, 4096, 99);
+
+    double shell_best = 0, engine_best = 0;
+    usb_export_stats_t stats;
+    memset(&stats, 0, sizeof(stats));
+    for (int it = 0; it < BENCH_ITERATIONS && ok; it++) {
+        double ms;
+        usb_export_remove_files(dest_dir, USB_EXPORT_DB_PREFIX, USB_EXPORT_DB_SUFFIX);
+        ok = copy_with_shell(src_dir, dest_dir, &ms) && verify_copy(src_dir, dest_dir, files);
+        if (it == 0 || ms < shell_best) shell_best = ms;
+
+        usb_export_remove_files(dest_dir, USB_EXPORT_DB_PREFIX, USB_EXPORT_DB_SUFFIX);
+        ok = ok && copy_in_process(src_dir, dest_dir, &ms, &stats) && verify_copy(src_dir, dest_dir, files);
+        if (it == 0 || ms < engine_best) engine_best = ms;
+    }
+
+    // Progresso: soma dos arquivos concluídos igual ao total anunciado
+    unsigned long long reported = 0;
+    usb_export_stats_t progress_stats;
+    usb_export_remove_files(dest_dir, USB_EXPORT_DB_PREFIX, USB_EXPORT_DB_SUFFIX);
+    ok = ok && usb_export_copy_dir(src_dir, dest_dir, USB_EXPORT_DB_PREFIX, USB_EXPORT_DB_SUFFIX,
+                                   NULL, NULL, count_progress, &reported, &progress_stats) == 0 &&
+         reported == progress_stats.total_bytes && progress_stats.files == files;
+
+    double mb = (double)files * file_mb;
+    printf("\n=== Exportação para pen drive: %d arquivos de %d MB (%s -> %s) ===\n",
+           files, file_mb, base, target);
+    printf("%-34s %10s %10s %10s\n", "caminho", "ms", "MB/s", "processos");
+    printf("%-34s %10.1f %10.1f %10d\n", "find -exec cp + sync()", shell_best,
+           mb / (shell_best / 1000.0), files + 2);
+    printf("%-34s %10.1f %10.1f %10d\n", "usb_export + syncfs()", engine_best,
+           mb / (engine_best / 1000.0), 0);
+    printf("mecanismo: %s, syncfs: %lld ms, melhor de %d execuções\n",
+           usb_export_method_name(stats.method), stats.sync_ms, BENCH_ITERATIONS);
+    printf("progresso em bytes: %llu de %llu\n", reported, progress_stats.total_bytes);
+    printf("(o caminho antigo ainda dormia 1 s após o sync(), não incluído acima)\n");
+    printf("resultado: %s\n", ok ? "OK" : "FALHOU");
+
+    remove_dir(src_dir);
+    remove_dir(dest_dir);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * @brief Acrescenta bytes pseudoaleatórios a um arquivo (partição em uso recebendo registros)
+ */
+static bool append_synthetic(const char* path, size_t bytes, uint32_t seed) {
+    FILE* f = fopen(path, "ab");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+    for (size_t i = 0; i < bytes; i += sizeof(seed)) {
+        seed = seed * 1664525u + 1013904223u;
+        fwrite(&seed, 1, sizeof(seed), f);
+    }
+    return fclose(f) == 0;
+}
+
+/**
+ * @brief Uma exportação como em extract_all_logs_to_device: manifesto, cópia
+ * dos selados, "snapshot" do arquivo em uso, poda e gravação do manifesto
+ */
+static bool export_once(const char* src_dir, const char* dest_dir, const char* live_name,
+                        bool* incremental, int* removed, double* ms, usb_export_stats_t* stats) {
+    long long t0 = now_ns();
+    usb_export_manifest_t manifest;
+    *incremental = usb_export_manifest_load(dest_dir, &manifest);
+    if (!*incremental) {
+        usb_export_remove_files(dest_dir, USB_EXPORT_DB_PREFIX, USB_EXPORT_DB_SUFFIX);
+    }
+
+    char src[USB_EXPORT_MAX_PATH + 32];
+    char dest[USB_EXPORT_MAX_PATH + 32];
+    snprintf(src, sizeof(src), "%s/%s", src_dir, live_name);
+    snprintf(dest, sizeof(dest), "%s/%s", dest_dir, live_name);
+    usb_export_stats_t live_stats;
+    usb_export_entry_t live;
+    memset(&live_stats, 0, sizeof(live_stats));
+    memset(&live, 0, sizeof(live));
+    bool ok = usb_export_copy_file(src, dest, &live.crc, NULL, NULL, &live_stats) == 0;
+
+    ok = usb_export_copy_dir(src_dir, dest_dir, USB_EXPORT_DB_PREFIX, USB_EXPORT_DB_SUFFIX, live_name,
+                             &manifest, NULL, NULL, stats) == 0 && ok;
+    stats->bytes += live_stats.bytes;
+    stats->files += live_stats.files;
+    *removed = usb_export_manifest_prune(&manifest, dest_dir, USB_EXPORT_DB_PREFIX,
+                                         USB_EXPORT_DB_SUFFIX, live_name);
+    snprintf(live.name, sizeof(live.name), "%s", live_name);
+    live.bytes = live_stats.bytes;
+    ok = usb_export_manifest_set(&manifest, &live) == 0 && ok;
+    ok = usb_export_manifest_save(dest_dir, &manifest) == 0 && ok;
+    usb_export_manifest_free(&manifest);
+    ok = usb_export_sync(dest_dir) == 0 && ok;
+    *ms = (double)(now_ns() - t0) / 1e6;
+    return ok;
+}
+
+static int bench_incremental(int argc, char* argv[]) {
+    int months = BENCH_COPY_FILES;
+    int file_mb = BENCH_COPY_FILE_MB;
+    const char* base = "/tmp";
+    const char* target = "/dev/shm";
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:s:o:")) != -1) {
+        switch (opt) {
+            case 'n': months = atoi(optarg); break;
+            case 's': file_mb = atoi(optarg); break;
+            case 'o': base = optarg; break;
+            default: return EXIT_FAILURE;
+        }
+    }
+    if (optind < argc) target = argv[optind];
+    if (months < 3 || months > 98 || file_mb <= 0) {
+        fprintf(stderr, "Erro: parâmetros inválidos\n");
+        return EXIT_FAILURE;
+    }
+
+    char src_dir[USB_EXPORT_MAX_PATH];
+    char dest_dir[USB_EXPORT_MAX_PATH];
+    snprintf(src_dir, sizeof(src_dir), "%s/usb_export_bench_src", base);
+    snprintf(dest_dir, sizeof(dest_dir), "%s/usb_export_bench_dest", target);
+    remove_dir(src_dir);
+    remove_dir(dest_dir);
+    if (mkdir(src_dir, 0755) != 0 || mkdir(dest_dir, 0755) != 0) {
+        perror("mkdir");
+        return EXIT_FAILURE;
+    }
+
+    // Meses 1..n-1 selados, mês n em uso
+    char path[USB_EXPORT_MAX_PATH + 64];
+    char live_name[64];
+    bool ok = true;
+    for (int i = 0; i < months && ok; i++) {
+        snprintf(path, sizeof(path), "%s/NIBENCH_2024%02d.db", src_dir, i + 1);
+        ok = write_synthetic_file(path, (size_t)file_mb * 1024 * 1024, (uint32_t)(i + 1));
+    }
+    snprintf(live_name, sizeof(live_name), "NIBENCH_2024%02d.db", months);
+
+    const char* labels[3] = {"1ª (sem manifesto)", "2ª (virada do mês)", "3ª (sem mudanças)"};
+    usb_export_stats_t stats[3];
+    double ms[3] = {0};
+    int removed[3] = {0};
+    bool incremental[3] = {false};
+    memset(stats, 0, sizeof(stats));
+
+    ok = ok && export_once(src_dir, dest_dir, live_name, &incremental[0], &removed[0], &ms[0], &stats[0]);
+
+    // Virada do mês: a partição em uso recebe os últimos registros e é selada,
+    // um novo mês começa, o mais antigo restante sai pela retenção e outro
+    // tem apenas o mtime alterado (aberto e fechado sem escrita)
+    snprintf(path, sizeof(path), "%s/%s", src_dir, live_name);
+    ok = ok && append_synthetic(path, 64 * 1024, 7);
+    snprintf(live_name, sizeof(live_name), "NIBENCH_2024%02d.db", months + 1);
+    snprintf(path, sizeof(path), "%s/%s", src_dir, live_name);
+    ok = ok && write_synthetic_file(path, 64 * 1024, 8);
+    snprintf(path, sizeof(path), "%s/NIBENCH_202402.db", src_dir);
+    unlink(path);
+    sleep(1);
+    snprintf(path, sizeof(path), "%s/NIBENCH_202401.db", src_dir);
+    ok = ok && utimensat(AT_FDCWD, path, NULL, 0) == 0;
+
+    ok = ok && export_once(src_dir, dest_dir, live_name, &incremental[1], &removed[1], &ms[1], &stats[1]);
+    ok = ok && export_once(src_dir, dest_dir, live_name, &incremental[2], &removed[2], &ms[2], &stats[2]);
+
+    // Destino igual à origem, sem o mês removido
+    for (int i = 0; i <= months && ok; i++) {
+        char src[USB_EXPORT_MAX_PATH + 32];
+        snprintf(src, sizeof(src), "%s/NIBENCH_2024%02d.db", src_dir, i + 1);
+        snprintf(path, sizeof(path), "%s/NIBENCH_2024%02d.db", dest_dir, i + 1);
+        if (i == 1) {
+            ok = access(path, F_OK) != 0;
+        } else {
+            ok = same_content(src, path);
+        }
+        if (!ok) fprintf(stderr, "Erro: destino divergente em %s\n", path);
+    }
+    ok = ok && !incremental[0] && incremental[1] && incremental[2] &&
+         stats[1].skipped == months - 2 && stats[1].hashed == 1 && removed[1] == 1 &&
+         stats[2].skipped == months - 1 && stats[2].files == 1;
+
+    printf("\n=== Exportação incremental: %d partições mensais de %d MB (%s -> %s) ===\n",
+           months, file_mb, base, target);
+    printf("%-22s %10s %10s %12s %12s %10s %10s\n", "exportação", "ms", "gravados",
+           "MB gravados", "MB pulados", "relidos", "removidos");
+    for (int i = 0; i < 3; i++) {
+        printf("%-22s %10.1f %10d %12.1f %12.1f %10d %10d\n", labels[i], ms[i], stats[i].files,
+               stats[i].bytes / (1024.0 * 1024.0), stats[i].skipped_bytes / (1024.0 * 1024.0),
+               stats[i].hashed, removed[i]);
+    }
+    printf("resultado: %s\n", ok ? "OK" : "FALHOU");
+
+    remove_dir(src_dir);
+    remove_dir(dest_dir);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * @brief Uma cópia completa do diretório em um dos modos do comando verify
+ */
+static bool copy_mode(const char* src_dir, const char* dest_dir, int mode, double* ms,
+                      usb_export_stats_t* stats) {
+    usb_export_manifest_t manifest;
+    memset(&manifest, 0, sizeof(manifest));
+    usb_export_remove_files(dest_dir, USB_EXPORT_DB_PREFIX, USB_EXPORT_DB_SUFFIX);
+
+    long long t0 = now_ns();
+    bool ok = usb_export_copy_dir(src_dir, dest_dir, USB_EXPORT_DB_PREFIX, USB_EXPORT_DB_SUFFIX, NULL,
+                                  mode == 0 || mode == 2 ? NULL : &manifest, NULL, NULL, stats) == 0;
+    if (mode == 2) {
+        // Segunda leitura da origem apenas para o CRC
+        DIR* dir = opendir(src_dir);
+        struct dirent* entry;
+        while (ok && dir && (entry = readdir(dir)) != NULL) {
+            if (strncmp(entry->d_name, USB_EXPORT_DB_PREFIX, 2) != 0) continue;
+            char path[USB_EXPORT_MAX_PATH + 288];
+            uint32_t crc;
+            snprintf(path, sizeof(path), "%s/%s", src_dir, entry->d_name);
+            ok = usb_export_crc_file(path, &crc, NULL) == 0;
+        }
+        if (dir) closedir(dir);
+    }
+    ok = ok && usb_export_sync(dest_dir) == 0;
+    if (mode == 3) {
+        ok = ok && usb_export_manifest_verify(&manifest, dest_dir, stats) == 0 &&
+             stats->verified == stats->files;
+    }
+    *ms = (double)(now_ns() - t0) / 1e6;
+
+    // Byte corrompido no destino: a releitura precisa detectar e remover o arquivo
+    if (mode == 3 && ok) {
+        char path[USB_EXPORT_MAX_PATH + 288];
+        snprintf(path, sizeof(path), "%s/%s", dest_dir, manifest.entries[0].name);
+        FILE* f = fopen(path, "r+b");
+        ok = f != NULL;
+        if (f) {
+            int c = fgetc(f);
+            fseek(f, 0, SEEK_SET);
+            fputc(c ^ 0x01, f);
+            fclose(f);
+        }
+        for (int i = 0; i < manifest.count; i++) manifest.entries[i].written = true;
+        usb_export_stats_t check;
+        memset(&check, 0, sizeof(check));
+        ok = ok && usb_export_manifest_verify(&manifest, dest_dir, &check) == 1 &&
+             check.verify_failed == 1 && access(path, F_OK) != 0;
+    }
+    usb_export_manifest_free(&manifest);
+    return ok;
+}
+
+static int bench_verify(int argc, char* argv[]) {
+    int files = BENCH_COPY_FILES;
+    int file_mb = BENCH_COPY_FILE_MB;
+    const char* base = "/tmp";
+    const char* target = "/dev/shm";
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:s:o:")) != -1) {
+        switch (opt) {
+            case 'n': files = atoi(optarg); break;
+            case 's': file_mb = atoi(optarg); break;
+            case 'o': base = optarg; break;
+            default: return EXIT_FAILURE;
+        }
+    }
+    if (optind < argc) target = argv[optind];
+    if (files <= 0 || files > 99 || file_mb <= 0) {
+        fprintf(stderr, "Erro: parâmetros inválidos\n");
+        return EXIT_FAILURE;
+    }
+
+    char src_dir[USB_EXPORT_MAX_PATH];
+    char dest_dir[USB_EXPORT_MAX_PATH];
+    snprintf(src_dir, sizeof(src_dir), "%s/usb_export_bench_src", base);
+    snprintf(dest_dir, sizeof(dest_dir), "%s/usb_export_bench_dest", target);
+    remove_dir(src_dir);
+    remove_dir(dest_dir);
+    if (mkdir(src_dir, 0755) != 0 || mkdir(dest_dir, 0755) != 0) {
+        perror("mkdir");
+        return EXIT_FAILURE;
+    }
+
+    char path[USB_EXPORT_MAX_PATH + 32];
+    bool ok = true;
+    for (int i = 0; i < files && ok; i++) {
+        snprintf(path, sizeof(path), "%s/NIBENCH_2024%02d.db", src_dir, i + 1);
+        ok = write_synthetic_file(path, (size_t)file_mb * 1024 * 1024, (uint32_t)(i + 1));
+    }
+
+    // Vazão do CRC32C em memória
+    size_t crc_len = 16 * 1024 * 1024;
+    unsigned char* data = malloc(crc_len);
+    double crc_mbs = 0;
+    if (data) {
+        for (size_t i = 0; i < crc_len; i++) data[i] = (unsigned char)(i * 31);
+        long long t0 = now_ns();
+        volatile uint32_t crc = usb_export_crc32c(0, data, crc_len);
+        (void)crc;
+        crc_mbs = 16.0 / ((double)(now_ns() - t0) / 1e9);
+        free(data);
+    }
+
+    const char* labels[4] = {
+        "kernel, sem CRC", "CRC durante a cópia", "cópia + 2ª leitura p/ CRC", "CRC + releitura destino"
+    };
+    double best[4] = {0};
+    usb_export_stats_t stats[4];
+    memset(stats, 0, sizeof(stats));
+    for (int it = 0; it < BENCH_ITERATIONS && ok; it++) {
+        for (int mode = 0; mode < 4 && ok; mode++) {
+            double ms;
+            ok = copy_mode(src_dir, dest_dir, mode, &ms, &stats[mode]);
+            if (it == 0 || ms < best[mode]) best[mode] = ms;
+        }
+    }
+
+    double mb = (double)files * file_mb;
+    printf("\n=== Verificação da exportação: %d arquivos de %d MB (%s -> %s) ===\n",
+           files, file_mb, base, target);
+    printf("%-28s %10s %10s %16s\n", "modo", "ms", "MB/s", "mecanismo");
+    for (int mode = 0; mode < 4; mode++) {
+        printf("%-28s %10.1f %10.1f %16s\n", labels[mode], best[mode], mb / (best[mode] / 1000.0),
+               usb_export_method_name(stats[mode].method));
+    }
+    printf("releitura: %s, %d arquivos; corrupção de 1 byte detectada: %s\n",
+           stats[3].verify_direct ? "O_DIRECT" : "cache descartado", stats[3].verified,
+           ok ? "sim" : "não");
+    printf("CRC32C em memória: %.0f MB/s\n", crc_mbs);
+    printf("resultado: %s\n", ok ? "OK" : "FALHOU");
+
+    remove_dir(src_dir);
+    remove_dir(dest_dir);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * @brief Descarta do cache as páginas dos arquivos da origem (leitura seguinte vem do dispositivo)
+ */
+static void drop_source_cache(const char* src_dir, int files) {
+    char path[USB_EXPORT_MAX_PATH + 32];
+    for (int i = 0; i < files; i++) {
+        snprintf(path, sizeof(path), "%s/NIBENCH_2024%02d.db", src_dir, i + 1);
+        int fd = open(path, O_RDONLY);
+        if (fd >= 0) {
+            posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+            close(fd);
+        }
+    }
+}
+
+/**
+ * @brief Prepara os destinos: vazios, ou mantidos com a exportação anterior
+ */
+static bool reset_targets(char dirs[][USB_EXPORT_MAX_PATH + 16], int count, bool keep_first) {
+    for (int i = 0; i < count; i++) {
+        if (keep_first && i < count - 1) continue;
+        remove_dir(dirs[i]);
+        if (mkdir(dirs[i], 0755) != 0) {
+            perror("mkdir");
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Um destino por vez, como antes: manifesto, cópia, syncfs e gravação do manifesto
+ */
+static bool export_sequential(const char* src_dir, char dirs[][USB_EXPORT_MAX_PATH + 16], int count,
+                              int files, double* ms, unsigned long long* read_bytes) {
+    bool ok = true;
+    long long t0 = now_ns();
+    *read_bytes = 0;
+    for (int i = 0; i < count && ok; i++) {
+        usb_export_manifest_t manifest;
+        usb_export_stats_t stats;
+        usb_export_manifest_load(dirs[i], &manifest);
+        drop_source_cache(src_dir, files);
+        ok = usb_export_copy_dir(src_dir, dirs[i], USB_EXPORT_DB_PREFIX, USB_EXPORT_DB_SUFFIX, NULL,
+                                 &manifest, NULL, NULL, &stats) == 0;
+        ok = ok && usb_export_sync(dirs[i]) == 0;
+        ok = ok && usb_export_manifest_save(dirs[i], &manifest) == 0;
+        usb_export_manifest_free(&manifest);
+        *read_bytes += stats.bytes;
+    }
+    *ms = (double)(now_ns() - t0) / 1e6;
+    return ok;
+}
+
+// Finalização de um destino em thread própria (syncfs + manifesto)
+typedef struct {
+    const char* dir;
+    usb_export_manifest_t* manifest;
+    int result;
+} finish_job_t;
+
+static void* finish_target(void* arg) {
+    finish_job_t* job = arg;
+    job->result = usb_export_sync(job->dir) == 0 &&
+                  usb_export_manifest_save(job->dir, job->manifest) == 0 ? 0 : -1;
+    return NULL;
+}
+
+/**
+ * @brief Todos os destinos juntos: cópia em leque e finalização em uma thread por destino
+ */
+static bool export_fanout(const char* src_dir, char dirs[][USB_EXPORT_MAX_PATH + 16], int count,
+                          int files, double* ms, unsigned long long* read_bytes,
+                          usb_export_target_t* targets) {
+    usb_export_manifest_t manifests[USB_EXPORT_MAX_TARGETS];
+    finish_job_t jobs[USB_EXPORT_MAX_TARGETS];
+    pthread_t threads[USB_EXPORT_MAX_TARGETS];
+    bool started[USB_EXPORT_MAX_TARGETS];
+
+    long long t0 = now_ns();
+    drop_source_cache(src_dir, files);
+    for (int i = 0; i < count; i++) {
+        usb_export_manifest_load(dirs[i], &manifests[i]);
+        memset(&targets[i], 0, sizeof(targets[i]));
+        targets[i].dir = dirs[i];
+        targets[i].manifest = &manifests[i];
+    }
+    bool ok = usb_export_copy_dir_multi(src_dir, USB_EXPORT_DB_PREFIX, USB_EXPORT_DB_SUFFIX, NULL,
+                                        targets, count) == 0;
+
+    // Bytes lidos da origem: o maior volume entre os destinos (cada arquivo lido uma vez)
+    *read_bytes = 0;
+    for (int i = 0; i < count; i++) {
+        if (targets[i].stats.bytes > *read_bytes) *read_bytes = targets[i].stats.bytes;
+        jobs[i].dir = dirs[i];
+        jobs[i].manifest = &manifests[i];
+        jobs[i].result = -1;
+        started[i] = pthread_create(&threads[i], NULL, finish_target, &jobs[i]) == 0;
+        if (!started[i]) {
+            finish_target(&jobs[i]);
+        }
+    }
+    for (int i = 0; i < count; i++) {
+        if (started[i]) pthread_join(threads[i], NULL);
+        ok = ok && jobs[i].result == 0;
+        usb_export_manifest_free(&manifests[i]);
+    }
+    *ms = (double)(now_ns() - t0) / 1e6;
+    return ok;
+}
+
+static int bench_multi(int argc, char* argv[]) {
+    int files = BENCH_COPY_FILES;
+    int file_mb = BENCH_COPY_FILE_MB;
+    int count = BENCH_MULTI_TARGETS;
+    const char* base = "/tmp";
+    const char* target = "/dev/shm";
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:s:d:o:")) != -1) {
+        switch (opt) {
+            case 'n': files = atoi(optarg); break;
+            case 's': file_mb = atoi(optarg); break;
+            case 'd': count = atoi(optarg); break;
+            case 'o': base = optarg; break;
+            default: return EXIT_FAILURE;
+        }
+    }
+    if (optind < argc) target = argv[optind];
+    if (files <= 0 || files > 99 || file_mb <= 0 || count < 2 || count > USB_EXPORT_MAX_TARGETS) {
+        fprintf(stderr, "Erro: parâmetros inválidos\n");
+        return EXIT_FAILURE;
+    }
+
+    char src_dir[USB_EXPORT_MAX_PATH];
+    char dirs[USB_EXPORT_MAX_TARGETS][USB_EXPORT_MAX_PATH + 16];
+    snprintf(src_dir, sizeof(src_dir), "%s/usb_export_bench_src", base);
+    for (int i = 0; i < count; i++) {
+        snprintf(dirs[i], sizeof(dirs[i]), "%s/usb_export_bench_dest%d", target, i + 1);
+    }
+    remove_dir(src_dir);
+    if (mkdir(src_dir, 0755) != 0) {
+        perror("mkdir");
+        return EXIT_FAILURE;
+    }
+
+    char path[USB_EXPORT_MAX_PATH + 32];
+    bool ok = true;
+    for (int i = 0; i < files && ok; i++) {
+        snprintf(path, sizeof(path), "%s/NIBENCH_2024%02d.db", src_dir, i + 1);
+        ok = write_synthetic_file(path, (size_t)file_mb * 1024 * 1024, (uint32_t)(i + 1));
+    }
+
+    double seq_best = 0, fan_best = 0;
+    unsigned long long seq_read = 0, fan_read = 0;
+    usb_export_target_t targets[USB_EXPORT_MAX_TARGETS];
+    for (int it = 0; it < BENCH_ITERATIONS && ok; it++) {
+        double ms;
+        ok = reset_targets(dirs, count, false) &&
+             export_sequential(src_dir, dirs, count, files, &ms, &seq_read);
+        if (it == 0 || ms < seq_best) seq_best = ms;
+
+        ok = ok && reset_targets(dirs, count, false) &&
+             export_fanout(src_dir, dirs, count, files, &ms, &fan_read, targets);
+        if (it == 0 || ms < fan_best) fan_best = ms;
+        for (int i = 0; i < count && ok; i++) {
+            ok = verify_copy(src_dir, dirs[i], files) && targets[i].stats.files == files;
+        }
+    }
+
+    // Um pen drive novo junto com outros já exportados: só ele recebe os bancos
+    double mixed_ms = 0;
+    unsigned long long mixed_read = 0;
+    ok = ok && reset_targets(dirs, count, true) &&
+         export_fanout(src_dir, dirs, count, files, &mixed_ms, &mixed_read, targets) &&
+         verify_copy(src_dir, dirs[count - 1], files) && targets[count - 1].stats.files == files;
+    for (int i = 0; i < count - 1 && ok; i++) {
+        ok = targets[i].stats.files == 0 && targets[i].stats.skipped == files;
+    }
+
+    double mb = (double)files * file_mb;
+    printf("\n=== Exportação para %d pen drives: %d arquivos de %d MB (%s -> %s) ===\n",
+           count, files, file_mb, base, target);
+    printf("%-34s %10s %14s %14s\n", "caminho", "ms", "MB lidos", "MB gravados");
+    printf("%-34s %10.1f %14.1f %14.1f\n", "um pen drive por vez", seq_best,
+           seq_read / (1024.0 * 1024.0), mb * count);
+    printf("%-34s %10.1f %14.1f %14.1f\n", "em leque + syncfs em paralelo", fan_best,
+           fan_read / (1024.0 * 1024.0), mb * count);
+    printf("%-34s %10.1f %14.1f %14.1f\n", "em leque, 1 novo + exportados", mixed_ms,
+           mixed_read / (1024.0 * 1024.0), mb);
+    printf("(cache da origem descartado antes de cada passada; melhor de %d execuções)\n", BENCH_ITERATIONS);
+    printf("resultado: %s\n", ok ? "OK" : "FALHOU");
+
+    remove_dir(src_dir);
+    for (int i = 0; i < count; i++) {
+        remove_dir(dirs[i]);
+    }
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * @brief Grava os primeiros bytes de uma partição sintética e confere a identificação
+ */
+static bool probe_synthetic(const char* path, usb_fs_t expected) {
+    unsigned char sb[USB_MOUNT_PROBE_BYTES];
+    memset(sb, 0, sizeof(sb));
+
+    switch (expected) {
+        case USB_FS_VFAT:
+            sb[11] = 0x00; sb[12] = 0x02;    // 512 bytes por setor
+            sb[13] = 8;                      // Setores por cluster
+            sb[16] = 2;                      // Cópias da FAT
+            memcpy(sb + 82, "FAT32   ", 8);
+            sb[510] = 0x55; sb[511] = 0xAA;
+            break;
+        case USB_FS_EXFAT:
+            memcpy(sb + 3, "EXFAT   ", 8);
+            sb[510] = 0x55; sb[511] = 0xAA;
+            break;
+        case USB_FS_NTFS:
+            memcpy(sb + 3, "NTFS    ", 8);
+            sb[510] = 0x55; sb[511] = 0xAA;
+            break;
+        case USB_FS_EXT2:
+        case USB_FS_EXT3:
+        case USB_FS_EXT4:
+            sb[1024 + 56] = 0x53; sb[1024 + 57] = 0xEF;
+            sb[1024 + 96] = 0x02;                                  // filetype
+            if (expected != USB_FS_EXT2) sb[1024 + 92] = 0x04;     // has_journal
+            if (expected == USB_FS_EXT4) sb[1024 + 96] |= 0x40;    // extents
+            break;
+        default:
+            memset(sb, 0xA5, sizeof(sb));
+            break;
+    }
+
+    FILE* f = fopen(path, "wb");
+    bool ok = f && fwrite(sb, 1, sizeof(sb), f) == sizeof(sb);
+    if (f && fclose(f) != 0) ok = false;
+    usb_fs_t found = usb_mount_probe(path);
+    unlink(path);
+    if (!ok || found != expected) {
+        fprintf(stderr, "Erro: %s identificado como %s\n", usb_mount_fs_name(expected),
+                usb_mount_fs_name(found));
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Montagem antiga: tipos em sequência até um mount() dar certo
+ */
+static bool mount_by_trial(const char* device, const char* mount_point, int* attempts) {
+    const char* types[] = {"vfat", "exfat", "ntfs", "ext4", "ext3", "ext2", NULL};
+    *attempts = 0;
+    for (int i = 0; types[i]; i++) {
+        (*attempts)++;
+        if (mount(device, mount_point, types[i], MS_NOATIME, NULL) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static int bench_mount(int argc, char* argv[]) {
+    int iterations = 10;
+    const char* mount_point = "/tmp/usb_export_bench_mnt";
+
+    int opt;
+    while ((opt = getopt(argc, argv, "i:")) != -1) {
+        switch (opt) {
+            case 'i': iterations = atoi(optarg); break;
+            default: return EXIT_FAILURE;
+        }
+    }
+
+    // Identificação em partições sintéticas (não precisa de root)
+    const usb_fs_t kinds[] = {
+        USB_FS_VFAT, USB_FS_EXFAT, USB_FS_NTFS, USB_FS_EXT2, USB_FS_EXT3, USB_FS_EXT4, USB_FS_UNKNOWN
+    };
+    bool ok = true;
+    for (size_t i = 0; i < sizeof(kinds) / sizeof(kinds[0]); i++) {
+        ok = probe_synthetic("/tmp/usb_export_bench_probe.img", kinds[i]) && ok;
+    }
+    printf("\nidentificação por superbloco (vfat, exfat, ntfs, ext2/3/4, desconhecido): %s\n",
+           ok ? "OK" : "FALHOU");
+
+    if (optind >= argc) {
+        printf("(informe uma partição, ex: losetup -f --show imagem.img, para medir a montagem)\n");
+        return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    const char* device = argv[optind];
+    if (optind + 1 < argc) mount_point = argv[optind + 1];
+    if (iterations <= 0 || (mkdir(mount_point, 0755) != 0 && errno != EEXIST)) {
+        fprintf(stderr, "Erro: parâmetros inválidos\n");
+        return EXIT_FAILURE;
+    }
+
+    usb_fs_t known = usb_mount_probe(device);
+    const char* labels[3] = {"tentativas em sequência", "superbloco", "tipo do udev"};
+    double total_ms[3] = {0};
+    int attempts[3] = {0};
+    char driver[32] = "";
+    for (int it = 0; it < iterations && ok; it++) {
+        for (int mode = 0; mode < 3 && ok; mode++) {
+            usb_mount_result_t result;
+            long long t0 = now_ns();
+            if (mode == 0) {
+                ok = mount_by_trial(device, mount_point, &attempts[mode]);
+            } else {
+                ok = usb_mount_device(device, mount_point, mode == 1 ? USB_FS_UNKNOWN : known, &result) == 0;
+                attempts[mode] = result.attempts;
+                snprintf(driver, sizeof(driver), "%s", result.driver);
+            }
+            total_ms[mode] += (double)(now_ns() - t0) / 1e6;
+            if (ok && umount(mount_point) != 0) {
+                perror("umount");
+                ok = false;
+            }
+        }
+    }
+    rmdir(mount_point);
+
+    printf("\n=== Montagem de %s (%s, driver %s), média de %d ===\n", device,
+           usb_mount_fs_name(known), driver, iterations);
+    printf("%-26s %10s %10s\n", "identificação", "ms", "mount()");
+    for (int mode = 0; mode < 3; mode++) {
+        printf("%-26s %10.2f %10d\n", labels[mode], total_ms[mode] / iterations, attempts[mode]);
+    }
+    printf("resultado: %s\n", ok ? "OK" : "FALHOU");
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * @brief Consulta antiga: percorre /proc/mounts procurando o dispositivo
+ */
+static bool mounted_by_scan(const char* device) {
+    FILE* fp = fopen("/proc/mounts", "r");
+    if (!fp) {
+        return false;
+    }
+    bool found = false;
+    struct mntent* entry;
+    while (!found && (entry = getmntent(fp)) != NULL) {
+        found = strcmp(entry->mnt_fsname, device) == 0;
+    }
+    fclose(fp);
+    return found;
+}
+
+static int bench_mounttab(int argc, char* argv[]) {
+    int lookups = 10000;
+    const char* mount_point = "/tmp/usb_export_bench_mnt";
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:")) != -1) {
+        switch (opt) {
+            case 'n': lookups = atoi(optarg); break;
+            default: return EXIT_FAILURE;
+        }
+    }
+    if (optind < argc) mount_point = argv[optind];
+    if (lookups <= 0) {
+        fprintf(stderr, "Erro: parâmetros inválidos\n");
+        return EXIT_FAILURE;
+    }
+
+    // Partições candidatas de uma enumeração (/dev/sda1 ... /dev/sdh1)
+    char devices[8][16];
+    for (int i = 0; i < 8; i++) {
+        snprintf(devices[i], sizeof(devices[i]), "/dev/sd%c1", 'a' + i);
+    }
+
+    usb_mount_entry_t entries[256];
+    int entry_count = usb_mount_table_entries(entries, 256);
+    unsigned long refreshes = usb_mount_table_refreshes();
+
+    int found[2] = {0};
+    double ms[2];
+    long long t0 = now_ns();
+    for (int i = 0; i < lookups; i++) {
+        found[0] += mounted_by_scan(devices[i % 8]);
+    }
+    ms[0] = (double)(now_ns() - t0) / 1e6;
+    t0 = now_ns();
+    for (int i = 0; i < lookups; i++) {
+        found[1] += usb_mount_table_find_device(devices[i % 8], NULL);
+    }
+    ms[1] = (double)(now_ns() - t0) / 1e6;
+    unsigned long steady = usb_mount_table_refreshes() - refreshes;
+    bool ok = entry_count > 0 && found[0] == found[1];
+
+    printf("\n=== Tabela de montagens (%d entradas), %d consultas ===\n", entry_count, lookups);
+    printf("%-26s %10s %10s %12s\n", "consulta", "ms", "us/cons.", "releituras");
+    printf("%-26s %10.2f %10.3f %12d\n", "/proc/mounts a cada vez", ms[0], ms[0] * 1000 / lookups, lookups);
+    printf("%-26s %10.2f %10.3f %12lu\n", "cache + poll()", ms[1], ms[1] * 1000 / lookups, steady);
+
+    // Montagem e desmontagem: uma releitura cada, percebidas na consulta seguinte
+    if (geteuid() != 0) {
+        printf("(execute como root para conferir a notificação de montagens)\n");
+    } else if (mkdir(mount_point, 0755) != 0 && errno != EEXIST) {
+        perror("mkdir");
+        ok = false;
+    } else {
+        refreshes = usb_mount_table_refreshes();
+        bool seen = false;
+        bool gone = false;
+        if (mount("usb_export_bench", mount_point, "tmpfs", 0, "size=1m") == 0) {
+            usb_mount_entry_t entry;
+            seen = usb_mount_table_find_mount_point(mount_point, &entry) &&
+                   strcmp(entry.fs_type, "tmpfs") == 0;
+            umount(mount_point);
+            gone = !usb_mount_table_find_mount_point(mount_point, NULL);
+        } else {
+            perror("mount");
+        }
+        rmdir(mount_point);
+        unsigned long changes = usb_mount_table_refreshes() - refreshes;
+        printf("notificação: montagem %s, desmontagem %s, %lu releituras\n",
+               seen ? "vista" : "NÃO vista", gone ? "vista" : "NÃO vista", changes);
+        ok = ok && seen && gone;
+    }
+
+    usb_mount_table_cleanup();
+    printf("resultado: %s\n", ok ? "OK" : "FALHOU");
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * @brief Conta os arquivos nome.part no destino
+ */
+static int count_parts(const char* dir_path) {
+    DIR* dir = opendir(dir_path);
+    if (!dir) {
+        return -1;
+    }
+    int parts = 0;
+    size_t suffix_len = strlen(USB_EXPORT_PART_SUFFIX);
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        size_t len = strlen(entry->d_name);
+        parts += len > suffix_len && strcmp(entry->d_name + len - suffix_len, USB_EXPORT_PART_SUFFIX) == 0;
+    }
+    closedir(dir);
+    return parts;
+}
+
+static int bench_resume(int argc, char* argv[]) {
+    int files = 4;
+    int file_mb = 64;
+    const char* base = "/tmp";
+    const char* mount_point = "/tmp/usb_export_bench_stick";
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:s:o:")) != -1) {
+        switch (opt) {
+            case 'n': files = atoi(optarg); break;
+            case 's': file_mb = atoi(optarg); break;
+            case 'o': base = optarg; break;
+            default: return EXIT_FAILURE;
+        }
+    }
+    if (optind < argc) mount_point = argv[optind];
+    if (files < 2 || files > 99 || file_mb <= 0 ||
+        (unsigned long long)file_mb * 1024 * 1024 < 2 * USB_EXPORT_CHECKPOINT_BYTES) {
+        fprintf(stderr, "Erro: parâmetros inválidos (bancos de ao menos dois pontos de controle)\n");
+        return EXIT_FAILURE;
+    }
+    if (geteuid() != 0) {
+        fprintf(stderr, "Erro: o comando resume monta um tmpfs e requer root\n");
+        return EXIT_FAILURE;
+    }
+
+    char src_dir[USB_EXPORT_MAX_PATH];
+    snprintf(src_dir, sizeof(src_dir), "%s/usb_export_bench_src", base);
+    remove_dir(src_dir);
+    if (mkdir(src_dir, 0755) != 0 || (mkdir(mount_point, 0755) != 0 && errno != EEXIST)) {
+        perror("mkdir");
+        return EXIT_FAILURE;
+    }
+
+    char path[USB_EXPORT_MAX_PATH + 32];
+    bool ok = true;
+    for (int i = 0; i < files && ok; i++) {
+        snprintf(path, sizeof(path), "%s/NIBENCH_2024%02d.db", src_dir, i + 1);
+        ok = write_synthetic_file(path, (size_t)file_mb * 1024 * 1024, (uint32_t)(i + 1));
+    }
+
+    // Cabe o primeiro banco e três quartos do segundo: a cópia para no meio dele
+    char options[64];
+    unsigned long long total = (unsigned long long)files * file_mb * 1024 * 1024;
+    snprintf(options, sizeof(options), "size=%dm", file_mb + file_mb * 3 / 4);
+    if (ok && mount("usb_export_bench", mount_point, "tmpfs", 0, options) != 0) {
+        perror("mount");
+        ok = false;
+    }
+    bool mounted = ok;
+
+    usb_export_manifest_t manifest;
+    usb_export_stats_t stats[2];
+    double ms[2] = {0};
+    int results[2] = {0};
+    memset(stats, 0, sizeof(stats));
+    memset(&manifest, 0, sizeof(manifest));
+    if (ok) {
+        long long t0 = now_ns();
+        results[0] = usb_export_copy_dir(src_dir, mount_point, USB_EXPORT_DB_PREFIX, USB_EXPORT_DB_SUFFIX,
+                                         NULL, &manifest, NULL, NULL, &stats[0]);
+        ms[0] = (double)(now_ns() - t0) / 1e6;
+    }
+    int parts_left = mounted ? count_parts(mount_point) : -1;
+
+    // Reinserção: só o que os pontos de controle gravaram no pen drive é conhecido
+    snprintf(options, sizeof(options), "size=%dm", files * file_mb + file_mb);
+    if (ok && mount("usb_export_bench", mount_point, "tmpfs", MS_REMOUNT, options) != 0) {
+        perror("mount -o remount");
+        ok = false;
+    }
+    bool loaded = false;
+    if (ok) {
+        loaded = usb_export_manifest_load(mount_point, &manifest);
+        long long t0 = now_ns();
+        results[1] = usb_export_copy_dir(src_dir, mount_point, USB_EXPORT_DB_PREFIX, USB_EXPORT_DB_SUFFIX,
+                                         NULL, &manifest, NULL, NULL, &stats[1]);
+        usb_export_manifest_prune(&manifest, mount_point, USB_EXPORT_DB_PREFIX, USB_EXPORT_DB_SUFFIX, NULL);
+        ok = usb_export_manifest_save(mount_point, &manifest) == 0 &&
+             usb_export_sync(mount_point) == 0;
+        ms[1] = (double)(now_ns() - t0) / 1e6;
+    }
+
+    int parts_end = mounted ? count_parts(mount_point) : -1;
+    ok = ok && results[0] != 0 && results[1] == 0 && loaded && stats[1].resumed == 1 &&
+         stats[1].skipped == 1 && parts_left == 1 && parts_end == 0 &&
+         verify_copy(src_dir, mount_point, files);
+
+    // Sem retomada, o banco interrompido seria gravado de novo desde o início
+    unsigned long long written = stats[0].bytes + stats[1].bytes;
+    printf("\n=== Exportação interrompida e retomada: %d bancos de %d MB (%s -> %s) ===\n",
+           files, file_mb, base, mount_point);
+    printf("%-22s %10s %10s %12s %12s %12s %10s\n", "exportação", "ms", "gravados",
+           "MB gravados", "MB retomados", "MB pulados", "controles");
+    const char* labels[2] = {"até encher o destino", "após a reinserção"};
+    for (int i = 0; i < 2; i++) {
+        printf("%-22s %10.1f %10d %12.1f %12.1f %12.1f %10d\n", labels[i], ms[i], stats[i].files,
+               stats[i].bytes / (1024.0 * 1024.0), stats[i].resumed_bytes / (1024.0 * 1024.0),
+               stats[i].skipped_bytes / (1024.0 * 1024.0), stats[i].checkpoints);
+    }
+    printf("gravado no total: %.1f MB para %.1f MB de bancos (sem retomada: %.1f MB)\n",
+           written / (1024.0 * 1024.0), total / (1024.0 * 1024.0),
+           (written + stats[1].resumed_bytes) / (1024.0 * 1024.0));
+    printf(".part no destino: %d após a interrupção, %d no fim\n", parts_left, parts_end);
+    printf("resultado: %s\n", ok ? "OK" : "FALHOU");
+
+    if (mounted) {
+        umount(mount_point);
+    }
+    rmdir(mount_point);
+    remove_dir(src_dir);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static void print_usage(const char* prog) {
+    fprintf(stderr, "Uso: %s <comando> [argumentos]\n", prog);
+    fprintf(stderr, "  copy [-n arquivos] [-s MB] [-o origem] [destino]  find -exec cp x cópia no processo\n");
+    fprintf(stderr, "  incremental [-n meses] [-s MB] [-o origem] [destino]  Exportação com manifesto: bytes pulados\n");
+    fprintf(stderr, "  verify [-n arquivos] [-s MB] [-o origem] [destino]  CRC durante a cópia e releitura do destino\n");
+    fprintf(stderr, "  mount [-i iterações] <partição> [ponto]  Tentativas x superbloco x udev na montagem\n");
+    fprintf(stderr, "  multi [-n arquivos] [-s MB] [-d destinos] [-o origem] [destino]  Vários pen drives: um por vez x em leque\n");
+    fprintf(stderr, "  mounttab [-n consultas] [ponto]  /proc/mounts a cada consulta x cache da tabela\n");
+    fprintf(stderr, "  resume [-n arquivos] [-s MB] [-o origem] [ponto]  Exportação interrompida retomada do ponto de controle\n");
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const char* command = argv[1];
+    if (strcmp(command, "copy") == 0) {
+        return bench_copy(argc - 1, argv + 1);
+    }
+    if (strcmp(command, "verify") == 0) {
+        return bench_verify(argc - 1, argv + 1);
+    }
+    if (strcmp(command, "incremental") == 0) {
+        return bench_incremental(argc - 1, argv + 1);
+    }
+    if (strcmp(command, "multi") == 0) {
+        return bench_multi(argc - 1, argv + 1);
+    }
+    if (strcmp(command, "mount") == 0) {
+        return bench_mount(argc - 1, argv + 1);
+    }
+    if (strcmp(command, "mounttab") == 0) {
+        return bench_mounttab(argc - 1, argv + 1);
+    }
+    if (strcmp(command, "resume") == 0) {
+        return bench_resume(argc - 1, argv + 1);
+    }
+
+    print_usage(argv[0]);
+    return EXIT_FAILURE;
+}